@@ -2,202 +2,189 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <random>
 #define _USE_MATH_DEFINES
 #include <math.h>
+#if defined(_WIN32)
 #include <Windows.h>
+#endif
 
-struct vertex { double x; double y; };
-struct velocity { double x; double y; };
-struct triangle { vertex aA; vertex bB; vertex cC; vertex zZ; };
-void compensator(struct vertex* ver, vertex ref, double og);
+#include "checkpoint.h"
+#include "commands.h"
+#include "glrender.h"
+#include "handoff.h"
+#include "profile.h"
+#include "scene.h"
+#include "sim.h"
+#include "simthread.h"
 
-/// <summary>
-/// Creates a triangle struct object representing an equilateral triangle from a center point and side length
-/// </summary>
-/// <param name="center">center point</param>
-/// <param name="len">side length</param>
-/// <returns>an equilateral triangle struct object</returns>
-triangle makeEquiTri(struct vertex* center, double len) {
-    triangle myEqui;
-    myEqui.zZ = *center;
-    myEqui.aA = { center->x - len / 2, center->y - len * sqrt(3) / 6 };
-    myEqui.bB = { center->x + len / 2, center->y - len * sqrt(3) / 6 };
-    myEqui.cC = { center->x, center->y + len * sqrt(3) / 3 };
-    return myEqui;
-}
+#if defined(__linux__)
+#define GLFW_EXPOSE_NATIVE_X11
+#define GLFW_EXPOSE_NATIVE_GLX
+#include <GLFW/glfw3native.h>
+#ifndef GLX_BACK_BUFFER_AGE_EXT
+#define GLX_BACK_BUFFER_AGE_EXT 0x20F4
+#endif
+#endif
 
-/// <summary>
-/// Performs rotation on a point around the origin (at the center of the window)
-/// </summary>
-/// <param name="phi">rotation angle</param>
-/// <param name="ver">pointer to the point to be rotated</param>
-void rotation(double phi, struct vertex* ver, vertex* ref) {
-    double side = (pow(ver->x - ref->x, 2) + pow(ver->y - ref->y, 2));
-    ver->x = ref->x + (ver->x - ref->x) * cos(phi) - (ver->y - ref->y) * sin(phi);
-    ver->y = ref->y + (ver->x - ref->x) * sin(phi) + (ver->y - ref->y) * cos(phi);
-    compensator(ver, *ref, side);
-}
+/* a held key repeats its command at this interval of simulation time, independent of the frame rate */
+static const double keyRepeat = 0.5;
 
 /// <summary>
-/// Eliviates inaccuracies due to rounding errors that accumulate after rounds
+/// Keyboard state of the viewer, shared with the GLFW key callback through the window user pointer.
+/// A key press queues its command at once, stamped with the simulation time; while the key stays down,
+/// keyRepeats queues it again every keyRepeat seconds of simulation time.
 /// </summary>
-/// <param name="ver">the vertex to be adjusted</param>
-/// <param name="ref">reference vertex</param>
-/// <param name="og">original distance</param>
-void compensator(struct vertex* ver, vertex ref, double og) {
-    double magnif = (pow(ver->x - ref.x, 2) + pow(ver->y - ref.y, 2)) / og;
-    if (magnif < 0.99999 || magnif > 1.00001) {
-        ver->x = ref.x + (ver->x - ref.x) / sqrt(magnif);
-        ver->y = ref.y + (ver->y - ref.y) / sqrt(magnif);
-    }
-}
+struct viewerInput {
+    commandRing* commands;
+    const simThread* physics;
+    double side, omega, iniLen, omega0;
+    bool held[4] = { false, false, false, false };
+    double nextRepeat[4] = { 0, 0, 0, 0 };
+};
 
 /// <summary>
-/// Rotate a whole equilateral triangle struct object 
+/// Queues the command of a key, unless the limit of size or rotation speed is reached
 /// </summary>
-/// <param name="tria">the equilateral triangle to be rotated</param>
-/// <param name="phi">rotation angle</param>
-void triRotate(struct triangle* tria, double phi) {
-    vertex* pA = &tria->aA, * pB = &tria->bB, * pC = &tria->cC, * pZ = &tria->zZ;
-    rotation(phi, pA, pZ);
-    rotation(phi, pB, pZ);
-    rotation(phi, pC, pZ);
-    //delete pA, pB,pC,pZ;
+/// <param name="in">the keyboard state</param>
+/// <param name="key">0 right, 1 left, 2 up, 3 down</param>
+/// <param name="time">simulation time of the command</param>
+static void keyCommand(struct viewerInput* in, int key, double time) {
+    simCommand cmd = { key < 2 ? CMD_RESIZE : CMD_SPIN, 0, time };
+    if (key == 0 && in->side < 5 * in->iniLen)
+        cmd.value = 1.1;
+    else if (key == 1 && in->side > 0.5 * in->iniLen)
+        cmd.value = 0.9;
+    else if (key == 2 && fabs(in->omega) < 4 * M_PI)
+        cmd.value = in->omega0;
+    else if (key == 3 && fabs(in->omega) > 0.2 * M_PI)
+        cmd.value = -in->omega0;
+    if (cmd.value != 0)
+        commandPush(in->commands, cmd);
 }
 
 /// <summary>
-/// Resize the given triangle with a given ratio
+/// Number of frames since the back buffer of the window last held a frame, as GLX_EXT_buffer_age reports it.
+/// A double buffered window usually reports 2, but a compositor or driver may hand out a fresh buffer.
 /// </summary>
-/// <param name="tria">the triangle to be resized</param>
-/// <param name="coeff">resize ratio</param>
-void triResize(struct triangle* tria, double coeff) {
-    tria->aA.x = tria->zZ.x + (tria->aA.x - tria->zZ.x) * coeff;
-    tria->bB.x = tria->zZ.x + (tria->bB.x - tria->zZ.x) * coeff;
-    tria->cC.x = tria->zZ.x + (tria->cC.x - tria->zZ.x) * coeff;
-    tria->aA.y = tria->zZ.y + (tria->aA.y - tria->zZ.y) * coeff;
-    tria->bB.y = tria->zZ.y + (tria->bB.y - tria->zZ.y) * coeff;
-    tria->cC.y = tria->zZ.y + (tria->cC.y - tria->zZ.y) * coeff;
-}
-
-/// <summary>
-/// Move the given triangle away some distance
-/// </summary>
-/// <param name="tria">the triangle to be moved</param>
-/// <param name="velo">move distance</param>
-void triTranslate(struct triangle* tria, struct velocity velo) {
-    tria->aA.x = tria->aA.x + velo.x;
-    tria->bB.x = tria->bB.x + velo.x;
-    tria->cC.x = tria->cC.x + velo.x;
-    tria->zZ.x = tria->zZ.x + velo.x;
-    tria->aA.y = tria->aA.y + velo.y;
-    tria->bB.y = tria->bB.y + velo.y;
-    tria->cC.y = tria->cC.y + velo.y;
-    tria->zZ.y = tria->zZ.y + velo.y;
+/// <param name="window">the window, its context current</param>
+/// <returns>the age, 0 if the contents are undefined or the window system can not tell</returns>
+static int backBufferAge(GLFWwindow* window) {
+#if defined(__linux__)
+    Display* display = glfwGetX11Display();
+    const GLXWindow drawable = display ? glfwGetGLXWindow(window) : 0;
+    if (!drawable)
+        return 0;
+    static const bool supported = [display] {
+        const char* ext = glXQueryExtensionsString(display, DefaultScreen(display));
+        return ext && strstr(ext, "GLX_EXT_buffer_age") != nullptr;
+    }();
+    unsigned int age = 0;
+    if (supported)
+        glXQueryDrawable(display, drawable, GLX_BACK_BUFFER_AGE_EXT, &age);
+    return (int)age;
+#else
+    (void)window;
+    return 0;
+#endif
 }
 
-/// <summary>
-/// A help function to translate the triangle in special cases when the triangle hits window borders
-/// </summary>
-/// <param name="tria">the triangle struct object</param>
-/// <param name="dist">relocation parameter</param>
-/// <param name="yRicht">true if the triangle hits the upper/lower boundaries, false it if hits left/right boundaries</param>
-void triReflect(struct triangle* tria, double dist, bool yRicht) {
-    if (yRicht) {
-        tria->aA.y = tria->aA.y * dist;
-        tria->bB.y = tria->bB.y * dist;
-        tria->cC.y = tria->cC.y * dist;
-        tria->zZ.y = tria->zZ.y * dist;
-    }
-    else {
-        tria->aA.x = tria->aA.x * dist;
-        tria->bB.x = tria->bB.x * dist;
-        tria->cC.x = tria->cC.x * dist;
-        tria->zZ.x = tria->zZ.x * dist;
+static void onKey(GLFWwindow* window, int key, int, int action, int) {
+    viewerInput* in = (viewerInput*)glfwGetWindowUserPointer(window);
+    const int k = key == GLFW_KEY_RIGHT ? 0 : key == GLFW_KEY_LEFT ? 1 : key == GLFW_KEY_UP ? 2 : key == GLFW_KEY_DOWN ? 3 : -1;
+    if (k < 0 || action == GLFW_REPEAT)
+        return;
+    in->held[k] = action == GLFW_PRESS;
+    if (in->held[k]) {
+        const double now = simThreadTime(*in->physics);
+        keyCommand(in, k, now);
+        in->nextRepeat[k] = now + keyRepeat;
     }
 }
 
 /// <summary>
-/// Handles the cases when the triangle collides with window borders
+/// Queues the repeats of held keys that are due, each stamped with the time it was due at
 /// </summary>
-/// <param name="tria">the triangle object</param>
-/// <param name="velo">the triangle's translational velocity</param>
-/// <param name="breite">horizontal dimension of the window</param>
-/// <param name="hoehe">vertical dimension of the window</param>
-/// <param name="omega">the triangle's angular velocity</param>
-/// <returns>true if the triangle is in collision with border, false if otherwise</returns>
-bool triCollision(struct triangle* tria, velocity* velo, double breite, double hoehe,
-    double* omega) {
-    vertex* pA = &tria->aA, * pB = &tria->bB, * pC = &tria->cC, * pZ = &tria->zZ;
-    if (pA->y <= -hoehe || pA->y >= hoehe) {
-        double alpha = atan((pA->y - pZ->y) / (pA->x - pZ->x));
-        velo->y = -velo->y;
-        while (pA->y <= -hoehe || pA->y >= hoehe) 
-            triReflect(tria, 0.99, true);
-        *omega = -*omega;
-        return true;
-    }
-    if (pB->y <= -hoehe || pB->y >= hoehe) {
-        double alpha = atan((pB->y - pZ->y) / (pB->x - pZ->x));
-        velo->y = -velo->y;
-        while (pB->y <= -hoehe || pB->y >= hoehe) 
-            triReflect(tria, 0.99, true);
-        *omega = -*omega; return true;
-    }
-    if (pC->y <= -hoehe || pC->y >= hoehe) {
-        double alpha = atan((pC->y - pZ->y) / (pC->x - pZ->x));
-        velo->y = -velo->y;
-        while (pC->y <= -hoehe || pC->y >= hoehe) 
-            triReflect(tria, 0.99, true);
-        *omega = -*omega; return true;
-    }
-    if (pA->x <= -breite || pA->x >= breite) {
-        velo->x = -velo->x;
-        while (pA->x <= -breite || pA->x >= breite) 
-            triReflect(tria, 0.99, false);
-        *omega = -*omega;
-        return true;
-    }
-    if (pB->x <= -breite || pB->x >= breite) {
-        velo->x = -velo->x;
-        while (pB->x <= -breite || pB->x >= breite) 
-            triReflect(tria, 0.99, false);
-        *omega = -*omega; return true;
-    }
-    if (pC->x <= -breite || pC->x >= breite) {
-        velo->x = -velo->x;
-        while (pC->x <= -breite || pC->x >= breite) 
-            triReflect(tria, 0.99, false);
-        *omega = -*omega; return true;
-    }
-    return false;
+/// <param name="in">the keyboard state</param>
+/// <param name="now">simulation time</param>
+static void keyRepeats(struct viewerInput* in, double now) {
+    for (int k = 0; k < 4; k++)
+        for (; in->held[k] && in->nextRepeat[k] <= now; in->nextRepeat[k] += keyRepeat)
+            keyCommand(in, k, in->nextRepeat[k]);
 }
 
 /// <summary>
 /// main operational function. An equilateral triangle object is created.
-/// A running loop will update the triangle's position and orientation 
-/// and handle inputs to increase or decrease triangle's size as well as rotational velocity.
+/// The physics runs on its own thread; the render loop draws the latest snapshot, interpolated to the
+/// frame time, and sends inputs to increase or decrease triangle's size as well as rotational velocity.
+/// --seed N fixes the initial velocity, which otherwise comes from the clock; --record FILE writes
+/// a trace of the run that sim_bench --replay FILE runs again bit for bit. --script FILE plays the
+/// commands of a command script in addition to the keys. In a build with SIM_PROFILE,
+/// --profile FILE and --chrome FILE write the stage timings at exit as JSON histograms and Chrome trace.
+/// --integrator euler|verlet|rk4 and --gravity PX/S^2 select the integrator and a downward pull.
+/// --redraw dirty clears and draws only the regions that changed, on a window system that reports the age of
+/// the back buffer; elsewhere, and with --redraw full, the default, the whole window is drawn every frame.
+/// --restore FILE continues the scene of a checkpoint instead of starting a new one, --checkpoint FILE
+/// writes the scene into a checkpoint at exit.
 /// </summary>
-/// <param name=""></param>
+/// <param name="argc">number of arguments</param>
+/// <param name="argv">[--seed N] [--record FILE] [--script FILE] [--profile FILE] [--chrome FILE]
+/// [--integrator euler|verlet|rk4] [--gravity G] [--redraw full|dirty] [--restore FILE] [--checkpoint FILE]</param>
 /// <returns>0</returns>
-int main(void)
+int main(int argc, char** argv)
 {
-    MessageBox(0, "RIGHT to grow triangle \n LEFT to shrink triangle \n UP to speed up rotation\n DOWN to reduce rotation speed ", "How to use", MB_OK);
+    unsigned seed = (unsigned)time(0);
+    const char* recordPath = nullptr, * scriptPath = nullptr, * profilePath = nullptr, * chromePath = nullptr;
+    const char* restorePath = nullptr, * checkpointPath = nullptr;
+    integratorConfig motion;
+    bool dirty = false;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--seed"))
+            seed = (unsigned)strtoul(argv[i + 1], nullptr, 10);
+        else if (!strcmp(argv[i], "--record"))
+            recordPath = argv[i + 1];
+        else if (!strcmp(argv[i], "--script"))
+            scriptPath = argv[i + 1];
+        else if (!strcmp(argv[i], "--profile"))
+            profilePath = argv[i + 1];
+        else if (!strcmp(argv[i], "--chrome"))
+            chromePath = argv[i + 1];
+        else if (!strcmp(argv[i], "--integrator"))
+            motion.kind = !strcmp(argv[i + 1], "rk4") ? INTEGRATE_RK4 : !strcmp(argv[i + 1], "verlet") ? INTEGRATE_VERLET
+                : INTEGRATE_EULER;
+        else if (!strcmp(argv[i], "--gravity"))
+            motion.gravityY = -strtod(argv[i + 1], nullptr);
+        else if (!strcmp(argv[i], "--restore"))
+            restorePath = argv[i + 1];
+        else if (!strcmp(argv[i], "--checkpoint"))
+            checkpointPath = argv[i + 1];
+        else if (!strcmp(argv[i], "--redraw"))
+            dirty = !strcmp(argv[i + 1], "dirty");
+    }
+    std::cout << "seed " << seed << std::endl;
+
+    const char* help = "RIGHT to grow triangle \n LEFT to shrink triangle \n UP to speed up rotation\n DOWN to reduce rotation speed ";
+#if defined(_WIN32)
+    MessageBox(0, help, "How to use", MB_OK);
+#else
+    std::cout << "How to use:\n " << help << std::endl;
+#endif
     GLFWwindow* window;
 
     /* Initialize the library */
     if (!glfwInit())
         return -1;
 
-    int count = 0;
-    double omega = M_PI, omega0 = omega / 3;  double* angularV = &omega;
+    double omega0 = M_PI / 3;
 
     std::cout << glfwGetVersionString() << std::endl;
     
 
     /* Create a windowed mode window and its OpenGL context */
     const double breite = 1280, hoehe = 720;
-    double magniB = 100 / breite, magniH = 100 / hoehe;
     window = glfwCreateWindow((int)breite, (int)hoehe, "My Canvas", NULL, NULL);
     if (!window)
     {
@@ -208,72 +195,133 @@ int main(void)
 
     vertex center;    center.x = 0.0; center.y = 0.0;
     std::uniform_real_distribution<double> unif(1, 2);
-    std::default_random_engine re(time(0));
-    long double velX = 150 * unif(re);    long double* velXP = &velX;
-    long double velY = 150 * unif(re);     long double* velYP = &velY;
-    velocity velo = { velX, velY }; velocity* velP = &velo;
+    std::default_random_engine re(seed);
 
-    vertex* vp1, * vp2, * vp3, * vpc;
-    vpc = &center;
+    /* The physics runs on its own thread at a fixed 120 Hz step, decoupled from the frame rate */
+    sceneConfig cfg;
+    cfg.response = RESPONSE_REFLECT;
+    cfg.boundary = BOUNDARY_SWEPT;
+    cfg.integrator = motion;
+    scene sim = makeScene(breite, hoehe, 1.0 / 120, cfg);
     double iniLen = 100;
-    triangle myEqui = makeEquiTri(vpc, iniLen); triangle* equiP = &myEqui;
+    soaPush(&sim.bodies, makeBody(center, iniLen, 0, { 150 * unif(re), 150 * unif(re) }, M_PI));
+    if (restorePath) {
+        checkpointView view;
+        if (checkpointMap(restorePath, &view)) {
+            checkpointRestore(view, &sim);
+            checkpointUnmap(&view);
+        }
+        else
+            std::cout << "can not restore " << restorePath << std::endl;
+    }
+    tripleBuffer snapshots;
+    bufferInit(&snapshots, sim.bodies.count);
+    commandRing commands;
+    simThread physics;
+    commandScript script;
+    if (scriptPath && !scriptLoad(scriptPath, &script))
+        std::cout << "can not read script " << scriptPath << std::endl;
+    traceWriter trace;
+    if (recordPath) {
+        if (traceOpen(&trace, recordPath, &sim))
+            physics.trace = &trace;
+        else
+            std::cout << "can not record to " << recordPath << std::endl;
+    }
 
     /* Make the window's context current */
     glfwMakeContextCurrent(window);
 
-    if (glewInit != GLEW_OK)
+    if (glewInit() != GLEW_OK)
         std::cout << "ERR" << std::endl;
-    //glBegin(GL_TRIANGLES);
+    glRenderer renderer;
+    if (!rendererInit(&renderer, sim.bodies.count))
+        std::cout << "ERR" << std::endl;
+    renderer.partial = dirty;
+
+    viewerInput input = { &commands, &physics, iniLen, 0, iniLen, omega0 };
+    glfwSetWindowUserPointer(window, &input);
+    glfwSetKeyCallback(window, onKey);
 
-    double prevTime = 0;
+    simThreadStart(&physics, &sim, &snapshots, &commands);
+    long long frames = 0, lastSteps = 0;
+    uint64_t lastTouched = 0, lastPixels = 0;
+    double lastReport = 0;
 
     /* Loop until the user closes the window */
     while (!glfwWindowShouldClose(window))
     {
-        /* Render here */
-        glClear(GL_COLOR_BUFFER_BIT);
-        double side = sqrt(pow(myEqui.aA.x - myEqui.bB.x, 2) + pow(myEqui.aA.y - myEqui.bB.y, 2));
-
-        glBegin(GL_TRIANGLES);
-        glVertex2d(myEqui.aA.x / breite, myEqui.aA.y / hoehe);
-        glVertex2d(myEqui.bB.x / breite, myEqui.bB.y / hoehe);
-        glVertex2d(myEqui.cC.x / breite, myEqui.cC.y / hoehe);
-        glEnd();
-
-        double currTime = glfwGetTime();
-
-        triRotate(equiP, omega * (currTime - prevTime));  
-
-        currTime = glfwGetTime();
-        velocity dist = { velo.x * (currTime - prevTime), velo.y * (currTime - prevTime) };
-
-        if (!triCollision(equiP, velP, breite, hoehe, angularV))
-            triTranslate(equiP, dist);
+        PROFILE_SCOPE(STAGE_FRAME);
+        /* Render here, one physics step behind so there is always a pose to interpolate towards */
+        double now = simThreadTime(physics);
+        const snapshot* snap = bufferRead(&snapshots, nullptr);
+        double alpha = snapshotAlpha(*snap, now - sim.dt);
+        {
+            PROFILE_SCOPE(STAGE_DRAW);
+            /* the swap chain decides which buffer comes back, so its age is asked for every frame */
+            renderer.bufferAge = dirty ? backBufferAge(window) : 0;
+            rendererDraw(&renderer, *snap, alpha, sim.breite, sim.hoehe);
+        }
 
-        int stateR = glfwGetKey(window, GLFW_KEY_RIGHT), stateL = glfwGetKey(window, GLFW_KEY_LEFT);
-        int stateU = glfwGetKey(window, GLFW_KEY_UP), stateD = glfwGetKey(window, GLFW_KEY_DOWN);
-        if (stateR == GLFW_PRESS && side < 5 * iniLen && count % 100 == 0) {
-            triResize(equiP, 1.1);
+        /* render and physics rates, measured separately, and the share of pixels redrawn, once per second in the title */
+        frames++;
+        if (now - lastReport >= 1) {
+            long long steps = physics.steps.load();
+            const uint64_t pixels = renderer.pixelsTotal - lastPixels;
+            const double redrawn = pixels ? (double)(renderer.touchedTotal - lastTouched) / (double)pixels : 0.0;
+            char title[128];
+            snprintf(title, sizeof(title), "My Canvas - render %.0f fps, physics %.0f Hz, %.1f %% redrawn",
+                frames / (now - lastReport), (steps - lastSteps) / (now - lastReport), 100 * redrawn);
+            glfwSetWindowTitle(window, title);
+            frames = 0;
+            lastSteps = steps;
+            lastTouched = renderer.touchedTotal;
+            lastPixels = renderer.pixelsTotal;
+            lastReport = now;
         }
-        if (stateL == GLFW_PRESS && side > 0.5 * iniLen && count % 100 == 0) {
-            triResize(equiP, 0.9);
+
+        {
+            PROFILE_SCOPE(STAGE_INPUT);
+            input.side = snap->count ? snap->len[0] : iniLen;
+            input.omega = snap->count ? snap->omega[0] : 0;
+            keyRepeats(&input, now);
+            scriptFeed(&script, &commands);
         }
-        if (stateU == GLFW_PRESS && abs(omega) < 4 * M_PI && count % 100 == 0)
-            omega = (omega >= 0) ? omega + omega0 : omega - omega0;
-        if (stateD == GLFW_PRESS && abs(omega) > 0.2 * M_PI && count % 100 == 0)
-            omega = (omega >= 0) ? omega - omega0 : omega + omega0;
 
         /* Swap front and back buffers */
-        glfwSwapBuffers(window);
+        {
+            PROFILE_SCOPE(STAGE_SWAP);
+            glfwSwapBuffers(window);
+        }
 
         /* Poll for and process events */
-        glfwPollEvents();
-        prevTime = currTime;
-        if (count >= 100)
-            count = 0;
-        count++;
+        {
+            PROFILE_SCOPE(STAGE_INPUT);
+            glfwPollEvents();
+        }
     }
 
+    simThreadStop(&physics);
+    if (physics.traceStopped >= 0)
+        std::cout << "recording to " << recordPath << " stopped at step " << physics.traceStopped
+            << ", the file could not be extended" << std::endl;
+    if (physics.trace && !traceClose(&trace))
+        std::cout << "trace " << recordPath << " is incomplete" << std::endl;
+    if (checkpointPath && !checkpointWrite(checkpointPath, &sim))
+        std::cout << "can not write " << checkpointPath << std::endl;
+    if (profilePath) {
+        if (FILE* f = fopen(profilePath, "w")) {
+            profileWriteJson(f);
+            fclose(f);
+        }
+    }
+    if (chromePath) {
+        if (FILE* f = fopen(chromePath, "w")) {
+            profileWriteChromeTrace(f);
+            fclose(f);
+        }
+    }
+    rendererDestroy(&renderer);
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
@@ -99,7 +99,6 @@ bool triCollision(struct triangle* tria, velocity* velo, double breite, double h
     double len = sqrt(pow(pA->x - pZ->x, 2) + pow(pA->y - pZ->y, 2));
     double coVel = 0.9, coAn = 0.5;
     if (pA->y <= -hoehe || pA->y >= hoehe) {
-        std::cout << velo->y << " _____ ";
         double alpha = atan((pA->y - pZ->y) / (pA->x - pZ->x));
         /*velo->y = coVel*(velo->y * cos(alpha) * cos(alpha) - 2 * sqrt(3) * len * cos(alpha) * *omega - 3 * velo->y)
             / (3 + cos(alpha) * cos(alpha));
@@ -108,13 +107,11 @@ bool triCollision(struct triangle* tria, velocity* velo, double breite, double h
         velo->y = -velo->y; 
         while (pA->y <= -hoehe || pA->y >= hoehe) {
             triReflect(tria, 0.99,true);
-            std::cout << velo->y << "y@A" << std::endl;
         }
         *omega = -*omega;
         return true;
     }
     if (pB->y <= -hoehe || pB->y>= hoehe ) {
-        std::cout << velo->y << " _____ ";
         double alpha = atan((pB->y - pZ->y) / (pB->x - pZ->x));
         /*velo->y = coVel*(velo->y * cos(alpha) * cos(alpha) - 2 * sqrt(3) * len * cos(alpha) * *omega - 3 * velo->y)
             / (3 + cos(alpha) * cos(alpha));
@@ -123,12 +120,10 @@ bool triCollision(struct triangle* tria, velocity* velo, double breite, double h
         velo->y = -velo->y; 
         while (pB->y <= -hoehe || pB->y >= hoehe) {
             triReflect(tria, 0.99, true);
-            std::cout << velo->y << "y@B" << std::endl;
         }
         *omega = -*omega; return true;
     }
     if (pC->y  <= -hoehe  || pC->y  >= hoehe ) {
-        std::cout << velo->y << " _____ ";
         double alpha = atan((pC->y - pZ->y) / (pC->x - pZ->x));
         /*velo->y = coVel*(velo->y * cos(alpha) * cos(alpha) - 2 * sqrt(3) * len * cos(alpha) * *omega - 3 * velo->y)
             / (3 + cos(alpha) * cos(alpha));
@@ -137,7 +132,6 @@ bool triCollision(struct triangle* tria, velocity* velo, double breite, double h
         velo->y = -velo->y; 
         while (pC->y <= -hoehe || pC->y >= hoehe) {
             triReflect(tria, 0.99, true);
-            std::cout << velo->y << "y@C" << std::endl;
         }
         *omega = -*omega; return true;
     }
@@ -145,7 +139,6 @@ bool triCollision(struct triangle* tria, velocity* velo, double breite, double h
         velo->x = -velo->x; 
         while (pA->x <= -breite|| pA->x >= breite) {
             triReflect(tria, 0.99, false);
-            std::cout << velo->x << "x@A" << std::endl;
         }
         *omega = -*omega;
         return true;
@@ -154,7 +147,6 @@ bool triCollision(struct triangle* tria, velocity* velo, double breite, double h
         velo->x = -velo->x;
         while (pB->x <= -breite || pB->x >= breite) {
             triReflect(tria,0.99, false);
-            std::cout << velo->x << "x@B" << std::endl;
         } 
         *omega = -*omega; return true;
     }
@@ -162,7 +154,6 @@ bool triCollision(struct triangle* tria, velocity* velo, double breite, double h
         velo->x = -velo->x; 
         while (pC->x <= -breite || pC->x >= breite) {
             triReflect(tria,0.99, false);
-            std::cout << velo->x << "x@C" << std::endl;
         }  
         *omega = -*omega; return true;
     }
@@ -212,8 +203,8 @@ int main(void)
     vertex center;    center.x = 0.0; center.y = 0.0;
     std::uniform_real_distribution<double> unif(1, 2);
     std::default_random_engine re(time(0));
-    long double velX = 100*unif(re);    long double* velXP = &velX;
-    long double velY = 100*unif(re);     long double* velYP = &velY;
+    double velX = 100*unif(re);
+    double velY = 100*unif(re);
     velocity velo = { velX, velY }; velocity* velP = &velo;
 
     vertex* vp1, * vp2, * vp3, * vpc;
@@ -255,7 +246,6 @@ int main(void)
         if (!triCollision(equiP, velP, breite, hoehe, angularV, currTime - prevTime)) {
             triTranslate(equiP, dist);
         }
-        else std::cout << "Collide!" << std::endl;
         
         int stateR = glfwGetKey(window, GLFW_KEY_RIGHT), stateL = glfwGetKey(window, GLFW_KEY_LEFT);
         int stateU = glfwGetKey(window, GLFW_KEY_UP), stateD = glfwGetKey(window, GLFW_KEY_DOWN);
@@ -0,0 +1,158 @@
+#include "dirty.h"
+#include <algorithm>
+
+/// <summary>
+/// Sizes the tracker for a screen and makes the next frames full redraws
+/// </summary>
+/// <param name="d">the tracker</param>
+/// <param name="width">width in pixels</param>
+/// <param name="height">height in pixels</param>
+/// <param name="tileSize">side of a tile in pixels</param>
+/// <param name="age">frames a target keeps its pixels for, 1 or more</param>
+void dirtyInit(struct dirtyRegion* d, int width, int height, int tileSize, int age) {
+    d->width = width;
+    d->height = height;
+    d->tileSize = tileSize;
+    d->tilesX = (width + tileSize - 1) / tileSize;
+    d->tilesY = (height + tileSize - 1) / tileSize;
+    d->age = std::max(1, age);
+    d->tiles.assign((size_t)d->tilesX * d->tilesY, 1);
+    d->history.assign(d->age, std::vector<uint8_t>(d->tiles.size(), 1));
+    d->rects.clear();
+    dirtyInvalidate(d);
+}
+
+/// <summary>
+/// Forgets the last frames, so the next age frames are redrawn in full
+/// </summary>
+/// <param name="d">the tracker</param>
+void dirtyInvalidate(struct dirtyRegion* d) {
+    d->bodies.clear();
+    d->full = d->age;
+}
+
+static void markBox(struct dirtyRegion* d, std::vector<uint8_t>& mask, const dirtyBody& b) {
+    if (b.minX > b.maxX || b.minY > b.maxY || b.maxX < 0 || b.maxY < 0 || b.minX >= d->width || b.minY >= d->height)
+        return;
+    const int ts = d->tileSize;
+    const int tx0 = std::max(0, b.minX) / ts, tx1 = std::min(d->width - 1, b.maxX) / ts;
+    const int ty0 = std::max(0, b.minY) / ts, ty1 = std::min(d->height - 1, b.maxY) / ts;
+    for (int ty = ty0; ty <= ty1; ty++)
+        std::fill(mask.begin() + (size_t)ty * d->tilesX + tx0, mask.begin() + (size_t)ty * d->tilesX + tx1 + 1, 1);
+}
+
+static inline bool sameBody(const dirtyBody& a, const dirtyBody& b) {
+    return a.key == b.key && a.minX == b.minX && a.minY == b.minY && a.maxX == b.maxX && a.maxY == b.maxY;
+}
+
+/// <summary>
+/// Compares the bodies of a new frame with those of the last one and marks the tiles to redraw in tiles,
+/// one byte per tile, row by row. A change in the number of bodies redraws everything.
+/// </summary>
+/// <param name="d">the tracker</param>
+/// <param name="bodies">screen box and pose key of every body, in the same order every frame</param>
+/// <param name="count">number of bodies</param>
+/// <returns>number of dirty tiles</returns>
+size_t dirtyUpdate(struct dirtyRegion* d, const dirtyBody* bodies, size_t count) {
+    if (count != d->bodies.size())
+        d->full = d->age;
+    /* the mask of this frame replaces the oldest one kept */
+    std::vector<uint8_t>& now = d->history[(size_t)(d->frames % d->age)];
+    if (d->full > 0) {
+        std::fill(now.begin(), now.end(), 1);
+        d->full--;
+    }
+    else {
+        std::fill(now.begin(), now.end(), 0);
+        for (size_t i = 0; i < count; i++)
+            if (!sameBody(bodies[i], d->bodies[i])) {
+                markBox(d, now, d->bodies[i]);
+                markBox(d, now, bodies[i]);
+            }
+    }
+    d->bodies.assign(bodies, bodies + count);
+
+    const int ts = d->tileSize;
+    d->dirtyTiles = 0;
+    d->touched = 0;
+    for (size_t t = 0; t < d->tiles.size(); t++) {
+        uint8_t dirty = 0;
+        for (const std::vector<uint8_t>& h : d->history)
+            dirty |= h[t];
+        d->tiles[t] = dirty;
+        if (dirty) {
+            const int tx = (int)(t % d->tilesX) * ts, ty = (int)(t / d->tilesX) * ts;
+            d->dirtyTiles++;
+            d->touched += (uint64_t)(std::min(tx + ts, d->width) - tx) * (uint64_t)(std::min(ty + ts, d->height) - ty);
+        }
+    }
+    d->touchedTotal += d->touched;
+    d->frames++;
+    return d->dirtyTiles;
+}
+
+/// <summary>
+/// Merges the dirty tiles into rectangles: runs of dirty tiles in a row, joined with the same run
+/// of the rows below
+/// </summary>
+/// <param name="d">the tracker, dirtyUpdate must have run</param>
+/// <returns>number of rectangles in d->rects</returns>
+size_t dirtyMerge(struct dirtyRegion* d) {
+    const int ts = d->tileSize;
+    d->rects.clear();
+    d->open.clear();
+    for (int ty = 0; ty < d->tilesY; ty++) {
+        const uint8_t* row = d->tiles.data() + (size_t)ty * d->tilesX;
+        const int y = ty * ts, h = std::min(y + ts, d->height) - y;
+        d->next.clear();
+        /* runs and open rects both come in ascending x, so one pass over each pairs them up */
+        size_t k = 0;
+        for (int tx = 0; tx < d->tilesX;) {
+            if (!row[tx]) {
+                tx++;
+                continue;
+            }
+            int end = tx + 1;
+            while (end < d->tilesX && row[end])
+                end++;
+            const int x = tx * ts, w = std::min(end * ts, d->width) - x;
+            while (k < d->open.size() && d->rects[d->open[k]].x < x)
+                k++;
+            if (k < d->open.size() && d->rects[d->open[k]].x == x && d->rects[d->open[k]].width == w) {
+                d->rects[d->open[k]].height += h;
+                d->next.push_back(d->open[k]);
+            }
+            else {
+                d->next.push_back((uint32_t)d->rects.size());
+                d->rects.push_back({ x, y, w, h });
+            }
+            tx = end;
+        }
+        d->open.swap(d->next);
+    }
+    return d->rects.size();
+}
+
+/// <summary>
+/// Share of the screen redrawn in the last frame
+/// </summary>
+/// <returns>touched pixels divided by all pixels, 1 for a full redraw</returns>
+double dirtyShare(const dirtyRegion& d) {
+    const double all = (double)d.width * d.height;
+    return all > 0 ? d.touched / all : 0;
+}
+
+/// <summary>
+/// Pose key of a body from the values that decide its pixels
+/// </summary>
+/// <param name="values">the values, e.g. fixed point vertices or the floats of an instance</param>
+/// <param name="n">number of 32 bit words</param>
+/// <returns>64 bit FNV-1a hash taken a word at a time</returns>
+uint64_t dirtyKey(const uint32_t* values, size_t n) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < n; i++) {
+        h ^= values[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
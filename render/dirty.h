@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// What one body covered on screen in a frame: its bounding box in whole pixels, empty when minX > maxX,
+/// and a key of its exact pose, so a body that turns within the same box still counts as changed
+/// </summary>
+struct dirtyBody {
+    int minX, minY, maxX, maxY;
+    uint64_t key;
+};
+
+/// <summary>
+/// A rectangle of whole pixels, top row first like the framebuffer
+/// </summary>
+struct dirtyRect {
+    int x, y, width, height;
+};
+
+/// <summary>
+/// Tracks which square tiles of the screen changed between frames. A tile is dirty when a body that
+/// changed covered it in the last frame or covers it now; clean tiles keep last frame's pixels.
+/// age is the number of frames a target keeps its pixels for: 1 for a framebuffer that is drawn into
+/// every frame, 2 for a double buffered window, whose back buffer holds the frame before last.
+/// The dirty tiles of the last age frames are combined, and merged into rects for scissoring.
+/// </summary>
+struct dirtyRegion {
+    int width = 0;
+    int height = 0;
+    int tileSize = 64;
+    int tilesX = 0;
+    int tilesY = 0;
+    int age = 1;
+    std::vector<dirtyBody> bodies;
+    std::vector<uint8_t> tiles;
+    std::vector<std::vector<uint8_t>> history;
+    std::vector<dirtyRect> rects;
+    /* rects that end at the row dirtyMerge is at, and those of the next row */
+    std::vector<uint32_t> open, next;
+    int full = 0;
+    size_t dirtyTiles = 0;
+    uint64_t touched = 0;
+    long long frames = 0;
+    uint64_t touchedTotal = 0;
+};
+
+/// <summary>
+/// Sizes the tracker for a screen and makes the next frames full redraws
+/// </summary>
+/// <param name="d">the tracker</param>
+/// <param name="width">width in pixels</param>
+/// <param name="height">height in pixels</param>
+/// <param name="tileSize">side of a tile in pixels</param>
+/// <param name="age">frames a target keeps its pixels for, 1 or more</param>
+void dirtyInit(struct dirtyRegion* d, int width, int height, int tileSize, int age);
+
+/// <summary>
+/// Forgets the last frames, so the next age frames are redrawn in full
+/// </summary>
+/// <param name="d">the tracker</param>
+void dirtyInvalidate(struct dirtyRegion* d);
+
+/// <summary>
+/// Compares the bodies of a new frame with those of the last one and marks the tiles to redraw in tiles,
+/// one byte per tile, row by row. A change in the number of bodies redraws everything.
+/// </summary>
+/// <param name="d">the tracker</param>
+/// <param name="bodies">screen box and pose key of every body, in the same order every frame</param>
+/// <param name="count">number of bodies</param>
+/// <returns>number of dirty tiles</returns>
+size_t dirtyUpdate(struct dirtyRegion* d, const dirtyBody* bodies, size_t count);
+
+/// <summary>
+/// Merges the dirty tiles into rectangles: runs of dirty tiles in a row, joined with the same run
+/// of the rows below
+/// </summary>
+/// <param name="d">the tracker, dirtyUpdate must have run</param>
+/// <returns>number of rectangles in d->rects</returns>
+size_t dirtyMerge(struct dirtyRegion* d);
+
+/// <summary>
+/// Share of the screen redrawn in the last frame
+/// </summary>
+/// <returns>touched pixels divided by all pixels, 1 for a full redraw</returns>
+double dirtyShare(const dirtyRegion& d);
+
+/// <summary>
+/// Pose key of a body from the values that decide its pixels
+/// </summary>
+/// <param name="values">the values, e.g. fixed point vertices or the floats of an instance</param>
+/// <param name="n">number of 32 bit words</param>
+/// <returns>64 bit FNV-1a hash taken a word at a time</returns>
+uint64_t dirtyKey(const uint32_t* values, size_t n);
@@ -0,0 +1,10 @@
+#pragma once
+/* The viewer loads OpenGL through GLEW. Headless builds (OSMesa or EGL on Mesa) link the
+   GL entry points directly, so they only need the prototypes. */
+#if defined(RENDER_HEADLESS)
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#else
+#include <GL/glew.h>
+#endif
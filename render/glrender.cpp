@@ -0,0 +1,305 @@
+#include "glrender.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+static const char* vertexSource = R"(#version 330 core
+layout(location = 0) in vec2 corner;
+layout(location = 1) in vec4 body;
+uniform vec2 scale;
+void main() {
+    float c = cos(body.z), s = sin(body.z);
+    vec2 p = body.xy + body.w * vec2(c * corner.x - s * corner.y, s * corner.x + c * corner.y);
+    gl_Position = vec4(p * scale, 0.0, 1.0);
+}
+)";
+
+static const char* fragmentSource = R"(#version 330 core
+uniform vec4 tint;
+out vec4 color;
+void main() {
+    color = tint;
+}
+)";
+
+/* the unit triangle of soaVertices: side 1, centroid in the origin, one corner up */
+static const float unitTriangle[6] = {
+    -0.5f, -0.28867513f,
+    0.5f, -0.28867513f,
+    0.0f, 0.57735027f,
+};
+
+static GLuint compileShader(GLenum type, const char* source) {
+    GLuint sh = glCreateShader(type);
+    glShaderSource(sh, 1, &source, nullptr);
+    glCompileShader(sh);
+    GLint ok = 0;
+    glGetShaderiv(sh, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetShaderInfoLog(sh, sizeof(log), nullptr, log);
+        std::fprintf(stderr, "shader: %s\n", log);
+        glDeleteShader(sh);
+        return 0;
+    }
+    return sh;
+}
+
+/// <summary>
+/// Links a vertex shader with the fragment shader, returns 0 and prints the log if that fails
+/// </summary>
+static GLuint linkProgram(const char* vertex) {
+    GLuint vs = compileShader(GL_VERTEX_SHADER, vertex), fs = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    if (!vs || !fs)
+        return 0;
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    GLint ok = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        std::fprintf(stderr, "program: %s\n", log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+/// <summary>
+/// Screen box in pixels and pose key of every instance, for a viewport of width x height that shows
+/// [-breite, breite] x [-hoehe, hoehe]. The box holds the circle through the vertices plus one pixel.
+/// </summary>
+static void instanceBoxes(const instance* in, size_t n, double breite, double hoehe, int width, int height,
+    dirtyBody* out) {
+    const double sx = 0.5 * width / breite, sy = 0.5 * height / hoehe;
+    for (size_t i = 0; i < n; i++) {
+        const double cx = (in[i].x + breite) * sx, cy = (hoehe - in[i].y) * sy;
+        const double rx = 0.57735027 * in[i].len * sx + 1, ry = 0.57735027 * in[i].len * sy + 1;
+        uint32_t pose[4];
+        std::memcpy(pose, &in[i], sizeof(pose));
+        out[i] = { (int)std::floor(cx - rx), (int)std::floor(cy - ry), (int)std::ceil(cx + rx), (int)std::ceil(cy + ry),
+            dirtyKey(pose, 4) };
+    }
+}
+
+/// <summary>
+/// (Re)creates the instance buffer for capacity bodies per region and binds it to attribute 1
+/// </summary>
+static void allocateInstances(struct glRenderer* r, size_t capacity) {
+    for (GLsync& f : r->fences)
+        if (f) {
+            glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            glDeleteSync(f);
+            f = nullptr;
+        }
+    if (r->instanceVbo) {
+        glBindBuffer(GL_ARRAY_BUFFER, r->instanceVbo);
+        if (r->mapped)
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        glDeleteBuffers(1, &r->instanceVbo);
+        r->mapped = nullptr;
+    }
+    r->capacity = capacity;
+    glBindVertexArray(r->vao);
+    glGenBuffers(1, &r->instanceVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, r->instanceVbo);
+    if (r->persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLsizeiptr bytes = (GLsizeiptr)(rendererRegions * capacity * sizeof(instance));
+        glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+        r->mapped = (instance*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+    }
+    else {
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(capacity * sizeof(instance)), nullptr, GL_STREAM_DRAW);
+        r->staging.resize(capacity);
+    }
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(instance), nullptr);
+    glVertexAttribDivisor(1, 1);
+    glBindVertexArray(0);
+}
+
+/// <summary>
+/// Compiles the shaders and creates the buffers, a GL context must be current
+/// </summary>
+/// <param name="r">the renderer</param>
+/// <param name="capacity">number of bodies to make room for, grows on demand</param>
+/// <returns>false if the shaders do not compile or link, the log is printed to stderr</returns>
+bool rendererInit(struct glRenderer* r, size_t capacity) {
+    r->program = linkProgram(vertexSource);
+    if (!r->program)
+        return false;
+    r->scaleLoc = glGetUniformLocation(r->program, "scale");
+    r->tintLoc = glGetUniformLocation(r->program, "tint");
+
+    /* persistent mapping needs buffer storage (4.4), drawing from a region needs base instance (4.2) */
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    r->persistent = major > 4 || (major == 4 && minor >= 4);
+
+    glGenVertexArrays(1, &r->vao);
+    glBindVertexArray(r->vao);
+    glGenBuffers(1, &r->shapeVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, r->shapeVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(unitTriangle), unitTriangle, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
+    allocateInstances(r, capacity > 0 ? capacity : 1);
+    return true;
+}
+
+/// <summary>
+/// Clears the frame and draws every body of a snapshot with one instanced call. With r->partial only the
+/// dirty rectangles are cleared, each through a scissor, or their bounding box when there are more than
+/// maxRects of them, and the bodies are drawn into that box. A box over half the frame redraws all of it,
+/// and so does a bufferAge of 0.
+/// </summary>
+/// <param name="r">the renderer</param>
+/// <param name="s">the snapshot</param>
+/// <param name="alpha">interpolation factor from snapshotAlpha</param>
+/// <param name="breite">horizontal dimension of the world, maps to the window edges</param>
+/// <param name="hoehe">vertical dimension of the world, maps to the window edges</param>
+void rendererDraw(struct glRenderer* r, const snapshot& s, double alpha, double breite, double hoehe) {
+    if (s.count > r->capacity)
+        allocateInstances(r, s.count + s.count / 2);
+
+    /* without a known age the back buffer may hold anything, so the frame is drawn in full and tracking starts over */
+    const bool partial = r->partial && r->bufferAge > 0;
+    if (r->partial && !partial)
+        dirtyInvalidate(&r->dirty);
+    GLuint base = 0;
+    instance* out = nullptr;
+    auto t0 = std::chrono::steady_clock::now();
+    if (r->persistent) {
+        /* wait until the GPU is done with the region written three frames ago */
+        r->region = (r->region + 1) % rendererRegions;
+        GLsync& fence = r->fences[r->region];
+        if (fence) {
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        base = (GLuint)(r->region * r->capacity);
+        out = r->mapped + base;
+    }
+    /* the boxes are read back from the instances, so with partial redraw they go through staging, which is
+       never write-combined GPU memory */
+    if (!r->persistent || partial) {
+        r->staging.resize(r->capacity);
+        packInstances(s, alpha, r->staging.data());
+        if (out)
+            std::memcpy(out, r->staging.data(), s.count * sizeof(instance));
+    }
+    else
+        packInstances(s, alpha, out);
+    if (!r->persistent) {
+        glBindBuffer(GL_ARRAY_BUFFER, r->instanceVbo);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(r->capacity * sizeof(instance)), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(s.count * sizeof(instance)), r->staging.data());
+    }
+
+    GLint viewport[4] = { 0, 0, 0, 0 };
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const uint64_t pixels = (uint64_t)viewport[2] * (uint64_t)viewport[3];
+    if (partial) {
+        if (viewport[2] != r->dirty.width || viewport[3] != r->dirty.height || r->dirty.age != r->bufferAge)
+            dirtyInit(&r->dirty, viewport[2], viewport[3], 64, r->bufferAge);
+        r->boxes.resize(s.count);
+        instanceBoxes(r->staging.data(), s.count, breite, hoehe, viewport[2], viewport[3], r->boxes.data());
+        dirtyUpdate(&r->dirty, r->boxes.data(), s.count);
+        dirtyMerge(&r->dirty);
+    }
+    r->packSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    /* GL counts rows from the bottom, the dirty rects from the top */
+    auto scissor = [&viewport](const dirtyRect& d) {
+        glScissor(viewport[0] + d.x, viewport[1] + viewport[3] - d.y - d.height, d.width, d.height);
+    };
+    dirtyRect box = { 0, 0, viewport[2], viewport[3] };
+    const std::vector<dirtyRect>& rects = r->dirty.rects;
+    if (partial) {
+        box = rects.empty() ? dirtyRect{ 0, 0, 0, 0 } : rects[0];
+        for (const dirtyRect& d : rects) {
+            const int x1 = std::max(box.x + box.width, d.x + d.width), y1 = std::max(box.y + box.height, d.y + d.height);
+            box.x = std::min(box.x, d.x);
+            box.y = std::min(box.y, d.y);
+            box.width = x1 - box.x;
+            box.height = y1 - box.y;
+        }
+    }
+    /* a few rects are cleared one by one. With more of them their bounding box is cleared as a whole, and once
+       that covers half the frame, the whole frame is: drivers clear a full frame much faster than a scissor. */
+    const uint64_t boxPixels = (uint64_t)box.width * (uint64_t)box.height;
+    const bool scissored = partial && 2 * boxPixels <= pixels;
+    if (!scissored) {
+        box = { 0, 0, viewport[2], viewport[3] };
+        glClear(GL_COLOR_BUFFER_BIT);
+        r->touched = pixels;
+    }
+    else {
+        glEnable(GL_SCISSOR_TEST);
+        if (rects.size() <= r->maxRects) {
+            for (const dirtyRect& d : rects) {
+                scissor(d);
+                glClear(GL_COLOR_BUFFER_BIT);
+            }
+            r->touched = r->dirty.touched;
+        }
+        else {
+            scissor(box);
+            glClear(GL_COLOR_BUFFER_BIT);
+            r->touched = boxPixels;
+        }
+        /* the bodies are drawn once into the bounding box. The clean tiles inside it that were not cleared
+           get the same pixels again, no body that changed reaches into them. */
+        scissor(box);
+    }
+    if (box.width > 0 && box.height > 0) {
+        glUseProgram(r->program);
+        glUniform2f(r->scaleLoc, (float)(1 / breite), (float)(1 / hoehe));
+        glUniform4f(r->tintLoc, 1, 1, 1, 1);
+        glBindVertexArray(r->vao);
+        if (r->persistent)
+            glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 3, (GLsizei)s.count, base);
+        else
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 3, (GLsizei)s.count);
+    }
+    if (scissored)
+        glDisable(GL_SCISSOR_TEST);
+    if (r->persistent)
+        r->fences[r->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glBindVertexArray(0);
+    r->touchedTotal += r->touched;
+    r->pixelsTotal += pixels;
+    r->frames++;
+}
+
+/// <summary>
+/// Releases all GL objects, the context must still be current
+/// </summary>
+/// <param name="r">the renderer</param>
+void rendererDestroy(struct glRenderer* r) {
+    for (GLsync& f : r->fences)
+        if (f) {
+            glDeleteSync(f);
+            f = nullptr;
+        }
+    if (r->mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, r->instanceVbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        r->mapped = nullptr;
+    }
+    glDeleteBuffers(1, &r->instanceVbo);
+    glDeleteBuffers(1, &r->shapeVbo);
+    glDeleteVertexArrays(1, &r->vao);
+    glDeleteProgram(r->program);
+    r->instanceVbo = r->shapeVbo = r->vao = r->program = 0;
+}
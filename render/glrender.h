@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "dirty.h"
+#include "gl.h"
+#include "handoff.h"
+#include "instances.h"
+
+/* The instance buffer is split into this many regions, the CPU fills one while the GPU may still read the others */
+const unsigned rendererRegions = 3;
+
+/// <summary>
+/// Instanced renderer: one unit triangle in a static buffer and one instance per body in a buffer
+/// that stays mapped for the lifetime of the renderer. All bodies are drawn with a single instanced
+/// call, the vertex shader rotates, scales and moves the unit triangle and maps world units to
+/// normalized device coordinates. Without GL 4.4 buffer storage, the instances are uploaded
+/// with glBufferSubData instead. With partial set, only the tiles of the window that a body changed
+/// are cleared and drawn again: every merged run of dirty tiles is cleared through a scissor and the
+/// bodies are drawn with a scissor around all of them. bufferAge is the number of frames since the target
+/// last held a frame, so dirty is kept for that many frames; 1 for an offscreen framebuffer, the age the
+/// window system reports for a window's back buffer, and 0 when it is unknown, which draws the frame in full.
+/// touched counts the pixels cleared in the last frame.
+/// </summary>
+struct glRenderer {
+    GLuint program = 0;
+    GLuint vao = 0;
+    GLuint shapeVbo = 0;
+    GLuint instanceVbo = 0;
+    GLint scaleLoc = -1;
+    GLint tintLoc = -1;
+    size_t capacity = 0;
+    bool persistent = false;
+    instance* mapped = nullptr;
+    std::vector<instance> staging;
+    GLsync fences[rendererRegions] = {};
+    unsigned region = 0;
+    long long frames = 0;
+    double packSeconds = 0;
+    bool partial = false;
+    int bufferAge = 0;
+    size_t maxRects = 4;
+    dirtyRegion dirty;
+    std::vector<dirtyBody> boxes;
+    uint64_t touched = 0;
+    uint64_t touchedTotal = 0;
+    uint64_t pixelsTotal = 0;
+};
+
+/// <summary>
+/// Compiles the shaders and creates the buffers, a GL context must be current
+/// </summary>
+/// <param name="r">the renderer</param>
+/// <param name="capacity">number of bodies to make room for, grows on demand</param>
+/// <returns>false if the shaders do not compile or link, the log is printed to stderr</returns>
+bool rendererInit(struct glRenderer* r, size_t capacity);
+
+/// <summary>
+/// Clears the frame and draws every body of a snapshot with one instanced call. With r->partial only the
+/// dirty rectangles are cleared, each through a scissor, or their bounding box when there are more than
+/// maxRects of them, and the bodies are drawn into that box. A box over half the frame redraws all of it,
+/// and so does a bufferAge of 0.
+/// </summary>
+/// <param name="r">the renderer</param>
+/// <param name="s">the snapshot</param>
+/// <param name="alpha">interpolation factor from snapshotAlpha</param>
+/// <param name="breite">horizontal dimension of the world, maps to the window edges</param>
+/// <param name="hoehe">vertical dimension of the world, maps to the window edges</param>
+void rendererDraw(struct glRenderer* r, const snapshot& s, double alpha, double breite, double hoehe);
+
+/// <summary>
+/// Releases all GL objects, the context must still be current
+/// </summary>
+/// <param name="r">the renderer</param>
+void rendererDestroy(struct glRenderer* r);
@@ -0,0 +1,242 @@
+#include "image.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// Copies one framebuffer row to RGB bytes
+/// </summary>
+static void rowRgb(const framebuffer& fb, int y, uint8_t* out) {
+    const uint8_t* p = (const uint8_t*)(fb.pixels.data() + (size_t)y * fb.width);
+    for (int x = 0; x < fb.width; x++, p += 4, out += 3) {
+        out[0] = p[0];
+        out[1] = p[1];
+        out[2] = p[2];
+    }
+}
+
+static bool writeRows(FILE* f, const framebuffer& fb) {
+    std::vector<uint8_t> row((size_t)fb.width * 3);
+    for (int y = 0; y < fb.height; y++) {
+        rowRgb(fb, y, row.data());
+        if (std::fwrite(row.data(), 1, row.size(), f) != row.size())
+            return false;
+    }
+    return true;
+}
+
+/// <summary>
+/// Writes a frame as binary PPM (P6), RGB without alpha
+/// </summary>
+/// <param name="f">an open file</param>
+/// <param name="fb">the frame</param>
+/// <returns>false on a write error</returns>
+bool writePpm(FILE* f, const framebuffer& fb) {
+    return std::fprintf(f, "P6\n%d %d\n255\n", fb.width, fb.height) > 0 && writeRows(f, fb);
+}
+
+/// <summary>
+/// Writes a frame as raw RGB bytes, top row first, without any header
+/// </summary>
+/// <param name="f">an open file or pipe</param>
+/// <param name="fb">the frame</param>
+/// <returns>false on a write error</returns>
+bool writeRaw(FILE* f, const framebuffer& fb) {
+    return writeRows(f, fb);
+}
+
+/* deflate length symbols 257..285 and distance symbols 0..29: first value and number of extra bits */
+static const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+    67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+    5, 5, 5, 5, 0 };
+static const uint16_t distBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513,
+    769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t distExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10,
+    11, 11, 12, 12, 13, 13 };
+
+/// <summary>
+/// Least significant bit first output as deflate wants it
+/// </summary>
+struct bitWriter {
+    std::vector<uint8_t>* out;
+    uint32_t acc = 0;
+    int bits = 0;
+};
+
+static void putBits(bitWriter* w, uint32_t value, int count) {
+    w->acc |= value << w->bits;
+    w->bits += count;
+    while (w->bits >= 8) {
+        w->out->push_back((uint8_t)w->acc);
+        w->acc >>= 8;
+        w->bits -= 8;
+    }
+}
+
+/* Huffman codes are sent most significant bit first */
+static void putCode(bitWriter* w, uint32_t code, int count) {
+    uint32_t rev = 0;
+    for (int i = 0; i < count; i++)
+        rev |= ((code >> i) & 1) << (count - 1 - i);
+    putBits(w, rev, count);
+}
+
+/// <summary>
+/// Sends a literal or length symbol with the fixed Huffman code of RFC 1951, 3.2.6
+/// </summary>
+static void putSymbol(bitWriter* w, int sym) {
+    if (sym < 144)
+        putCode(w, 0x30 + sym, 8);
+    else if (sym < 256)
+        putCode(w, 0x190 + sym - 144, 9);
+    else if (sym < 280)
+        putCode(w, sym - 256, 7);
+    else
+        putCode(w, 0xC0 + sym - 280, 8);
+}
+
+static void putMatch(bitWriter* w, int length, int distance) {
+    int l = 28;
+    while (lengthBase[l] > length)
+        l--;
+    putSymbol(w, 257 + l);
+    putBits(w, length - lengthBase[l], lengthExtra[l]);
+    int d = 29;
+    while (distBase[d] > distance)
+        d--;
+    putCode(w, d, 5);
+    putBits(w, distance - distBase[d], distExtra[d]);
+}
+
+static int matchLength(const std::vector<uint8_t>& data, size_t i, size_t distance) {
+    const size_t end = std::min(data.size(), i + 258);
+    size_t n = i;
+    while (n < end && data[n] == data[n - distance])
+        n++;
+    return (int)(n - i);
+}
+
+/// <summary>
+/// zlib stream of one fixed Huffman block. Only two match distances are tried: the pixel to the
+/// left and the byte above, which is all a frame of flat colored triangles needs.
+/// </summary>
+static std::vector<uint8_t> deflateFixed(const std::vector<uint8_t>& data, size_t stride) {
+    std::vector<uint8_t> out;
+    out.reserve(data.size() / 8 + 64);
+    out.push_back(0x78);
+    out.push_back(0x01);
+    bitWriter w{ &out };
+    putBits(&w, 1, 1);
+    putBits(&w, 1, 2);
+    size_t i = 0;
+    while (i < data.size()) {
+        int best = 0, dist = 0;
+        if (i >= 3) {
+            best = matchLength(data, i, 3);
+            dist = 3;
+        }
+        if (i >= stride && stride <= 32768) {
+            int n = matchLength(data, i, stride);
+            if (n > best) {
+                best = n;
+                dist = (int)stride;
+            }
+        }
+        if (best >= 3) {
+            putMatch(&w, best, dist);
+            i += best;
+        }
+        else
+            putSymbol(&w, data[i++]);
+    }
+    putSymbol(&w, 256);
+    if (w.bits)
+        putBits(&w, 0, 8 - w.bits);
+
+    uint32_t a = 1, b = 0;
+    for (uint8_t c : data) {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    const uint32_t adler = (b << 16) | a;
+    for (int s = 24; s >= 0; s -= 8)
+        out.push_back((uint8_t)(adler >> s));
+    return out;
+}
+
+static uint32_t crc32(const uint8_t* p, size_t n, uint32_t crc) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++)
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static bool writeChunk(FILE* f, const char* type, const std::vector<uint8_t>& data) {
+    uint8_t head[8];
+    const uint32_t n = (uint32_t)data.size();
+    for (int k = 0; k < 4; k++) {
+        head[k] = (uint8_t)(n >> (24 - 8 * k));
+        head[4 + k] = (uint8_t)type[k];
+    }
+    uint32_t crc = crc32(head + 4, 4, 0);
+    crc = crc32(data.data(), data.size(), crc);
+    const uint8_t tail[4] = { (uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc };
+    return std::fwrite(head, 1, 8, f) == 8 && std::fwrite(data.data(), 1, data.size(), f) == data.size()
+        && std::fwrite(tail, 1, 4, f) == 4;
+}
+
+/// <summary>
+/// Writes a frame as 8 bit RGB PNG without zlib
+/// </summary>
+/// <param name="f">an open file</param>
+/// <param name="fb">the frame</param>
+/// <returns>false on a write error</returns>
+bool writePng(FILE* f, const framebuffer& fb) {
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    const size_t stride = (size_t)fb.width * 3 + 1;
+    std::vector<uint8_t> raw(stride * fb.height);
+    for (int y = 0; y < fb.height; y++) {
+        raw[y * stride] = 0;
+        rowRgb(fb, y, &raw[y * stride + 1]);
+    }
+
+    std::vector<uint8_t> header(13, 0);
+    for (int k = 0; k < 4; k++) {
+        header[k] = (uint8_t)(fb.width >> (24 - 8 * k));
+        header[4 + k] = (uint8_t)(fb.height >> (24 - 8 * k));
+    }
+    header[8] = 8;
+    header[9] = 2;
+    return std::fwrite(signature, 1, 8, f) == 8 && writeChunk(f, "IHDR", header)
+        && writeChunk(f, "IDAT", deflateFixed(raw, stride)) && writeChunk(f, "IEND", std::vector<uint8_t>());
+}
+
+/// <summary>
+/// Writes a frame in the given format
+/// </summary>
+/// <param name="f">an open file or pipe</param>
+/// <param name="fb">the frame</param>
+/// <param name="format">the file format</param>
+/// <returns>false on a write error</returns>
+bool writeImage(FILE* f, const framebuffer& fb, imageFormat format) {
+    switch (format) {
+    case IMAGE_PNG:
+        return writePng(f, fb);
+    case IMAGE_RAW:
+        return writeRaw(f, fb);
+    default:
+        return writePpm(f, fb);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdio>
+
+#include "softraster.h"
+
+/// <summary>
+/// File formats a frame can be written in
+/// </summary>
+enum imageFormat { IMAGE_PPM, IMAGE_PNG, IMAGE_RAW };
+
+/// <summary>
+/// Writes a frame as binary PPM (P6), RGB without alpha
+/// </summary>
+/// <param name="f">an open file</param>
+/// <param name="fb">the frame</param>
+/// <returns>false on a write error</returns>
+bool writePpm(FILE* f, const framebuffer& fb);
+
+/// <summary>
+/// Writes a frame as 8 bit RGB PNG. Needs no zlib: the pixel data is deflated with the fixed Huffman
+/// code and only matches one pixel to the left or one row up, which shrinks the mostly empty frames
+/// of a simulation to a few percent of their raw size.
+/// </summary>
+/// <param name="f">an open file</param>
+/// <param name="fb">the frame</param>
+/// <returns>false on a write error</returns>
+bool writePng(FILE* f, const framebuffer& fb);
+
+/// <summary>
+/// Writes a frame as raw RGB bytes, top row first, without any header. A sequence of these is what
+/// a video encoder reads from a pipe, e.g. ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -i -
+/// </summary>
+/// <param name="f">an open file or pipe</param>
+/// <param name="fb">the frame</param>
+/// <returns>false on a write error</returns>
+bool writeRaw(FILE* f, const framebuffer& fb);
+
+/// <summary>
+/// Writes a frame in the given format
+/// </summary>
+/// <param name="f">an open file or pipe</param>
+/// <param name="fb">the frame</param>
+/// <param name="format">the file format</param>
+/// <returns>false on a write error</returns>
+bool writeImage(FILE* f, const framebuffer& fb, imageFormat format);
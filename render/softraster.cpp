@@ -0,0 +1,304 @@
+#include "softraster.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/* sub-pixel precision of the fixed point coordinates */
+static const int subBits = 4;
+static const int32_t subOne = 1 << subBits;
+
+/* triangles whose vertices span at most this many pixels keep their edge functions within 32 bits; the edge
+   values grow with the distance from the vertices, so what counts is the box before it is clipped to the screen */
+static const int smallTri = 1024;
+
+/// <summary>
+/// Coefficients of the three edge functions E(px, py) = A * px + B * py + C, positive inside.
+/// C already holds the top-left bias, so a pixel is covered when all three are >= 0.
+/// </summary>
+struct edges {
+    int32_t a[3], b[3];
+    int64_t c[3];
+};
+
+static edges edgesOf(const screenTri& t) {
+    const int32_t x[3] = { t.x0, t.x1, t.x2 }, y[3] = { t.y0, t.y1, t.y2 };
+    edges e;
+    for (int k = 0; k < 3; k++) {
+        int n = (k + 1) % 3;
+        e.a[k] = y[k] - y[n];
+        e.b[k] = x[n] - x[k];
+        e.c[k] = -((int64_t)e.a[k] * x[k] + (int64_t)e.b[k] * y[k]);
+        bool topLeft = e.a[k] > 0 || (e.a[k] == 0 && e.b[k] > 0);
+        if (!topLeft)
+            e.c[k] -= 1;
+    }
+    return e;
+}
+
+/// <summary>
+/// Packs a color into a pixel value
+/// </summary>
+/// <returns>R, G, B, A in memory order</returns>
+uint32_t rasterColor(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha) {
+    return (uint32_t)red | ((uint32_t)green << 8) | ((uint32_t)blue << 16) | ((uint32_t)alpha << 24);
+}
+
+/// <summary>
+/// Sets the framebuffer size and allocates tiles and bins
+/// </summary>
+/// <param name="r">the rasterizer</param>
+/// <param name="width">width in pixels</param>
+/// <param name="height">height in pixels</param>
+void rasterInit(struct softRaster* r, int width, int height) {
+    r->fb.width = width;
+    r->fb.height = height;
+    r->fb.pixels.assign((size_t)width * height, 0);
+    r->tilesX = (width + r->tileSize - 1) / r->tileSize;
+    r->tilesY = (height + r->tileSize - 1) / r->tileSize;
+    r->bins.assign((size_t)r->tilesX * r->tilesY, std::vector<uint32_t>());
+    r->tileCoverage.assign(r->bins.size(), 0);
+    dirtyInit(&r->dirty, width, height, r->tileSize, 1);
+}
+
+/// <summary>
+/// Fills the whole framebuffer with one color
+/// </summary>
+/// <param name="r">the rasterizer</param>
+/// <param name="color">pixel value, see rasterColor</param>
+void rasterClear(struct softRaster* r, uint32_t color) {
+    std::fill(r->fb.pixels.begin(), r->fb.pixels.end(), color);
+}
+
+/// <summary>
+/// Converts a world triangle to screen space, returns false if it is degenerate or off screen
+/// </summary>
+static bool setupTri(const triangle& t, double sx, double sy, int width, int height, uint32_t color, screenTri* out) {
+    const vertex* v[3] = { &t.aA, &t.bB, &t.cC };
+    double px[3], py[3];
+    for (int k = 0; k < 3; k++) {
+        px[k] = (v[k]->x * sx + 0.5) * width;
+        py[k] = (0.5 - v[k]->y * sy) * height;
+    }
+    double lox = std::min(px[0], std::min(px[1], px[2])), hix = std::max(px[0], std::max(px[1], px[2]));
+    double loy = std::min(py[0], std::min(py[1], py[2])), hiy = std::max(py[0], std::max(py[1], py[2]));
+    if (hix < 0 || hiy < 0 || lox > width || loy > height || hix - lox > 1 << 20 || hiy - loy > 1 << 20)
+        return false;
+
+    int32_t fx[3], fy[3];
+    for (int k = 0; k < 3; k++) {
+        fx[k] = (int32_t)lround(px[k] * subOne);
+        fy[k] = (int32_t)lround(py[k] * subOne);
+    }
+    int64_t area = (int64_t)(fx[1] - fx[0]) * (fy[2] - fy[0]) - (int64_t)(fy[1] - fy[0]) * (fx[2] - fx[0]);
+    if (area == 0)
+        return false;
+    if (area < 0) {
+        std::swap(fx[1], fx[2]);
+        std::swap(fy[1], fy[2]);
+    }
+    *out = { fx[0], fy[0], fx[1], fy[1], fx[2], fy[2], 0, 0, 0, 0, (int)ceil(hix - lox), (int)ceil(hiy - loy), color };
+    /* pixel centers sit at (i + 1/2) * subOne, covered pixels lie within the box of the vertices */
+    out->minX = std::max(0, (int)floor(lox - 0.5));
+    out->maxX = std::min(width - 1, (int)ceil(hix - 0.5));
+    out->minY = std::max(0, (int)floor(loy - 0.5));
+    out->maxY = std::min(height - 1, (int)ceil(hiy - 0.5));
+    return out->minX <= out->maxX && out->minY <= out->maxY;
+}
+
+/// <summary>
+/// Portable inner loop, 64 bit edge values, works for triangles of any size
+/// </summary>
+static uint64_t fillScalar(const edges& e, uint32_t color, uint32_t* pixels, int width, int x0, int x1, int y0, int y1) {
+    uint64_t n = 0;
+    for (int y = y0; y <= y1; y++) {
+        const int64_t cy = (int64_t)y * subOne + subOne / 2, cx = (int64_t)x0 * subOne + subOne / 2;
+        int64_t w0 = e.a[0] * cx + e.b[0] * cy + e.c[0];
+        int64_t w1 = e.a[1] * cx + e.b[1] * cy + e.c[1];
+        int64_t w2 = e.a[2] * cx + e.b[2] * cy + e.c[2];
+        uint32_t* row = pixels + (size_t)y * width;
+        for (int x = x0; x <= x1; x++) {
+            if ((w0 | w1 | w2) >= 0) {
+                row[x] = color;
+                n++;
+            }
+            w0 += e.a[0] * subOne;
+            w1 += e.a[1] * subOne;
+            w2 += e.a[2] * subOne;
+        }
+    }
+    return n;
+}
+
+#if defined(__AVX2__)
+
+const char* rasterKernelName() { return "avx2"; }
+
+static inline unsigned laneCount(int bits) {
+    unsigned v = (unsigned)bits;
+    v = v - ((v >> 1) & 0x55);
+    v = (v & 0x33) + ((v >> 2) & 0x33);
+    return (v + (v >> 4)) & 0x0F;
+}
+
+/// <summary>
+/// Eight pixels per step with 32 bit edge values, only for triangles whose vertices span less than smallTri pixels
+/// </summary>
+static uint64_t fillSimd(const edges& e, uint32_t color, uint32_t* pixels, int width, int x0, int x1, int y0, int y1) {
+    uint64_t n = 0;
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), minusOne = _mm256_set1_epi32(-1);
+    const __m256i vcolor = _mm256_set1_epi32((int)color);
+    __m256i step[3], laneOff[3];
+    for (int k = 0; k < 3; k++) {
+        step[k] = _mm256_set1_epi32(e.a[k] * subOne * 8);
+        laneOff[k] = _mm256_mullo_epi32(lane, _mm256_set1_epi32(e.a[k] * subOne));
+    }
+    for (int y = y0; y <= y1; y++) {
+        const int64_t cy = (int64_t)y * subOne + subOne / 2, cx = (int64_t)x0 * subOne + subOne / 2;
+        __m256i w[3];
+        for (int k = 0; k < 3; k++)
+            w[k] = _mm256_add_epi32(_mm256_set1_epi32((int32_t)(e.a[k] * cx + e.b[k] * cy + e.c[k])), laneOff[k]);
+        uint32_t* row = pixels + (size_t)y * width;
+        for (int x = x0; x <= x1; x += 8) {
+            __m256i any = _mm256_or_si256(w[0], _mm256_or_si256(w[1], w[2]));
+            __m256i mask = _mm256_cmpgt_epi32(any, minusOne);
+            if (x1 - x < 7)
+                mask = _mm256_and_si256(mask, _mm256_cmpgt_epi32(_mm256_set1_epi32(x1 - x + 1), lane));
+            int bits = _mm256_movemask_ps(_mm256_castsi256_ps(mask));
+            if (bits) {
+                _mm256_maskstore_epi32((int*)(row + x), mask, vcolor);
+                n += laneCount(bits);
+            }
+            for (int k = 0; k < 3; k++)
+                w[k] = _mm256_add_epi32(w[k], step[k]);
+        }
+    }
+    return n;
+}
+
+#else
+
+const char* rasterKernelName() { return "scalar"; }
+
+#endif
+
+/// <summary>
+/// Fills the part of one triangle that lies in the pixel rectangle [x0, x1] x [y0, y1]
+/// </summary>
+static uint64_t fillTri(const softRaster& r, const screenTri& t, uint32_t* pixels, int x0, int x1, int y0, int y1) {
+    const edges e = edgesOf(t);
+#if defined(__AVX2__)
+    if (r.simd && t.spanX < smallTri && t.spanY < smallTri)
+        return fillSimd(e, t.color, pixels, r.fb.width, x0, x1, y0, y1);
+#endif
+    return fillScalar(e, t.color, pixels, r.fb.width, x0, x1, y0, y1);
+}
+
+/// <summary>
+/// Sets up and bins the triangles, in submission order so every tile draws its triangles in that order.
+/// With boxes, also writes the screen box and pose key of every triangle there.
+/// </summary>
+static void binTriangles(struct softRaster* r, const triangle* tris, size_t count, double breite, double hoehe,
+    uint32_t color, dirtyBody* boxes) {
+    const int width = r->fb.width, height = r->fb.height, ts = r->tileSize;
+    const double sx = 0.5 / breite, sy = 0.5 / hoehe;
+    r->tris.clear();
+    for (std::vector<uint32_t>& bin : r->bins)
+        bin.clear();
+    for (size_t i = 0; i < count; i++) {
+        screenTri t;
+        if (!setupTri(tris[i], sx, sy, width, height, color, &t)) {
+            if (boxes)
+                boxes[i] = { 0, 0, -1, -1, 0 };
+            continue;
+        }
+        if (boxes) {
+            const uint32_t pose[7] = { (uint32_t)t.x0, (uint32_t)t.y0, (uint32_t)t.x1, (uint32_t)t.y1,
+                (uint32_t)t.x2, (uint32_t)t.y2, t.color };
+            boxes[i] = { t.minX, t.minY, t.maxX, t.maxY, dirtyKey(pose, 7) };
+        }
+        const uint32_t id = (uint32_t)r->tris.size();
+        r->tris.push_back(t);
+        for (int ty = t.minY / ts; ty <= t.maxY / ts; ty++)
+            for (int tx = t.minX / ts; tx <= t.maxX / ts; tx++)
+                r->bins[(size_t)ty * r->tilesX + tx].push_back(id);
+    }
+}
+
+/// <summary>
+/// Fills the binned triangles tile by tile. With a mask only the tiles marked in it are drawn,
+/// each cleared to background first. Returns the number of pixels written by triangles.
+/// </summary>
+static uint64_t fillTiles(struct softRaster* r, const uint8_t* mask, uint32_t background, struct jobPool* pool) {
+    const int width = r->fb.width, height = r->fb.height, ts = r->tileSize;
+    poolFor(pool, r->bins.size(), 4, [r, ts, width, height, mask, background](size_t, size_t from, size_t to) {
+        for (size_t tile = from; tile < to; tile++) {
+            r->tileCoverage[tile] = 0;
+            if (mask && !mask[tile])
+                continue;
+            const int tx0 = (int)(tile % r->tilesX) * ts, ty0 = (int)(tile / r->tilesX) * ts;
+            const int tx1 = std::min(tx0 + ts, width) - 1, ty1 = std::min(ty0 + ts, height) - 1;
+            if (mask)
+                for (int y = ty0; y <= ty1; y++) {
+                    uint32_t* row = r->fb.pixels.data() + (size_t)y * width;
+                    std::fill(row + tx0, row + tx1 + 1, background);
+                }
+            uint64_t n = 0;
+            for (uint32_t id : r->bins[tile]) {
+                const screenTri& t = r->tris[id];
+                n += fillTri(*r, t, r->fb.pixels.data(), std::max(t.minX, tx0), std::min(t.maxX, tx1),
+                    std::max(t.minY, ty0), std::min(t.maxY, ty1));
+            }
+            r->tileCoverage[tile] = n;
+        }
+    });
+
+    uint64_t total = 0;
+    for (uint64_t n : r->tileCoverage)
+        total += n;
+    r->covered += total;
+    return total;
+}
+
+/// <summary>
+/// Rasterizes triangles in world coordinates into the framebuffer. The world spans [-breite, breite] x
+/// [-hoehe, hoehe] like in the viewer, y pointing up. Triangles are drawn in order.
+/// </summary>
+/// <param name="r">the rasterizer</param>
+/// <param name="tris">the triangles</param>
+/// <param name="count">number of triangles</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="color">pixel value of every triangle</param>
+/// <param name="pool">fills the tiles on these threads, may be null</param>
+/// <returns>number of pixels written</returns>
+uint64_t rasterTriangles(struct softRaster* r, const triangle* tris, size_t count, double breite, double hoehe,
+    uint32_t color, struct jobPool* pool) {
+    binTriangles(r, tris, count, breite, hoehe, color, nullptr);
+    return fillTiles(r, nullptr, 0, pool);
+}
+
+/// <summary>
+/// rasterTriangles for a framebuffer that still holds the last frame drawn by this function: only the tiles
+/// that a changed triangle covered before or covers now are cleared to background and drawn again, the
+/// others keep their pixels. Triangles are matched by their position in tris. The first call, a call with a
+/// different number of triangles and the first call after dirtyInvalidate(&r->dirty) redraw everything.
+/// </summary>
+/// <param name="r">the rasterizer</param>
+/// <param name="tris">the triangles</param>
+/// <param name="count">number of triangles</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="color">pixel value of every triangle</param>
+/// <param name="background">pixel value the dirty tiles are cleared to</param>
+/// <param name="pool">fills the tiles on these threads, may be null</param>
+/// <returns>number of pixels written by triangles; r->dirty tells the tiles and pixels redrawn</returns>
+uint64_t rasterTrianglesDirty(struct softRaster* r, const triangle* tris, size_t count, double breite, double hoehe,
+    uint32_t color, uint32_t background, struct jobPool* pool) {
+    r->boxes.resize(count);
+    binTriangles(r, tris, count, breite, hoehe, color, r->boxes.data());
+    dirtyUpdate(&r->dirty, r->boxes.data(), count);
+    return fillTiles(r, r->dirty.tiles.data(), background, pool);
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dirty.h"
+#include "jobs.h"
+#include "sim.h"
+
+/// <summary>
+/// CPU framebuffer, one 32 bit pixel per entry with the bytes R, G, B, A in memory order, top row first
+/// </summary>
+struct framebuffer {
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> pixels;
+};
+
+/// <summary>
+/// A triangle in screen space, 4 bit sub-pixel fixed point, counter-clockwise on screen,
+/// with its bounding box clipped to the framebuffer in whole pixels and the size of the unclipped box
+/// </summary>
+struct screenTri {
+    int32_t x0, y0, x1, y1, x2, y2;
+    int minX, minY, maxX, maxY;
+    int spanX, spanY;
+    uint32_t color;
+};
+
+/// <summary>
+/// Tiled software rasterizer. Triangles are set up once, binned into square tiles and then every
+/// tile is filled on its own, so tiles can run on several threads without sharing pixels.
+/// Coverage follows the top-left rule: triangles that share an edge never both fill a pixel on it.
+/// dirty tracks the screen box of every triangle, so rasterTrianglesDirty redraws only the tiles that changed.
+/// </summary>
+struct softRaster {
+    framebuffer fb;
+    int tileSize = 64;
+    int tilesX = 0;
+    int tilesY = 0;
+    bool simd = true;
+    std::vector<screenTri> tris;
+    std::vector<std::vector<uint32_t>> bins;
+    std::vector<uint64_t> tileCoverage;
+    uint64_t covered = 0;
+    dirtyRegion dirty;
+    std::vector<dirtyBody> boxes;
+};
+
+/// <summary>
+/// Sets the framebuffer size and allocates tiles and bins
+/// </summary>
+/// <param name="r">the rasterizer</param>
+/// <param name="width">width in pixels</param>
+/// <param name="height">height in pixels</param>
+void rasterInit(struct softRaster* r, int width, int height);
+
+/// <summary>
+/// Fills the whole framebuffer with one color
+/// </summary>
+/// <param name="r">the rasterizer</param>
+/// <param name="color">pixel value, see rasterColor</param>
+void rasterClear(struct softRaster* r, uint32_t color);
+
+/// <summary>
+/// Packs a color into a pixel value
+/// </summary>
+/// <returns>R, G, B, A in memory order</returns>
+uint32_t rasterColor(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha = 255);
+
+/// <summary>
+/// Rasterizes triangles in world coordinates into the framebuffer. The world spans [-breite, breite] x
+/// [-hoehe, hoehe] like in the viewer, y pointing up. Triangles are drawn in order.
+/// </summary>
+/// <param name="r">the rasterizer</param>
+/// <param name="tris">the triangles</param>
+/// <param name="count">number of triangles</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="color">pixel value of every triangle</param>
+/// <param name="pool">fills the tiles on these threads, may be null</param>
+/// <returns>number of pixels written</returns>
+uint64_t rasterTriangles(struct softRaster* r, const triangle* tris, size_t count, double breite, double hoehe,
+    uint32_t color, struct jobPool* pool = nullptr);
+
+/// <summary>
+/// rasterTriangles for a framebuffer that still holds the last frame drawn by this function: only the tiles
+/// that a changed triangle covered before or covers now are cleared to background and drawn again, the
+/// others keep their pixels. Triangles are matched by their position in tris. The first call, a call with a
+/// different number of triangles and the first call after dirtyInvalidate(&r->dirty) redraw everything.
+/// </summary>
+/// <param name="r">the rasterizer</param>
+/// <param name="tris">the triangles</param>
+/// <param name="count">number of triangles</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="color">pixel value of every triangle</param>
+/// <param name="background">pixel value the dirty tiles are cleared to</param>
+/// <param name="pool">fills the tiles on these threads, may be null</param>
+/// <returns>number of pixels written by triangles; r->dirty tells the tiles and pixels redrawn</returns>
+uint64_t rasterTrianglesDirty(struct softRaster* r, const triangle* tris, size_t count, double breite, double hoehe,
+    uint32_t color, uint32_t background, struct jobPool* pool = nullptr);
+
+/// <summary>
+/// Name of the instruction set the inner loop was compiled for
+/// </summary>
+/// <returns>"avx2" or "scalar"</returns>
+const char* rasterKernelName();
@@ -0,0 +1,185 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "glrender.h"
+#include "handoff.h"
+#include "scene.h"
+
+#if defined(RENDER_OSMESA)
+#include <GL/osmesa.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+/// <summary>
+/// Settings of the headless run, filled from the command line
+/// </summary>
+struct headlessArgs {
+    size_t bodies = 10000;
+    long long frames = 300;
+    int width = 1280;
+    int height = 720;
+    double len = 20;
+    unsigned seed = 1;
+    const char* out = nullptr;
+    bool dirty = false;
+};
+
+static void usage(const char* prog) {
+    std::printf("usage: %s [--bodies N] [--frames N] [--width PX] [--height PX] [--len PX] [--seed N] [--out FILE.ppm]\n"
+        "          [--redraw full|dirty]\n", prog);
+}
+
+/// <summary>
+/// Parses the command line into a headlessArgs object
+/// </summary>
+/// <returns>false if an argument is unknown or lacks its value</returns>
+static bool parseArgs(int argc, char** argv, headlessArgs* args) {
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (i + 1 >= argc)
+            return false;
+        const char* v = argv[++i];
+        if (!std::strcmp(a, "--bodies"))
+            args->bodies = std::strtoull(v, nullptr, 10);
+        else if (!std::strcmp(a, "--frames"))
+            args->frames = std::strtoll(v, nullptr, 10);
+        else if (!std::strcmp(a, "--width"))
+            args->width = std::atoi(v);
+        else if (!std::strcmp(a, "--height"))
+            args->height = std::atoi(v);
+        else if (!std::strcmp(a, "--len"))
+            args->len = std::strtod(v, nullptr);
+        else if (!std::strcmp(a, "--seed"))
+            args->seed = (unsigned)std::strtoul(v, nullptr, 10);
+        else if (!std::strcmp(a, "--out"))
+            args->out = v;
+        else if (!std::strcmp(a, "--redraw") && (!std::strcmp(v, "full") || !std::strcmp(v, "dirty")))
+            args->dirty = !std::strcmp(v, "dirty");
+        else
+            return false;
+    }
+    return true;
+}
+
+#if defined(RENDER_OSMESA)
+static std::vector<unsigned char> osmesaPixels;
+
+/// <summary>
+/// Creates an OSMesa core profile context that renders into memory
+/// </summary>
+static bool createContext(int width, int height) {
+    const int attribs[] = { OSMESA_FORMAT, OSMESA_RGBA, OSMESA_DEPTH_BITS, 0, OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+        OSMESA_CONTEXT_MAJOR_VERSION, 4, OSMESA_CONTEXT_MINOR_VERSION, 5, 0 };
+    OSMesaContext ctx = OSMesaCreateContextAttribs(attribs, nullptr);
+    if (!ctx)
+        return false;
+    osmesaPixels.resize((size_t)width * height * 4);
+    return OSMesaMakeCurrent(ctx, osmesaPixels.data(), GL_UNSIGNED_BYTE, width, height);
+}
+#else
+/// <summary>
+/// Creates a core profile context on Mesa's surfaceless EGL platform, no window system needed
+/// </summary>
+static bool createContext(int, int) {
+    auto getDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay dpy = getDisplay ? getDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr)
+        : eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major, minor;
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &major, &minor) || !eglBindAPI(EGL_OPENGL_API))
+        return false;
+    const EGLint attribs[] = { EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 5,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+    EGLContext ctx = eglCreateContext(dpy, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+    return ctx != EGL_NO_CONTEXT && eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+}
+#endif
+
+/// <summary>
+/// Writes the bound framebuffer as binary PPM, top row first
+/// </summary>
+static bool writePpm(const char* path, int width, int height) {
+    std::vector<unsigned char> rgba((size_t)width * height * 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+    FILE* f = std::fopen(path, "wb");
+    if (!f)
+        return false;
+    std::fprintf(f, "P6\n%d %d\n255\n", width, height);
+    for (int y = height - 1; y >= 0; y--)
+        for (int x = 0; x < width; x++)
+            std::fwrite(&rgba[((size_t)y * width + x) * 4], 1, 3, f);
+    return std::fclose(f) == 0;
+}
+
+/// <summary>
+/// Draws a running scene with the instanced renderer into an offscreen framebuffer and reports
+/// frames/sec, the CPU time spent packing instances and the share of pixels redrawn per frame.
+/// Works on Mesa's llvmpipe without any display.
+/// </summary>
+int main(int argc, char** argv) {
+    headlessArgs args;
+    if (!parseArgs(argc, argv, &args)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!createContext(args.width, args.height)) {
+        std::fprintf(stderr, "no OpenGL context\n");
+        return 1;
+    }
+
+    GLuint fbo, color;
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, args.width, args.height);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glViewport(0, 0, args.width, args.height);
+
+    glRenderer r;
+    if (!rendererInit(&r, args.bodies))
+        return 1;
+    /* the offscreen framebuffer keeps its pixels from one frame to the next */
+    r.partial = args.dirty;
+    r.bufferAge = 1;
+    glClearColor(0, 0, 0, 0);
+
+    sceneConfig cfg;
+    cfg.response = RESPONSE_REFLECT;
+    scene sc = makeScene(args.width, args.height, 1.0 / 120, cfg);
+    sceneSpawn(&sc, args.bodies, args.len, args.seed);
+    snapshot snap;
+
+    auto t0 = std::chrono::steady_clock::now();
+    double simSeconds = 0;
+    for (long long f = 0; f < args.frames; f++) {
+        auto s0 = std::chrono::steady_clock::now();
+        snapshotBefore(&snap, sc.bodies);
+        sceneStep(&sc);
+        snapshotAfter(&snap, sc.bodies, sc.steps, sc.dt);
+        simSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - s0).count();
+        rendererDraw(&r, snap, 0.5, sc.breite, sc.hoehe);
+    }
+    glFinish();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() - simSeconds;
+
+    std::printf("renderer: %s\n", (const char*)glGetString(GL_RENDERER));
+    std::printf("version: %s\n", (const char*)glGetString(GL_VERSION));
+    std::printf("upload: %s\n", r.persistent ? "persistent mapped" : "buffer sub data");
+    std::printf("bodies: %zu\n", args.bodies);
+    std::printf("frames: %lld\n", args.frames);
+    std::printf("frames/sec: %.1f\n", secs > 0 ? args.frames / secs : 0.0);
+    std::printf("pack ns per instance: %.3f\n", args.frames && args.bodies ? r.packSeconds * 1e9 / (args.frames * (double)args.bodies) : 0.0);
+    std::printf("redraw: %s\n", r.partial ? "dirty rects" : "full");
+    std::printf("touched per frame: %.2f %%\n", r.pixelsTotal ? 100.0 * r.touchedTotal / r.pixelsTotal : 0.0);
+    if (args.out && !writePpm(args.out, args.width, args.height)) {
+        std::fprintf(stderr, "could not write %s\n", args.out);
+        return 1;
+    }
+    rendererDestroy(&r);
+    return 0;
+}
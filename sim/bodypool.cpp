@@ -0,0 +1,128 @@
+#include "bodypool.h"
+
+static bodySlot& slotAt(const bodyPool& p, uint32_t slot) {
+    return p.chunks[slot / bodySlotChunk][slot % bodySlotChunk];
+}
+
+static void addChunk(struct bodyPool* p) {
+    p->chunks.emplace_back(new bodySlot[bodySlotChunk]);
+    for (uint32_t i = 0; i < bodySlotChunk; i++)
+        p->chunks.back()[i] = { 0, 1 };
+}
+
+/// <summary>
+/// Takes a slot from the free list or, if it is empty, a new one from the arena
+/// </summary>
+static uint32_t takeSlot(struct bodyPool* p) {
+    if (p->freeHead != UINT32_MAX) {
+        uint32_t s = p->freeHead;
+        p->freeHead = slotAt(*p, s).index;
+        return s;
+    }
+    if (p->slots == p->chunks.size() * bodySlotChunk)
+        addChunk(p);
+    return p->slots++;
+}
+
+/// <summary>
+/// Attaches a pool to a body store and hands out handles for the bodies already in it
+/// </summary>
+/// <param name="p">the pool</param>
+/// <param name="bodies">the store, from now on bodies must only be added and removed through the pool</param>
+/// <param name="sleeping">the sleep state of the scene that steps the store, or nullptr</param>
+void bodyPoolInit(struct bodyPool* p, struct bodySoA* bodies, struct sleepState* sleeping) {
+    *p = bodyPool();
+    p->bodies = bodies;
+    p->sleeping = sleeping;
+    for (size_t i = 0; i < bodies->count; i++) {
+        uint32_t s = takeSlot(p);
+        slotAt(*p, s).index = (uint32_t)i;
+        p->owner.push_back(s);
+    }
+}
+
+/// <summary>
+/// Makes room for n bodies in the store and the handle table, so spawning up to n allocates nothing
+/// </summary>
+/// <param name="p">the pool</param>
+/// <param name="n">number of bodies</param>
+void bodyPoolReserve(struct bodyPool* p, size_t n) {
+    soaReserve(p->bodies, n);
+    if (p->sleeping)
+        sleepReserve(p->sleeping, n);
+    p->owner.reserve(n);
+    p->chunks.reserve((n + bodySlotChunk - 1) / bodySlotChunk);
+    while (p->chunks.size() * bodySlotChunk < n)
+        addChunk(p);
+}
+
+/// <summary>
+/// Adds a body at the end of the store
+/// </summary>
+/// <param name="p">the pool</param>
+/// <param name="b">the body</param>
+/// <returns>its handle</returns>
+bodyHandle bodyPoolSpawn(struct bodyPool* p, const body& b) {
+    uint32_t s = takeSlot(p);
+    bodySlot& slot = slotAt(*p, s);
+    slot.index = (uint32_t)p->bodies->count;
+    if (p->sleeping)
+        sleepPush(p->sleeping, p->bodies->count);
+    soaPush(p->bodies, b);
+    p->owner.push_back(s);
+    p->spawned++;
+    return { s, slot.generation };
+}
+
+/// <summary>
+/// Removes a body; the last body of the store takes its index
+/// </summary>
+/// <param name="p">the pool</param>
+/// <param name="h">handle of the body</param>
+/// <returns>false if the handle is stale</returns>
+bool bodyPoolDespawn(struct bodyPool* p, bodyHandle h) {
+    const size_t i = bodyPoolIndex(*p, h);
+    if (i == SIZE_MAX)
+        return false;
+    const uint32_t moved = p->owner.back();
+    if (p->sleeping)
+        sleepRemove(p->sleeping, i, p->bodies->count);
+    soaRemove(p->bodies, i);
+    p->owner[i] = moved;
+    p->owner.pop_back();
+    slotAt(*p, moved).index = (uint32_t)i;
+
+    bodySlot& slot = slotAt(*p, h.slot);
+    /* generation 0 is never valid, a wrapped counter starts over at 1 */
+    slot.generation = slot.generation + 1 ? slot.generation + 1 : 1;
+    slot.index = p->freeHead;
+    p->freeHead = h.slot;
+    p->despawned++;
+    return true;
+}
+
+/// <summary>
+/// Current index of a body in the store
+/// </summary>
+/// <param name="p">the pool</param>
+/// <param name="h">handle of the body</param>
+/// <returns>the index, SIZE_MAX if the handle is stale</returns>
+size_t bodyPoolIndex(const bodyPool& p, bodyHandle h) {
+    if (h.slot >= p.slots)
+        return SIZE_MAX;
+    const bodySlot& slot = slotAt(p, h.slot);
+    if (slot.generation != h.generation || slot.index >= p.owner.size() || p.owner[slot.index] != h.slot)
+        return SIZE_MAX;
+    return slot.index;
+}
+
+/// <summary>
+/// Handle of the body at an index of the store
+/// </summary>
+/// <param name="p">the pool</param>
+/// <param name="index">index in the store, below its count</param>
+/// <returns>the handle</returns>
+bodyHandle bodyPoolHandle(const bodyPool& p, size_t index) {
+    const uint32_t s = p.owner[index];
+    return { s, slotAt(p, s).generation };
+}
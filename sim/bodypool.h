@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "sleep.h"
+#include "soa.h"
+
+/// <summary>
+/// Reference to a body that stays valid while the body lives, wherever it is moved in the store,
+/// and is recognised as stale once the body is gone. slot 0 with generation 0 is never handed out.
+/// </summary>
+struct bodyHandle {
+    uint32_t slot;
+    uint32_t generation;
+};
+
+/// <summary>
+/// One entry of the handle table: the body's index in the store while it lives,
+/// the next free slot while it is free
+/// </summary>
+struct bodySlot {
+    uint32_t index;
+    uint32_t generation;
+};
+
+/* slots per arena chunk; chunks are never moved, so growing the table copies nothing */
+static const uint32_t bodySlotChunk = 4096;
+
+/// <summary>
+/// Generational handles on top of a body store. The bodies themselves stay packed in the SoA arrays
+/// so the SIMD step runs over them unchanged; despawning moves the last body into the hole.
+/// The handle table lives in a chunked arena and the despawned slots form a free list, so spawn and
+/// despawn are O(1) and, once the store and the table have reached their peak size, allocate nothing.
+/// With a sleep state attached, its entries move along with the bodies, still in O(1).
+/// </summary>
+struct bodyPool {
+    bodySoA* bodies = nullptr;
+    sleepState* sleeping = nullptr;
+    std::vector<std::unique_ptr<bodySlot[]>> chunks;
+    std::vector<uint32_t> owner;
+    uint32_t slots = 0;
+    uint32_t freeHead = UINT32_MAX;
+    uint64_t spawned = 0;
+    uint64_t despawned = 0;
+};
+
+/// <summary>
+/// Attaches a pool to a body store and hands out handles for the bodies already in it
+/// </summary>
+/// <param name="p">the pool</param>
+/// <param name="bodies">the store, from now on bodies must only be added and removed through the pool</param>
+/// <param name="sleeping">the sleep state of the scene that steps the store, or nullptr</param>
+void bodyPoolInit(struct bodyPool* p, struct bodySoA* bodies, struct sleepState* sleeping = nullptr);
+
+/// <summary>
+/// Makes room for n bodies in the store and the handle table, so spawning up to n allocates nothing
+/// </summary>
+/// <param name="p">the pool</param>
+/// <param name="n">number of bodies</param>
+void bodyPoolReserve(struct bodyPool* p, size_t n);
+
+/// <summary>
+/// Adds a body at the end of the store
+/// </summary>
+/// <param name="p">the pool</param>
+/// <param name="b">the body</param>
+/// <returns>its handle</returns>
+bodyHandle bodyPoolSpawn(struct bodyPool* p, const body& b);
+
+/// <summary>
+/// Removes a body; the last body of the store takes its index
+/// </summary>
+/// <param name="p">the pool</param>
+/// <param name="h">handle of the body</param>
+/// <returns>false if the handle is stale</returns>
+bool bodyPoolDespawn(struct bodyPool* p, bodyHandle h);
+
+/// <summary>
+/// Current index of a body in the store
+/// </summary>
+/// <param name="p">the pool</param>
+/// <param name="h">handle of the body</param>
+/// <returns>the index, SIZE_MAX if the handle is stale</returns>
+size_t bodyPoolIndex(const bodyPool& p, bodyHandle h);
+
+/// <summary>
+/// Handle of the body at an index of the store
+/// </summary>
+/// <param name="p">the pool</param>
+/// <param name="index">index in the store, below its count</param>
+/// <returns>the handle</returns>
+bodyHandle bodyPoolHandle(const bodyPool& p, size_t index);
@@ -0,0 +1,318 @@
+#include "broadphase.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+/// <summary>
+/// Computes the bounding boxes of all bodies from their cached vertices
+/// </summary>
+/// <param name="soa">the body store, soaVertices must have run</param>
+/// <param name="box">receives one box per body</param>
+void soaBounds(const bodySoA& soa, struct aabbSoA* box) {
+    box->lox.resize(soa.count);
+    box->loy.resize(soa.count);
+    box->hix.resize(soa.count);
+    box->hiy.resize(soa.count);
+    soaBoundsRange(soa, 0, soa.count, box);
+}
+
+/// <summary>
+/// Computes the bounding boxes of the bodies [from, to), box must already hold soa.count entries
+/// </summary>
+/// <param name="soa">the body store, soaVertices must have run</param>
+/// <param name="from">first body</param>
+/// <param name="to">one past the last body</param>
+/// <param name="box">receives the boxes of the range</param>
+void soaBoundsRange(const bodySoA& soa, size_t from, size_t to, struct aabbSoA* box) {
+    const vertexSoA& v = soa.verts;
+    for (size_t i = from; i < to; i++) {
+        box->lox[i] = std::min(v.ax[i], std::min(v.bx[i], v.cx[i]));
+        box->hix[i] = std::max(v.ax[i], std::max(v.bx[i], v.cx[i]));
+        box->loy[i] = std::min(v.ay[i], std::min(v.by[i], v.cy[i]));
+        box->hiy[i] = std::max(v.ay[i], std::max(v.by[i], v.cy[i]));
+    }
+}
+
+static inline bool boxOverlap(const aabbSoA& box, uint32_t a, uint32_t b) {
+    return box.lox[a] <= box.hix[b] && box.lox[b] <= box.hix[a]
+        && box.loy[a] <= box.hiy[b] && box.loy[b] <= box.hiy[a];
+}
+
+/// <summary>
+/// Packs the integer coordinates of a grid cell into one key
+/// </summary>
+static inline uint64_t cellKey(int64_t ix, int64_t iy) {
+    return ((uint64_t)(uint32_t)(ix + 0x80000000LL) << 32) | (uint32_t)(iy + 0x80000000LL);
+}
+
+static inline uint32_t bucketOf(uint64_t key, int shift) {
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> shift);
+}
+
+/// <summary>
+/// Bodies wider than this many cells are kept out of the cells, so a box covers at most 5 x 5 of them
+/// </summary>
+static const double gridOversize = 4;
+
+static inline double boxExtent(const aabbSoA& box, size_t i) {
+    return std::max(box.hix[i] - box.lox[i], box.hiy[i] - box.loy[i]);
+}
+
+/// <summary>
+/// Rebuilds the grid from the bodies ids[0, n), or from the bodies [0, n) if ids is null.
+/// The cell size is the median extent of the bodies, so a few large ones cannot coarsen the cells
+/// until every body shares one; those go into the large list instead.
+/// </summary>
+static void buildGrid(struct hashGrid* grid, const aabbSoA& box, const uint32_t* ids, size_t n) {
+    std::vector<double>& extents = grid->tmpExtents;
+    extents.resize(n);
+    for (size_t k = 0; k < n; k++)
+        extents[k] = boxExtent(box, ids ? ids[k] : k);
+    double cell = 0;
+    if (n) {
+        std::nth_element(extents.begin(), extents.begin() + n / 2, extents.end());
+        cell = extents[n / 2];
+    }
+    cell = cell > 0 ? cell : 1;
+    grid->cell = cell;
+    const double inv = 1 / cell;
+    const double oversize = gridOversize * cell;
+
+    int bits = 1;
+    while (((size_t)1 << bits) < 2 * n)
+        bits++;
+    const size_t buckets = (size_t)1 << bits;
+    const int shift = 64 - bits;
+    grid->shift = shift;
+
+    /* pass 1: every body into all cells its box touches, counting entries per bucket */
+    grid->bucketStart.assign(buckets + 1, 0);
+    grid->tmpKeys.clear();
+    grid->tmpIds.clear();
+    grid->tmpBuckets.clear();
+    grid->members.clear();
+    grid->large.clear();
+    for (size_t k = 0; k < n; k++) {
+        const size_t i = ids ? ids[k] : k;
+        if (boxExtent(box, i) > oversize) {
+            grid->large.push_back((uint32_t)i);
+            continue;
+        }
+        grid->members.push_back((uint32_t)i);
+        int64_t ix0 = (int64_t)floor(box.lox[i] * inv), ix1 = (int64_t)floor(box.hix[i] * inv);
+        int64_t iy0 = (int64_t)floor(box.loy[i] * inv), iy1 = (int64_t)floor(box.hiy[i] * inv);
+        for (int64_t ix = ix0; ix <= ix1; ix++)
+            for (int64_t iy = iy0; iy <= iy1; iy++) {
+                uint64_t key = cellKey(ix, iy);
+                uint32_t b = bucketOf(key, shift);
+                grid->tmpKeys.push_back(key);
+                grid->tmpIds.push_back((uint32_t)i);
+                grid->tmpBuckets.push_back(b);
+                grid->bucketStart[b + 1]++;
+            }
+    }
+
+    /* pass 2: prefix sum and scatter, entries end up grouped by bucket */
+    for (size_t b = 0; b < buckets; b++)
+        grid->bucketStart[b + 1] += grid->bucketStart[b];
+    const size_t entries = grid->tmpKeys.size();
+    grid->keys.resize(entries);
+    grid->ids.resize(entries);
+    std::vector<uint32_t>& fill = grid->tmpBuckets;
+    for (size_t e = 0; e < entries; e++) {
+        uint32_t b = fill[e];
+        uint32_t at = grid->bucketStart[b + 1] - 1;
+        grid->bucketStart[b + 1]--;
+        grid->keys[at] = grid->tmpKeys[e];
+        grid->ids[at] = grid->tmpIds[e];
+    }
+    /* the decrements above turned every bucketStart[b + 1] into the start of bucket b */
+    for (size_t b = 0; b < buckets; b++)
+        grid->bucketStart[b] = grid->bucketStart[b + 1];
+    grid->bucketStart[buckets] = (uint32_t)entries;
+}
+
+/// <summary>
+/// Collects the overlapping pairs of every large body with the bodies in the cells and with the large
+/// bodies after it
+/// </summary>
+static void largePairs(const hashGrid& grid, const aabbSoA& box, std::vector<bodyPair>* pairs) {
+    for (size_t k = 0; k < grid.large.size(); k++) {
+        const uint32_t p = grid.large[k];
+        for (uint32_t q : grid.members)
+            if (boxOverlap(box, p, q))
+                pairs->push_back({ std::min(p, q), std::max(p, q) });
+        for (size_t l = k + 1; l < grid.large.size(); l++) {
+            const uint32_t q = grid.large[l];
+            if (boxOverlap(box, p, q))
+                pairs->push_back({ std::min(p, q), std::max(p, q) });
+        }
+    }
+}
+
+/// <summary>
+/// Collects the overlapping pairs within every cell of the grid
+/// </summary>
+static void cellPairs(const hashGrid& grid, const aabbSoA& box, std::vector<bodyPair>* pairs) {
+    const double inv = 1 / grid.cell;
+    const size_t buckets = grid.bucketStart.size() - 1;
+    for (size_t b = 0; b < buckets; b++) {
+        const uint32_t s = grid.bucketStart[b], e = grid.bucketStart[b + 1];
+        for (uint32_t i = s; i < e; i++)
+            for (uint32_t j = i + 1; j < e; j++) {
+                if (grid.keys[i] != grid.keys[j])
+                    continue;
+                uint32_t p = grid.ids[i], q = grid.ids[j];
+                if (!boxOverlap(box, p, q))
+                    continue;
+                int64_t hx = (int64_t)floor(std::max(box.lox[p], box.lox[q]) * inv);
+                int64_t hy = (int64_t)floor(std::max(box.loy[p], box.loy[q]) * inv);
+                if (cellKey(hx, hy) != grid.keys[i])
+                    continue;
+                pairs->push_back({ std::min(p, q), std::max(p, q) });
+            }
+    }
+}
+
+/// <summary>
+/// Rebuilds the grid and collects every pair of bodies whose boxes overlap, each pair exactly once.
+/// The cell size follows the median body and every box in the cells covers at most 5 x 5 of them.
+/// A pair sharing several cells is only reported from the cell that holds the corner
+/// (max lox, max loy) of both boxes. Larger bodies are tested against all others.
+/// </summary>
+/// <param name="grid">the grid, its buffers are reused between calls</param>
+/// <param name="box">bounding boxes of all bodies</param>
+/// <param name="count">number of bodies</param>
+/// <param name="pairs">receives the candidate pairs, cleared first</param>
+/// <returns>number of candidate pairs</returns>
+size_t gridPairs(struct hashGrid* grid, const aabbSoA& box, size_t count, std::vector<bodyPair>* pairs) {
+    pairs->clear();
+    if (count < 2)
+        return 0;
+    buildGrid(grid, box, nullptr, count);
+    cellPairs(*grid, box, pairs);
+    largePairs(*grid, box, pairs);
+    return pairs->size();
+}
+
+/// <summary>
+/// gridPairs on a subset of the bodies: only the listed bodies go into the grid and only pairs among them are found
+/// </summary>
+/// <param name="grid">the grid, its buffers are reused between calls</param>
+/// <param name="box">bounding boxes, indexed by body</param>
+/// <param name="ids">indices of the bodies</param>
+/// <param name="n">number of indices</param>
+/// <param name="pairs">receives the candidate pairs, cleared first</param>
+/// <returns>number of candidate pairs</returns>
+size_t gridPairsOf(struct hashGrid* grid, const aabbSoA& box, const uint32_t* ids, size_t n, std::vector<bodyPair>* pairs) {
+    pairs->clear();
+    if (n < 2)
+        return 0;
+    buildGrid(grid, box, ids, n);
+    cellPairs(*grid, box, pairs);
+    largePairs(*grid, box, pairs);
+    return pairs->size();
+}
+
+/// <summary>
+/// Builds the grid from a subset of the bodies without collecting pairs, to be queried with gridQuery later
+/// </summary>
+/// <param name="grid">the grid</param>
+/// <param name="box">bounding boxes, indexed by body</param>
+/// <param name="ids">indices of the bodies</param>
+/// <param name="n">number of indices</param>
+void gridBuild(struct hashGrid* grid, const aabbSoA& box, const uint32_t* ids, size_t n) {
+    buildGrid(grid, box, ids, n);
+}
+
+/// <summary>
+/// Appends every pair of a listed body and a body in the grid whose boxes overlap, each pair once.
+/// The listed bodies must not be in the grid.
+/// </summary>
+/// <param name="grid">a grid built with gridBuild, its boxes unchanged since</param>
+/// <param name="box">bounding boxes, indexed by body</param>
+/// <param name="ids">indices of the bodies to look up</param>
+/// <param name="n">number of indices</param>
+/// <param name="pairs">the pairs are appended here</param>
+/// <returns>number of pairs appended</returns>
+size_t gridQuery(const hashGrid& grid, const aabbSoA& box, const uint32_t* ids, size_t n, std::vector<bodyPair>* pairs) {
+    const size_t before = pairs->size();
+    if (grid.bucketStart.size() < 2 || (grid.members.empty() && grid.large.empty()))
+        return 0;
+    const double inv = 1 / grid.cell;
+    const double oversize = gridOversize * grid.cell;
+    for (size_t k = 0; k < n; k++) {
+        const uint32_t p = ids[k];
+        for (uint32_t q : grid.large)
+            if (boxOverlap(box, p, q))
+                pairs->push_back({ std::min(p, q), std::max(p, q) });
+        /* a body too large for the cells of the grid is tested against all bodies in them */
+        if (boxExtent(box, p) > oversize) {
+            for (uint32_t q : grid.members)
+                if (boxOverlap(box, p, q))
+                    pairs->push_back({ std::min(p, q), std::max(p, q) });
+            continue;
+        }
+        int64_t ix0 = (int64_t)floor(box.lox[p] * inv), ix1 = (int64_t)floor(box.hix[p] * inv);
+        int64_t iy0 = (int64_t)floor(box.loy[p] * inv), iy1 = (int64_t)floor(box.hiy[p] * inv);
+        for (int64_t ix = ix0; ix <= ix1; ix++)
+            for (int64_t iy = iy0; iy <= iy1; iy++) {
+                const uint64_t key = cellKey(ix, iy);
+                const uint32_t b = bucketOf(key, grid.shift);
+                for (uint32_t e = grid.bucketStart[b]; e < grid.bucketStart[b + 1]; e++) {
+                    if (grid.keys[e] != key)
+                        continue;
+                    const uint32_t q = grid.ids[e];
+                    if (!boxOverlap(box, p, q))
+                        continue;
+                    int64_t hx = (int64_t)floor(std::max(box.lox[p], box.lox[q]) * inv);
+                    int64_t hy = (int64_t)floor(std::max(box.loy[p], box.loy[q]) * inv);
+                    if (cellKey(hx, hy) != key)
+                        continue;
+                    pairs->push_back({ std::min(p, q), std::max(p, q) });
+                }
+            }
+    }
+    return pairs->size() - before;
+}
+
+/// <summary>
+/// Re-sorts the bodies along x and collects every pair of bodies whose boxes overlap
+/// </summary>
+/// <param name="sap">the sweep state, its order is reused between calls</param>
+/// <param name="box">bounding boxes of all bodies</param>
+/// <param name="count">number of bodies</param>
+/// <param name="pairs">receives the candidate pairs, cleared first</param>
+/// <returns>number of candidate pairs</returns>
+size_t sweepPairs(struct sweepAndPrune* sap, const aabbSoA& box, size_t count, std::vector<bodyPair>* pairs) {
+    pairs->clear();
+    std::vector<uint32_t>& order = sap->order;
+    const double* lox = box.lox.data();
+    if (order.size() != count) {
+        order.resize(count);
+        std::iota(order.begin(), order.end(), 0u);
+        std::sort(order.begin(), order.end(), [lox](uint32_t p, uint32_t q) { return lox[p] < lox[q]; });
+    }
+    else {
+        for (size_t i = 1; i < count; i++) {
+            uint32_t id = order[i];
+            size_t j = i;
+            while (j > 0 && lox[order[j - 1]] > lox[id]) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = id;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const uint32_t p = order[i];
+        const double hix = box.hix[p];
+        for (size_t j = i + 1; j < count && lox[order[j]] <= hix; j++) {
+            const uint32_t q = order[j];
+            if (box.loy[p] <= box.hiy[q] && box.loy[q] <= box.hiy[p])
+                pairs->push_back({ std::min(p, q), std::max(p, q) });
+        }
+    }
+    return pairs->size();
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "soa.h"
+
+/// <summary>
+/// Axis aligned bounding boxes of all bodies, one array per bound
+/// </summary>
+struct aabbSoA {
+    std::vector<double> lox, loy, hix, hiy;
+};
+
+/// <summary>
+/// A candidate pair of bodies whose bounding boxes overlap, a is always less than b
+/// </summary>
+struct bodyPair { uint32_t a; uint32_t b; };
+
+/// <summary>
+/// Uniform grid hashed into a fixed number of buckets. The cell size follows the median body; bodies
+/// more than gridOversize cells wide stay out of the cells and are tested against every body directly.
+/// All buffers are kept between steps, so a rebuild is two linear passes (count, scatter) without any
+/// allocation once they have grown.
+/// </summary>
+struct hashGrid {
+    double cell = 0;
+    int shift = 0;
+    std::vector<uint32_t> bucketStart;
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> ids;
+    std::vector<uint32_t> members;
+    std::vector<uint32_t> large;
+    std::vector<uint64_t> tmpKeys;
+    std::vector<uint32_t> tmpIds;
+    std::vector<uint32_t> tmpBuckets;
+    std::vector<double> tmpExtents;
+};
+
+/// <summary>
+/// Sort and sweep along the x axis. The order of the previous step is kept
+/// and repaired with an insertion sort, which is close to linear since bodies move only a little per step.
+/// </summary>
+struct sweepAndPrune {
+    std::vector<uint32_t> order;
+};
+
+/// <summary>
+/// Computes the bounding boxes of all bodies from their cached vertices
+/// </summary>
+/// <param name="soa">the body store, soaVertices must have run</param>
+/// <param name="box">receives one box per body</param>
+void soaBounds(const bodySoA& soa, struct aabbSoA* box);
+
+/// <summary>
+/// Computes the bounding boxes of the bodies [from, to), box must already hold soa.count entries
+/// </summary>
+/// <param name="soa">the body store, soaVertices must have run</param>
+/// <param name="from">first body</param>
+/// <param name="to">one past the last body</param>
+/// <param name="box">receives the boxes of the range</param>
+void soaBoundsRange(const bodySoA& soa, size_t from, size_t to, struct aabbSoA* box);
+
+/// <summary>
+/// Rebuilds the grid and collects every pair of bodies whose boxes overlap, each pair exactly once
+/// </summary>
+/// <param name="grid">the grid, its buffers are reused between calls</param>
+/// <param name="box">bounding boxes of all bodies</param>
+/// <param name="count">number of bodies</param>
+/// <param name="pairs">receives the candidate pairs, cleared first</param>
+/// <returns>number of candidate pairs</returns>
+size_t gridPairs(struct hashGrid* grid, const aabbSoA& box, size_t count, std::vector<bodyPair>* pairs);
+
+/// <summary>
+/// gridPairs on a subset of the bodies: only the listed bodies go into the grid and only pairs among them are found
+/// </summary>
+/// <param name="grid">the grid, its buffers are reused between calls</param>
+/// <param name="box">bounding boxes, indexed by body</param>
+/// <param name="ids">indices of the bodies</param>
+/// <param name="n">number of indices</param>
+/// <param name="pairs">receives the candidate pairs, cleared first</param>
+/// <returns>number of candidate pairs</returns>
+size_t gridPairsOf(struct hashGrid* grid, const aabbSoA& box, const uint32_t* ids, size_t n, std::vector<bodyPair>* pairs);
+
+/// <summary>
+/// Builds the grid from a subset of the bodies without collecting pairs, to be queried with gridQuery later
+/// </summary>
+/// <param name="grid">the grid</param>
+/// <param name="box">bounding boxes, indexed by body</param>
+/// <param name="ids">indices of the bodies</param>
+/// <param name="n">number of indices</param>
+void gridBuild(struct hashGrid* grid, const aabbSoA& box, const uint32_t* ids, size_t n);
+
+/// <summary>
+/// Appends every pair of a listed body and a body in the grid whose boxes overlap, each pair once.
+/// The listed bodies must not be in the grid.
+/// </summary>
+/// <param name="grid">a grid built with gridBuild, its boxes unchanged since</param>
+/// <param name="box">bounding boxes, indexed by body</param>
+/// <param name="ids">indices of the bodies to look up</param>
+/// <param name="n">number of indices</param>
+/// <param name="pairs">the pairs are appended here</param>
+/// <returns>number of pairs appended</returns>
+size_t gridQuery(const hashGrid& grid, const aabbSoA& box, const uint32_t* ids, size_t n, std::vector<bodyPair>* pairs);
+
+/// <summary>
+/// Re-sorts the bodies along x and collects every pair of bodies whose boxes overlap
+/// </summary>
+/// <param name="sap">the sweep state, its order is reused between calls</param>
+/// <param name="box">bounding boxes of all bodies</param>
+/// <param name="count">number of bodies</param>
+/// <param name="pairs">receives the candidate pairs, cleared first</param>
+/// <returns>number of candidate pairs</returns>
+size_t sweepPairs(struct sweepAndPrune* sap, const aabbSoA& box, size_t count, std::vector<bodyPair>* pairs);
@@ -0,0 +1,242 @@
+#include "checkpoint.h"
+#include <cstring>
+#include <vector>
+
+#include "mapfile.h"
+
+static const uint32_t checkpointVersion = 1;
+/* every array starts on a cache line, and so on a boundary the vector kernels can load from */
+static const uint64_t arrayAlign = 64;
+
+/* the arrays of the body store, in file order; after them come still, next, awake and asleep of the sleep state */
+static const size_t bodyArrays = 17;
+static const size_t checkpointArrays = bodyArrays + 4;
+
+static const std::vector<double>* bodyArray(const bodySoA& b, size_t k) {
+    const std::vector<double>* arrays[bodyArrays] = { &b.x, &b.y, &b.phi, &b.len, &b.vx, &b.vy, &b.omega,
+        &b.invMass, &b.invInertia, &b.restitution, &b.friction,
+        &b.verts.ax, &b.verts.ay, &b.verts.bx, &b.verts.by, &b.verts.cx, &b.verts.cy };
+    return arrays[k];
+}
+
+static std::vector<double>* bodyArray(struct bodySoA* b, size_t k) {
+    return const_cast<std::vector<double>*>(bodyArray(*b, k));
+}
+
+static uint64_t arrayBytes(size_t k, uint64_t bodies, uint64_t awake) {
+    if (k <= bodyArrays)
+        return bodies * sizeof(double);
+    if (k == bodyArrays + 1)
+        return bodies * sizeof(uint32_t);
+    if (k == bodyArrays + 2)
+        return awake * sizeof(uint32_t);
+    return bodies;
+}
+
+/// <summary>
+/// Places the arrays of a checkpoint behind header and table
+/// </summary>
+/// <returns>size of the file</returns>
+static uint64_t layout(uint64_t bodies, uint64_t awake, checkpointArray* table) {
+    uint64_t at = sizeof(checkpointHeader) + checkpointArrays * sizeof(checkpointArray);
+    for (size_t k = 0; k < checkpointArrays; k++) {
+        at = (at + arrayAlign - 1) / arrayAlign * arrayAlign;
+        table[k] = { at, arrayBytes(k, bodies, awake) };
+        at += table[k].bytes;
+    }
+    return at;
+}
+
+/// <summary>
+/// Checks that the sleep state of a checkpoint can be stepped: every index below bodies, awake strictly
+/// ascending and holding exactly the bodies that do not sleep, awake bodies outside any island, and the
+/// next chain of every sleeping body a circle through sleeping bodies back to it
+/// </summary>
+static bool sleepValid(uint64_t bodies, uint64_t awakeCount, const uint32_t* next, const uint32_t* awake, const uint8_t* asleep) {
+    uint64_t sleeping = 0;
+    for (uint64_t i = 0; i < bodies; i++) {
+        if (asleep[i] > 1 || (!asleep[i] && next[i] != UINT32_MAX))
+            return false;
+        sleeping += asleep[i];
+    }
+    if (awakeCount + sleeping != bodies)
+        return false;
+    for (uint64_t k = 0; k < awakeCount; k++)
+        if (awake[k] >= bodies || asleep[awake[k]] || (k && awake[k] <= awake[k - 1]))
+            return false;
+    /* every body is visited once, a chain that runs into another circle or out of the sleepers is refused */
+    std::vector<uint8_t> seen((size_t)bodies, 0);
+    for (uint64_t i = 0; i < bodies; i++) {
+        if (!asleep[i] || seen[i])
+            continue;
+        uint64_t j = i;
+        do {
+            if (j >= bodies || !asleep[j] || seen[j])
+                return false;
+            seen[j] = 1;
+            j = next[j];
+        } while (j != i);
+    }
+    return true;
+}
+
+/// <summary>
+/// Writes the complete state of a scene into a checkpoint file: world, settings, step count, bodies and
+/// which of them sleep. The arrays are copied into a mapping of the file, one memcpy each.
+/// </summary>
+/// <param name="path">the file, replaced if it exists</param>
+/// <param name="sc">the scene; its sleep state is reset first if it does not match the bodies yet</param>
+/// <returns>false if the file could not be created or mapped</returns>
+bool checkpointWrite(const char* path, struct scene* sc) {
+    const bodySoA& b = sc->bodies;
+    sleepState& sl = sc->sleeping;
+    if (sl.bodies != b.count)
+        sleepReset(&sl, b.count);
+    sleepRefresh(&sl);
+
+    checkpointHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, "GLCP", 4);
+    h.version = checkpointVersion;
+    h.headerBytes = sizeof(h);
+    h.arrays = (uint32_t)checkpointArrays;
+    h.bodies = b.count;
+    h.awake = sl.awake.size();
+    h.steps = sc->steps;
+    h.breite = sc->breite;
+    h.hoehe = sc->hoehe;
+    h.dt = sc->dt;
+    h.boundary = sc->cfg.boundary;
+    h.response = sc->cfg.response;
+    h.iterations = sc->cfg.iterations;
+    h.grain = sc->cfg.grain;
+    const integratorConfig& ic = sc->cfg.integrator;
+    h.motion = { (int32_t)ic.kind, ic.maxSubsteps, ic.gravityX, ic.gravityY, ic.drag, ic.maxTravel };
+    const sleepConfig& cs = sc->cfg.sleep;
+    h.sleep = { cs.enabled ? 1 : 0, 0, cs.linear, cs.angular, cs.time };
+
+    checkpointArray table[checkpointArrays];
+    const uint64_t size = layout(h.bodies, h.awake, table);
+    uint8_t* map = mapCreate(path, size);
+    if (!map)
+        return false;
+    std::memcpy(map, &h, sizeof(h));
+    std::memcpy(map + sizeof(h), table, sizeof(table));
+    const void* sources[checkpointArrays];
+    for (size_t k = 0; k < bodyArrays; k++)
+        sources[k] = bodyArray(b, k)->data();
+    sources[bodyArrays] = sl.still.data();
+    sources[bodyArrays + 1] = sl.next.data();
+    sources[bodyArrays + 2] = sl.awake.data();
+    sources[bodyArrays + 3] = sl.asleep.data();
+    for (size_t k = 0; k < checkpointArrays; k++)
+        if (table[k].bytes)
+            std::memcpy(map + table[k].offset, sources[k], (size_t)table[k].bytes);
+    mapRelease(map, size);
+    return true;
+}
+
+/// <summary>
+/// Maps a checkpoint file and points the arrays of the view into it. Of the arrays only the sleep state
+/// is read, to check it; the pages of the body arrays are loaded when they are first touched.
+/// </summary>
+/// <param name="path">the file</param>
+/// <param name="v">a view that is not mapped</param>
+/// <returns>false if the file is missing, not a checkpoint, of another version, cut short or its sleep
+/// state is damaged</returns>
+bool checkpointMap(const char* path, struct checkpointView* v) {
+    uint64_t size = 0;
+    const uint8_t* map = mapRead(path, &size);
+    if (!map)
+        return false;
+    checkpointHeader& h = v->header;
+    checkpointArray table[checkpointArrays], expected[checkpointArrays];
+    bool ok = size >= sizeof(h) + sizeof(table);
+    if (ok) {
+        std::memcpy(&h, map, sizeof(h));
+        std::memcpy(table, map + sizeof(h), sizeof(table));
+        ok = !std::memcmp(h.magic, "GLCP", 4) && h.version == checkpointVersion && h.headerBytes == sizeof(h)
+            && h.arrays == checkpointArrays && h.awake <= h.bodies && h.bodies < UINT32_MAX;
+    }
+    /* the table must be the one this version lays out, which also keeps every array aligned and inside the file */
+    ok = ok && size >= layout(h.bodies, h.awake, expected)
+        && !std::memcmp(table, expected, sizeof(table));
+    /* the sleep state holds indices the scene follows without checks, a damaged one is refused here */
+    ok = ok && sleepValid(h.bodies, h.awake, (const uint32_t*)(map + table[bodyArrays + 1].offset),
+        (const uint32_t*)(map + table[bodyArrays + 2].offset), map + table[bodyArrays + 3].offset);
+    if (!ok) {
+        mapRelease(map, size);
+        return false;
+    }
+
+    v->map = map;
+    v->size = size;
+    const double** doubles[bodyArrays + 1] = { &v->x, &v->y, &v->phi, &v->len, &v->vx, &v->vy, &v->omega,
+        &v->invMass, &v->invInertia, &v->restitution, &v->friction,
+        &v->ax, &v->ay, &v->bx, &v->by, &v->cx, &v->cy, &v->still };
+    for (size_t k = 0; k <= bodyArrays; k++)
+        *doubles[k] = (const double*)(map + table[k].offset);
+    v->next = (const uint32_t*)(map + table[bodyArrays + 1].offset);
+    v->awake = (const uint32_t*)(map + table[bodyArrays + 2].offset);
+    v->asleep = map + table[bodyArrays + 3].offset;
+    return true;
+}
+
+/// <summary>
+/// Makes a scene continue from a mapped checkpoint, bit for bit as the scene that was written would have.
+/// Every array is copied from the mapping in one memcpy. Restoring the same view into several scenes
+/// forks experiments from one state; each fork may then change its settings.
+/// </summary>
+/// <param name="v">a mapped view</param>
+/// <param name="sc">receives the scene, a pool set on it is kept and used</param>
+void checkpointRestore(const checkpointView& v, struct scene* sc) {
+    const checkpointHeader& h = v.header;
+    sceneConfig cfg;
+    cfg.boundary = (boundaryMode)h.boundary;
+    cfg.response = (responseMode)h.response;
+    cfg.iterations = h.iterations;
+    cfg.grain = (size_t)h.grain;
+    cfg.integrator.kind = (integratorKind)h.motion.kind;
+    cfg.integrator.maxSubsteps = h.motion.maxSubsteps;
+    cfg.integrator.gravityX = h.motion.gravityX;
+    cfg.integrator.gravityY = h.motion.gravityY;
+    cfg.integrator.drag = h.motion.drag;
+    cfg.integrator.maxTravel = h.motion.maxTravel;
+    cfg.sleep.enabled = h.sleep.enabled != 0;
+    cfg.sleep.linear = h.sleep.linear;
+    cfg.sleep.angular = h.sleep.angular;
+    cfg.sleep.time = h.sleep.time;
+    jobPool* pool = sc->pool;
+    *sc = makeScene(h.breite, h.hoehe, h.dt, cfg);
+    sc->pool = pool;
+    sc->steps = h.steps;
+
+    const size_t n = (size_t)h.bodies;
+    bodySoA* b = &sc->bodies;
+    b->count = n;
+    const double* arrays[bodyArrays] = { v.x, v.y, v.phi, v.len, v.vx, v.vy, v.omega,
+        v.invMass, v.invInertia, v.restitution, v.friction, v.ax, v.ay, v.bx, v.by, v.cx, v.cy };
+    for (size_t k = 0; k < bodyArrays; k++)
+        bodyArray(b, k)->assign(arrays[k], arrays[k] + n);
+
+    /* the grid of the sleepers is rebuilt from their boxes at the next step, as it would have been */
+    sleepState& sl = sc->sleeping;
+    sl.bodies = n;
+    sl.still.assign(v.still, v.still + n);
+    sl.next.assign(v.next, v.next + n);
+    sl.awake.assign(v.awake, v.awake + h.awake);
+    sl.asleep.assign(v.asleep, v.asleep + n);
+    sl.parent.resize(n);
+    sl.islandStill.resize(n);
+    sl.gridDirty = true;
+}
+
+/// <summary>
+/// Unmaps a checkpoint, the arrays of the view are invalid afterwards
+/// </summary>
+/// <param name="v">the view</param>
+void checkpointUnmap(struct checkpointView* v) {
+    if (v->map)
+        mapRelease(v->map, v->size);
+    *v = checkpointView();
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "scene.h"
+#include "trace.h"
+
+/// <summary>
+/// Fixed part at the start of a checkpoint file. It is followed by a table of arrays (checkpointArray)
+/// and then by the arrays themselves, each starting at a multiple of 64 bytes: every array of the body store
+/// including the cached vertices, count doubles each, then the sleep state. Values are stored in the byte
+/// order of the machine that wrote the checkpoint.
+/// </summary>
+struct checkpointHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t headerBytes;
+    uint32_t arrays;
+    uint64_t bodies;
+    uint64_t awake;
+    int64_t steps;
+    double breite, hoehe, dt;
+    int32_t boundary, response, iterations, reserved;
+    uint64_t grain;
+    traceMotion motion;
+    traceSleep sleep;
+};
+
+/// <summary>
+/// Where one array lies in a checkpoint file: offset from the start of the file and length, both in bytes
+/// </summary>
+struct checkpointArray {
+    uint64_t offset;
+    uint64_t bytes;
+};
+
+/// <summary>
+/// A checkpoint file mapped into memory. The pointers point straight into the mapping, in the layout
+/// of bodySoA and sleepState, so reading a checkpoint copies nothing. They stay valid until checkpointUnmap.
+/// awake holds header.awake entries, all other arrays header.bodies.
+/// </summary>
+struct checkpointView {
+    const uint8_t* map = nullptr;
+    uint64_t size = 0;
+    checkpointHeader header;
+    const double* x = nullptr, * y = nullptr, * phi = nullptr, * len = nullptr;
+    const double* vx = nullptr, * vy = nullptr, * omega = nullptr;
+    const double* invMass = nullptr, * invInertia = nullptr, * restitution = nullptr, * friction = nullptr;
+    const double* ax = nullptr, * ay = nullptr, * bx = nullptr, * by = nullptr, * cx = nullptr, * cy = nullptr;
+    const double* still = nullptr;
+    const uint32_t* next = nullptr;
+    const uint32_t* awake = nullptr;
+    const uint8_t* asleep = nullptr;
+};
+
+/// <summary>
+/// Writes the complete state of a scene into a checkpoint file: world, settings, step count, bodies and
+/// which of them sleep. The arrays are copied into a mapping of the file, one memcpy each.
+/// </summary>
+/// <param name="path">the file, replaced if it exists</param>
+/// <param name="sc">the scene; its sleep state is reset first if it does not match the bodies yet</param>
+/// <returns>false if the file could not be created or mapped</returns>
+bool checkpointWrite(const char* path, struct scene* sc);
+
+/// <summary>
+/// Maps a checkpoint file and points the arrays of the view into it. Of the arrays only the sleep state
+/// is read, to check it; the pages of the body arrays are loaded when they are first touched.
+/// </summary>
+/// <param name="path">the file</param>
+/// <param name="v">a view that is not mapped</param>
+/// <returns>false if the file is missing, not a checkpoint, of another version, cut short or its sleep
+/// state is damaged</returns>
+bool checkpointMap(const char* path, struct checkpointView* v);
+
+/// <summary>
+/// Makes a scene continue from a mapped checkpoint, bit for bit as the scene that was written would have.
+/// Every array is copied from the mapping in one memcpy. Restoring the same view into several scenes
+/// forks experiments from one state; each fork may then change its settings.
+/// </summary>
+/// <param name="v">a mapped view</param>
+/// <param name="sc">receives the scene, a pool set on it is kept and used</param>
+void checkpointRestore(const checkpointView& v, struct scene* sc);
+
+/// <summary>
+/// Unmaps a checkpoint, the arrays of the view are invalid afterwards
+/// </summary>
+/// <param name="v">the view</param>
+void checkpointUnmap(struct checkpointView* v);
@@ -0,0 +1,148 @@
+#include "commands.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+static bool inBox(const bodySelection& s, double x, double y) {
+    return x >= s.lox && x <= s.hix && y >= s.loy && y <= s.hiy;
+}
+
+/// <summary>
+/// Wakes the sleeping bodies among [from, to) that the selection picks
+/// </summary>
+static void wakeSelection(struct scene* sc, const bodySelection& s, size_t from, size_t to) {
+    sleepState& sl = sc->sleeping;
+    if (sl.bodies != sc->bodies.count)
+        return;
+    sleepRefresh(&sl);
+    if (sl.awake.size() == sl.bodies)
+        return;
+    for (size_t i = from; i < to; i++)
+        if (s.kind != SELECT_BOX || inBox(s, sc->bodies.x[i], sc->bodies.y[i]))
+            sleepWake(&sl, (uint32_t)i);
+    sleepCommit(&sl);
+}
+
+/// <summary>
+/// Applies one command to the selected bodies of a scene. A resize is a single vectorized pass
+/// over the selection that also rescales mass and moment of inertia. Selected bodies that sleep are woken.
+/// </summary>
+/// <param name="sc">the scene</param>
+/// <param name="cmd">the command</param>
+void sceneApply(struct scene* sc, const simCommand& cmd) {
+    bodySoA* b = &sc->bodies;
+    const bodySelection& s = cmd.select;
+    size_t from = 0, to = b->count;
+    if (s.kind == SELECT_RANGE) {
+        from = std::min(s.first, b->count);
+        to = from + std::min(s.count, b->count - from);
+    }
+    wakeSelection(sc, s, from, to);
+    if (cmd.kind == CMD_RESIZE) {
+        if (s.kind == SELECT_BOX)
+            soaResizeBox(b, cmd.value, s.lox, s.loy, s.hix, s.hiy);
+        else
+            soaResizeRange(b, from, to, cmd.value);
+        return;
+    }
+    if (s.kind == SELECT_BOX) {
+        for (size_t i = 0; i < b->count; i++)
+            if (inBox(s, b->x[i], b->y[i]))
+                b->omega[i] += b->omega[i] >= 0 ? cmd.value : -cmd.value;
+        return;
+    }
+    for (size_t i = from; i < to; i++)
+        b->omega[i] += b->omega[i] >= 0 ? cmd.value : -cmd.value;
+}
+
+static bool sameSelection(const bodySelection& a, const bodySelection& b) {
+    return a.kind == b.kind && (a.kind != SELECT_RANGE || (a.first == b.first && a.count == b.count))
+        && (a.kind != SELECT_BOX || (a.lox == b.lox && a.loy == b.loy && a.hix == b.hix && a.hiy == b.hiy));
+}
+
+/// <summary>
+/// Applies every queued command stamped before a point in simulation time, in order. Runs of
+/// resizes on the same selection are folded into one command, so they cost one pass together.
+/// </summary>
+/// <param name="ring">the queue, called from its consumer thread</param>
+/// <param name="sc">the scene</param>
+/// <param name="until">simulation time, commands stamped at or after it stay queued</param>
+/// <param name="trace">if set, every applied command is recorded into it; recording stops at the first
+/// command that can not be written, the writer keeps the failure</param>
+/// <returns>number of commands applied after folding</returns>
+size_t commandDrain(struct commandRing* ring, struct scene* sc, double until, struct traceWriter* trace) {
+    size_t applied = 0;
+    simCommand cmd, next;
+    while (commandPeek(*ring, &cmd) && cmd.time < until) {
+        commandPop(ring, &cmd);
+        /* spins do not fold: whether one adds or subtracts depends on the sign the previous one left */
+        while (cmd.kind == CMD_RESIZE && commandPeek(*ring, &next) && next.time < until
+            && next.kind == CMD_RESIZE && sameSelection(cmd.select, next.select)) {
+            commandPop(ring, &next);
+            cmd.value *= next.value;
+        }
+        sceneApply(sc, cmd);
+        if (trace && !traceCommand(trace, cmd))
+            trace = nullptr;
+        applied++;
+    }
+    return applied;
+}
+
+/// <summary>
+/// Reads a command script
+/// </summary>
+/// <param name="path">the file</param>
+/// <param name="script">receives the commands</param>
+/// <returns>false if the file can not be read or a line is malformed</returns>
+bool scriptLoad(const char* path, struct commandScript* script) {
+    *script = commandScript();
+    FILE* f = std::fopen(path, "r");
+    if (!f)
+        return false;
+    char line[256], kind[16], select[16];
+    bool ok = true;
+    while (ok && std::fgets(line, sizeof(line), f)) {
+        simCommand cmd;
+        int used = 0;
+        if (std::sscanf(line, " %15s", kind) != 1 || kind[0] == '#')
+            continue;
+        ok = std::sscanf(line, "%lf %15s %lf %n", &cmd.time, kind, &cmd.value, &used) == 3;
+        if (!ok)
+            break;
+        ok = !std::strcmp(kind, "resize") || !std::strcmp(kind, "spin");
+        cmd.kind = !std::strcmp(kind, "resize") ? CMD_RESIZE : CMD_SPIN;
+        if (ok && std::sscanf(line + used, "%15s", select) == 1) {
+            bodySelection& s = cmd.select;
+            const char* rest = line + used + std::strspn(line + used, " \t") + std::strlen(select);
+            if (!std::strcmp(select, "range")) {
+                s.kind = SELECT_RANGE;
+                ok = std::sscanf(rest, "%zu %zu", &s.first, &s.count) == 2;
+            }
+            else if (!std::strcmp(select, "box")) {
+                s.kind = SELECT_BOX;
+                ok = std::sscanf(rest, "%lf %lf %lf %lf", &s.lox, &s.loy, &s.hix, &s.hiy) == 4;
+            }
+            else
+                ok = !std::strcmp(select, "all");
+        }
+        ok = ok && (script->commands.empty() || cmd.time >= script->commands.back().time);
+        if (ok)
+            script->commands.push_back(cmd);
+    }
+    std::fclose(f);
+    return ok;
+}
+
+/// <summary>
+/// Queues as many of the remaining commands of a script as the ring takes. Commands carry their own
+/// time, so they may be queued long before they are due.
+/// </summary>
+/// <param name="script">the script</param>
+/// <param name="ring">the queue, called from its producer thread</param>
+/// <returns>true once every command has been queued</returns>
+bool scriptFeed(struct commandScript* script, struct commandRing* ring) {
+    while (script->next < script->commands.size() && commandPush(ring, script->commands[script->next]))
+        script->next++;
+    return script->next == script->commands.size();
+}
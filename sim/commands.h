@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "handoff.h"
+#include "scene.h"
+#include "trace.h"
+
+/// <summary>
+/// Commands read from a text file, to drive a run without a keyboard. Every line is
+/// "time resize|spin value [all | range first count | box lox loy hix hiy]", time in simulation
+/// seconds and non-decreasing; empty lines and lines starting with # are skipped.
+/// </summary>
+struct commandScript {
+    std::vector<simCommand> commands;
+    size_t next = 0;
+};
+
+/// <summary>
+/// Applies one command to the selected bodies of a scene. A resize is a single vectorized pass
+/// over the selection that also rescales mass and moment of inertia. Selected bodies that sleep are woken.
+/// </summary>
+/// <param name="sc">the scene</param>
+/// <param name="cmd">the command</param>
+void sceneApply(struct scene* sc, const simCommand& cmd);
+
+/// <summary>
+/// Applies every queued command stamped before a point in simulation time, in order. Runs of
+/// resizes on the same selection are folded into one command, so they cost one pass together.
+/// </summary>
+/// <param name="ring">the queue, called from its consumer thread</param>
+/// <param name="sc">the scene</param>
+/// <param name="until">simulation time, commands stamped at or after it stay queued</param>
+/// <param name="trace">if set, every applied command is recorded into it; recording stops at the first
+/// command that can not be written, the writer keeps the failure</param>
+/// <returns>number of commands applied after folding</returns>
+size_t commandDrain(struct commandRing* ring, struct scene* sc, double until, struct traceWriter* trace);
+
+/// <summary>
+/// Reads a command script
+/// </summary>
+/// <param name="path">the file</param>
+/// <param name="script">receives the commands</param>
+/// <returns>false if the file can not be read or a line is malformed</returns>
+bool scriptLoad(const char* path, struct commandScript* script);
+
+/// <summary>
+/// Queues as many of the remaining commands of a script as the ring takes. Commands carry their own
+/// time, so they may be queued long before they are due.
+/// </summary>
+/// <param name="script">the script</param>
+/// <param name="ring">the queue, called from its producer thread</param>
+/// <returns>true once every command has been queued</returns>
+bool scriptFeed(struct commandScript* script, struct commandRing* ring);
@@ -0,0 +1,176 @@
+#define _USE_MATH_DEFINES
+#include "handoff.h"
+#include <algorithm>
+#include <cmath>
+
+/* set in middle when the writer published into it and the reader has not taken it yet */
+static const unsigned FRESH = 4;
+
+static void reserveSnapshot(struct snapshot* s, size_t capacity) {
+    for (std::vector<double>* v : { &s->x0, &s->y0, &s->phi0, &s->x, &s->y, &s->phi, &s->len, &s->omega })
+        v->reserve(capacity);
+}
+
+/// <summary>
+/// Preallocates all three slots for up to capacity bodies
+/// </summary>
+/// <param name="buf">the triple buffer</param>
+/// <param name="capacity">largest number of bodies that will be handed over</param>
+void bufferInit(struct tripleBuffer* buf, size_t capacity) {
+    for (snapshot& s : buf->slots)
+        reserveSnapshot(&s, capacity);
+    buf->capacity = capacity;
+}
+
+/// <summary>
+/// Slot the writer fills next, owned by the writer until bufferPublish
+/// </summary>
+/// <param name="buf">the triple buffer</param>
+/// <returns>the back slot</returns>
+snapshot* bufferBack(struct tripleBuffer* buf) {
+    return &buf->slots[buf->back];
+}
+
+/// <summary>
+/// Hands the back slot to the reader and takes over the slot the reader left behind
+/// </summary>
+/// <param name="buf">the triple buffer</param>
+void bufferPublish(struct tripleBuffer* buf) {
+    unsigned prev = buf->middle.exchange(buf->back | FRESH, std::memory_order_acq_rel);
+    buf->back = prev & 3;
+}
+
+/// <summary>
+/// Takes over the latest published snapshot, if there is a newer one than the last call returned
+/// </summary>
+/// <param name="buf">the triple buffer</param>
+/// <param name="fresh">set to whether the snapshot is new since the last call, may be null</param>
+/// <returns>the front slot, owned by the reader until the next call</returns>
+const snapshot* bufferRead(struct tripleBuffer* buf, bool* fresh) {
+    bool isNew = (buf->middle.load(std::memory_order_acquire) & FRESH) != 0;
+    if (isNew) {
+        unsigned prev = buf->middle.exchange(buf->front, std::memory_order_acq_rel);
+        buf->front = prev & 3;
+    }
+    if (fresh)
+        *fresh = isNew;
+    return &buf->slots[buf->front];
+}
+
+/// <summary>
+/// Copies the current pose of every body into the before-step arrays of a snapshot
+/// </summary>
+/// <param name="s">the snapshot, its capacity must hold soa.count bodies</param>
+/// <param name="soa">the body store</param>
+void snapshotBefore(struct snapshot* s, const bodySoA& soa) {
+    const size_t n = soa.count;
+    s->x0.resize(n);
+    s->y0.resize(n);
+    s->phi0.resize(n);
+    std::copy(soa.x.begin(), soa.x.begin() + n, s->x0.begin());
+    std::copy(soa.y.begin(), soa.y.begin() + n, s->y0.begin());
+    std::copy(soa.phi.begin(), soa.phi.begin() + n, s->phi0.begin());
+}
+
+/// <summary>
+/// Copies the current state of every body into a snapshot
+/// </summary>
+/// <param name="s">the snapshot, its capacity must hold soa.count bodies</param>
+/// <param name="soa">the body store</param>
+/// <param name="step">number of steps done</param>
+/// <param name="dt">timestep</param>
+void snapshotAfter(struct snapshot* s, const bodySoA& soa, long long step, double dt) {
+    const size_t n = soa.count;
+    s->step = step;
+    s->simTime = step * dt;
+    s->dt = dt;
+    s->count = n;
+    s->x.resize(n);
+    s->y.resize(n);
+    s->phi.resize(n);
+    s->len.resize(n);
+    s->omega.resize(n);
+    std::copy(soa.x.begin(), soa.x.begin() + n, s->x.begin());
+    std::copy(soa.y.begin(), soa.y.begin() + n, s->y.begin());
+    std::copy(soa.phi.begin(), soa.phi.begin() + n, s->phi.begin());
+    std::copy(soa.len.begin(), soa.len.begin() + n, s->len.begin());
+    std::copy(soa.omega.begin(), soa.omega.begin() + n, s->omega.begin());
+}
+
+/// <summary>
+/// Interpolation factor between the before and after pose for a point in simulation time.
+/// Rendering one step behind the simulation keeps it within [0, 1].
+/// </summary>
+/// <param name="s">the snapshot</param>
+/// <param name="renderTime">simulation time of the frame</param>
+/// <returns>0 for the pose before the step, 1 for the pose after it, clamped</returns>
+double snapshotAlpha(const snapshot& s, double renderTime) {
+    if (s.dt <= 0)
+        return 1;
+    double a = (renderTime - (s.simTime - s.dt)) / s.dt;
+    return std::min(std::max(a, 0.0), 1.0);
+}
+
+/// <summary>
+/// Triangle of one body, interpolated between the pose before and after the step.
+/// The angle takes the short way around, so a wrap from pi to -pi does not spin the triangle.
+/// </summary>
+/// <param name="s">the snapshot</param>
+/// <param name="i">index of the body</param>
+/// <param name="alpha">interpolation factor from snapshotAlpha</param>
+/// <returns>the triangle with absolute vertex positions</returns>
+triangle snapshotTriangle(const snapshot& s, size_t i, double alpha) {
+    const bool before = i < s.x0.size();
+    double x0 = before ? s.x0[i] : s.x[i], y0 = before ? s.y0[i] : s.y[i], p0 = before ? s.phi0[i] : s.phi[i];
+    double dp = s.phi[i] - p0;
+    dp -= 2 * M_PI * nearbyint(dp * (0.5 / M_PI));
+    triangle t;
+    t.zZ.x = x0 + (s.x[i] - x0) * alpha;
+    t.zZ.y = y0 + (s.y[i] - y0) * alpha;
+    triPose(&t, p0 + dp * alpha, s.len[i]);
+    return t;
+}
+
+/// <summary>
+/// Queues a command, called by the render thread only
+/// </summary>
+/// <param name="ring">the ring</param>
+/// <param name="cmd">the command</param>
+/// <returns>false if the ring is full and the command was dropped</returns>
+bool commandPush(struct commandRing* ring, simCommand cmd) {
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) == commandRing::size)
+        return false;
+    ring->items[head % commandRing::size] = cmd;
+    ring->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+/// <summary>
+/// Takes the oldest command, called by the physics thread only
+/// </summary>
+/// <param name="ring">the ring</param>
+/// <param name="cmd">receives the command</param>
+/// <returns>false if the ring is empty</returns>
+bool commandPop(struct commandRing* ring, simCommand* cmd) {
+    size_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (tail == ring->head.load(std::memory_order_acquire))
+        return false;
+    *cmd = ring->items[tail % commandRing::size];
+    ring->tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+/// <summary>
+/// Looks at the oldest command without taking it, called by the physics thread only
+/// </summary>
+/// <param name="ring">the ring</param>
+/// <param name="cmd">receives the command</param>
+/// <returns>false if the ring is empty</returns>
+bool commandPeek(const commandRing& ring, simCommand* cmd) {
+    size_t tail = ring.tail.load(std::memory_order_relaxed);
+    if (tail == ring.head.load(std::memory_order_acquire))
+        return false;
+    *cmd = ring.items[tail % commandRing::size];
+    return true;
+}
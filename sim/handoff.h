@@ -0,0 +1,165 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "sim.h"
+#include "soa.h"
+
+/// <summary>
+/// State of all bodies after one physics step, as handed to the renderer. The pose before the step
+/// (x0, y0, phi0) travels along, so the renderer can interpolate inside a single snapshot.
+/// </summary>
+struct snapshot {
+    long long step = 0;
+    double simTime = 0;
+    double dt = 0;
+    size_t count = 0;
+    std::vector<double> x0, y0, phi0;
+    std::vector<double> x, y, phi, len, omega;
+};
+
+/// <summary>
+/// Lock-free triple buffer between one writer and one reader. The writer fills back, the reader
+/// looks at front, and middle holds the slot in between together with a flag telling whether the
+/// writer put something new there. Neither side ever waits and the reader always gets the latest
+/// complete snapshot. Slots are preallocated by bufferInit, so a handoff never allocates as long as
+/// the body count stays within the capacity.
+/// </summary>
+struct tripleBuffer {
+    snapshot slots[3];
+    std::atomic<unsigned> middle{ 1 };
+    unsigned back = 0;
+    unsigned front = 2;
+    size_t capacity = 0;
+};
+
+/// <summary>
+/// Kind of an input command from the render thread
+/// </summary>
+enum commandKind { CMD_RESIZE, CMD_SPIN };
+
+/// <summary>
+/// How a command picks its bodies
+/// </summary>
+enum selectKind { SELECT_ALL, SELECT_RANGE, SELECT_BOX };
+
+/// <summary>
+/// Bodies a command applies to: all of them, the indices [first, first + count),
+/// or those whose center lies in the box [lox, hix] x [loy, hiy]
+/// </summary>
+struct bodySelection {
+    selectKind kind = SELECT_ALL;
+    size_t first = 0;
+    size_t count = 0;
+    double lox = 0, loy = 0, hix = 0, hiy = 0;
+};
+
+/// <summary>
+/// An input command. CMD_RESIZE multiplies the size of the selected bodies by value,
+/// CMD_SPIN adds value to their angular speed, away from zero. time is the simulation time the
+/// command was given at; the physics applies it before the step that covers this time.
+/// </summary>
+struct simCommand {
+    commandKind kind;
+    double value;
+    double time = 0;
+    bodySelection select;
+};
+
+/// <summary>
+/// Fixed size lock-free single producer, single consumer ring of commands, from the render thread to the physics thread
+/// </summary>
+struct commandRing {
+    static const size_t size = 256;
+    simCommand items[size];
+    std::atomic<size_t> head{ 0 };
+    std::atomic<size_t> tail{ 0 };
+};
+
+/// <summary>
+/// Preallocates all three slots for up to capacity bodies
+/// </summary>
+/// <param name="buf">the triple buffer</param>
+/// <param name="capacity">largest number of bodies that will be handed over</param>
+void bufferInit(struct tripleBuffer* buf, size_t capacity);
+
+/// <summary>
+/// Slot the writer fills next, owned by the writer until bufferPublish
+/// </summary>
+/// <param name="buf">the triple buffer</param>
+/// <returns>the back slot</returns>
+snapshot* bufferBack(struct tripleBuffer* buf);
+
+/// <summary>
+/// Hands the back slot to the reader and takes over the slot the reader left behind
+/// </summary>
+/// <param name="buf">the triple buffer</param>
+void bufferPublish(struct tripleBuffer* buf);
+
+/// <summary>
+/// Takes over the latest published snapshot, if there is a newer one than the last call returned
+/// </summary>
+/// <param name="buf">the triple buffer</param>
+/// <param name="fresh">set to whether the snapshot is new since the last call, may be null</param>
+/// <returns>the front slot, owned by the reader until the next call</returns>
+const snapshot* bufferRead(struct tripleBuffer* buf, bool* fresh);
+
+/// <summary>
+/// Copies the current pose of every body into the before-step arrays of a snapshot
+/// </summary>
+/// <param name="s">the snapshot, its capacity must hold soa.count bodies</param>
+/// <param name="soa">the body store</param>
+void snapshotBefore(struct snapshot* s, const bodySoA& soa);
+
+/// <summary>
+/// Copies the current state of every body into a snapshot
+/// </summary>
+/// <param name="s">the snapshot, its capacity must hold soa.count bodies</param>
+/// <param name="soa">the body store</param>
+/// <param name="step">number of steps done</param>
+/// <param name="dt">timestep</param>
+void snapshotAfter(struct snapshot* s, const bodySoA& soa, long long step, double dt);
+
+/// <summary>
+/// Interpolation factor between the before and after pose for a point in simulation time.
+/// Rendering one step behind the simulation keeps it within [0, 1].
+/// </summary>
+/// <param name="s">the snapshot</param>
+/// <param name="renderTime">simulation time of the frame</param>
+/// <returns>0 for the pose before the step, 1 for the pose after it, clamped</returns>
+double snapshotAlpha(const snapshot& s, double renderTime);
+
+/// <summary>
+/// Triangle of one body, interpolated between the pose before and after the step.
+/// The angle takes the short way around, so a wrap from pi to -pi does not spin the triangle.
+/// </summary>
+/// <param name="s">the snapshot</param>
+/// <param name="i">index of the body</param>
+/// <param name="alpha">interpolation factor from snapshotAlpha</param>
+/// <returns>the triangle with absolute vertex positions</returns>
+triangle snapshotTriangle(const snapshot& s, size_t i, double alpha);
+
+/// <summary>
+/// Queues a command, called by the render thread only
+/// </summary>
+/// <param name="ring">the ring</param>
+/// <param name="cmd">the command</param>
+/// <returns>false if the ring is full and the command was dropped</returns>
+bool commandPush(struct commandRing* ring, simCommand cmd);
+
+/// <summary>
+/// Takes the oldest command, called by the physics thread only
+/// </summary>
+/// <param name="ring">the ring</param>
+/// <param name="cmd">receives the command</param>
+/// <returns>false if the ring is empty</returns>
+bool commandPop(struct commandRing* ring, simCommand* cmd);
+
+/// <summary>
+/// Looks at the oldest command without taking it, called by the physics thread only
+/// </summary>
+/// <param name="ring">the ring</param>
+/// <param name="cmd">receives the command</param>
+/// <returns>false if the ring is empty</returns>
+bool commandPeek(const commandRing& ring, simCommand* cmd);
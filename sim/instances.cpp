@@ -0,0 +1,39 @@
+#define _USE_MATH_DEFINES
+#include "instances.h"
+#include <cmath>
+
+/// <summary>
+/// Writes one instance per body of a snapshot, interpolated between the pose before and after its step
+/// </summary>
+/// <param name="s">the snapshot</param>
+/// <param name="alpha">interpolation factor from snapshotAlpha</param>
+/// <param name="out">receives s.count instances, typically a mapped GPU buffer</param>
+void packInstances(const snapshot& s, double alpha, struct instance* out) {
+    const size_t n = s.count;
+    if (s.x0.size() < n) {
+        for (size_t i = 0; i < n; i++)
+            out[i] = { (float)s.x[i], (float)s.y[i], (float)s.phi[i], (float)s.len[i] };
+        return;
+    }
+    const double* x0 = s.x0.data(), * y0 = s.y0.data(), * p0 = s.phi0.data();
+    const double* x1 = s.x.data(), * y1 = s.y.data(), * p1 = s.phi.data(), * len = s.len.data();
+    for (size_t i = 0; i < n; i++) {
+        /* the angle takes the short way around, like snapshotTriangle */
+        double dp = p1[i] - p0[i];
+        dp -= 2 * M_PI * nearbyint(dp * (0.5 / M_PI));
+        out[i].x = (float)(x0[i] + (x1[i] - x0[i]) * alpha);
+        out[i].y = (float)(y0[i] + (y1[i] - y0[i]) * alpha);
+        out[i].phi = (float)(p0[i] + dp * alpha);
+        out[i].len = (float)len[i];
+    }
+}
+
+/// <summary>
+/// Writes one instance per body of the store, at its current pose
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="out">receives soa.count instances</param>
+void packInstancesSoA(const bodySoA& soa, struct instance* out) {
+    for (size_t i = 0; i < soa.count; i++)
+        out[i] = { (float)soa.x[i], (float)soa.y[i], (float)soa.phi[i], (float)soa.len[i] };
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+
+#include "handoff.h"
+#include "soa.h"
+
+/// <summary>
+/// Per body data of the instanced renderer: center, orientation and side length in world units.
+/// The vertex shader turns this into the three vertices and scales them to normalized device coordinates,
+/// so the CPU writes 16 bytes per body instead of three transformed vertices.
+/// </summary>
+struct instance {
+    float x, y, phi, len;
+};
+
+/// <summary>
+/// Writes one instance per body of a snapshot, interpolated between the pose before and after its step
+/// </summary>
+/// <param name="s">the snapshot</param>
+/// <param name="alpha">interpolation factor from snapshotAlpha</param>
+/// <param name="out">receives s.count instances, typically a mapped GPU buffer</param>
+void packInstances(const snapshot& s, double alpha, struct instance* out);
+
+/// <summary>
+/// Writes one instance per body of the store, at its current pose
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="out">receives soa.count instances</param>
+void packInstancesSoA(const bodySoA& soa, struct instance* out);
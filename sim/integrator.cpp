@@ -0,0 +1,301 @@
+#define _USE_MATH_DEFINES
+#include "integrator.h"
+#include <algorithm>
+#include <cmath>
+
+/* distance of a vertex from the center of a triangle with side length 1 */
+static const double vertexRadius = 0.57735026918962573;
+
+static inline bool hasForces(const integratorConfig& ic) {
+    return ic.gravityX != 0 || ic.gravityY != 0 || ic.drag != 0;
+}
+
+/// <summary>
+/// On dv/dt = force - drag * v, one step of h of each integrator comes down to two factors: with
+/// a = force - drag * v at the start, the coordinate moves by (v + travel * a) * h and the velocity
+/// ends at v + end * a. They are the Taylor series of the exact solution, cut after the order of the integrator.
+/// </summary>
+struct stepFactors {
+    double travel, end;
+};
+
+static stepFactors factorsOf(const integratorConfig& ic, double h) {
+    const double z = ic.drag * h;
+    switch (ic.kind) {
+    case INTEGRATE_VERLET:
+        return { h / 2, h * (1 - z / 2) };
+    case INTEGRATE_RK4:
+        return { h * (0.5 - z / 6 + z * z / 24), h * (1 - z / 2 + z * z / 6 - z * z * z / 24) };
+    default:
+        return { h, h };
+    }
+}
+
+/// <summary>
+/// Advances the velocities vel = (vx, vy, omega) by h and returns the distance every coordinate
+/// (x, y, phi) moves in move. The three axes do not couple, acceleration is force[k] - drag * vel[k].
+/// </summary>
+static void advance(const integratorConfig& ic, double h, double vel[3], double move[3]) {
+    const double force[3] = { ic.gravityX, ic.gravityY, 0 };
+    const stepFactors f = factorsOf(ic, h);
+    for (int k = 0; k < 3; k++) {
+        const double v = vel[k], a = force[k] - ic.drag * v;
+        move[k] = (v + f.travel * a) * h;
+        vel[k] = v + f.end * a;
+    }
+}
+
+/// <summary>
+/// Advances one body by h under the forces of the settings, without border handling.
+/// phi is not wrapped.
+/// </summary>
+/// <param name="m">the body</param>
+/// <param name="ic">integrator and forces</param>
+/// <param name="h">timestep</param>
+void integrateMotion(struct motionState* m, const integratorConfig& ic, double h) {
+    double vel[3] = { m->vx, m->vy, m->omega }, move[3];
+    advance(ic, h, vel, move);
+    m->x += move[0];
+    m->y += move[1];
+    m->phi += move[2];
+    m->vx = vel[0];
+    m->vy = vel[1];
+    m->omega = vel[2];
+}
+
+/// <summary>
+/// Number of sub-steps body i needs for a step of dt: its vertices move at most |v| + |omega| * r,
+/// r the distance of a vertex from the center, and may travel maxTravel * len per sub-step
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="i">index of the body</param>
+/// <param name="dt">timestep</param>
+/// <param name="ic">settings</param>
+/// <returns>1 for a slow body, at most ic.maxSubsteps</returns>
+int substepCount(const bodySoA& soa, size_t i, double dt, const integratorConfig& ic) {
+    const double len = soa.len[i];
+    const double travel = (std::sqrt(soa.vx[i] * soa.vx[i] + soa.vy[i] * soa.vy[i])
+        + std::fabs(soa.omega[i]) * vertexRadius * len) * dt;
+    const double limit = ic.maxTravel * len;
+    if (ic.maxSubsteps <= 1 || !(travel > limit))
+        return 1;
+    return (int)std::min((double)ic.maxSubsteps, std::ceil(travel / limit));
+}
+
+/// <summary>
+/// Advances body i by one sub-step of h: velocities and orientation with the integrator, then the vertices
+/// at the old center. Returns the distance the center has to travel in tx, ty.
+/// </summary>
+static void substepMotion(struct bodySoA* soa, size_t i, const integratorConfig& ic, double h, double* tx, double* ty) {
+    double vel[3] = { soa->vx[i], soa->vy[i], soa->omega[i] }, move[3];
+    advance(ic, h, vel, move);
+    const double p = soa->phi[i] + move[2];
+    soa->phi[i] = p - 2 * M_PI * nearbyint(p * (0.5 / M_PI));
+    soa->vx[i] = vel[0];
+    soa->vy[i] = vel[1];
+    soa->omega[i] = vel[2];
+    soaVerticesRange(soa, i, i + 1);
+    *tx = move[0];
+    *ty = move[1];
+}
+
+static inline void bodyBounds(const vertexSoA& v, size_t i, double* loX, double* hiX, double* loY, double* hiY) {
+    *loX = std::min(v.ax[i], std::min(v.bx[i], v.cx[i]));
+    *hiX = std::max(v.ax[i], std::max(v.bx[i], v.cx[i]));
+    *loY = std::min(v.ay[i], std::min(v.by[i], v.cy[i]));
+    *hiY = std::max(v.ay[i], std::max(v.by[i], v.cy[i]));
+}
+
+static inline void moveBody(struct bodySoA* soa, size_t i, double dx, double dy) {
+    vertexSoA& v = soa->verts;
+    soa->x[i] += dx;
+    soa->y[i] += dy;
+    v.ax[i] += dx; v.bx[i] += dx; v.cx[i] += dx;
+    v.ay[i] += dy; v.by[i] += dy; v.cy[i] += dy;
+}
+
+/// <summary>
+/// Advances body i by dt in n sub-steps, each one swept against the borders like soaSweep
+/// </summary>
+/// <returns>true if the body hit a border</returns>
+static bool sweepSubsteps(struct bodySoA* soa, size_t i, int n, double dt, const integratorConfig& ic,
+    double breite, double hoehe) {
+    const double h = dt / n;
+    bool hits = false;
+    for (int s = 0; s < n; s++) {
+        double tx, ty, loX, hiX, loY, hiY;
+        substepMotion(soa, i, ic, h, &tx, &ty);
+        bodyBounds(soa->verts, i, &loX, &hiX, &loY, &hiY);
+        double mx = tx, my = ty;
+        bool hit = false;
+        if (loX + std::min(tx, 0.0) < -breite || hiX + std::max(tx, 0.0) > breite)
+            hit |= axisSweep(loX, hiX, &soa->vx[i], tx, breite, &mx);
+        if (loY + std::min(ty, 0.0) < -hoehe || hiY + std::max(ty, 0.0) > hoehe)
+            hit |= axisSweep(loY, hiY, &soa->vy[i], ty, hoehe, &my);
+        moveBody(soa, i, mx, my);
+        if (hit) {
+            soa->omega[i] = -soa->omega[i];
+            hits = true;
+        }
+    }
+    return hits;
+}
+
+/// <summary>
+/// Advances body i by dt in up to n sub-steps without border response, stopping after the first one
+/// that ends inside a wall
+/// </summary>
+/// <returns>number of sub-steps taken</returns>
+static int moveSubsteps(struct bodySoA* soa, size_t i, int n, double dt, const integratorConfig& ic,
+    double breite, double hoehe) {
+    const double h = dt / n;
+    for (int s = 0; s < n; s++) {
+        double tx, ty, loX, hiX, loY, hiY;
+        substepMotion(soa, i, ic, h, &tx, &ty);
+        moveBody(soa, i, tx, ty);
+        bodyBounds(soa->verts, i, &loX, &hiX, &loY, &hiY);
+        if (loX < -breite || hiX > breite || loY < -hoehe || hiY > hoehe)
+            return s + 1;
+    }
+    return n;
+}
+
+/* bodies per block of the force pass, their end velocities are kept on the stack */
+static const size_t forceBlock = 256;
+
+/// <summary>
+/// One step of the slow bodies [from, to) under forces. A pass over the arrays sets every velocity to the one
+/// the body travels with in this step, the vectorized kernels move the bodies by it (soaStepRange with
+/// borders, soaIntegrateRange without), and a second pass sets the velocities the step ends with.
+/// A velocity the border turned takes its new direction along.
+/// </summary>
+/// <returns>number of border hits</returns>
+static size_t forceRun(struct bodySoA* soa, size_t from, size_t to, double breite, double hoehe, double dt,
+    const boundaryMode* boundary, const integratorConfig& ic) {
+    const double force[3] = { ic.gravityX, ic.gravityY, 0 };
+    const stepFactors f = factorsOf(ic, dt);
+    double* vel[3] = { soa->vx.data(), soa->vy.data(), soa->omega.data() };
+    double travel[3][forceBlock], end[3][forceBlock];
+    size_t hits = 0;
+    for (size_t first = from; first < to; first += forceBlock) {
+        const size_t n = std::min(forceBlock, to - first);
+        for (int k = 0; k < 3; k++) {
+            double* v = vel[k] + first;
+            for (size_t j = 0; j < n; j++) {
+                const double a = force[k] - ic.drag * v[j];
+                end[k][j] = v[j] + f.end * a;
+                travel[k][j] = v[j] = v[j] + f.travel * a;
+            }
+        }
+        if (boundary)
+            hits += soaStepRange(soa, first, first + n, breite, hoehe, dt, *boundary);
+        else
+            soaIntegrateRange(soa, first, first + n, dt);
+        for (int k = 0; k < 2; k++) {
+            double* v = vel[k] + first;
+            for (size_t j = 0; j < n; j++)
+                v[j] = v[j] == travel[k][j] ? end[k][j] : std::copysign(end[k][j], v[j]);
+        }
+        double* w = vel[2] + first;
+        for (size_t j = 0; j < n; j++)
+            w[j] = w[j] == travel[2][j] ? end[2][j] : -end[2][j];
+    }
+    return hits;
+}
+
+/// <summary>
+/// soaStepRange with the integrator: one timestep on the bodies [from, to) including the borders.
+/// Runs of slow bodies go through the vectorized soaStepRange, after a pass that applies the forces to their
+/// velocities; only fast bodies are advanced on their own in substepCount swept sub-steps, so the cost
+/// grows with the number of fast bodies only.
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="from">first body</param>
+/// <param name="to">one past the last body</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="dt">timestep</param>
+/// <param name="boundary">border handling of the vectorized runs, sub-steps always sweep</param>
+/// <param name="ic">integrator, forces and sub-stepping</param>
+/// <param name="stats">receives border hits, fast bodies and the sub-steps they took</param>
+void integrateStepRange(struct bodySoA* soa, size_t from, size_t to, double breite, double hoehe, double dt,
+    boundaryMode boundary, const integratorConfig& ic, struct integrateStats* stats) {
+    integrateStats st;
+    const bool forces = hasForces(ic);
+    auto slow = [&](size_t first, size_t last) {
+        return forces ? forceRun(soa, first, last, breite, hoehe, dt, &boundary, ic)
+            : soaStepRange(soa, first, last, breite, hoehe, dt, boundary);
+    };
+    if (ic.maxSubsteps <= 1) {
+        st.hits = slow(from, to);
+        *stats = st;
+        return;
+    }
+    size_t run = from;
+    for (size_t i = from; i < to; i++) {
+        const int n = substepCount(*soa, i, dt, ic);
+        if (n == 1)
+            continue;
+        if (run < i)
+            st.hits += slow(run, i);
+        run = i + 1;
+        st.hits += sweepSubsteps(soa, i, n, dt, ic, breite, hoehe);
+        st.fast++;
+        st.substeps += n;
+    }
+    if (run < to)
+        st.hits += slow(run, to);
+    *stats = st;
+}
+
+/// <summary>
+/// soaIntegrateRange with the integrator, for the impulse solver: moves the bodies [from, to) and derives
+/// their vertices without border response. A fast body stops after the first sub-step that ends inside a
+/// wall, so it reaches the solver with a shallow penetration instead of a deep one.
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="from">first body</param>
+/// <param name="to">one past the last body</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="dt">timestep</param>
+/// <param name="ic">integrator, forces and sub-stepping</param>
+/// <param name="stats">receives fast bodies and the sub-steps they took</param>
+void integrateMoveRange(struct bodySoA* soa, size_t from, size_t to, double breite, double hoehe, double dt,
+    const integratorConfig& ic, struct integrateStats* stats) {
+    integrateStats st;
+    const bool forces = hasForces(ic);
+    auto slow = [&](size_t first, size_t last) {
+        if (forces)
+            forceRun(soa, first, last, breite, hoehe, dt, nullptr, ic);
+        else
+            soaIntegrateRange(soa, first, last, dt);
+    };
+    if (ic.maxSubsteps <= 1) {
+        slow(from, to);
+        *stats = st;
+        return;
+    }
+    size_t run = from;
+    for (size_t i = from; i < to; i++) {
+        const int n = substepCount(*soa, i, dt, ic);
+        if (n == 1)
+            continue;
+        if (run < i)
+            slow(run, i);
+        run = i + 1;
+        st.fast++;
+        st.substeps += moveSubsteps(soa, i, n, dt, ic, breite, hoehe);
+    }
+    if (run < to)
+        slow(run, to);
+    *stats = st;
+}
+
+/// <summary>
+/// Name of an integrator
+/// </summary>
+/// <returns>"euler", "verlet" or "rk4"</returns>
+const char* integratorName(integratorKind kind) {
+    return kind == INTEGRATE_RK4 ? "rk4" : kind == INTEGRATE_VERLET ? "verlet" : "euler";
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+
+#include "soa.h"
+
+/// <summary>
+/// How velocities and positions are advanced under the forces of an integratorConfig.
+/// INTEGRATE_EULER is semi-implicit (symplectic) Euler: velocity first, then position with the new velocity.
+/// INTEGRATE_VERLET is velocity Verlet, second order. INTEGRATE_RK4 is classic fourth order Runge-Kutta.
+/// Without forces the velocities stay constant and the three agree.
+/// </summary>
+enum integratorKind { INTEGRATE_EULER, INTEGRATE_VERLET, INTEGRATE_RK4 };
+
+/// <summary>
+/// Forces and sub-stepping of the integrator. Every body accelerates by gravity - drag * velocity and
+/// its angular velocity decays by drag * omega. A body whose vertices would travel further than
+/// maxTravel times its side length in one step is advanced in that many sub-steps instead, at most
+/// maxSubsteps; maxSubsteps 1 turns sub-stepping off.
+/// </summary>
+struct integratorConfig {
+    integratorKind kind = INTEGRATE_EULER;
+    double gravityX = 0, gravityY = 0;
+    double drag = 0;
+    double maxTravel = 0.5;
+    int maxSubsteps = 32;
+};
+
+/// <summary>
+/// Counters of one integration pass
+/// </summary>
+struct integrateStats {
+    size_t hits = 0;
+    size_t fast = 0;
+    size_t substeps = 0;
+};
+
+/// <summary>
+/// Position, orientation and velocities of one body
+/// </summary>
+struct motionState {
+    double x, y, phi;
+    double vx, vy, omega;
+};
+
+/// <summary>
+/// Advances one body by h under the forces of the settings, without border handling.
+/// phi is not wrapped.
+/// </summary>
+/// <param name="m">the body</param>
+/// <param name="ic">integrator and forces</param>
+/// <param name="h">timestep</param>
+void integrateMotion(struct motionState* m, const integratorConfig& ic, double h);
+
+/// <summary>
+/// Number of sub-steps body i needs for a step of dt: its vertices move at most |v| + |omega| * r,
+/// r the distance of a vertex from the center, and may travel maxTravel * len per sub-step
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="i">index of the body</param>
+/// <param name="dt">timestep</param>
+/// <param name="ic">settings</param>
+/// <returns>1 for a slow body, at most ic.maxSubsteps</returns>
+int substepCount(const bodySoA& soa, size_t i, double dt, const integratorConfig& ic);
+
+/// <summary>
+/// soaStepRange with the integrator: one timestep on the bodies [from, to) including the borders.
+/// Runs of slow bodies go through the vectorized soaStepRange, after a pass that applies the forces to their
+/// velocities; only fast bodies are advanced on their own in substepCount swept sub-steps, so the cost
+/// grows with the number of fast bodies only.
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="from">first body</param>
+/// <param name="to">one past the last body</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="dt">timestep</param>
+/// <param name="boundary">border handling of the vectorized runs, sub-steps always sweep</param>
+/// <param name="ic">integrator, forces and sub-stepping</param>
+/// <param name="stats">receives border hits, fast bodies and the sub-steps they took</param>
+void integrateStepRange(struct bodySoA* soa, size_t from, size_t to, double breite, double hoehe, double dt,
+    boundaryMode boundary, const integratorConfig& ic, struct integrateStats* stats);
+
+/// <summary>
+/// soaIntegrateRange with the integrator, for the impulse solver: moves the bodies [from, to) and derives
+/// their vertices without border response. A fast body stops after the first sub-step that ends inside a
+/// wall, so it reaches the solver with a shallow penetration instead of a deep one.
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="from">first body</param>
+/// <param name="to">one past the last body</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="dt">timestep</param>
+/// <param name="ic">integrator, forces and sub-stepping</param>
+/// <param name="stats">receives fast bodies and the sub-steps they took</param>
+void integrateMoveRange(struct bodySoA* soa, size_t from, size_t to, double breite, double hoehe, double dt,
+    const integratorConfig& ic, struct integrateStats* stats);
+
+/// <summary>
+/// Name of an integrator
+/// </summary>
+/// <returns>"euler", "verlet" or "rk4"</returns>
+const char* integratorName(integratorKind kind);
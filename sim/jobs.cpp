@@ -0,0 +1,145 @@
+#include "jobs.h"
+#include <algorithm>
+
+/// <summary>
+/// Takes the next chunk of the worker's own queue, or steals the last one of another queue
+/// </summary>
+static bool takeChunk(struct jobPool* pool, size_t self, size_t* chunk) {
+    const size_t n = pool->queues.size();
+    {
+        jobQueue& own = *pool->queues[self];
+        std::lock_guard<std::mutex> lk(own.lock);
+        if (!own.chunks.empty()) {
+            *chunk = own.chunks.front();
+            own.chunks.pop_front();
+            return true;
+        }
+    }
+    for (size_t k = 1; k < n; k++) {
+        jobQueue& other = *pool->queues[(self + k) % n];
+        std::lock_guard<std::mutex> lk(other.lock);
+        if (!other.chunks.empty()) {
+            *chunk = other.chunks.back();
+            other.chunks.pop_back();
+            pool->steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+/// <summary>
+/// Runs chunks until no queue holds any
+/// </summary>
+static void drain(struct jobPool* pool, size_t self) {
+    size_t chunk;
+    while (takeChunk(pool, self, &chunk)) {
+        pool->job(chunk);
+        pool->remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+static void workerLoop(struct jobPool* pool, size_t self) {
+    unsigned long long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(pool->wakeLock);
+            pool->wake.wait(lk, [&] { return pool->quit || pool->generation != seen; });
+            if (pool->quit)
+                return;
+            seen = pool->generation;
+        }
+        drain(pool, self);
+    }
+}
+
+/// <summary>
+/// Starts the worker threads
+/// </summary>
+/// <param name="pool">a pool that is not running</param>
+/// <param name="threads">number of threads including the caller, 0 uses every hardware thread</param>
+void poolStart(struct jobPool* pool, unsigned threads) {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    pool->quit = false;
+    pool->queues.clear();
+    for (unsigned t = 0; t < threads; t++)
+        pool->queues.push_back(std::unique_ptr<jobQueue>(new jobQueue()));
+    for (unsigned t = 1; t < threads; t++)
+        pool->threads.emplace_back(workerLoop, pool, (size_t)t);
+}
+
+/// <summary>
+/// Stops and joins the worker threads
+/// </summary>
+/// <param name="pool">the pool</param>
+void poolStop(struct jobPool* pool) {
+    {
+        std::lock_guard<std::mutex> lk(pool->wakeLock);
+        pool->quit = true;
+    }
+    pool->wake.notify_all();
+    for (std::thread& t : pool->threads)
+        t.join();
+    pool->threads.clear();
+    pool->queues.clear();
+}
+
+/// <summary>
+/// Number of threads that work on a poolFor, including the caller
+/// </summary>
+/// <param name="pool">the pool, may be null</param>
+/// <returns>1 for a null pool</returns>
+unsigned poolThreads(const jobPool* pool) {
+    return pool && !pool->queues.empty() ? (unsigned)pool->queues.size() : 1;
+}
+
+/// <summary>
+/// Number of chunks poolFor cuts count items into
+/// </summary>
+/// <param name="count">number of items</param>
+/// <param name="grain">items per chunk</param>
+/// <returns>count / grain rounded up</returns>
+size_t poolChunks(size_t count, size_t grain) {
+    return (count + grain - 1) / grain;
+}
+
+/// <summary>
+/// Runs fn once for every chunk of [0, count) and returns when all chunks are done.
+/// With a null pool the chunks run in order on the calling thread.
+/// </summary>
+/// <param name="pool">the pool, may be null</param>
+/// <param name="count">number of items</param>
+/// <param name="grain">items per chunk</param>
+/// <param name="fn">called with the chunk index and its item range [from, to)</param>
+void poolFor(struct jobPool* pool, size_t count, size_t grain,
+    const std::function<void(size_t chunk, size_t from, size_t to)>& fn) {
+    const size_t chunks = poolChunks(count, grain);
+    if (chunks == 0)
+        return;
+    if (poolThreads(pool) == 1 || chunks == 1) {
+        for (size_t c = 0; c < chunks; c++)
+            fn(c, c * grain, std::min(count, (c + 1) * grain));
+        return;
+    }
+
+    pool->job = [&fn, count, grain](size_t c) { fn(c, c * grain, std::min(count, (c + 1) * grain)); };
+    pool->remaining.store(chunks, std::memory_order_release);
+    /* contiguous blocks keep neighbouring chunks on the same worker */
+    const size_t n = pool->queues.size();
+    for (size_t w = 0; w < n; w++) {
+        jobQueue& q = *pool->queues[w];
+        std::lock_guard<std::mutex> lk(q.lock);
+        for (size_t c = chunks * w / n; c < chunks * (w + 1) / n; c++)
+            q.chunks.push_back(c);
+    }
+    {
+        std::lock_guard<std::mutex> lk(pool->wakeLock);
+        pool->generation++;
+    }
+    pool->wake.notify_all();
+
+    drain(pool, 0);
+    while (pool->remaining.load(std::memory_order_acquire) > 0)
+        std::this_thread::yield();
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Chunk indices waiting to be run by one worker. The owner takes from the front, thieves from the back.
+/// </summary>
+struct jobQueue {
+    std::mutex lock;
+    std::deque<size_t> chunks;
+};
+
+/// <summary>
+/// Work-stealing thread pool. poolFor splits an index range into chunks of a fixed size and deals
+/// them out to the workers in contiguous blocks; a worker that runs dry steals from the others.
+/// The calling thread works along as worker 0, so a pool of one thread runs everything inline.
+/// Chunk boundaries only depend on count and grain, never on the number of threads, so results
+/// that are reduced per chunk in chunk order are the same for any thread count.
+/// </summary>
+struct jobPool {
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<jobQueue>> queues;
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    unsigned long long generation = 0;
+    bool quit = false;
+    std::function<void(size_t chunk)> job;
+    std::atomic<size_t> remaining{ 0 };
+    std::atomic<size_t> steals{ 0 };
+};
+
+/// <summary>
+/// Starts the worker threads
+/// </summary>
+/// <param name="pool">a pool that is not running</param>
+/// <param name="threads">number of threads including the caller, 0 uses every hardware thread</param>
+void poolStart(struct jobPool* pool, unsigned threads);
+
+/// <summary>
+/// Stops and joins the worker threads
+/// </summary>
+/// <param name="pool">the pool</param>
+void poolStop(struct jobPool* pool);
+
+/// <summary>
+/// Number of threads that work on a poolFor, including the caller
+/// </summary>
+/// <param name="pool">the pool, may be null</param>
+/// <returns>1 for a null pool</returns>
+unsigned poolThreads(const jobPool* pool);
+
+/// <summary>
+/// Number of chunks poolFor cuts count items into
+/// </summary>
+/// <param name="count">number of items</param>
+/// <param name="grain">items per chunk</param>
+/// <returns>count / grain rounded up</returns>
+size_t poolChunks(size_t count, size_t grain);
+
+/// <summary>
+/// Runs fn once for every chunk of [0, count) and returns when all chunks are done.
+/// With a null pool the chunks run in order on the calling thread.
+/// </summary>
+/// <param name="pool">the pool, may be null</param>
+/// <param name="count">number of items</param>
+/// <param name="grain">items per chunk</param>
+/// <param name="fn">called with the chunk index and its item range [from, to)</param>
+void poolFor(struct jobPool* pool, size_t count, size_t grain,
+    const std::function<void(size_t chunk, size_t from, size_t to)>& fn);
@@ -0,0 +1,120 @@
+#include "mapfile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+/// <summary>
+/// Maps a whole file for reading. The pages are shared with every other mapping of the same file,
+/// so many readers of one file cost its size in memory once.
+/// </summary>
+/// <param name="path">the file</param>
+/// <param name="size">receives the size of the file</param>
+/// <returns>the first byte of the file, nullptr if it is missing or empty</returns>
+const uint8_t* mapRead(const char* path, uint64_t* size) {
+    HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE)
+        return nullptr;
+    LARGE_INTEGER n;
+    const uint8_t* data = nullptr;
+    if (GetFileSizeEx(f, &n) && n.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        *size = (uint64_t)n.QuadPart;
+    }
+    CloseHandle(f);
+    return data;
+}
+
+/// <summary>
+/// Creates a file of the given size, replacing one that exists, and maps it for writing.
+/// What is written into the mapping reaches the file at the latest when it is released.
+/// </summary>
+/// <param name="path">the file</param>
+/// <param name="size">size of the file in bytes, more than 0</param>
+/// <returns>the first byte of the file, nullptr if it could not be created or mapped</returns>
+uint8_t* mapCreate(const char* path, uint64_t size) {
+    HANDLE f = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE)
+        return nullptr;
+    uint8_t* data = nullptr;
+    HANDLE mapping = CreateFileMappingA(f, nullptr, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, nullptr);
+    if (mapping) {
+        data = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)size);
+        CloseHandle(mapping);
+    }
+    CloseHandle(f);
+    return data;
+}
+
+/// <summary>
+/// Unmaps a file mapped by mapRead or mapCreate
+/// </summary>
+/// <param name="data">the first byte of the mapping</param>
+/// <param name="size">size of the mapping</param>
+void mapRelease(const void* data, uint64_t) {
+    UnmapViewOfFile(data);
+}
+#else
+/// <summary>
+/// Maps a whole file for reading. The pages are shared with every other mapping of the same file,
+/// so many readers of one file cost its size in memory once.
+/// </summary>
+/// <param name="path">the file</param>
+/// <param name="size">receives the size of the file</param>
+/// <returns>the first byte of the file, nullptr if it is missing or empty</returns>
+const uint8_t* mapRead(const char* path, uint64_t* size) {
+    int f = open(path, O_RDONLY);
+    if (f < 0)
+        return nullptr;
+    struct stat st;
+    const uint8_t* data = nullptr;
+    if (fstat(f, &st) == 0 && st.st_size > 0) {
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, f, 0);
+        data = p == MAP_FAILED ? nullptr : (const uint8_t*)p;
+        *size = (uint64_t)st.st_size;
+    }
+    close(f);
+    return data;
+}
+
+/// <summary>
+/// Creates a file of the given size, replacing one that exists, and maps it for writing.
+/// What is written into the mapping reaches the file at the latest when it is released.
+/// </summary>
+/// <param name="path">the file</param>
+/// <param name="size">size of the file in bytes, more than 0</param>
+/// <returns>the first byte of the file, nullptr if it could not be created or mapped</returns>
+uint8_t* mapCreate(const char* path, uint64_t size) {
+    int f = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (f < 0)
+        return nullptr;
+    uint8_t* data = nullptr;
+    if (ftruncate(f, (off_t)size) == 0) {
+        void* p = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, f, 0);
+        data = p == MAP_FAILED ? nullptr : (uint8_t*)p;
+    }
+    close(f);
+    return data;
+}
+
+/// <summary>
+/// Unmaps a file mapped by mapRead or mapCreate
+/// </summary>
+/// <param name="data">the first byte of the mapping</param>
+/// <param name="size">size of the mapping</param>
+void mapRelease(const void* data, uint64_t size) {
+    munmap((void*)data, size);
+}
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+
+/// <summary>
+/// Maps a whole file for reading. The pages are shared with every other mapping of the same file,
+/// so many readers of one file cost its size in memory once.
+/// </summary>
+/// <param name="path">the file</param>
+/// <param name="size">receives the size of the file</param>
+/// <returns>the first byte of the file, nullptr if it is missing or empty</returns>
+const uint8_t* mapRead(const char* path, uint64_t* size);
+
+/// <summary>
+/// Creates a file of the given size, replacing one that exists, and maps it for writing.
+/// What is written into the mapping reaches the file at the latest when it is released.
+/// </summary>
+/// <param name="path">the file</param>
+/// <param name="size">size of the file in bytes, more than 0</param>
+/// <returns>the first byte of the file, nullptr if it could not be created or mapped</returns>
+uint8_t* mapCreate(const char* path, uint64_t size);
+
+/// <summary>
+/// Unmaps a file mapped by mapRead or mapCreate
+/// </summary>
+/// <param name="data">the first byte of the mapping</param>
+/// <param name="size">size of the mapping</param>
+void mapRelease(const void* data, uint64_t size);
@@ -0,0 +1,116 @@
+#include "narrowphase.h"
+#include <algorithm>
+#include <cmath>
+
+/// <summary>
+/// Projects the three vertices of a triangle onto an axis
+/// </summary>
+static inline void project(const triangle& t, double nx, double ny, double* lo, double* hi) {
+    double a = t.aA.x * nx + t.aA.y * ny;
+    double b = t.bB.x * nx + t.bB.y * ny;
+    double c = t.cC.x * nx + t.cC.y * ny;
+    *lo = std::min(a, std::min(b, c));
+    *hi = std::max(a, std::max(b, c));
+}
+
+/// <summary>
+/// Separating axis test of two triangles. The candidate axes are the six edge normals.
+/// </summary>
+/// <param name="p">first triangle</param>
+/// <param name="q">second triangle</param>
+/// <param name="c">if not null and the triangles overlap, receives normal, depth and point, a and b are left untouched</param>
+/// <returns>true if the triangles overlap</returns>
+bool triOverlap(const triangle& p, const triangle& q, struct contact* c) {
+    const vertex* edges[6][2] = {
+        { &p.aA, &p.bB }, { &p.bB, &p.cC }, { &p.cC, &p.aA },
+        { &q.aA, &q.bB }, { &q.bB, &q.cC }, { &q.cC, &q.aA } };
+    double best = INFINITY, bx = 0, by = 0;
+    int bestK = 0;
+    for (int k = 0; k < 6; k++) {
+        double nx = -(edges[k][1]->y - edges[k][0]->y);
+        double ny = edges[k][1]->x - edges[k][0]->x;
+        double pLo, pHi, qLo, qHi;
+        project(p, nx, ny, &pLo, &pHi);
+        project(q, nx, ny, &qLo, &qHi);
+        /* q leaves p by moving pHi - qLo along the axis or qHi - pLo against it; the shorter way is the overlap,
+           which is more than the shared interval when one projection holds the other */
+        double overlap = std::min(pHi - qLo, qHi - pLo);
+        if (overlap < 0)
+            return false;
+        /* the axes are not normalized, compare overlap / |n| without a sqrt per axis */
+        double n2 = nx * nx + ny * ny;
+        if (n2 > 0 && overlap * overlap < best * best * n2) {
+            best = overlap / sqrt(n2);
+            bx = nx / sqrt(n2);
+            by = ny / sqrt(n2);
+            bestK = k;
+        }
+    }
+    if (c) {
+        /* the normal points the way q leaves p, the centers only break a tie */
+        double pLo, pHi, qLo, qHi;
+        project(p, bx, by, &pLo, &pHi);
+        project(q, bx, by, &qLo, &qHi);
+        const double ahead = pHi - qLo, behind = qHi - pLo;
+        if (behind < ahead || (behind == ahead && (q.zZ.x - p.zZ.x) * bx + (q.zZ.y - p.zZ.y) * by < 0)) {
+            bx = -bx;
+            by = -by;
+        }
+        c->nx = bx;
+        c->ny = by;
+        c->depth = best;
+        /* the axis belongs to a face of p: the deepest vertex of q lies furthest against the normal, and vice versa */
+        const triangle& inc = bestK < 3 ? q : p;
+        const double sign = bestK < 3 ? -1 : 1;
+        const vertex* v[3] = { &inc.aA, &inc.bB, &inc.cC };
+        const vertex* deep = v[0];
+        for (int k = 1; k < 3; k++)
+            if (sign * (v[k]->x * bx + v[k]->y * by) > sign * (deep->x * bx + deep->y * by))
+                deep = v[k];
+        c->px = deep->x - sign * bx * best / 2;
+        c->py = deep->y - sign * by * best / 2;
+    }
+    return true;
+}
+
+/// <summary>
+/// Runs the separating axis test on every candidate pair
+/// </summary>
+/// <param name="soa">the body store, soaVertices must have run</param>
+/// <param name="pairs">candidate pairs from the broad phase</param>
+/// <param name="contacts">receives the pairs that really overlap, cleared first</param>
+/// <returns>number of contacts</returns>
+size_t soaNarrowphase(const bodySoA& soa, const std::vector<bodyPair>& pairs, std::vector<contact>* contacts) {
+    contacts->clear();
+    return soaNarrowphaseRange(soa, pairs, 0, pairs.size(), contacts);
+}
+
+/// <summary>
+/// Runs the separating axis test on the candidate pairs [from, to)
+/// </summary>
+/// <param name="soa">the body store, soaVertices must have run</param>
+/// <param name="pairs">candidate pairs from the broad phase</param>
+/// <param name="from">first pair</param>
+/// <param name="to">one past the last pair</param>
+/// <param name="contacts">the pairs that really overlap are appended here</param>
+/// <returns>number of contacts appended</returns>
+size_t soaNarrowphaseRange(const bodySoA& soa, const std::vector<bodyPair>& pairs, size_t from, size_t to,
+    std::vector<contact>* contacts) {
+    const vertexSoA& v = soa.verts;
+    const size_t before = contacts->size();
+    for (size_t k = from; k < to; k++) {
+        const bodyPair& pr = pairs[k];
+        triangle p, q;
+        p.aA = { v.ax[pr.a], v.ay[pr.a] }; p.bB = { v.bx[pr.a], v.by[pr.a] }; p.cC = { v.cx[pr.a], v.cy[pr.a] };
+        p.zZ = { soa.x[pr.a], soa.y[pr.a] };
+        q.aA = { v.ax[pr.b], v.ay[pr.b] }; q.bB = { v.bx[pr.b], v.by[pr.b] }; q.cC = { v.cx[pr.b], v.cy[pr.b] };
+        q.zZ = { soa.x[pr.b], soa.y[pr.b] };
+        contact c;
+        if (triOverlap(p, q, &c)) {
+            c.a = pr.a;
+            c.b = pr.b;
+            contacts->push_back(c);
+        }
+    }
+    return contacts->size() - before;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "broadphase.h"
+
+/// <summary>
+/// Two overlapping bodies. The normal (nx, ny) has unit length and points from a to b, the way b leaves a;
+/// depth is the overlap along it, i.e. the shortest distance that separates the two.
+/// (px, py) is the contact point, halfway between the deepest vertex and the face it went through.
+/// a is WALL for a contact with a world border.
+/// </summary>
+struct contact { uint32_t a; uint32_t b; double nx; double ny; double depth; double px; double py; };
+
+const uint32_t WALL = 0xFFFFFFFFu;
+
+/// <summary>
+/// Separating axis test of two triangles. The candidate axes are the six edge normals.
+/// </summary>
+/// <param name="p">first triangle</param>
+/// <param name="q">second triangle</param>
+/// <param name="c">if not null and the triangles overlap, receives normal, depth and point, a and b are left untouched</param>
+/// <returns>true if the triangles overlap</returns>
+bool triOverlap(const triangle& p, const triangle& q, struct contact* c);
+
+/// <summary>
+/// Runs the separating axis test on every candidate pair
+/// </summary>
+/// <param name="soa">the body store, soaVertices must have run</param>
+/// <param name="pairs">candidate pairs from the broad phase</param>
+/// <param name="contacts">receives the pairs that really overlap, cleared first</param>
+/// <returns>number of contacts</returns>
+size_t soaNarrowphase(const bodySoA& soa, const std::vector<bodyPair>& pairs, std::vector<contact>* contacts);
+
+/// <summary>
+/// Runs the separating axis test on the candidate pairs [from, to)
+/// </summary>
+/// <param name="soa">the body store, soaVertices must have run</param>
+/// <param name="pairs">candidate pairs from the broad phase</param>
+/// <param name="from">first pair</param>
+/// <param name="to">one past the last pair</param>
+/// <param name="contacts">the pairs that really overlap are appended here</param>
+/// <returns>number of contacts appended</returns>
+size_t soaNarrowphaseRange(const bodySoA& soa, const std::vector<bodyPair>& pairs, size_t from, size_t to,
+    std::vector<contact>* contacts);
@@ -0,0 +1,98 @@
+#include "polygon.h"
+
+/// <summary>
+/// Converts a triangle to a Polygon&lt;3&gt;, aA, bB, cC in this order
+/// </summary>
+Polygon<3> polyFromTriangle(const triangle& t) {
+    Polygon<3> p;
+    p.v[0] = t.aA;
+    p.v[1] = t.bB;
+    p.v[2] = t.cC;
+    p.zZ = t.zZ;
+    return p;
+}
+
+/// <summary>
+/// Creates a regular polygon with n vertices at run time
+/// </summary>
+/// <param name="n">number of vertices, at least 3</param>
+/// <param name="center">center point</param>
+/// <param name="len">side length</param>
+/// <param name="phi">orientation angle</param>
+/// <returns>the polygon</returns>
+polygon makeRegular(int n, vertex center, double len, double phi) {
+    std::vector<vertex> unit(n);
+    const double r = 0.5 / sin(polyPi / n);
+    for (int k = 0; k < n; k++) {
+        const double a = -polyPi / 2 - polyPi / n + 2 * polyPi * k / n;
+        unit[k] = { r * cos(a), r * sin(a) };
+    }
+    polygon p;
+    p.v.resize(n);
+    p.zZ = center;
+    polyPose(&p, unit.data(), phi, len);
+    return p;
+}
+
+/// <summary>
+/// Places the vertices of a polygon around its center zZ
+/// </summary>
+/// <param name="p">the polygon, only zZ and the number of vertices are read</param>
+/// <param name="unit">body space vertex offsets, one per vertex</param>
+/// <param name="phi">orientation angle</param>
+/// <param name="len">scale of the offsets</param>
+void polyPose(struct polygon* p, const vertex* unit, double phi, double len) {
+    polyPoseVerts(p->v.data(), (int)p->v.size(), p->zZ, unit, phi, len);
+}
+
+/// <summary>
+/// Rotates the vertices of a polygon around its center
+/// </summary>
+/// <param name="p">the polygon</param>
+/// <param name="phi">rotation angle</param>
+void polyRotate(struct polygon* p, double phi) {
+    polyRotateVerts(p->v.data(), (int)p->v.size(), p->zZ, phi);
+}
+
+/// <summary>
+/// Moves a polygon
+/// </summary>
+/// <param name="p">the polygon</param>
+/// <param name="velo">move distance</param>
+void polyTranslate(struct polygon* p, velocity velo) {
+    polyTranslateVerts(p->v.data(), (int)p->v.size(), &p->zZ, velo);
+}
+
+/// <summary>
+/// Resizes a polygon around its center
+/// </summary>
+/// <param name="p">the polygon</param>
+/// <param name="coeff">resize ratio</param>
+void polyResize(struct polygon* p, double coeff) {
+    polyResizeVerts(p->v.data(), (int)p->v.size(), p->zZ, coeff);
+}
+
+/// <summary>
+/// Moves a polygon by velo * dt and reflects it at the window borders like triSweep
+/// </summary>
+/// <param name="p">the polygon</param>
+/// <param name="velo">translational velocity</param>
+/// <param name="dt">timestep, 0 only resolves an existing penetration</param>
+/// <param name="breite">horizontal dimension of the window</param>
+/// <param name="hoehe">vertical dimension of the window</param>
+/// <param name="omega">angular velocity, reversed on impact</param>
+/// <returns>true if the polygon touched a border</returns>
+bool polySweep(struct polygon* p, velocity* velo, double dt, double breite, double hoehe, double* omega) {
+    return polySweepVerts(p->v.data(), (int)p->v.size(), &p->zZ, velo, dt, breite, hoehe, omega);
+}
+
+/// <summary>
+/// Separating axis test of two convex polygons of any vertex count
+/// </summary>
+/// <param name="p">first polygon</param>
+/// <param name="q">second polygon</param>
+/// <param name="c">if not null and the polygons overlap, receives normal, depth and point, a and b are left untouched</param>
+/// <returns>true if the polygons overlap</returns>
+bool polyOverlap(const polygon& p, const polygon& q, struct contact* c) {
+    return polyOverlapVerts(p.v.data(), (int)p.v.size(), p.zZ, q.v.data(), (int)q.v.size(), q.zZ, c);
+}
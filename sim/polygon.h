@@ -0,0 +1,354 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include "narrowphase.h"
+#include "sim.h"
+
+/// <summary>
+/// A convex polygon with N vertices in counter-clockwise order around its center zZ.
+/// The kernels below take the vertex count as a template parameter, so for a fixed N
+/// every loop over the vertices is unrolled like the hand-written triangle functions.
+/// </summary>
+template <int N>
+struct Polygon {
+    static_assert(N >= 3, "a polygon needs at least three vertices");
+    vertex v[N];
+    vertex zZ;
+};
+
+/// <summary>
+/// A convex polygon whose vertex count is only known at run time, for shapes read from data.
+/// Same vertex order as Polygon; the functions for it run the same code as the templates with a loop.
+/// </summary>
+struct polygon {
+    std::vector<vertex> v;
+    vertex zZ;
+};
+
+/* compile time sin and cos: the angles of a regular polygon, reduced to [-pi, pi] and summed as a Taylor series */
+constexpr double polyPi = 3.14159265358979323846;
+
+constexpr double polySin(double a) {
+    while (a > polyPi)
+        a -= 2 * polyPi;
+    while (a < -polyPi)
+        a += 2 * polyPi;
+    double term = a, sum = a;
+    for (int k = 1; k < 30; k++) {
+        term *= -a * a / ((2 * k) * (2 * k + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double polyCos(double a) { return polySin(a + polyPi / 2); }
+
+/// <summary>
+/// Vertex offsets of a regular N-gon with side length 1 around its center, counter-clockwise with the
+/// first edge at the bottom. For N = 3 these are the vertices aA, bB, cC of makeEquiTri.
+/// </summary>
+/// <returns>the N offsets</returns>
+template <int N>
+constexpr std::array<vertex, N> regularOffsets() {
+    std::array<vertex, N> v{};
+    const double r = 0.5 / polySin(polyPi / N);
+    for (int k = 0; k < N; k++) {
+        const double a = -polyPi / 2 - polyPi / N + 2 * polyPi * k / N;
+        v[k] = { r * polyCos(a), r * polySin(a) };
+    }
+    return v;
+}
+
+template <int N>
+constexpr std::array<vertex, N> regularUnit = regularOffsets<N>();
+
+/* the triangle takes the offsets the SoA kernels use, so Polygon<3> poses bit for bit like bodySoA */
+template <>
+constexpr std::array<vertex, 3> regularUnit<3> = { unitTri[0], unitTri[1], unitTri[2] };
+
+/*
+ * The kernels are written once against a vertex count n that is either std::integral_constant<int, N>
+ * (Polygon<N>, the loops unroll) or a plain int (polygon, the loops stay loops).
+ */
+
+template <class Count>
+inline void polyPoseVerts(vertex* v, Count n, vertex z, const vertex* unit, double phi, double len) {
+    const double c = cos(phi) * len, s = sin(phi) * len;
+    for (int k = 0; k < n; k++)
+        v[k] = { z.x + unit[k].x * c - unit[k].y * s, z.y + unit[k].x * s + unit[k].y * c };
+}
+
+template <class Count>
+inline void polyRotateVerts(vertex* v, Count n, vertex z, double phi) {
+    const double c = cos(phi), s = sin(phi);
+    for (int k = 0; k < n; k++) {
+        const double dx = v[k].x - z.x, dy = v[k].y - z.y;
+        v[k] = { z.x + dx * c - dy * s, z.y + dx * s + dy * c };
+    }
+}
+
+template <class Count>
+inline void polyTranslateVerts(vertex* v, Count n, vertex* z, velocity velo) {
+    for (int k = 0; k < n; k++)
+        v[k] = { v[k].x + velo.x, v[k].y + velo.y };
+    *z = { z->x + velo.x, z->y + velo.y };
+}
+
+template <class Count>
+inline void polyResizeVerts(vertex* v, Count n, vertex z, double coeff) {
+    for (int k = 0; k < n; k++)
+        v[k] = { z.x + (v[k].x - z.x) * coeff, z.y + (v[k].y - z.y) * coeff };
+}
+
+template <class Count>
+inline bool polySweepVerts(vertex* v, Count n, vertex* z, velocity* velo, double dt, double breite, double hoehe,
+    double* omega) {
+    double loX = v[0].x, hiX = v[0].x, loY = v[0].y, hiY = v[0].y;
+    for (int k = 1; k < n; k++) {
+        loX = std::min(loX, v[k].x);
+        hiX = std::max(hiX, v[k].x);
+        loY = std::min(loY, v[k].y);
+        hiY = std::max(hiY, v[k].y);
+    }
+    velocity move;
+    bool hitX = axisSweep(loX, hiX, &velo->x, velo->x * dt, breite, &move.x);
+    bool hitY = axisSweep(loY, hiY, &velo->y, velo->y * dt, hoehe, &move.y);
+    polyTranslateVerts(v, n, z, move);
+    if (hitX || hitY)
+        *omega = -*omega;
+    return hitX || hitY;
+}
+
+template <class Count>
+inline void polyProject(const vertex* v, Count n, double nx, double ny, double* lo, double* hi) {
+    *lo = *hi = v[0].x * nx + v[0].y * ny;
+    for (int k = 1; k < n; k++) {
+        const double d = v[k].x * nx + v[k].y * ny;
+        *lo = std::min(*lo, d);
+        *hi = std::max(*hi, d);
+    }
+}
+
+/// <summary>
+/// One candidate axis of the separating axis test: the normal of the edge from a to b.
+/// Keeps the axis with the least overlap in best, bx, by; returns false if it separates p and q.
+/// </summary>
+template <class PCount, class QCount>
+inline bool polyAxis(const vertex* p, PCount pn, const vertex* q, QCount qn, vertex a, vertex b, int k,
+    double* best, double* bx, double* by, int* bestK) {
+    const double nx = -(b.y - a.y), ny = b.x - a.x;
+    double pLo, pHi, qLo, qHi;
+    polyProject(p, pn, nx, ny, &pLo, &pHi);
+    polyProject(q, qn, nx, ny, &qLo, &qHi);
+    /* q leaves p by moving pHi - qLo along the axis or qHi - pLo against it, the shorter way is the overlap */
+    const double overlap = std::min(pHi - qLo, qHi - pLo);
+    if (overlap < 0)
+        return false;
+    /* the axes are not normalized, compare overlap / |n| without a sqrt per axis */
+    const double n2 = nx * nx + ny * ny;
+    if (n2 > 0 && overlap * overlap < *best * *best * n2) {
+        *best = overlap / sqrt(n2);
+        *bx = nx / sqrt(n2);
+        *by = ny / sqrt(n2);
+        *bestK = k;
+    }
+    return true;
+}
+
+template <class PCount, class QCount>
+inline bool polyOverlapVerts(const vertex* p, PCount pn, vertex pz, const vertex* q, QCount qn, vertex qz,
+    struct contact* c) {
+    double best = INFINITY, bx = 0, by = 0;
+    int bestK = 0;
+    for (int k = 0; k < pn; k++)
+        if (!polyAxis(p, pn, q, qn, p[k], p[k + 1 < pn ? k + 1 : 0], k, &best, &bx, &by, &bestK))
+            return false;
+    for (int k = 0; k < qn; k++)
+        if (!polyAxis(p, pn, q, qn, q[k], q[k + 1 < qn ? k + 1 : 0], pn + k, &best, &bx, &by, &bestK))
+            return false;
+    if (c) {
+        /* the normal points the way q leaves p, the centers only break a tie */
+        double pLo, pHi, qLo, qHi;
+        polyProject(p, pn, bx, by, &pLo, &pHi);
+        polyProject(q, qn, bx, by, &qLo, &qHi);
+        const double ahead = pHi - qLo, behind = qHi - pLo;
+        if (behind < ahead || (behind == ahead && (qz.x - pz.x) * bx + (qz.y - pz.y) * by < 0)) {
+            bx = -bx;
+            by = -by;
+        }
+        c->nx = bx;
+        c->ny = by;
+        c->depth = best;
+        /* the axis belongs to a face of p: the deepest vertex of q lies furthest against the normal, and vice versa */
+        const bool faceOfP = bestK < pn;
+        const vertex* inc = faceOfP ? q : p;
+        const int incN = faceOfP ? (int)qn : (int)pn;
+        const double sign = faceOfP ? -1 : 1;
+        const vertex* deep = inc;
+        for (int k = 1; k < incN; k++)
+            if (sign * (inc[k].x * bx + inc[k].y * by) > sign * (deep->x * bx + deep->y * by))
+                deep = inc + k;
+        c->px = deep->x - sign * bx * best / 2;
+        c->py = deep->y - sign * by * best / 2;
+    }
+    return true;
+}
+
+template <int N>
+using polyCount = std::integral_constant<int, N>;
+
+/// <summary>
+/// Creates a regular N-gon from center, side length and orientation
+/// </summary>
+/// <param name="center">center point</param>
+/// <param name="len">side length</param>
+/// <param name="phi">orientation angle</param>
+/// <returns>the polygon</returns>
+template <int N>
+Polygon<N> makeRegular(vertex center, double len, double phi) {
+    Polygon<N> p;
+    p.zZ = center;
+    polyPoseVerts(p.v, polyCount<N>(), center, regularUnit<N>.data(), phi, len);
+    return p;
+}
+
+/// <summary>
+/// Places the vertices of a polygon around its center zZ, like triPose
+/// </summary>
+/// <param name="p">the polygon, only zZ is read</param>
+/// <param name="unit">body space vertex offsets, regularUnit&lt;N&gt; for a regular polygon</param>
+/// <param name="phi">orientation angle</param>
+/// <param name="len">scale of the offsets, the side length for a regular polygon</param>
+template <int N>
+void polyPose(Polygon<N>* p, const vertex* unit, double phi, double len) {
+    polyPoseVerts(p->v, polyCount<N>(), p->zZ, unit, phi, len);
+}
+
+/// <summary>
+/// Rotates the vertices of a polygon around its center
+/// </summary>
+/// <param name="p">the polygon</param>
+/// <param name="phi">rotation angle</param>
+template <int N>
+void polyRotate(Polygon<N>* p, double phi) {
+    polyRotateVerts(p->v, polyCount<N>(), p->zZ, phi);
+}
+
+/// <summary>
+/// Moves a polygon
+/// </summary>
+/// <param name="p">the polygon</param>
+/// <param name="velo">move distance</param>
+template <int N>
+void polyTranslate(Polygon<N>* p, velocity velo) {
+    polyTranslateVerts(p->v, polyCount<N>(), &p->zZ, velo);
+}
+
+/// <summary>
+/// Resizes a polygon around its center
+/// </summary>
+/// <param name="p">the polygon</param>
+/// <param name="coeff">resize ratio</param>
+template <int N>
+void polyResize(Polygon<N>* p, double coeff) {
+    polyResizeVerts(p->v, polyCount<N>(), p->zZ, coeff);
+}
+
+/// <summary>
+/// Moves a polygon by velo * dt and reflects it at the window borders like triSweep.
+/// dt = 0 only resolves an existing penetration, like triCollision.
+/// </summary>
+/// <param name="p">the polygon</param>
+/// <param name="velo">translational velocity</param>
+/// <param name="dt">timestep</param>
+/// <param name="breite">horizontal dimension of the window</param>
+/// <param name="hoehe">vertical dimension of the window</param>
+/// <param name="omega">angular velocity, reversed on impact</param>
+/// <returns>true if the polygon touched a border</returns>
+template <int N>
+bool polySweep(Polygon<N>* p, velocity* velo, double dt, double breite, double hoehe, double* omega) {
+    return polySweepVerts(p->v, polyCount<N>(), &p->zZ, velo, dt, breite, hoehe, omega);
+}
+
+/// <summary>
+/// Separating axis test of two convex polygons over the N + M edge normals, like triOverlap
+/// </summary>
+/// <param name="p">first polygon</param>
+/// <param name="q">second polygon</param>
+/// <param name="c">if not null and the polygons overlap, receives normal, depth and point, a and b are left untouched</param>
+/// <returns>true if the polygons overlap</returns>
+template <int N, int M>
+bool polyOverlap(const Polygon<N>& p, const Polygon<M>& q, struct contact* c) {
+    return polyOverlapVerts(p.v, polyCount<N>(), p.zZ, q.v, polyCount<M>(), q.zZ, c);
+}
+
+/// <summary>
+/// Converts a triangle to a Polygon&lt;3&gt;, aA, bB, cC in this order
+/// </summary>
+Polygon<3> polyFromTriangle(const triangle& t);
+
+/// <summary>
+/// Creates a regular polygon with n vertices at run time
+/// </summary>
+/// <param name="n">number of vertices, at least 3</param>
+/// <param name="center">center point</param>
+/// <param name="len">side length</param>
+/// <param name="phi">orientation angle</param>
+/// <returns>the polygon</returns>
+polygon makeRegular(int n, vertex center, double len, double phi);
+
+/// <summary>
+/// Places the vertices of a polygon around its center zZ
+/// </summary>
+/// <param name="p">the polygon, only zZ and the number of vertices are read</param>
+/// <param name="unit">body space vertex offsets, one per vertex</param>
+/// <param name="phi">orientation angle</param>
+/// <param name="len">scale of the offsets</param>
+void polyPose(struct polygon* p, const vertex* unit, double phi, double len);
+
+/// <summary>
+/// Rotates the vertices of a polygon around its center
+/// </summary>
+/// <param name="p">the polygon</param>
+/// <param name="phi">rotation angle</param>
+void polyRotate(struct polygon* p, double phi);
+
+/// <summary>
+/// Moves a polygon
+/// </summary>
+/// <param name="p">the polygon</param>
+/// <param name="velo">move distance</param>
+void polyTranslate(struct polygon* p, velocity velo);
+
+/// <summary>
+/// Resizes a polygon around its center
+/// </summary>
+/// <param name="p">the polygon</param>
+/// <param name="coeff">resize ratio</param>
+void polyResize(struct polygon* p, double coeff);
+
+/// <summary>
+/// Moves a polygon by velo * dt and reflects it at the window borders like triSweep
+/// </summary>
+/// <param name="p">the polygon</param>
+/// <param name="velo">translational velocity</param>
+/// <param name="dt">timestep, 0 only resolves an existing penetration</param>
+/// <param name="breite">horizontal dimension of the window</param>
+/// <param name="hoehe">vertical dimension of the window</param>
+/// <param name="omega">angular velocity, reversed on impact</param>
+/// <returns>true if the polygon touched a border</returns>
+bool polySweep(struct polygon* p, velocity* velo, double dt, double breite, double hoehe, double* omega);
+
+/// <summary>
+/// Separating axis test of two convex polygons of any vertex count
+/// </summary>
+/// <param name="p">first polygon</param>
+/// <param name="q">second polygon</param>
+/// <param name="c">if not null and the polygons overlap, receives normal, depth and point, a and b are left untouched</param>
+/// <returns>true if the polygons overlap</returns>
+bool polyOverlap(const polygon& p, const polygon& q, struct contact* c);
@@ -0,0 +1,362 @@
+#define _USE_MATH_DEFINES
+#include "precision.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/// <summary>
+/// Arithmetic the kernels need from a scalar type. work is the floating point type vertices are
+/// derived in (load and store convert to and from it), step the form of dt that velocities are multiplied with.
+/// </summary>
+template <class T>
+struct scalarTraits;
+
+template <>
+struct scalarTraits<double> {
+    typedef double work;
+    typedef double step;
+    static const char* name() { return "double"; }
+    static double from(double v) { return v; }
+    static double to(double v) { return v; }
+    static work load(double v) { return v; }
+    static double store(work v) { return v; }
+    static double fromAngle(double phi) { return phi; }
+    static double toAngle(double phi) { return phi; }
+    static work loadAngle(double phi) { return phi; }
+    static step makeStep(double dt) { return dt; }
+    static double advance(double v, step k) { return v * k; }
+    static double turn(double phi, double omega, step k) {
+        double p = phi + omega * k;
+        return p - 2 * M_PI * nearbyint(p * (0.5 / M_PI));
+    }
+};
+
+template <>
+struct scalarTraits<float> {
+    typedef float work;
+    typedef float step;
+    static const char* name() { return "float"; }
+    static float from(double v) { return (float)v; }
+    static double to(float v) { return v; }
+    static work load(float v) { return v; }
+    static float store(work v) { return v; }
+    static float fromAngle(double phi) { return (float)phi; }
+    static double toAngle(float phi) { return phi; }
+    static work loadAngle(float phi) { return phi; }
+    static step makeStep(double dt) { return (float)dt; }
+    static float advance(float v, step k) { return v * k; }
+    static float turn(float phi, float omega, step k) {
+        float p = phi + omega * k;
+        return p - (float)(2 * M_PI) * nearbyintf(p * (float)(0.5 / M_PI));
+    }
+};
+
+/// <summary>
+/// dt for fixed32: move is dt as Q0.32, so the product with a Q16.16 speed keeps 32 fraction bits before
+/// it is rounded. turn converts a Q16.16 angular speed into 2^-32 turns per step the same way.
+/// </summary>
+struct fixedStep { int64_t move; int64_t turn; };
+
+/*
+ * The angle of a fixed32 body is a binary angle, raw / 2^32 of a full turn. The integer wraps around at
+ * exactly one turn, so no reduction is needed and the resolution is 1.5e-9 rad. A Q16.16 angle would
+ * add the same rounding error of omega * dt in every step, which grows into a visible drift.
+ */
+template <>
+struct scalarTraits<fixed32> {
+    typedef float work;
+    typedef fixedStep step;
+    static const char* name() { return "fixed32"; }
+    static fixed32 from(double v) { return { (int32_t)lrint(v * 65536) }; }
+    static double to(fixed32 v) { return v.raw * (1.0 / 65536); }
+    static work load(fixed32 v) { return v.raw * (1.0f / 65536); }
+    /* vertex offsets are a few body sizes at most, rounding half away from zero in float is exact enough for them */
+    static fixed32 store(work v) { return { (int32_t)(v * 65536 + std::copysign(0.5f, v)) }; }
+    static fixed32 fromAngle(double phi) { return { (int32_t)llrint(phi * (2147483648.0 / M_PI)) }; }
+    static double toAngle(fixed32 phi) { return phi.raw * (M_PI / 2147483648.0); }
+    static work loadAngle(fixed32 phi) { return phi.raw * (float)(M_PI / 2147483648.0); }
+    static step makeStep(double dt) { return { llrint(dt * 4294967296.0), llrint(dt * (4294967296.0 / (2 * M_PI))) }; }
+    static fixed32 advance(fixed32 v, step k) { return { (int32_t)(((int64_t)v.raw * k.move + ((int64_t)1 << 31)) >> 32) }; }
+    static fixed32 turn(fixed32 phi, fixed32 omega, step k) {
+        const int64_t d = ((int64_t)omega.raw * k.turn + (1 << 15)) >> 16;
+        return { (int32_t)((uint32_t)phi.raw + (uint32_t)d) };
+    }
+};
+
+template <class T>
+static void verticesScalar(struct bodyStore<T>* st, size_t from, size_t to);
+
+template <class T>
+const char* storeScalarName() { return scalarTraits<T>::name(); }
+
+template <class T>
+void storeFromWorld(struct bodyStore<T>* st, const world& w) {
+    typedef scalarTraits<T> S;
+    *st = bodyStore<T>();
+    for (const body& b : w.bodies) {
+        st->x.push_back(S::from(b.tri.zZ.x));
+        st->y.push_back(S::from(b.tri.zZ.y));
+        st->phi.push_back(S::fromAngle(remainder(b.phi, 2 * M_PI)));
+        st->len.push_back(S::from(b.len));
+        st->vx.push_back(S::from(b.velo.x));
+        st->vy.push_back(S::from(b.velo.y));
+        st->omega.push_back(S::from(b.omega));
+    }
+    st->count = w.bodies.size();
+    for (std::vector<T>* v : { &st->ax, &st->ay, &st->bx, &st->by, &st->cx, &st->cy })
+        v->resize(st->count);
+    verticesScalar(st, 0, st->count);
+}
+
+template <class T>
+triangle storeTriangle(const bodyStore<T>& st, size_t i) {
+    typedef scalarTraits<T> S;
+    triangle t;
+    t.aA = { S::to(st.ax[i]), S::to(st.ay[i]) };
+    t.bB = { S::to(st.bx[i]), S::to(st.by[i]) };
+    t.cC = { S::to(st.cx[i]), S::to(st.cy[i]) };
+    t.zZ = { S::to(st.x[i]), S::to(st.y[i]) };
+    return t;
+}
+
+template <class T>
+void storeSpin(const bodyStore<T>& st, size_t i, double* phi, double* omega) {
+    *phi = scalarTraits<T>::toAngle(st.phi[i]);
+    *omega = scalarTraits<T>::to(st.omega[i]);
+}
+
+/* the portable loops, for any T */
+
+template <class T>
+static void rotateScalar(struct bodyStore<T>* st, typename scalarTraits<T>::step k, size_t from, size_t to) {
+    typedef scalarTraits<T> S;
+    for (size_t i = from; i < to; i++)
+        st->phi[i] = S::turn(st->phi[i], st->omega[i], k);
+}
+
+template <class T>
+static void translateScalar(struct bodyStore<T>* st, typename scalarTraits<T>::step k, size_t from, size_t to) {
+    typedef scalarTraits<T> S;
+    for (size_t i = from; i < to; i++) {
+        st->x[i] = st->x[i] + S::advance(st->vx[i], k);
+        st->y[i] = st->y[i] + S::advance(st->vy[i], k);
+    }
+}
+
+/// <summary>
+/// Derives the vertices in the work type: the offset from the center is computed there and rounded
+/// to T once, so the center itself keeps the full precision of T
+/// </summary>
+template <class T>
+static void verticesScalar(struct bodyStore<T>* st, size_t from, size_t to) {
+    typedef scalarTraits<T> S;
+    typedef typename S::work W;
+    const W ux[3] = { (W)unitTri[0].x, (W)unitTri[1].x, (W)unitTri[2].x };
+    const W uy[3] = { (W)unitTri[0].y, (W)unitTri[1].y, (W)unitTri[2].y };
+    T* px[3] = { st->ax.data(), st->bx.data(), st->cx.data() }, * py[3] = { st->ay.data(), st->by.data(), st->cy.data() };
+    for (size_t i = from; i < to; i++) {
+        const W phi = S::loadAngle(st->phi[i]), len = S::load(st->len[i]);
+        const W lc = len * std::cos(phi), ls = len * std::sin(phi);
+        for (int k = 0; k < 3; k++) {
+            px[k][i] = st->x[i] + S::store(ux[k] * lc - uy[k] * ls);
+            py[k][i] = st->y[i] + S::store(ux[k] * ls + uy[k] * lc);
+        }
+    }
+}
+
+/// <summary>
+/// Border handling like soaCollide. Every vertex is compared with the walls in T without a branch;
+/// only a body that is out gets its bounds and goes through axisSweep in double, and the resulting
+/// move is rounded back to T.
+/// </summary>
+template <class T>
+static size_t collide(struct bodyStore<T>* st, double breite, double hoehe) {
+    typedef scalarTraits<T> S;
+    const T hiX = S::from(breite), loX = -hiX, hiY = S::from(hoehe), loY = -hiY;
+    size_t hits = 0;
+    for (size_t i = 0; i < st->count; i++) {
+        const T ax = st->ax[i], bx = st->bx[i], cx = st->cx[i], ay = st->ay[i], by = st->by[i], cy = st->cy[i];
+        const bool outX = (ax < loX) | (bx < loX) | (cx < loX) | (ax > hiX) | (bx > hiX) | (cx > hiX);
+        const bool outY = (ay < loY) | (by < loY) | (cy < loY) | (ay > hiY) | (by > hiY) | (cy > hiY);
+        if (!(outX | outY))
+            continue;
+        T mx = S::from(0), my = S::from(0);
+        if (outX) {
+            double v = S::to(st->vx[i]), move;
+            axisSweep(S::to(std::min(ax, std::min(bx, cx))), S::to(std::max(ax, std::max(bx, cx))), &v, 0, breite, &move);
+            st->vx[i] = S::from(v);
+            mx = S::from(move);
+        }
+        if (outY) {
+            double v = S::to(st->vy[i]), move;
+            axisSweep(S::to(std::min(ay, std::min(by, cy))), S::to(std::max(ay, std::max(by, cy))), &v, 0, hoehe, &move);
+            st->vy[i] = S::from(v);
+            my = S::from(move);
+        }
+        st->x[i] = st->x[i] + mx;
+        st->y[i] = st->y[i] + my;
+        for (T* p : { &st->ax[i], &st->bx[i], &st->cx[i] })
+            *p = *p + mx;
+        for (T* p : { &st->ay[i], &st->by[i], &st->cy[i] })
+            *p = *p + my;
+        st->omega[i] = -st->omega[i];
+        hits++;
+    }
+    return hits;
+}
+
+template <class T>
+size_t storeStepScalar(struct bodyStore<T>* st, double breite, double hoehe, double dt) {
+    const typename scalarTraits<T>::step k = scalarTraits<T>::makeStep(dt);
+    rotateScalar(st, k, 0, st->count);
+    translateScalar(st, k, 0, st->count);
+    verticesScalar(st, 0, st->count);
+    return collide(st, breite, hoehe);
+}
+
+/* vectorized float kernels, eight bodies per AVX2 register and four per NEON register */
+
+#if defined(__AVX2__)
+
+static void rotateSimd(struct bodyStore<float>* st, float k) {
+    float* phi = st->phi.data();
+    const float* omega = st->omega.data();
+    const size_t n = st->count & ~(size_t)7;
+    const __m256 vk = _mm256_set1_ps(k), twoPi = _mm256_set1_ps((float)(2 * M_PI)), inv = _mm256_set1_ps((float)(0.5 / M_PI));
+    for (size_t i = 0; i < n; i += 8) {
+        __m256 p = _mm256_add_ps(_mm256_loadu_ps(phi + i), _mm256_mul_ps(_mm256_loadu_ps(omega + i), vk));
+        __m256 r = _mm256_round_ps(_mm256_mul_ps(p, inv), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm256_storeu_ps(phi + i, _mm256_sub_ps(p, _mm256_mul_ps(twoPi, r)));
+    }
+    rotateScalar(st, k, n, st->count);
+}
+
+static void translateSimd(struct bodyStore<float>* st, float k) {
+    float* x = st->x.data(), * y = st->y.data();
+    const float* vx = st->vx.data(), * vy = st->vy.data();
+    const size_t n = st->count & ~(size_t)7;
+    const __m256 vk = _mm256_set1_ps(k);
+    for (size_t i = 0; i < n; i += 8) {
+        _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(_mm256_loadu_ps(vx + i), vk)));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(_mm256_loadu_ps(vy + i), vk)));
+    }
+    translateScalar(st, k, n, st->count);
+}
+
+/// <summary>
+/// Stores center + R(phi) * len * unit offset for eight bodies
+/// </summary>
+static inline void storeVertex(float* px, float* py, size_t i, __m256 x, __m256 y, __m256 lc, __m256 ls, double ux, double uy) {
+    const __m256 vux = _mm256_set1_ps((float)ux), vuy = _mm256_set1_ps((float)uy);
+    _mm256_storeu_ps(px + i, _mm256_add_ps(x, _mm256_sub_ps(_mm256_mul_ps(vux, lc), _mm256_mul_ps(vuy, ls))));
+    _mm256_storeu_ps(py + i, _mm256_add_ps(y, _mm256_add_ps(_mm256_mul_ps(vux, ls), _mm256_mul_ps(vuy, lc))));
+}
+
+static void verticesSimd(struct bodyStore<float>* st) {
+    const size_t n = st->count & ~(size_t)7;
+    alignas(32) float c[8], s[8];
+    for (size_t i = 0; i < n; i += 8) {
+        for (int l = 0; l < 8; l++) {
+            c[l] = std::cos(st->phi[i + l]);
+            s[l] = std::sin(st->phi[i + l]);
+        }
+        const __m256 len = _mm256_loadu_ps(st->len.data() + i);
+        const __m256 lc = _mm256_mul_ps(len, _mm256_load_ps(c)), ls = _mm256_mul_ps(len, _mm256_load_ps(s));
+        const __m256 x = _mm256_loadu_ps(st->x.data() + i), y = _mm256_loadu_ps(st->y.data() + i);
+        storeVertex(st->ax.data(), st->ay.data(), i, x, y, lc, ls, unitTri[0].x, unitTri[0].y);
+        storeVertex(st->bx.data(), st->by.data(), i, x, y, lc, ls, unitTri[1].x, unitTri[1].y);
+        storeVertex(st->cx.data(), st->cy.data(), i, x, y, lc, ls, unitTri[2].x, unitTri[2].y);
+    }
+    verticesScalar(st, n, st->count);
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+static void rotateSimd(struct bodyStore<float>* st, float k) {
+    float* phi = st->phi.data();
+    const float* omega = st->omega.data();
+    const size_t n = st->count & ~(size_t)3;
+    const float32x4_t twoPi = vdupq_n_f32((float)(2 * M_PI)), inv = vdupq_n_f32((float)(0.5 / M_PI));
+    for (size_t i = 0; i < n; i += 4) {
+        float32x4_t p = vaddq_f32(vld1q_f32(phi + i), vmulq_n_f32(vld1q_f32(omega + i), k));
+        float32x4_t r = vrndnq_f32(vmulq_f32(p, inv));
+        vst1q_f32(phi + i, vsubq_f32(p, vmulq_f32(twoPi, r)));
+    }
+    rotateScalar(st, k, n, st->count);
+}
+
+static void translateSimd(struct bodyStore<float>* st, float k) {
+    float* x = st->x.data(), * y = st->y.data();
+    const float* vx = st->vx.data(), * vy = st->vy.data();
+    const size_t n = st->count & ~(size_t)3;
+    for (size_t i = 0; i < n; i += 4) {
+        vst1q_f32(x + i, vaddq_f32(vld1q_f32(x + i), vmulq_n_f32(vld1q_f32(vx + i), k)));
+        vst1q_f32(y + i, vaddq_f32(vld1q_f32(y + i), vmulq_n_f32(vld1q_f32(vy + i), k)));
+    }
+    translateScalar(st, k, n, st->count);
+}
+
+static inline void storeVertex(float* px, float* py, size_t i, float32x4_t x, float32x4_t y,
+    float32x4_t lc, float32x4_t ls, double ux, double uy) {
+    const float fx = (float)ux, fy = (float)uy;
+    vst1q_f32(px + i, vaddq_f32(x, vsubq_f32(vmulq_n_f32(lc, fx), vmulq_n_f32(ls, fy))));
+    vst1q_f32(py + i, vaddq_f32(y, vaddq_f32(vmulq_n_f32(ls, fx), vmulq_n_f32(lc, fy))));
+}
+
+static void verticesSimd(struct bodyStore<float>* st) {
+    const size_t n = st->count & ~(size_t)3;
+    alignas(16) float c[4], s[4];
+    for (size_t i = 0; i < n; i += 4) {
+        for (int l = 0; l < 4; l++) {
+            c[l] = std::cos(st->phi[i + l]);
+            s[l] = std::sin(st->phi[i + l]);
+        }
+        const float32x4_t len = vld1q_f32(st->len.data() + i);
+        const float32x4_t lc = vmulq_f32(len, vld1q_f32(c)), ls = vmulq_f32(len, vld1q_f32(s));
+        const float32x4_t x = vld1q_f32(st->x.data() + i), y = vld1q_f32(st->y.data() + i);
+        storeVertex(st->ax.data(), st->ay.data(), i, x, y, lc, ls, unitTri[0].x, unitTri[0].y);
+        storeVertex(st->bx.data(), st->by.data(), i, x, y, lc, ls, unitTri[1].x, unitTri[1].y);
+        storeVertex(st->cx.data(), st->cy.data(), i, x, y, lc, ls, unitTri[2].x, unitTri[2].y);
+    }
+    verticesScalar(st, n, st->count);
+}
+
+#else
+
+static void rotateSimd(struct bodyStore<float>* st, float k) { rotateScalar(st, k, 0, st->count); }
+static void translateSimd(struct bodyStore<float>* st, float k) { translateScalar(st, k, 0, st->count); }
+static void verticesSimd(struct bodyStore<float>* st) { verticesScalar(st, 0, st->count); }
+
+#endif
+
+template <class T>
+size_t storeStep(struct bodyStore<T>* st, double breite, double hoehe, double dt) {
+    return storeStepScalar(st, breite, hoehe, dt);
+}
+
+template <>
+size_t storeStep(struct bodyStore<float>* st, double breite, double hoehe, double dt) {
+    const float k = (float)dt;
+    rotateSimd(st, k);
+    translateSimd(st, k);
+    verticesSimd(st);
+    return collide(st, breite, hoehe);
+}
+
+#define STORE_INSTANTIATE(T) \
+    template const char* storeScalarName<T>(); \
+    template void storeFromWorld<T>(struct bodyStore<T>*, const world&); \
+    template triangle storeTriangle<T>(const bodyStore<T>&, size_t); \
+    template void storeSpin<T>(const bodyStore<T>&, size_t, double*, double*); \
+    template size_t storeStepScalar<T>(struct bodyStore<T>*, double, double, double);
+
+STORE_INSTANTIATE(double)
+STORE_INSTANTIATE(float)
+STORE_INSTANTIATE(fixed32)
+template size_t storeStep<double>(struct bodyStore<double>*, double, double, double);
+template size_t storeStep<fixed32>(struct bodyStore<fixed32>*, double, double, double);
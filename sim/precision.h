@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sim.h"
+
+/// <summary>
+/// Signed Q16.16 fixed point number: raw / 65536. Covers +-32768 with a resolution of 1.5e-5,
+/// plenty for screen space positions, sizes and speeds in pixels.
+/// </summary>
+struct fixed32 {
+    int32_t raw;
+};
+
+inline fixed32 operator+(fixed32 a, fixed32 b) { return { a.raw + b.raw }; }
+inline fixed32 operator-(fixed32 a, fixed32 b) { return { a.raw - b.raw }; }
+inline fixed32 operator-(fixed32 a) { return { -a.raw }; }
+inline bool operator<(fixed32 a, fixed32 b) { return a.raw < b.raw; }
+inline bool operator>(fixed32 a, fixed32 b) { return a.raw > b.raw; }
+
+/// <summary>
+/// Structure-of-arrays store of the reflect-mode simulation (rotate, translate, border collision) with a
+/// configurable scalar type T: double, float or fixed32. Center, orientation, side length, velocities and
+/// the cached vertices are all kept in T (a fixed32 orientation is a binary angle, 2^32 to the turn), so float and fixed32 need half the memory and bandwidth of double
+/// and fit twice as many bodies into a SIMD register.
+/// </summary>
+template <class T>
+struct bodyStore {
+    size_t count = 0;
+    std::vector<T> x, y;
+    std::vector<T> phi, len;
+    std::vector<T> vx, vy;
+    std::vector<T> omega;
+    std::vector<T> ax, ay, bx, by, cx, cy;
+};
+
+/// <summary>
+/// Name of a scalar type
+/// </summary>
+/// <returns>"double", "float" or "fixed32"</returns>
+template <class T>
+const char* storeScalarName();
+
+/// <summary>
+/// Bytes a body takes in the store
+/// </summary>
+/// <returns>13 values of type T</returns>
+template <class T>
+constexpr size_t storeBodyBytes() { return 13 * sizeof(T); }
+
+/// <summary>
+/// Replaces the content of the store with the bodies of a world, rounded to T
+/// </summary>
+/// <param name="st">the store</param>
+/// <param name="w">the world to be copied</param>
+template <class T>
+void storeFromWorld(struct bodyStore<T>* st, const world& w);
+
+/// <summary>
+/// The cached vertices and the center of one body, converted to double
+/// </summary>
+/// <param name="st">the store</param>
+/// <param name="i">index of the body</param>
+/// <returns>the triangle</returns>
+template <class T>
+triangle storeTriangle(const bodyStore<T>& st, size_t i);
+
+/// <summary>
+/// Orientation and angular velocity of one body, converted to double
+/// </summary>
+/// <param name="st">the store</param>
+/// <param name="i">index of the body</param>
+/// <param name="phi">receives the angle in [-pi, pi]</param>
+/// <param name="omega">receives the angular velocity</param>
+template <class T>
+void storeSpin(const bodyStore<T>& st, size_t i, double* phi, double* omega);
+
+/// <summary>
+/// One fixed timestep like soaStep with BOUNDARY_DISCRETE: rotate, translate, derive vertices, collide with the borders.
+/// float uses the AVX2 or NEON kernels when the compiler targets them.
+/// </summary>
+/// <param name="st">the store</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="dt">timestep</param>
+/// <returns>number of bodies that hit a border</returns>
+template <class T>
+size_t storeStep(struct bodyStore<T>* st, double breite, double hoehe, double dt);
+
+template <>
+size_t storeStep(struct bodyStore<float>* st, double breite, double hoehe, double dt);
+
+/// <summary>
+/// storeStep with the portable loops only, the vectorized kernels are checked against it
+/// </summary>
+template <class T>
+size_t storeStepScalar(struct bodyStore<T>* st, double breite, double hoehe, double dt);
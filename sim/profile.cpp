@@ -0,0 +1,246 @@
+#include "profile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/* events kept per thread for the Chrome trace, the oldest are overwritten */
+static const uint64_t ringSize = 1 << 14;
+
+struct profileEvent {
+    uint64_t start;
+    uint64_t end;
+    uint32_t stage;
+};
+
+/// <summary>
+/// Everything one thread records. Only the owning thread writes to it.
+/// </summary>
+struct profileThread {
+    uint32_t id;
+    uint64_t written = 0;
+    profileEvent ring[ringSize];
+    latencyHistogram hist[STAGE_COUNT];
+};
+
+static std::mutex& registryLock() {
+    static std::mutex m;
+    return m;
+}
+
+/* owns the buffers of every thread that ever recorded, they outlive their thread for the reports */
+static std::vector<std::unique_ptr<profileThread>>& registry() {
+    static std::vector<std::unique_ptr<profileThread>> threads;
+    return threads;
+}
+
+static thread_local profileThread* mine = nullptr;
+
+static int highestBit(uint64_t v) {
+    int e = 0;
+    for (int s = 32; s > 0; s >>= 1)
+        if (v >> s) {
+            v >>= s;
+            e += s;
+        }
+    return e;
+}
+
+static int bucketOf(uint64_t v) {
+    if (v < (2u << histogramSubBits))
+        return (int)v;
+    const int e = highestBit(v);
+    return ((e - histogramSubBits + 1) << histogramSubBits) + (int)((v >> (e - histogramSubBits)) & ((1 << histogramSubBits) - 1));
+}
+
+/* largest value that falls into a bucket */
+static uint64_t bucketTop(int b) {
+    if (b < (2 << histogramSubBits))
+        return (uint64_t)b;
+    const int e = (b >> histogramSubBits) + histogramSubBits - 1, sub = b & ((1 << histogramSubBits) - 1);
+    const uint64_t lower = (uint64_t)((1 << histogramSubBits) + sub) << (e - histogramSubBits);
+    return lower + ((uint64_t)1 << (e - histogramSubBits)) - 1;
+}
+
+/// <summary>
+/// Empties a histogram
+/// </summary>
+/// <param name="h">the histogram</param>
+void histogramClear(struct latencyHistogram* h) {
+    std::memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+/// <summary>
+/// Counts one value
+/// </summary>
+/// <param name="h">the histogram</param>
+/// <param name="ns">the value, nanoseconds</param>
+void histogramAdd(struct latencyHistogram* h, uint64_t ns) {
+    h->counts[bucketOf(ns)]++;
+    h->count++;
+    h->sum += ns;
+    h->min = std::min(h->min, ns);
+    h->max = std::max(h->max, ns);
+}
+
+/// <summary>
+/// Adds all values of one histogram to another
+/// </summary>
+/// <param name="h">receives the values</param>
+/// <param name="other">the values to add</param>
+void histogramMerge(struct latencyHistogram* h, const latencyHistogram& other) {
+    for (int b = 0; b < histogramBuckets; b++)
+        h->counts[b] += other.counts[b];
+    h->count += other.count;
+    h->sum += other.sum;
+    h->min = std::min(h->min, other.min);
+    h->max = std::max(h->max, other.max);
+}
+
+/// <summary>
+/// Value below which the given fraction of the counted values lies, rounded up to its bucket
+/// </summary>
+/// <param name="h">the histogram</param>
+/// <param name="q">fraction between 0 and 1, e.g. 0.99</param>
+/// <returns>nanoseconds, 0 for an empty histogram</returns>
+uint64_t histogramPercentile(const latencyHistogram& h, double q) {
+    if (!h.count)
+        return 0;
+    const uint64_t rank = std::max<uint64_t>(1, (uint64_t)(q * h.count + 0.999999));
+    uint64_t seen = 0;
+    for (int b = 0; b < histogramBuckets; b++) {
+        seen += h.counts[b];
+        if (seen >= rank)
+            return std::min(bucketTop(b), h.max);
+    }
+    return h.max;
+}
+
+/// <summary>
+/// Name of a stage as used in the reports
+/// </summary>
+/// <param name="stage">the stage</param>
+/// <returns>e.g. "integrate"</returns>
+const char* profileStageName(profileStage stage) {
+    static const char* names[STAGE_COUNT] = { "step", "integrate", "broadphase", "narrowphase", "solve",
+        "input", "draw", "swap", "frame" };
+    return stage < STAGE_COUNT ? names[stage] : "?";
+}
+
+/// <summary>
+/// Nanoseconds since the first call in this process, on the steady clock
+/// </summary>
+/// <returns>nanoseconds</returns>
+uint64_t profileNow() {
+    static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+/// <summary>
+/// Records a timed stage on the calling thread: into its ring buffer of recent events and into its
+/// histogram of the stage. Every thread writes only its own buffers, so this takes no lock.
+/// </summary>
+/// <param name="stage">the stage</param>
+/// <param name="start">profileNow at the start</param>
+/// <param name="end">profileNow at the end</param>
+void profileRecord(profileStage stage, uint64_t start, uint64_t end) {
+    if (!mine) {
+        std::unique_ptr<profileThread> t(new profileThread());
+        for (latencyHistogram& h : t->hist)
+            histogramClear(&h);
+        std::lock_guard<std::mutex> lock(registryLock());
+        t->id = (uint32_t)registry().size() + 1;
+        mine = t.get();
+        registry().push_back(std::move(t));
+    }
+    mine->ring[mine->written % ringSize] = { start, end, (uint32_t)stage };
+    mine->written++;
+    histogramAdd(&mine->hist[stage], end - start);
+}
+
+/// <summary>
+/// Forgets everything recorded so far on all threads
+/// </summary>
+void profileReset() {
+    std::lock_guard<std::mutex> lock(registryLock());
+    for (std::unique_ptr<profileThread>& t : registry()) {
+        t->written = 0;
+        for (latencyHistogram& h : t->hist)
+            histogramClear(&h);
+    }
+}
+
+/// <summary>
+/// Merges the histograms of all threads
+/// </summary>
+/// <param name="out">receives one histogram per stage</param>
+void profileHistograms(struct latencyHistogram out[STAGE_COUNT]) {
+    for (int s = 0; s < STAGE_COUNT; s++)
+        histogramClear(&out[s]);
+    std::lock_guard<std::mutex> lock(registryLock());
+    for (std::unique_ptr<profileThread>& t : registry())
+        for (int s = 0; s < STAGE_COUNT; s++)
+            histogramMerge(&out[s], t->hist[s]);
+}
+
+/// <summary>
+/// Writes count, mean, p50, p99 and max of every stage that was recorded as JSON
+/// </summary>
+/// <param name="f">an open file</param>
+/// <returns>false on a write error</returns>
+bool profileWriteJson(FILE* f) {
+    std::vector<latencyHistogram> hist(STAGE_COUNT);
+    profileHistograms(hist.data());
+    std::fprintf(f, "{\n  \"unit\": \"us\",\n  \"stages\": [");
+    bool first = true;
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const latencyHistogram& h = hist[s];
+        if (!h.count)
+            continue;
+        std::fprintf(f, "%s\n    { \"name\": \"%s\", \"count\": %llu, \"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f }",
+            first ? "" : ",", profileStageName((profileStage)s), (unsigned long long)h.count, h.sum / 1e3 / h.count,
+            histogramPercentile(h, 0.5) / 1e3, histogramPercentile(h, 0.99) / 1e3, h.max / 1e3);
+        first = false;
+    }
+    return std::fprintf(f, "\n  ]\n}\n") > 0 && !std::ferror(f);
+}
+
+/// <summary>
+/// Writes the events still held in the ring buffers as Chrome trace, one track per thread
+/// </summary>
+/// <param name="f">an open file</param>
+/// <returns>false on a write error</returns>
+bool profileWriteChromeTrace(FILE* f) {
+    std::lock_guard<std::mutex> lock(registryLock());
+    std::fprintf(f, "{\"traceEvents\":[");
+    bool first = true;
+    for (std::unique_ptr<profileThread>& t : registry()) {
+        const uint64_t from = t->written > ringSize ? t->written - ringSize : 0;
+        for (uint64_t i = from; i < t->written; i++) {
+            const profileEvent& e = t->ring[i % ringSize];
+            std::fprintf(f, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                first ? "" : ",", profileStageName((profileStage)e.stage), t->id, e.start / 1e3, (e.end - e.start) / 1e3);
+            first = false;
+        }
+    }
+    return std::fprintf(f, "\n]}\n") > 0 && !std::ferror(f);
+}
+
+/// <summary>
+/// Prints a table of count, p50, p99 and max per stage
+/// </summary>
+/// <param name="f">an open file</param>
+void profilePrint(FILE* f) {
+    std::vector<latencyHistogram> hist(STAGE_COUNT);
+    profileHistograms(hist.data());
+    std::fprintf(f, "%-12s %10s %10s %10s %10s\n", "stage", "count", "p50 us", "p99 us", "max us");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const latencyHistogram& h = hist[s];
+        if (h.count)
+            std::fprintf(f, "%-12s %10llu %10.2f %10.2f %10.2f\n", profileStageName((profileStage)s), (unsigned long long)h.count,
+                histogramPercentile(h, 0.5) / 1e3, histogramPercentile(h, 0.99) / 1e3, h.max / 1e3);
+    }
+}
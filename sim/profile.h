@@ -0,0 +1,132 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+
+/// <summary>
+/// Stages of the main loop that are timed. STAGE_INTEGRATE covers rotation, translation and vertex
+/// update, which run fused per chunk; in RESPONSE_REFLECT mode it also covers the border collision.
+/// </summary>
+enum profileStage {
+    STAGE_STEP, STAGE_INTEGRATE, STAGE_BROADPHASE, STAGE_NARROWPHASE, STAGE_SOLVE,
+    STAGE_INPUT, STAGE_DRAW, STAGE_SWAP, STAGE_FRAME, STAGE_COUNT
+};
+
+/* log-linear buckets: 16 per power of two, so a bucket is at most 1/16 wider than its lower end */
+static const int histogramSubBits = 4;
+static const int histogramBuckets = 64 << histogramSubBits;
+
+/// <summary>
+/// Latency histogram in the manner of HdrHistogram: constant relative precision from 1 ns up to
+/// the full 64 bit range, fixed size, adding a value is a few integer operations
+/// </summary>
+struct latencyHistogram {
+    uint64_t counts[histogramBuckets];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+};
+
+/// <summary>
+/// Empties a histogram
+/// </summary>
+/// <param name="h">the histogram</param>
+void histogramClear(struct latencyHistogram* h);
+
+/// <summary>
+/// Counts one value
+/// </summary>
+/// <param name="h">the histogram</param>
+/// <param name="ns">the value, nanoseconds</param>
+void histogramAdd(struct latencyHistogram* h, uint64_t ns);
+
+/// <summary>
+/// Adds all values of one histogram to another
+/// </summary>
+/// <param name="h">receives the values</param>
+/// <param name="other">the values to add</param>
+void histogramMerge(struct latencyHistogram* h, const latencyHistogram& other);
+
+/// <summary>
+/// Value below which the given fraction of the counted values lies, rounded up to its bucket
+/// </summary>
+/// <param name="h">the histogram</param>
+/// <param name="q">fraction between 0 and 1, e.g. 0.99</param>
+/// <returns>nanoseconds, 0 for an empty histogram</returns>
+uint64_t histogramPercentile(const latencyHistogram& h, double q);
+
+/// <summary>
+/// Name of a stage as used in the reports
+/// </summary>
+/// <param name="stage">the stage</param>
+/// <returns>e.g. "integrate"</returns>
+const char* profileStageName(profileStage stage);
+
+/// <summary>
+/// Nanoseconds since the first call in this process, on the steady clock
+/// </summary>
+/// <returns>nanoseconds</returns>
+uint64_t profileNow();
+
+/// <summary>
+/// Records a timed stage on the calling thread: into its ring buffer of recent events and into its
+/// histogram of the stage. Every thread writes only its own buffers, so this takes no lock.
+/// </summary>
+/// <param name="stage">the stage</param>
+/// <param name="start">profileNow at the start</param>
+/// <param name="end">profileNow at the end</param>
+void profileRecord(profileStage stage, uint64_t start, uint64_t end);
+
+/// <summary>
+/// Forgets everything recorded so far on all threads. Like the functions below it must only be
+/// called while no other thread is recording.
+/// </summary>
+void profileReset();
+
+/// <summary>
+/// Merges the histograms of all threads
+/// </summary>
+/// <param name="out">receives one histogram per stage</param>
+void profileHistograms(struct latencyHistogram out[STAGE_COUNT]);
+
+/// <summary>
+/// Writes count, mean, p50, p99 and max of every stage that was recorded as JSON
+/// </summary>
+/// <param name="f">an open file</param>
+/// <returns>false on a write error</returns>
+bool profileWriteJson(FILE* f);
+
+/// <summary>
+/// Writes the events still held in the ring buffers as Chrome trace ("traceEvents"), one track per
+/// thread, to be opened in chrome://tracing or Perfetto
+/// </summary>
+/// <param name="f">an open file</param>
+/// <returns>false on a write error</returns>
+bool profileWriteChromeTrace(FILE* f);
+
+/// <summary>
+/// Prints a table of count, p50, p99 and max per stage
+/// </summary>
+/// <param name="f">an open file</param>
+void profilePrint(FILE* f);
+
+/// <summary>
+/// Times the enclosing scope, see PROFILE_SCOPE
+/// </summary>
+struct profileScope {
+    profileStage stage;
+    uint64_t start;
+    explicit profileScope(profileStage s) : stage(s), start(profileNow()) {}
+    ~profileScope() { profileRecord(stage, start, profileNow()); }
+};
+
+/* PROFILE_SCOPE(STAGE_X) times the rest of the enclosing block. Without SIM_PROFILE it is empty. */
+#if defined(SIM_PROFILE)
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(stage) profileScope PROFILE_CONCAT(profileScope_, __LINE__)(stage)
+static const bool profileEnabled = true;
+#else
+#define PROFILE_SCOPE(stage) ((void)0)
+static const bool profileEnabled = false;
+#endif
@@ -0,0 +1,179 @@
+#include "scene.h"
+#include <functional>
+
+#include "profile.h"
+
+/// <summary>
+/// Creates an empty scene
+/// </summary>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="dt">fixed timestep in seconds</param>
+/// <param name="cfg">settings</param>
+/// <returns>a scene without bodies</returns>
+scene makeScene(double breite, double hoehe, double dt, sceneConfig cfg) {
+    scene sc;
+    sc.breite = breite;
+    sc.hoehe = hoehe;
+    sc.dt = dt;
+    sc.cfg = cfg;
+    return sc;
+}
+
+/// <summary>
+/// Adds n bodies at random positions with random velocities, drawn like worldSpawn does
+/// </summary>
+/// <param name="sc">the scene to populate</param>
+/// <param name="n">number of bodies to add</param>
+/// <param name="len">side length of every body</param>
+/// <param name="seed">seed of the random engine, equal seeds give equal scenes</param>
+void sceneSpawn(struct scene* sc, size_t n, double len, unsigned seed) {
+    world w = makeWorld(sc->breite, sc->hoehe, sc->dt, ROT_POSE);
+    worldSpawn(&w, n, len, seed);
+    for (const body& b : w.bodies)
+        soaPush(&sc->bodies, b);
+}
+
+/// <summary>
+/// Sets density, restitution and friction of every body
+/// </summary>
+/// <param name="sc">the scene</param>
+/// <param name="density">mass per square pixel</param>
+/// <param name="restitution">ratio of normal speed after and before an impact</param>
+/// <param name="friction">Coulomb friction coefficient</param>
+void sceneSetMaterial(struct scene* sc, double density, double restitution, double friction) {
+    for (size_t i = 0; i < sc->bodies.count; i++)
+        soaSetMaterial(&sc->bodies, i, density, restitution, friction);
+}
+
+/// <summary>
+/// Joins the contacts of the chunks [from, to) in chunk order
+/// </summary>
+static size_t gatherContacts(struct scene* sc, size_t from, size_t to) {
+    size_t n = 0;
+    for (size_t c = from; c < to; c++) {
+        const std::vector<contact>& part = sc->chunkContacts[c];
+        sc->contacts.insert(sc->contacts.end(), part.begin(), part.end());
+        n += part.size();
+    }
+    return n;
+}
+
+/// <summary>
+/// Adds up the integration counters of the body chunks into the stats of the step
+/// </summary>
+static void gatherMotion(struct scene* sc) {
+    sc->stats.wallContacts = sc->stats.fastBodies = sc->stats.substeps = 0;
+    for (const integrateStats& m : sc->chunkMotion) {
+        sc->stats.wallContacts += m.hits;
+        sc->stats.fastBodies += m.fast;
+        sc->stats.substeps += m.substeps;
+    }
+}
+
+/// <summary>
+/// Advances the scene by one fixed timestep. With RESPONSE_IMPULSE: rotate, translate, derive vertices,
+/// find body and border contacts, solve them all together, then remove the remaining overlap.
+/// Border contacts are found after the move, so the boundary mode only matters for RESPONSE_REFLECT.
+/// Bodies too fast for one step are sub-stepped by the integrator, the rest keep the vectorized kernels.
+/// Rotation, translation, vertices, bounds, narrow phase and border contacts run in chunks on sc->pool;
+/// the grid, the solver and the separation stay on the calling thread because they couple all bodies.
+/// With sleeping on, every per body stage runs over the awake bodies only: sleeping bodies take part
+/// only as partners of the pairs found by looking up the awake boxes in the grid of the sleeping ones,
+/// and a contact with an awake body wakes their island before the solver runs.
+/// </summary>
+/// <param name="sc">the scene</param>
+void sceneStep(struct scene* sc) {
+    PROFILE_SCOPE(STAGE_STEP);
+    bodySoA* b = &sc->bodies;
+    const size_t grain = sc->cfg.grain;
+    if (sc->cfg.response == RESPONSE_REFLECT) {
+        PROFILE_SCOPE(STAGE_INTEGRATE);
+        sc->chunkMotion.assign(poolChunks(b->count, grain), integrateStats());
+        poolFor(sc->pool, b->count, grain, [sc, b](size_t c, size_t from, size_t to) {
+            integrateStepRange(b, from, to, sc->breite, sc->hoehe, sc->dt, sc->cfg.boundary, sc->cfg.integrator,
+                &sc->chunkMotion[c]);
+        });
+        sc->stats.pairs = sc->stats.bodyContacts = sc->stats.woken = sc->stats.asleep = 0;
+        sc->stats.awake = b->count;
+        gatherMotion(sc);
+        sc->steps++;
+        return;
+    }
+
+    sleepState& sl = sc->sleeping;
+    const bool sleeping = sc->cfg.sleep.enabled;
+    if (sleeping && sl.bodies != b->count)
+        sleepReset(&sl, b->count);
+    if (sleeping)
+        sleepRefresh(&sl);
+    const bool allAwake = !sleeping || sl.awake.size() == b->count;
+    const size_t bodyChunks = poolChunks(allAwake ? b->count : sl.awake.size(), grain);
+    /* runs fn(chunk, from, to) over the awake bodies: plain chunks while all are awake, else the runs of the awake list */
+    auto awakeFor = [sc, b, &sl, allAwake, grain](const std::function<void(size_t, size_t, size_t)>& fn) {
+        if (allAwake) {
+            poolFor(sc->pool, b->count, grain, fn);
+            return;
+        }
+        poolFor(sc->pool, sl.awake.size(), grain, [&sl, &fn](size_t c, size_t from, size_t to) {
+            forRuns(sl.awake.data() + from, to - from, [c, &fn](size_t lo, size_t hi) { fn(c, lo, hi); });
+        });
+    };
+
+    {
+        PROFILE_SCOPE(STAGE_INTEGRATE);
+        sc->box.lox.resize(b->count);
+        sc->box.loy.resize(b->count);
+        sc->box.hix.resize(b->count);
+        sc->box.hiy.resize(b->count);
+        sc->chunkMotion.assign(bodyChunks, integrateStats());
+        awakeFor([sc, b](size_t c, size_t from, size_t to) {
+            integrateStats st;
+            integrateMoveRange(b, from, to, sc->breite, sc->hoehe, sc->dt, sc->cfg.integrator, &st);
+            soaBoundsRange(*b, from, to, &sc->box);
+            sc->chunkMotion[c].fast += st.fast;
+            sc->chunkMotion[c].substeps += st.substeps;
+        });
+        gatherMotion(sc);
+    }
+    {
+        PROFILE_SCOPE(STAGE_BROADPHASE);
+        if (allAwake)
+            gridPairs(&sc->grid, sc->box, b->count, &sc->pairs);
+        else {
+            gridPairsOf(&sc->grid, sc->box, sl.awake.data(), sl.awake.size(), &sc->pairs);
+            sleepGrid(&sl, *b, &sc->box);
+            gridQuery(sl.grid, sc->box, sl.awake.data(), sl.awake.size(), &sc->pairs);
+        }
+        sc->stats.pairs = sc->pairs.size();
+    }
+
+    const size_t pairChunks = poolChunks(sc->pairs.size(), grain);
+    {
+        PROFILE_SCOPE(STAGE_NARROWPHASE);
+        if (sc->chunkContacts.size() < pairChunks + bodyChunks)
+            sc->chunkContacts.resize(pairChunks + bodyChunks);
+        for (size_t c = 0; c < pairChunks + bodyChunks; c++)
+            sc->chunkContacts[c].clear();
+        poolFor(sc->pool, sc->pairs.size(), grain, [sc, b](size_t c, size_t from, size_t to) {
+            soaNarrowphaseRange(*b, sc->pairs, from, to, &sc->chunkContacts[c]);
+        });
+        awakeFor([sc, b, pairChunks](size_t c, size_t from, size_t to) {
+            wallContactsRange(*b, from, to, sc->breite, sc->hoehe, &sc->chunkContacts[pairChunks + c]);
+        });
+        sc->contacts.clear();
+        sc->stats.bodyContacts = gatherContacts(sc, 0, pairChunks);
+        sc->stats.wallContacts = gatherContacts(sc, pairChunks, pairChunks + bodyChunks);
+        sc->stats.woken = allAwake ? 0 : sleepWakeContacts(&sl, sc->contacts);
+    }
+    {
+        PROFILE_SCOPE(STAGE_SOLVE);
+        solveContacts(b, sc->contacts, &sc->solver, sc->cfg.iterations);
+        separateContacts(b, sc->contacts);
+    }
+    if (sleeping)
+        sleepUpdate(&sl, b, sc->contacts, sc->cfg.sleep, sc->dt);
+    sc->stats.awake = sleeping ? sl.awake.size() : b->count;
+    sc->stats.asleep = b->count - sc->stats.awake;
+    sc->steps++;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "broadphase.h"
+#include "integrator.h"
+#include "jobs.h"
+#include "narrowphase.h"
+#include "sleep.h"
+#include "soa.h"
+#include "solver.h"
+
+/// <summary>
+/// How bodies respond to a contact.
+/// RESPONSE_REFLECT is the original behaviour: velocity component and angular velocity are reversed at the borders,
+/// bodies pass through each other.
+/// RESPONSE_IMPULSE resolves border and body-vs-body contacts with the impulse solver.
+/// </summary>
+enum responseMode { RESPONSE_REFLECT, RESPONSE_IMPULSE };
+
+/// <summary>
+/// Settings of a scene. grain is the number of bodies or pairs per chunk of the parallel stages,
+/// integrator selects forces and sub-stepping of fast bodies, sleep when resting bodies are skipped
+/// (RESPONSE_IMPULSE only, reflected bodies never slow down).
+/// </summary>
+struct sceneConfig {
+    boundaryMode boundary = BOUNDARY_SWEPT;
+    responseMode response = RESPONSE_IMPULSE;
+    int iterations = 8;
+    size_t grain = 2048;
+    integratorConfig integrator;
+    sleepConfig sleep;
+};
+
+/// <summary>
+/// Counters of the last step
+/// </summary>
+struct sceneStats {
+    size_t pairs = 0;
+    size_t bodyContacts = 0;
+    size_t wallContacts = 0;
+    size_t fastBodies = 0;
+    size_t substeps = 0;
+    size_t awake = 0;
+    size_t asleep = 0;
+    size_t woken = 0;
+};
+
+/// <summary>
+/// A complete headless simulation on the SoA store: the bodies, the world bounds, the settings and
+/// all scratch buffers of broad phase, narrow phase and solver, which are reused from step to step.
+/// With a pool the per body stages and the narrow phase run in chunks on its threads. Every chunk collects
+/// its contacts separately and they are joined in chunk order, so the solver sees the same contacts
+/// in the same order for any number of threads and the result does not depend on the thread count.
+/// </summary>
+struct scene {
+    bodySoA bodies;
+    double breite = 0;
+    double hoehe = 0;
+    double dt = 0;
+    long long steps = 0;
+    sceneConfig cfg;
+    sceneStats stats;
+    aabbSoA box;
+    hashGrid grid;
+    std::vector<bodyPair> pairs;
+    std::vector<contact> contacts;
+    contactSolver solver;
+    jobPool* pool = nullptr;
+    std::vector<std::vector<contact>> chunkContacts;
+    std::vector<integrateStats> chunkMotion;
+    sleepState sleeping;
+};
+
+/// <summary>
+/// Creates an empty scene
+/// </summary>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="dt">fixed timestep in seconds</param>
+/// <param name="cfg">settings</param>
+/// <returns>a scene without bodies</returns>
+scene makeScene(double breite, double hoehe, double dt, sceneConfig cfg = sceneConfig());
+
+/// <summary>
+/// Adds n bodies at random positions with random velocities, drawn like worldSpawn does
+/// </summary>
+/// <param name="sc">the scene to populate</param>
+/// <param name="n">number of bodies to add</param>
+/// <param name="len">side length of every body</param>
+/// <param name="seed">seed of the random engine, equal seeds give equal scenes</param>
+void sceneSpawn(struct scene* sc, size_t n, double len, unsigned seed);
+
+/// <summary>
+/// Sets density, restitution and friction of every body
+/// </summary>
+/// <param name="sc">the scene</param>
+/// <param name="density">mass per square pixel</param>
+/// <param name="restitution">ratio of normal speed after and before an impact</param>
+/// <param name="friction">Coulomb friction coefficient</param>
+void sceneSetMaterial(struct scene* sc, double density, double restitution, double friction);
+
+/// <summary>
+/// Advances the scene by one fixed timestep. With RESPONSE_IMPULSE: rotate, translate, derive vertices,
+/// find body and border contacts, solve them all together, then remove the remaining overlap.
+/// Fast bodies are sub-stepped, see integrateStepRange and integrateMoveRange. Uses sc->pool for the parallel stages when it is set.
+/// </summary>
+/// <param name="sc">the scene</param>
+void sceneStep(struct scene* sc);
@@ -0,0 +1,317 @@
+#define _USE_MATH_DEFINES
+#include "sim.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+/// <summary>
+/// Creates a triangle struct object representing an equilateral triangle from a center point and side length
+/// </summary>
+/// <param name="center">center point</param>
+/// <param name="len">side length</param>
+/// <returns>an equilateral triangle struct object</returns>
+triangle makeEquiTri(struct vertex* center, double len) {
+    triangle myEqui;
+    myEqui.zZ = *center;
+    myEqui.aA = { center->x - len / 2, center->y - len * sqrt(3) / 6 };
+    myEqui.bB = { center->x + len / 2, center->y - len * sqrt(3) / 6 };
+    myEqui.cC = { center->x, center->y + len * sqrt(3) / 3 };
+    return myEqui;
+}
+
+/// <summary>
+/// Places the vertices of an equilateral triangle around its center zZ from orientation and side length.
+/// sin and cos are evaluated once for all three vertices, and since nothing is accumulated there is no drift to compensate.
+/// </summary>
+/// <param name="tria">the triangle, only zZ is read</param>
+/// <param name="phi">orientation angle, 0 gives the same triangle as makeEquiTri</param>
+/// <param name="len">side length</param>
+void triPose(struct triangle* tria, double phi, double len) {
+    const double c = cos(phi), s = sin(phi);
+    const double h = len * sqrt(3) / 6;
+    const double ax = -len / 2, ay = -h, bx = len / 2, by = -h, cx = 0, cy = 2 * h;
+    tria->aA = { tria->zZ.x + ax * c - ay * s, tria->zZ.y + ax * s + ay * c };
+    tria->bB = { tria->zZ.x + bx * c - by * s, tria->zZ.y + bx * s + by * c };
+    tria->cC = { tria->zZ.x + cx * c - cy * s, tria->zZ.y + cx * s + cy * c };
+}
+
+/// <summary>
+/// Performs rotation on a point around the origin (at the center of the window)
+/// </summary>
+/// <param name="phi">rotation angle</param>
+/// <param name="ver">pointer to the point to be rotated</param>
+void rotation(double phi, struct vertex* ver, vertex* ref) {
+    double side = (pow(ver->x - ref->x, 2) + pow(ver->y - ref->y, 2));
+    ver->x = ref->x + (ver->x - ref->x) * cos(phi) - (ver->y - ref->y) * sin(phi);
+    ver->y = ref->y + (ver->x - ref->x) * sin(phi) + (ver->y - ref->y) * cos(phi);
+    compensator(ver, *ref, side);
+}
+
+/// <summary>
+/// Eliviates inaccuracies due to rounding errors that accumulate after rounds
+/// </summary>
+/// <param name="ver">the vertex to be adjusted</param>
+/// <param name="ref">reference vertex</param>
+/// <param name="og">original distance</param>
+void compensator(struct vertex* ver, vertex ref, double og) {
+    double magnif = (pow(ver->x - ref.x, 2) + pow(ver->y - ref.y, 2)) / og;
+    if (magnif < 0.99999 || magnif > 1.00001) {
+        ver->x = ref.x + (ver->x - ref.x) / sqrt(magnif);
+        ver->y = ref.y + (ver->y - ref.y) / sqrt(magnif);
+    }
+}
+
+/// <summary>
+/// Rotate a whole equilateral triangle struct object 
+/// </summary>
+/// <param name="tria">the equilateral triangle to be rotated</param>
+/// <param name="phi">rotation angle</param>
+void triRotate(struct triangle* tria, double phi) {
+    vertex* pA = &tria->aA, * pB = &tria->bB, * pC = &tria->cC, * pZ = &tria->zZ;
+    rotation(phi, pA, pZ);
+    rotation(phi, pB, pZ);
+    rotation(phi, pC, pZ);
+    //delete pA, pB,pC,pZ;
+}
+
+/// <summary>
+/// Resize the given triangle with a given ratio
+/// </summary>
+/// <param name="tria">the triangle to be resized</param>
+/// <param name="coeff">resize ratio</param>
+void triResize(struct triangle* tria, double coeff) {
+    tria->aA.x = tria->zZ.x + (tria->aA.x - tria->zZ.x) * coeff;
+    tria->bB.x = tria->zZ.x + (tria->bB.x - tria->zZ.x) * coeff;
+    tria->cC.x = tria->zZ.x + (tria->cC.x - tria->zZ.x) * coeff;
+    tria->aA.y = tria->zZ.y + (tria->aA.y - tria->zZ.y) * coeff;
+    tria->bB.y = tria->zZ.y + (tria->bB.y - tria->zZ.y) * coeff;
+    tria->cC.y = tria->zZ.y + (tria->cC.y - tria->zZ.y) * coeff;
+}
+
+/// <summary>
+/// Move the given triangle away some distance
+/// </summary>
+/// <param name="tria">the triangle to be moved</param>
+/// <param name="velo">move distance</param>
+void triTranslate(struct triangle* tria, struct velocity velo) {
+    tria->aA.x = tria->aA.x + velo.x;
+    tria->bB.x = tria->bB.x + velo.x;
+    tria->cC.x = tria->cC.x + velo.x;
+    tria->zZ.x = tria->zZ.x + velo.x;
+    tria->aA.y = tria->aA.y + velo.y;
+    tria->bB.y = tria->bB.y + velo.y;
+    tria->cC.y = tria->cC.y + velo.y;
+    tria->zZ.y = tria->zZ.y + velo.y;
+}
+
+/// <summary>
+/// Closed form border handling of one axis over one step. A body that already penetrates is first
+/// pushed back along the wall normal by its penetration depth. If the remaining travel crosses a wall,
+/// the body touches it at the time of impact toi = (bound - hi) / v and spends the rest of the step
+/// moving back, which is the same as mirroring the overshoot at the wall. The cost does not depend
+/// on speed or penetration depth.
+/// </summary>
+/// <param name="lo">lowest vertex coordinate on this axis</param>
+/// <param name="hi">highest vertex coordinate on this axis</param>
+/// <param name="v">velocity on this axis, reversed on impact</param>
+/// <param name="travel">distance the body would move without a wall, 0 for a purely discrete check</param>
+/// <param name="bound">the walls are at -bound and bound</param>
+/// <param name="move">receives the distance the body has to be moved instead of travel</param>
+/// <returns>true if the body touched a wall</returns>
+bool axisSweep(double lo, double hi, double* v, double travel, double bound, double* move) {
+    double pre = 0;
+    bool hit = false;
+    if (hi > bound) {
+        pre = bound - hi;
+        *v = -fabs(*v);
+        hit = true;
+    }
+    else if (lo < -bound) {
+        pre = -bound - lo;
+        *v = fabs(*v);
+        hit = true;
+    }
+    lo += pre;
+    hi += pre;
+    if (hit && travel != 0)
+        travel = (*v < 0) == (travel < 0) ? travel : -travel;
+    double end = travel;
+    if (hi + travel > bound) {
+        end = travel - 2 * (hi + travel - bound);
+        *v = -fabs(*v);
+        hit = true;
+    }
+    else if (lo + travel < -bound) {
+        end = travel + 2 * (-bound - (lo + travel));
+        *v = fabs(*v);
+        hit = true;
+    }
+    /* an overshoot longer than the free space bounces more than once, clamp it to the far wall */
+    end = std::min(std::max(end, -bound - lo), bound - hi);
+    *move = pre + end;
+    return hit;
+}
+
+/// <summary>
+/// Handles the cases when the triangle collides with window borders.
+/// The triangle is moved back along the wall normal by its penetration depth,
+/// and the velocity component is turned to point away from the wall.
+/// </summary>
+/// <param name="tria">the triangle object</param>
+/// <param name="velo">the triangle's translational velocity</param>
+/// <param name="breite">horizontal dimension of the window</param>
+/// <param name="hoehe">vertical dimension of the window</param>
+/// <param name="omega">the triangle's angular velocity</param>
+/// <returns>true if the triangle is in collision with border, false if otherwise</returns>
+bool triCollision(struct triangle* tria, velocity* velo, double breite, double hoehe,
+    double* omega) {
+    return triSweep(tria, velo, 0, breite, hoehe, omega);
+}
+
+/// <summary>
+/// Moves the triangle by velo * dt and reflects it at the window borders within the same step (swept mode),
+/// so a fast triangle at a low frame rate bounces off the wall at the right place instead of ending up deep behind it
+/// </summary>
+/// <param name="tria">the triangle object</param>
+/// <param name="velo">the triangle's translational velocity</param>
+/// <param name="dt">timestep, 0 only resolves an existing penetration</param>
+/// <param name="breite">horizontal dimension of the window</param>
+/// <param name="hoehe">vertical dimension of the window</param>
+/// <param name="omega">the triangle's angular velocity</param>
+/// <returns>true if the triangle touched a border during the step</returns>
+bool triSweep(struct triangle* tria, velocity* velo, double dt, double breite, double hoehe,
+    double* omega) {
+    vertex* pA = &tria->aA, * pB = &tria->bB, * pC = &tria->cC;
+    double loX = std::min(pA->x, std::min(pB->x, pC->x)), hiX = std::max(pA->x, std::max(pB->x, pC->x));
+    double loY = std::min(pA->y, std::min(pB->y, pC->y)), hiY = std::max(pA->y, std::max(pB->y, pC->y));
+    velocity move;
+    bool hitX = axisSweep(loX, hiX, &velo->x, velo->x * dt, breite, &move.x);
+    bool hitY = axisSweep(loY, hiY, &velo->y, velo->y * dt, hoehe, &move.y);
+    triTranslate(tria, move);
+    if (hitX || hitY)
+        *omega = -*omega;
+    return hitX || hitY;
+}
+
+/// <summary>
+/// Creates a body from center, side length and orientation
+/// </summary>
+/// <param name="center">center point</param>
+/// <param name="len">side length</param>
+/// <param name="phi">orientation angle</param>
+/// <param name="velo">translational velocity</param>
+/// <param name="omega">angular velocity</param>
+/// <returns>the body, its vertices already placed</returns>
+body makeBody(vertex center, double len, double phi, velocity velo, double omega) {
+    body b;
+    b.tri.zZ = center;
+    triPose(&b.tri, phi, len);
+    b.velo = velo;
+    b.omega = omega;
+    b.phi = phi;
+    b.len = len;
+    return b;
+}
+
+/// <summary>
+/// Resizes a body around its center, keeping triangle and side length in sync
+/// </summary>
+/// <param name="b">the body to be resized</param>
+/// <param name="coeff">resize ratio</param>
+void bodyResize(struct body* b, double coeff) {
+    triResize(&b->tri, coeff);
+    b->len *= coeff;
+}
+
+/// <summary>
+/// Creates an empty world with the given boundaries and fixed timestep
+/// </summary>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="dt">fixed timestep in seconds</param>
+/// <param name="mode">how orientations are advanced</param>
+/// <param name="boundary">how the borders are handled</param>
+/// <returns>a world without bodies</returns>
+world makeWorld(double breite, double hoehe, double dt, rotMode mode, boundaryMode boundary) {
+    world w;
+    w.breite = breite;
+    w.hoehe = hoehe;
+    w.dt = dt;
+    w.mode = mode;
+    w.boundary = boundary;
+    w.steps = 0;
+    return w;
+}
+
+/// <summary>
+/// Adds n equilateral triangles at random positions inside the world with random velocities.
+/// By default speeds are drawn like in the interactive program, 150 to 300 px/s per axis, with a random direction.
+/// </summary>
+/// <param name="w">the world to populate</param>
+/// <param name="n">number of bodies to add</param>
+/// <param name="len">side length of every body</param>
+/// <param name="seed">seed of the random engine, equal seeds give equal worlds</param>
+/// <param name="speed">every velocity component is drawn from speed to twice speed, with a random sign</param>
+/// <param name="omega">angular speed of every body, with a random sign</param>
+void worldSpawn(struct world* w, size_t n, double len, unsigned seed, double speed, double omega) {
+    std::default_random_engine re(seed);
+    std::uniform_real_distribution<double> unif(1, 2);
+    std::uniform_real_distribution<double> posX(-w->breite + len, w->breite - len);
+    std::uniform_real_distribution<double> posY(-w->hoehe + len, w->hoehe - len);
+    std::bernoulli_distribution flip(0.5);
+    w->bodies.reserve(w->bodies.size() + n);
+    for (size_t i = 0; i < n; i++) {
+        vertex center = { posX(re), posY(re) };
+        velocity velo;
+        velo.x = (flip(re) ? -speed : speed) * unif(re);
+        velo.y = (flip(re) ? -speed : speed) * unif(re);
+        w->bodies.push_back(makeBody(center, len, 0, velo, flip(re) ? -omega : omega));
+    }
+}
+
+/// <summary>
+/// Advances every body by exactly one fixed timestep: rotate, collide with the borders, translate.
+/// The angle phi is advanced in both modes, so the two can be diffed against each other.
+/// </summary>
+/// <param name="w">the world to be stepped</param>
+void worldStep(struct world* w) {
+    const double dt = w->dt;
+    for (body& b : w->bodies) {
+        b.phi += b.omega * dt;
+        if (b.phi > 2 * M_PI || b.phi < -2 * M_PI)
+            b.phi = remainder(b.phi, 2 * M_PI);
+        if (w->mode == ROT_POSE)
+            triPose(&b.tri, b.phi, b.len);
+        else
+            triRotate(&b.tri, b.omega * dt);
+        if (w->boundary == BOUNDARY_SWEPT) {
+            triSweep(&b.tri, &b.velo, dt, w->breite, w->hoehe, &b.omega);
+            continue;
+        }
+        velocity dist = { b.velo.x * dt, b.velo.y * dt };
+        if (!triCollision(&b.tri, &b.velo, w->breite, w->hoehe, &b.omega))
+            triTranslate(&b.tri, dist);
+    }
+    w->steps++;
+}
+
+/// <summary>
+/// Feeds a variable frame time into the fixed timestep loop and runs as many steps as have accumulated
+/// </summary>
+/// <param name="w">the world to be stepped</param>
+/// <param name="acc">accumulated, not yet simulated time, carried over between calls</param>
+/// <param name="frameTime">wall clock time since the last call</param>
+/// <param name="maxSteps">upper bound of steps per call, keeps a long hitch from stalling the caller</param>
+/// <returns>number of steps taken</returns>
+int worldAdvance(struct world* w, double* acc, double frameTime, int maxSteps) {
+    *acc += frameTime;
+    int n = 0;
+    while (*acc >= w->dt && n < maxSteps) {
+        worldStep(w);
+        *acc -= w->dt;
+        n++;
+    }
+    if (n == maxSteps && *acc >= w->dt)
+        *acc = 0;
+    return n;
+}
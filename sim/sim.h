@@ -0,0 +1,119 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+struct vertex { double x; double y; };
+struct velocity { double x; double y; };
+struct triangle { vertex aA; vertex bB; vertex cC; vertex zZ; };
+
+/// <summary>
+/// Vertex offsets of aA, bB and cC from the center for side length 1 and orientation 0, as makeEquiTri
+/// places them. The SoA kernels, the reduced precision stores and regularUnit&lt;3&gt; all pose triangles from these.
+/// </summary>
+constexpr vertex unitTri[3] = { { -0.5, -0.28867513459481287 }, { 0.5, -0.28867513459481287 }, { 0.0, 0.57735026918962573 } };
+
+/// <summary>
+/// A single simulated body: the triangle itself plus its translational and angular velocity.
+/// phi and len are the orientation and side length the triangle was built from;
+/// in ROT_POSE mode the vertices are derived from them instead of being rotated in place.
+/// </summary>
+struct body { triangle tri; velocity velo; double omega; double phi; double len; };
+
+/// <summary>
+/// How the orientation of a body is advanced.
+/// ROT_VERTEX rotates the world space vertices with triRotate and renormalizes them with compensator,
+/// ROT_POSE only advances the angle and rebuilds the vertices from center, angle and size.
+/// </summary>
+enum rotMode { ROT_VERTEX, ROT_POSE };
+
+/// <summary>
+/// How bodies are kept inside the world.
+/// BOUNDARY_DISCRETE moves first and pushes penetrating bodies back along the wall normal,
+/// BOUNDARY_SWEPT reflects the travel of the step at the time of impact, so fast bodies bounce at the right place.
+/// </summary>
+enum boundaryMode { BOUNDARY_DISCRETE, BOUNDARY_SWEPT };
+
+/// <summary>
+/// The complete simulation state. Bodies live in [-breite, breite] x [-hoehe, hoehe]
+/// and are advanced with the fixed timestep dt, independent of any window or GL context.
+/// </summary>
+struct world {
+    double breite;
+    double hoehe;
+    double dt;
+    rotMode mode;
+    boundaryMode boundary;
+    std::vector<body> bodies;
+    long long steps;
+};
+
+triangle makeEquiTri(struct vertex* center, double len);
+void triPose(struct triangle* tria, double phi, double len);
+void rotation(double phi, struct vertex* ver, vertex* ref);
+void compensator(struct vertex* ver, vertex ref, double og);
+void triRotate(struct triangle* tria, double phi);
+void triResize(struct triangle* tria, double coeff);
+void triTranslate(struct triangle* tria, struct velocity velo);
+bool axisSweep(double lo, double hi, double* v, double travel, double bound, double* move);
+bool triCollision(struct triangle* tria, velocity* velo, double breite, double hoehe,
+    double* omega);
+bool triSweep(struct triangle* tria, velocity* velo, double dt, double breite, double hoehe,
+    double* omega);
+
+/// <summary>
+/// Creates a body from center, side length and orientation
+/// </summary>
+/// <param name="center">center point</param>
+/// <param name="len">side length</param>
+/// <param name="phi">orientation angle</param>
+/// <param name="velo">translational velocity</param>
+/// <param name="omega">angular velocity</param>
+/// <returns>the body, its vertices already placed</returns>
+body makeBody(vertex center, double len, double phi, velocity velo, double omega);
+
+/// <summary>
+/// Resizes a body around its center, keeping triangle and side length in sync
+/// </summary>
+/// <param name="b">the body to be resized</param>
+/// <param name="coeff">resize ratio</param>
+void bodyResize(struct body* b, double coeff);
+
+/// <summary>
+/// Creates an empty world with the given boundaries and fixed timestep
+/// </summary>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="dt">fixed timestep in seconds</param>
+/// <param name="mode">how orientations are advanced</param>
+/// <param name="boundary">how the borders are handled</param>
+/// <returns>a world without bodies</returns>
+world makeWorld(double breite, double hoehe, double dt, rotMode mode = ROT_VERTEX,
+    boundaryMode boundary = BOUNDARY_DISCRETE);
+
+/// <summary>
+/// Adds n equilateral triangles at random positions inside the world with random velocities
+/// </summary>
+/// <param name="w">the world to populate</param>
+/// <param name="n">number of bodies to add</param>
+/// <param name="len">side length of every body</param>
+/// <param name="seed">seed of the random engine, equal seeds give equal worlds</param>
+/// <param name="speed">every velocity component is drawn from speed to twice speed, with a random sign</param>
+/// <param name="omega">angular speed of every body, with a random sign</param>
+void worldSpawn(struct world* w, size_t n, double len, unsigned seed, double speed = 150,
+    double omega = 3.141592653589793);
+
+/// <summary>
+/// Advances every body by exactly one fixed timestep: rotate, collide with the borders, translate
+/// </summary>
+/// <param name="w">the world to be stepped</param>
+void worldStep(struct world* w);
+
+/// <summary>
+/// Feeds a variable frame time into the fixed timestep loop and runs as many steps as have accumulated
+/// </summary>
+/// <param name="w">the world to be stepped</param>
+/// <param name="acc">accumulated, not yet simulated time, carried over between calls</param>
+/// <param name="frameTime">wall clock time since the last call</param>
+/// <param name="maxSteps">upper bound of steps per call, keeps a long hitch from stalling the caller</param>
+/// <returns>number of steps taken</returns>
+int worldAdvance(struct world* w, double* acc, double frameTime, int maxSteps);
@@ -0,0 +1,73 @@
+#include "simthread.h"
+
+static void physicsLoop(struct simThread* st) {
+    scene* sc = st->sc;
+    const double dt = sc->dt;
+    long long done = 0;
+    while (!st->quit.load(std::memory_order_acquire)) {
+        long long due = (long long)(simThreadTime(*st) / dt);
+        if (due - done > st->maxCatchUp) {
+            st->dropped.fetch_add(due - done - st->maxCatchUp, std::memory_order_relaxed);
+            done = due - st->maxCatchUp;
+        }
+        while (done < due) {
+            const bool recording = st->trace && st->traceStopped.load(std::memory_order_relaxed) < 0;
+            /* commands take effect at the step that covers their time stamp, whatever the frame rate */
+            commandDrain(st->in, sc, (done + 1) * dt, recording ? st->trace : nullptr);
+            snapshot* s = bufferBack(st->out);
+            snapshotBefore(s, sc->bodies);
+            sceneStep(sc);
+            if (recording && !traceStep(st->trace, *sc))
+                st->traceStopped.store(sc->steps, std::memory_order_relaxed);
+            done++;
+            /* labelled with the clock step, so the renderer's time base stays valid after dropped steps */
+            snapshotAfter(s, sc->bodies, done, dt);
+            bufferPublish(st->out);
+            st->steps.fetch_add(1, std::memory_order_relaxed);
+        }
+        std::this_thread::sleep_until(st->start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>((done + 1) * dt)));
+    }
+}
+
+/// <summary>
+/// Starts stepping the scene on a new thread
+/// </summary>
+/// <param name="st">a simThread that is not running</param>
+/// <param name="sc">the scene, owned by the thread until simThreadStop</param>
+/// <param name="out">receives a snapshot after every step, bufferInit must have run for the body count</param>
+/// <param name="in">commands for the scene</param>
+void simThreadStart(struct simThread* st, struct scene* sc, struct tripleBuffer* out, struct commandRing* in) {
+    st->sc = sc;
+    st->out = out;
+    st->in = in;
+    st->quit.store(false);
+    st->steps.store(0);
+    st->dropped.store(0);
+    /* the renderer may read before the first step, give it the initial pose */
+    snapshot* s = bufferBack(out);
+    snapshotBefore(s, sc->bodies);
+    snapshotAfter(s, sc->bodies, 0, sc->dt);
+    bufferPublish(out);
+    st->start = std::chrono::steady_clock::now();
+    st->thread = std::thread(physicsLoop, st);
+}
+
+/// <summary>
+/// Stops and joins the physics thread
+/// </summary>
+/// <param name="st">the simThread</param>
+void simThreadStop(struct simThread* st) {
+    st->quit.store(true, std::memory_order_release);
+    if (st->thread.joinable())
+        st->thread.join();
+}
+
+/// <summary>
+/// Simulation time the physics thread is aiming for right now: the seconds since it started
+/// </summary>
+/// <param name="st">the simThread</param>
+/// <returns>seconds since simThreadStart</returns>
+double simThreadTime(const simThread& st) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - st.start).count();
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "commands.h"
+#include "handoff.h"
+#include "scene.h"
+#include "trace.h"
+
+/// <summary>
+/// Runs a scene on its own thread at the fixed rate 1 / dt, measured against a steady clock.
+/// After every step a snapshot is published through out; commands from in are applied before the step
+/// their time stamp falls into.
+/// While the thread runs, the scene belongs to it and must not be touched from anywhere else.
+/// If the physics falls more than maxCatchUp steps behind the clock, the missing steps are
+/// skipped and counted in dropped instead of making the thread fall further behind.
+/// If trace is set, every applied command and every step is recorded into it. A record that can not be
+/// written stops the recording, traceStopped tells the step it stopped at.
+/// </summary>
+struct simThread {
+    scene* sc = nullptr;
+    tripleBuffer* out = nullptr;
+    commandRing* in = nullptr;
+    traceWriter* trace = nullptr;
+    std::thread thread;
+    std::atomic<bool> quit{ false };
+    std::atomic<long long> steps{ 0 };
+    std::atomic<long long> dropped{ 0 };
+    std::atomic<long long> traceStopped{ -1 };
+    std::chrono::steady_clock::time_point start;
+    long long maxCatchUp = 8;
+};
+
+/// <summary>
+/// Starts stepping the scene on a new thread
+/// </summary>
+/// <param name="st">a simThread that is not running</param>
+/// <param name="sc">the scene, owned by the thread until simThreadStop</param>
+/// <param name="out">receives a snapshot after every step, bufferInit must have run for the body count</param>
+/// <param name="in">commands for the scene</param>
+void simThreadStart(struct simThread* st, struct scene* sc, struct tripleBuffer* out, struct commandRing* in);
+
+/// <summary>
+/// Stops and joins the physics thread
+/// </summary>
+/// <param name="st">the simThread</param>
+void simThreadStop(struct simThread* st);
+
+/// <summary>
+/// Simulation time the physics thread is aiming for right now: the seconds since it started
+/// </summary>
+/// <param name="st">the simThread</param>
+/// <returns>seconds since simThreadStart</returns>
+double simThreadTime(const simThread& st);
@@ -0,0 +1,264 @@
+#include "sleep.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/// <summary>
+/// Wakes every body and sizes the state for count bodies
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="count">number of bodies</param>
+void sleepReset(struct sleepState* st, size_t count) {
+    st->bodies = count;
+    st->awake.resize(count);
+    for (size_t i = 0; i < count; i++)
+        st->awake[i] = (uint32_t)i;
+    st->asleep.assign(count, 0);
+    st->still.assign(count, 0);
+    st->next.assign(count, UINT32_MAX);
+    st->parent.resize(count);
+    st->islandStill.resize(count);
+    st->woken.clear();
+    st->sleepers.clear();
+    st->gridDirty = true;
+    st->awakeDirty = false;
+}
+
+/// <summary>
+/// Makes room for n bodies, so sleepPush up to n bodies allocates nothing
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="n">number of bodies</param>
+void sleepReserve(struct sleepState* st, size_t n) {
+    st->awake.reserve(n);
+    st->asleep.reserve(n);
+    st->still.reserve(n);
+    st->next.reserve(n);
+    st->parent.reserve(n);
+    st->islandStill.reserve(n);
+}
+
+/// <summary>
+/// Adds an awake body behind the others, for a body appended to the store. A state that does not
+/// match the store is left alone; the scene resets it at the next step.
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="count">number of bodies in the store before the new one</param>
+void sleepPush(struct sleepState* st, size_t count) {
+    if (st->bodies != count)
+        return;
+    /* the new body has the highest index, so the list stays ascending */
+    st->awake.push_back((uint32_t)count);
+    st->asleep.push_back(0);
+    st->still.push_back(0);
+    st->next.push_back(UINT32_MAX);
+    st->parent.push_back(0);
+    st->islandStill.push_back(0);
+    st->bodies++;
+}
+
+/// <summary>
+/// Follows the removal of body i from the store, where the last body takes index i as soaRemove does.
+/// A sleeping body wakes its island first, since the body may have held it up; the moved body keeps
+/// its timer and its place in its island. Only the per body entries move, the awake list is rebuilt
+/// once by sleepRefresh, so a removal costs O(1) plus the island walk. A state that does not match
+/// the store is left alone.
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="i">index of the removed body</param>
+/// <param name="count">number of bodies in the store before the removal</param>
+void sleepRemove(struct sleepState* st, size_t i, size_t count) {
+    if (st->bodies != count || i >= count)
+        return;
+    const uint32_t gone = (uint32_t)i, last = (uint32_t)(count - 1);
+    if (st->asleep[gone]) {
+        uint32_t j = gone;
+        do {
+            const uint32_t n = st->next[j];
+            st->asleep[j] = 0;
+            st->still[j] = 0;
+            st->next[j] = UINT32_MAX;
+            j = n;
+        } while (j != gone);
+        st->gridDirty = true;
+    }
+    if (last != gone) {
+        st->asleep[gone] = st->asleep[last];
+        st->still[gone] = st->still[last];
+        st->next[gone] = UINT32_MAX;
+        if (st->asleep[last]) {
+            /* the island circle runs through the new index; a body alone points at itself */
+            uint32_t j = last;
+            while (st->next[j] != last)
+                j = st->next[j];
+            st->next[j] = gone;
+            st->next[gone] = st->next[last] == last ? gone : st->next[last];
+            st->gridDirty = true;
+        }
+    }
+    st->asleep.pop_back();
+    st->still.pop_back();
+    st->next.pop_back();
+    st->parent.pop_back();
+    st->islandStill.pop_back();
+    st->bodies--;
+    st->awakeDirty = true;
+}
+
+/// <summary>
+/// Rebuilds the awake list from asleep if sleepRemove changed the bodies since the last call
+/// </summary>
+/// <param name="st">the sleep state</param>
+void sleepRefresh(struct sleepState* st) {
+    if (!st->awakeDirty)
+        return;
+    st->awake.clear();
+    for (size_t i = 0; i < st->bodies; i++)
+        if (!st->asleep[i])
+            st->awake.push_back((uint32_t)i);
+    st->awakeDirty = false;
+}
+
+/// <summary>
+/// Wakes the island of a sleeping body. The woken bodies join the awake list at the next sleepCommit.
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="i">index of the body</param>
+/// <returns>false if the body was already awake</returns>
+bool sleepWake(struct sleepState* st, uint32_t i) {
+    if (i >= st->bodies || !st->asleep[i])
+        return false;
+    uint32_t j = i;
+    do {
+        const uint32_t n = st->next[j];
+        st->asleep[j] = 0;
+        st->still[j] = 0;
+        st->next[j] = UINT32_MAX;
+        st->woken.push_back(j);
+        j = n;
+    } while (j != i);
+    st->gridDirty = true;
+    return true;
+}
+
+/// <summary>
+/// Merges the bodies woken since the last call into the awake list
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <returns>number of bodies woken</returns>
+size_t sleepCommit(struct sleepState* st) {
+    sleepRefresh(st);
+    const size_t n = st->woken.size();
+    if (!n)
+        return 0;
+    std::sort(st->woken.begin(), st->woken.end());
+    const size_t before = st->awake.size();
+    st->awake.insert(st->awake.end(), st->woken.begin(), st->woken.end());
+    std::inplace_merge(st->awake.begin(), st->awake.begin() + before, st->awake.end());
+    st->woken.clear();
+    return n;
+}
+
+/// <summary>
+/// Wakes the islands of all sleeping bodies that take part in a contact, and commits them
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="contacts">the contacts of the step</param>
+/// <returns>number of bodies woken</returns>
+size_t sleepWakeContacts(struct sleepState* st, const std::vector<contact>& contacts) {
+    for (const contact& c : contacts) {
+        if (c.a != WALL)
+            sleepWake(st, c.a);
+        if (c.b != WALL)
+            sleepWake(st, c.b);
+    }
+    return sleepCommit(st);
+}
+
+static uint32_t findRoot(std::vector<uint32_t>& parent, uint32_t i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+/// <summary>
+/// Advances the rest timers of the awake bodies after a solved step and puts every island of bodies that
+/// touch each other to sleep once all of them have rested long enough. Sleeping bodies get zero velocity.
+/// The root of an island is its lowest index, so islands come out the same for any contact order.
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="soa">the body store</param>
+/// <param name="contacts">the contacts of the step, they link the bodies into islands</param>
+/// <param name="cfg">thresholds</param>
+/// <param name="dt">timestep</param>
+/// <returns>number of bodies that fell asleep</returns>
+size_t sleepUpdate(struct sleepState* st, struct bodySoA* soa, const std::vector<contact>& contacts,
+    const sleepConfig& cfg, double dt) {
+    const double lin2 = cfg.linear * cfg.linear;
+    std::vector<uint32_t>& parent = st->parent;
+    bool anyStill = false;
+    for (uint32_t i : st->awake) {
+        parent[i] = i;
+        st->islandStill[i] = std::numeric_limits<double>::infinity();
+        const bool rest = soa->vx[i] * soa->vx[i] + soa->vy[i] * soa->vy[i] < lin2 && fabs(soa->omega[i]) < cfg.angular;
+        st->still[i] = rest ? st->still[i] + dt : 0;
+        anyStill |= st->still[i] >= cfg.time;
+    }
+    if (!anyStill)
+        return 0;
+    for (const contact& c : contacts) {
+        if (c.a == WALL || c.b == WALL)
+            continue;
+        const uint32_t ra = findRoot(parent, c.a), rb = findRoot(parent, c.b);
+        if (ra != rb)
+            parent[std::max(ra, rb)] = std::min(ra, rb);
+    }
+    for (uint32_t i : st->awake) {
+        const uint32_t r = findRoot(parent, i);
+        st->islandStill[r] = std::min(st->islandStill[r], st->still[i]);
+    }
+
+    size_t keep = 0, slept = 0;
+    for (uint32_t i : st->awake) {
+        const uint32_t r = findRoot(parent, i);
+        if (st->islandStill[r] < cfg.time) {
+            st->awake[keep++] = i;
+            continue;
+        }
+        /* the root comes first in ascending order and starts the circle, the others are linked in behind it */
+        if (r == i)
+            st->next[i] = i;
+        else {
+            st->next[i] = st->next[r];
+            st->next[r] = i;
+        }
+        st->asleep[i] = 1;
+        soa->vx[i] = soa->vy[i] = soa->omega[i] = 0;
+        slept++;
+    }
+    st->awake.resize(keep);
+    st->gridDirty |= slept > 0;
+    return slept;
+}
+
+/// <summary>
+/// Rebuilds the grid of the sleeping bodies if the set changed since the last call,
+/// after bringing their boxes up to date
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="soa">the body store</param>
+/// <param name="box">bounding boxes, indexed by body</param>
+void sleepGrid(struct sleepState* st, const bodySoA& soa, struct aabbSoA* box) {
+    if (!st->gridDirty)
+        return;
+    st->sleepers.clear();
+    for (size_t i = 0; i < st->bodies; i++)
+        if (st->asleep[i]) {
+            st->sleepers.push_back((uint32_t)i);
+            soaBoundsRange(soa, i, i + 1, box);
+        }
+    gridBuild(&st->grid, *box, st->sleepers.data(), st->sleepers.size());
+    st->gridDirty = false;
+}
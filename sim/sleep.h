@@ -0,0 +1,145 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "broadphase.h"
+#include "narrowphase.h"
+#include "soa.h"
+
+/// <summary>
+/// When bodies fall asleep. A body is at rest while its speed is below linear (px/s) and its angular
+/// speed below angular (rad/s); an island of touching bodies falls asleep together once all of its
+/// bodies have been at rest for time seconds.
+/// </summary>
+struct sleepConfig {
+    bool enabled = true;
+    double linear = 2;
+    double angular = 0.05;
+    double time = 0.5;
+};
+
+/// <summary>
+/// Which bodies of a scene are awake. awake lists the awake bodies in ascending order, so the kernels
+/// run over its contiguous runs and skip everything else. A sleeping island is a circular list through
+/// next, so touching any of its bodies wakes all of them. grid holds the boxes of the sleeping bodies and
+/// is rebuilt only when the set of sleeping bodies changes. A body pool keeps the state in step with its
+/// spawns and despawns (sleepPush, sleepRemove); the scene rebuilds the awake list before its next step. Otherwise the scene resets the state when the number of
+/// bodies changes; code that replaces bodies without changing the count must call sleepReset itself.
+/// </summary>
+struct sleepState {
+    size_t bodies = 0;
+    std::vector<uint32_t> awake;
+    std::vector<uint8_t> asleep;
+    std::vector<double> still;
+    std::vector<uint32_t> next;
+    std::vector<uint32_t> woken;
+    std::vector<uint32_t> sleepers;
+    hashGrid grid;
+    bool gridDirty = false;
+    /* set by sleepRemove: awake is stale until sleepRefresh */
+    bool awakeDirty = false;
+    /* union-find scratch of sleepUpdate, indexed by body */
+    std::vector<uint32_t> parent;
+    std::vector<double> islandStill;
+};
+
+/// <summary>
+/// Wakes every body and sizes the state for count bodies
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="count">number of bodies</param>
+void sleepReset(struct sleepState* st, size_t count);
+
+/// <summary>
+/// Makes room for n bodies, so sleepPush up to n bodies allocates nothing
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="n">number of bodies</param>
+void sleepReserve(struct sleepState* st, size_t n);
+
+/// <summary>
+/// Adds an awake body behind the others, for a body appended to the store. A state that does not
+/// match the store is left alone; the scene resets it at the next step.
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="count">number of bodies in the store before the new one</param>
+void sleepPush(struct sleepState* st, size_t count);
+
+/// <summary>
+/// Follows the removal of body i from the store, where the last body takes index i as soaRemove does.
+/// A sleeping body wakes its island first, since the body may have held it up; the moved body keeps
+/// its timer and its place in its island. Only the per body entries move, the awake list is rebuilt
+/// once by sleepRefresh, so a removal costs O(1) plus the island walk. A state that does not match
+/// the store is left alone.
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="i">index of the removed body</param>
+/// <param name="count">number of bodies in the store before the removal</param>
+void sleepRemove(struct sleepState* st, size_t i, size_t count);
+
+/// <summary>
+/// Rebuilds the awake list from asleep if sleepRemove changed the bodies since the last call
+/// </summary>
+/// <param name="st">the sleep state</param>
+void sleepRefresh(struct sleepState* st);
+
+/// <summary>
+/// Wakes the island of a sleeping body. The woken bodies join the awake list at the next sleepCommit.
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="i">index of the body</param>
+/// <returns>false if the body was already awake</returns>
+bool sleepWake(struct sleepState* st, uint32_t i);
+
+/// <summary>
+/// Merges the bodies woken since the last call into the awake list
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <returns>number of bodies woken</returns>
+size_t sleepCommit(struct sleepState* st);
+
+/// <summary>
+/// Wakes the islands of all sleeping bodies that take part in a contact, and commits them
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="contacts">the contacts of the step</param>
+/// <returns>number of bodies woken</returns>
+size_t sleepWakeContacts(struct sleepState* st, const std::vector<contact>& contacts);
+
+/// <summary>
+/// Advances the rest timers of the awake bodies after a solved step and puts every island of bodies that
+/// touch each other to sleep once all of them have rested long enough. Sleeping bodies get zero velocity.
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="soa">the body store</param>
+/// <param name="contacts">the contacts of the step, they link the bodies into islands</param>
+/// <param name="cfg">thresholds</param>
+/// <param name="dt">timestep</param>
+/// <returns>number of bodies that fell asleep</returns>
+size_t sleepUpdate(struct sleepState* st, struct bodySoA* soa, const std::vector<contact>& contacts,
+    const sleepConfig& cfg, double dt);
+
+/// <summary>
+/// Rebuilds the grid of the sleeping bodies if the set changed since the last call,
+/// after bringing their boxes up to date
+/// </summary>
+/// <param name="st">the sleep state</param>
+/// <param name="soa">the body store</param>
+/// <param name="box">bounding boxes, indexed by body</param>
+void sleepGrid(struct sleepState* st, const bodySoA& soa, struct aabbSoA* box);
+
+/// <summary>
+/// Calls fn(from, to) for every maximal run of consecutive indices in ids[0, n), which must be ascending
+/// </summary>
+template <class Fn>
+void forRuns(const uint32_t* ids, size_t n, Fn&& fn) {
+    size_t k = 0;
+    while (k < n) {
+        size_t e = k + 1;
+        while (e < n && ids[e] == ids[e - 1] + 1)
+            e++;
+        fn((size_t)ids[k], (size_t)ids[e - 1] + 1);
+        k = e;
+    }
+}
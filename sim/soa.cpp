@@ -0,0 +1,513 @@
+#define _USE_MATH_DEFINES
+#include "soa.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/// <summary>
+/// Appends a body to the store
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="b">the body to be copied in</param>
+void soaPush(struct bodySoA* soa, const body& b) {
+    soa->x.push_back(b.tri.zZ.x);
+    soa->y.push_back(b.tri.zZ.y);
+    soa->phi.push_back(b.phi);
+    soa->len.push_back(b.len);
+    soa->vx.push_back(b.velo.x);
+    soa->vy.push_back(b.velo.y);
+    soa->omega.push_back(b.omega);
+    soa->invMass.push_back(0);
+    soa->invInertia.push_back(0);
+    soa->restitution.push_back(0);
+    soa->friction.push_back(0);
+    soaSetMaterial(soa, soa->count, 1, 1, 0);
+    triangle t = soaTriangle(*soa, soa->count);
+    soa->verts.ax.push_back(t.aA.x);
+    soa->verts.ay.push_back(t.aA.y);
+    soa->verts.bx.push_back(t.bB.x);
+    soa->verts.by.push_back(t.bB.y);
+    soa->verts.cx.push_back(t.cC.x);
+    soa->verts.cy.push_back(t.cC.y);
+    soa->count++;
+}
+
+/* every per body array of the store */
+static const size_t soaArrayCount = 17;
+
+static void soaArrays(struct bodySoA* soa, std::vector<double>* arrays[soaArrayCount]) {
+    std::vector<double>* all[soaArrayCount] = { &soa->x, &soa->y, &soa->phi, &soa->len, &soa->vx, &soa->vy, &soa->omega,
+        &soa->invMass, &soa->invInertia, &soa->restitution, &soa->friction,
+        &soa->verts.ax, &soa->verts.ay, &soa->verts.bx, &soa->verts.by, &soa->verts.cx, &soa->verts.cy };
+    std::copy(all, all + soaArrayCount, arrays);
+}
+
+/// <summary>
+/// Makes room for n bodies, so pushing up to n bodies allocates nothing
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="n">number of bodies</param>
+void soaReserve(struct bodySoA* soa, size_t n) {
+    std::vector<double>* arrays[soaArrayCount];
+    soaArrays(soa, arrays);
+    for (std::vector<double>* a : arrays)
+        a->reserve(n);
+}
+
+/// <summary>
+/// Removes a body by moving the last body into its place, so the arrays stay dense
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="i">index of the body to remove</param>
+void soaRemove(struct bodySoA* soa, size_t i) {
+    std::vector<double>* arrays[soaArrayCount];
+    soaArrays(soa, arrays);
+    const size_t last = soa->count - 1;
+    for (std::vector<double>* a : arrays) {
+        (*a)[i] = (*a)[last];
+        a->pop_back();
+    }
+    soa->count--;
+}
+
+/// <summary>
+/// Sets mass, moment of inertia and material of one body. Mass is density times area,
+/// the moment of inertia of an equilateral triangle about its center is mass * len^2 / 12.
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="i">index of the body</param>
+/// <param name="density">mass per square pixel, 0 makes the body immovable</param>
+/// <param name="restitution">ratio of normal speed after and before an impact, 1 is perfectly elastic</param>
+/// <param name="friction">Coulomb friction coefficient</param>
+void soaSetMaterial(struct bodySoA* soa, size_t i, double density, double restitution, double friction) {
+    double len = soa->len[i];
+    double mass = density * sqrt(3) / 4 * len * len;
+    double inertia = mass * len * len / 12;
+    soa->invMass[i] = mass > 0 ? 1 / mass : 0;
+    soa->invInertia[i] = inertia > 0 ? 1 / inertia : 0;
+    soa->restitution[i] = restitution;
+    soa->friction[i] = friction;
+}
+
+/// <summary>
+/// Replaces the content of the store with the bodies of a world
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="w">the world to be copied</param>
+void soaFromWorld(struct bodySoA* soa, const world& w) {
+    *soa = bodySoA();
+    for (const body& b : w.bodies)
+        soaPush(soa, b);
+}
+
+/// <summary>
+/// Assembles the world space triangle of one body from its pose
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="i">index of the body</param>
+/// <returns>the triangle with absolute vertex positions</returns>
+triangle soaTriangle(const bodySoA& soa, size_t i) {
+    triangle t;
+    t.zZ = { soa.x[i], soa.y[i] };
+    triPose(&t, soa.phi[i], soa.len[i]);
+    return t;
+}
+
+/// <summary>
+/// Derives the vertices of the bodies [from, to) with the scalar fallback
+/// </summary>
+static void verticesRange(struct bodySoA* soa, size_t from, size_t to) {
+    vertexSoA& v = soa->verts;
+    for (size_t i = from; i < to; i++) {
+        double lc = soa->len[i] * cos(soa->phi[i]), ls = soa->len[i] * sin(soa->phi[i]);
+        v.ax[i] = soa->x[i] + unitTri[0].x * lc - unitTri[0].y * ls;
+        v.ay[i] = soa->y[i] + unitTri[0].x * ls + unitTri[0].y * lc;
+        v.bx[i] = soa->x[i] + unitTri[1].x * lc - unitTri[1].y * ls;
+        v.by[i] = soa->y[i] + unitTri[1].x * ls + unitTri[1].y * lc;
+        v.cx[i] = soa->x[i] + unitTri[2].x * lc - unitTri[2].y * ls;
+        v.cy[i] = soa->y[i] + unitTri[2].x * ls + unitTri[2].y * lc;
+    }
+}
+
+static void rotateScalarRange(struct bodySoA* soa, double dt, size_t from, size_t to) {
+    for (size_t i = from; i < to; i++) {
+        double p = soa->phi[i] + soa->omega[i] * dt;
+        soa->phi[i] = p - 2 * M_PI * nearbyint(p * (0.5 / M_PI));
+    }
+}
+
+static void translateScalarRange(struct bodySoA* soa, double dt, size_t from, size_t to) {
+    for (size_t i = from; i < to; i++) {
+        soa->x[i] += soa->vx[i] * dt;
+        soa->y[i] += soa->vy[i] * dt;
+    }
+}
+
+void soaRotateScalar(struct bodySoA* soa, double dt) {
+    rotateScalarRange(soa, dt, 0, soa->count);
+}
+
+void soaTranslateScalar(struct bodySoA* soa, double dt) {
+    translateScalarRange(soa, dt, 0, soa->count);
+}
+
+void soaVerticesScalar(struct bodySoA* soa) {
+    verticesRange(soa, 0, soa->count);
+}
+
+/// <summary>
+/// Mass grows with the area and the moment of inertia with area times len^2
+/// </summary>
+static void rescaleMass(struct bodySoA* soa, double coeff, size_t from, size_t to) {
+    const double k2 = 1 / (coeff * coeff), k4 = k2 * k2;
+    for (size_t i = from; i < to; i++) {
+        soa->invMass[i] *= k2;
+        soa->invInertia[i] *= k4;
+    }
+}
+
+void soaResizeScalar(struct bodySoA* soa, double coeff) {
+    for (size_t i = 0; i < soa->count; i++)
+        soa->len[i] *= coeff;
+    rescaleMass(soa, coeff, 0, soa->count);
+}
+
+/// <summary>
+/// Portable version of the masked resize: bodies outside the box are multiplied by 1
+/// </summary>
+static void resizeBoxScalar(struct bodySoA* soa, double coeff, double lox, double loy, double hix, double hiy, size_t from) {
+    const double k2 = 1 / (coeff * coeff), k4 = k2 * k2;
+    for (size_t i = from; i < soa->count; i++) {
+        const bool in = soa->x[i] >= lox && soa->x[i] <= hix && soa->y[i] >= loy && soa->y[i] <= hiy;
+        soa->len[i] *= in ? coeff : 1;
+        soa->invMass[i] *= in ? k2 : 1;
+        soa->invInertia[i] *= in ? k4 : 1;
+    }
+}
+
+#if defined(__AVX2__)
+
+const char* soaKernelName() { return "avx2"; }
+
+static void rotateRange(struct bodySoA* soa, double dt, size_t from, size_t to) {
+    double* phi = soa->phi.data();
+    const double* omega = soa->omega.data();
+    const size_t n = from + ((to - from) & ~(size_t)3);
+    const __m256d vdt = _mm256_set1_pd(dt), twoPi = _mm256_set1_pd(2 * M_PI), inv = _mm256_set1_pd(0.5 / M_PI);
+    for (size_t i = from; i < n; i += 4) {
+        __m256d p = _mm256_add_pd(_mm256_loadu_pd(phi + i), _mm256_mul_pd(_mm256_loadu_pd(omega + i), vdt));
+        __m256d k = _mm256_round_pd(_mm256_mul_pd(p, inv), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm256_storeu_pd(phi + i, _mm256_sub_pd(p, _mm256_mul_pd(twoPi, k)));
+    }
+    for (size_t i = n; i < to; i++) {
+        double p = phi[i] + omega[i] * dt;
+        phi[i] = p - 2 * M_PI * nearbyint(p * (0.5 / M_PI));
+    }
+}
+
+static void translateRange(struct bodySoA* soa, double dt, size_t from, size_t to) {
+    double* x = soa->x.data(), * y = soa->y.data();
+    const double* vx = soa->vx.data(), * vy = soa->vy.data();
+    const size_t n = from + ((to - from) & ~(size_t)3);
+    __m256d vdt = _mm256_set1_pd(dt);
+    for (size_t i = from; i < n; i += 4) {
+        _mm256_storeu_pd(x + i, _mm256_add_pd(_mm256_loadu_pd(x + i), _mm256_mul_pd(_mm256_loadu_pd(vx + i), vdt)));
+        _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(_mm256_loadu_pd(vy + i), vdt)));
+    }
+    for (size_t i = n; i < to; i++) {
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+    }
+}
+
+/// <summary>
+/// Stores center + R(phi) * len * unit offset for four bodies
+/// </summary>
+static inline void storeVertex(double* px, double* py, size_t i, __m256d x, __m256d y,
+    __m256d lc, __m256d ls, double ux, double uy) {
+    __m256d vux = _mm256_set1_pd(ux), vuy = _mm256_set1_pd(uy);
+    _mm256_storeu_pd(px + i, _mm256_add_pd(x, _mm256_sub_pd(_mm256_mul_pd(vux, lc), _mm256_mul_pd(vuy, ls))));
+    _mm256_storeu_pd(py + i, _mm256_add_pd(y, _mm256_add_pd(_mm256_mul_pd(vux, ls), _mm256_mul_pd(vuy, lc))));
+}
+
+static void verticesSimdRange(struct bodySoA* soa, size_t from, size_t to) {
+    vertexSoA& v = soa->verts;
+    const size_t n = from + ((to - from) & ~(size_t)3);
+    alignas(32) double c[4], s[4];
+    for (size_t i = from; i < n; i += 4) {
+        for (int l = 0; l < 4; l++) {
+            c[l] = cos(soa->phi[i + l]);
+            s[l] = sin(soa->phi[i + l]);
+        }
+        __m256d len = _mm256_loadu_pd(soa->len.data() + i);
+        __m256d lc = _mm256_mul_pd(len, _mm256_load_pd(c)), ls = _mm256_mul_pd(len, _mm256_load_pd(s));
+        __m256d x = _mm256_loadu_pd(soa->x.data() + i), y = _mm256_loadu_pd(soa->y.data() + i);
+        storeVertex(v.ax.data(), v.ay.data(), i, x, y, lc, ls, unitTri[0].x, unitTri[0].y);
+        storeVertex(v.bx.data(), v.by.data(), i, x, y, lc, ls, unitTri[1].x, unitTri[1].y);
+        storeVertex(v.cx.data(), v.cy.data(), i, x, y, lc, ls, unitTri[2].x, unitTri[2].y);
+    }
+    verticesRange(soa, n, to);
+}
+
+static void resizeRange(struct bodySoA* soa, double coeff, size_t from, size_t to) {
+    double* len = soa->len.data();
+    const size_t n = from + ((to - from) & ~(size_t)3);
+    __m256d vk = _mm256_set1_pd(coeff);
+    for (size_t i = from; i < n; i += 4)
+        _mm256_storeu_pd(len + i, _mm256_mul_pd(_mm256_loadu_pd(len + i), vk));
+    for (size_t i = n; i < to; i++)
+        len[i] *= coeff;
+    rescaleMass(soa, coeff, from, to);
+}
+
+void soaResizeBox(struct bodySoA* soa, double coeff, double lox, double loy, double hix, double hiy) {
+    const double k2 = 1 / (coeff * coeff);
+    const size_t n = soa->count & ~(size_t)3;
+    const __m256d one = _mm256_set1_pd(1), vk = _mm256_set1_pd(coeff), vk2 = _mm256_set1_pd(k2), vk4 = _mm256_set1_pd(k2 * k2);
+    const __m256d vlox = _mm256_set1_pd(lox), vloy = _mm256_set1_pd(loy), vhix = _mm256_set1_pd(hix), vhiy = _mm256_set1_pd(hiy);
+    double* len = soa->len.data(), * im = soa->invMass.data(), * ii = soa->invInertia.data();
+    for (size_t i = 0; i < n; i += 4) {
+        __m256d x = _mm256_loadu_pd(soa->x.data() + i), y = _mm256_loadu_pd(soa->y.data() + i);
+        __m256d in = _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(x, vlox, _CMP_GE_OQ), _mm256_cmp_pd(x, vhix, _CMP_LE_OQ)),
+            _mm256_and_pd(_mm256_cmp_pd(y, vloy, _CMP_GE_OQ), _mm256_cmp_pd(y, vhiy, _CMP_LE_OQ)));
+        _mm256_storeu_pd(len + i, _mm256_mul_pd(_mm256_loadu_pd(len + i), _mm256_blendv_pd(one, vk, in)));
+        _mm256_storeu_pd(im + i, _mm256_mul_pd(_mm256_loadu_pd(im + i), _mm256_blendv_pd(one, vk2, in)));
+        _mm256_storeu_pd(ii + i, _mm256_mul_pd(_mm256_loadu_pd(ii + i), _mm256_blendv_pd(one, vk4, in)));
+    }
+    resizeBoxScalar(soa, coeff, lox, loy, hix, hiy, n);
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+const char* soaKernelName() { return "neon"; }
+
+static void rotateRange(struct bodySoA* soa, double dt, size_t from, size_t to) {
+    double* phi = soa->phi.data();
+    const double* omega = soa->omega.data();
+    const size_t n = from + ((to - from) & ~(size_t)1);
+    const float64x2_t vdt = vdupq_n_f64(dt), twoPi = vdupq_n_f64(2 * M_PI), inv = vdupq_n_f64(0.5 / M_PI);
+    for (size_t i = from; i < n; i += 2) {
+        float64x2_t p = vaddq_f64(vld1q_f64(phi + i), vmulq_f64(vld1q_f64(omega + i), vdt));
+        float64x2_t k = vrndnq_f64(vmulq_f64(p, inv));
+        vst1q_f64(phi + i, vsubq_f64(p, vmulq_f64(twoPi, k)));
+    }
+    for (size_t i = n; i < to; i++) {
+        double p = phi[i] + omega[i] * dt;
+        phi[i] = p - 2 * M_PI * nearbyint(p * (0.5 / M_PI));
+    }
+}
+
+static void translateRange(struct bodySoA* soa, double dt, size_t from, size_t to) {
+    double* x = soa->x.data(), * y = soa->y.data();
+    const double* vx = soa->vx.data(), * vy = soa->vy.data();
+    const size_t n = from + ((to - from) & ~(size_t)1);
+    float64x2_t vdt = vdupq_n_f64(dt);
+    for (size_t i = from; i < n; i += 2) {
+        vst1q_f64(x + i, vaddq_f64(vld1q_f64(x + i), vmulq_f64(vld1q_f64(vx + i), vdt)));
+        vst1q_f64(y + i, vaddq_f64(vld1q_f64(y + i), vmulq_f64(vld1q_f64(vy + i), vdt)));
+    }
+    for (size_t i = n; i < to; i++) {
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+    }
+}
+
+/// <summary>
+/// Stores center + R(phi) * len * unit offset for two bodies
+/// </summary>
+static inline void storeVertex(double* px, double* py, size_t i, float64x2_t x, float64x2_t y,
+    float64x2_t lc, float64x2_t ls, double ux, double uy) {
+    float64x2_t vux = vdupq_n_f64(ux), vuy = vdupq_n_f64(uy);
+    vst1q_f64(px + i, vaddq_f64(x, vsubq_f64(vmulq_f64(vux, lc), vmulq_f64(vuy, ls))));
+    vst1q_f64(py + i, vaddq_f64(y, vaddq_f64(vmulq_f64(vux, ls), vmulq_f64(vuy, lc))));
+}
+
+static void verticesSimdRange(struct bodySoA* soa, size_t from, size_t to) {
+    vertexSoA& v = soa->verts;
+    const size_t n = from + ((to - from) & ~(size_t)1);
+    double c[2], s[2];
+    for (size_t i = from; i < n; i += 2) {
+        for (int l = 0; l < 2; l++) {
+            c[l] = cos(soa->phi[i + l]);
+            s[l] = sin(soa->phi[i + l]);
+        }
+        float64x2_t len = vld1q_f64(soa->len.data() + i);
+        float64x2_t lc = vmulq_f64(len, vld1q_f64(c)), ls = vmulq_f64(len, vld1q_f64(s));
+        float64x2_t x = vld1q_f64(soa->x.data() + i), y = vld1q_f64(soa->y.data() + i);
+        storeVertex(v.ax.data(), v.ay.data(), i, x, y, lc, ls, unitTri[0].x, unitTri[0].y);
+        storeVertex(v.bx.data(), v.by.data(), i, x, y, lc, ls, unitTri[1].x, unitTri[1].y);
+        storeVertex(v.cx.data(), v.cy.data(), i, x, y, lc, ls, unitTri[2].x, unitTri[2].y);
+    }
+    verticesRange(soa, n, to);
+}
+
+static void resizeRange(struct bodySoA* soa, double coeff, size_t from, size_t to) {
+    double* len = soa->len.data();
+    const size_t n = from + ((to - from) & ~(size_t)1);
+    float64x2_t vk = vdupq_n_f64(coeff);
+    for (size_t i = from; i < n; i += 2)
+        vst1q_f64(len + i, vmulq_f64(vld1q_f64(len + i), vk));
+    for (size_t i = n; i < to; i++)
+        len[i] *= coeff;
+    rescaleMass(soa, coeff, from, to);
+}
+
+void soaResizeBox(struct bodySoA* soa, double coeff, double lox, double loy, double hix, double hiy) {
+    const double k2 = 1 / (coeff * coeff);
+    const size_t n = soa->count & ~(size_t)1;
+    const float64x2_t one = vdupq_n_f64(1), vk = vdupq_n_f64(coeff), vk2 = vdupq_n_f64(k2), vk4 = vdupq_n_f64(k2 * k2);
+    double* len = soa->len.data(), * im = soa->invMass.data(), * ii = soa->invInertia.data();
+    for (size_t i = 0; i < n; i += 2) {
+        float64x2_t x = vld1q_f64(soa->x.data() + i), y = vld1q_f64(soa->y.data() + i);
+        uint64x2_t in = vandq_u64(vandq_u64(vcgeq_f64(x, vdupq_n_f64(lox)), vcleq_f64(x, vdupq_n_f64(hix))),
+            vandq_u64(vcgeq_f64(y, vdupq_n_f64(loy)), vcleq_f64(y, vdupq_n_f64(hiy))));
+        vst1q_f64(len + i, vmulq_f64(vld1q_f64(len + i), vbslq_f64(in, vk, one)));
+        vst1q_f64(im + i, vmulq_f64(vld1q_f64(im + i), vbslq_f64(in, vk2, one)));
+        vst1q_f64(ii + i, vmulq_f64(vld1q_f64(ii + i), vbslq_f64(in, vk4, one)));
+    }
+    resizeBoxScalar(soa, coeff, lox, loy, hix, hiy, n);
+}
+
+#else
+
+const char* soaKernelName() { return "scalar"; }
+
+static void rotateRange(struct bodySoA* soa, double dt, size_t from, size_t to) { rotateScalarRange(soa, dt, from, to); }
+static void translateRange(struct bodySoA* soa, double dt, size_t from, size_t to) { translateScalarRange(soa, dt, from, to); }
+static void verticesSimdRange(struct bodySoA* soa, size_t from, size_t to) { verticesRange(soa, from, to); }
+static void resizeRange(struct bodySoA* soa, double coeff, size_t from, size_t to) {
+    for (size_t i = from; i < to; i++)
+        soa->len[i] *= coeff;
+    rescaleMass(soa, coeff, from, to);
+}
+void soaResizeBox(struct bodySoA* soa, double coeff, double lox, double loy, double hix, double hiy) {
+    resizeBoxScalar(soa, coeff, lox, loy, hix, hiy, 0);
+}
+
+#endif
+
+void soaRotate(struct bodySoA* soa, double dt) { rotateRange(soa, dt, 0, soa->count); }
+void soaTranslate(struct bodySoA* soa, double dt) { translateRange(soa, dt, 0, soa->count); }
+void soaVertices(struct bodySoA* soa) { verticesSimdRange(soa, 0, soa->count); }
+void soaResize(struct bodySoA* soa, double coeff) { resizeRange(soa, coeff, 0, soa->count); }
+void soaResizeRange(struct bodySoA* soa, size_t from, size_t to, double coeff) { resizeRange(soa, coeff, from, to); }
+void soaVerticesRange(struct bodySoA* soa, size_t from, size_t to) { verticesSimdRange(soa, from, to); }
+
+/// <summary>
+/// Moves the cached vertices of body i along with its center
+/// </summary>
+static inline void shiftVertices(vertexSoA& v, size_t i, double dx, double dy) {
+    v.ax[i] += dx; v.bx[i] += dx; v.cx[i] += dx;
+    v.ay[i] += dy; v.by[i] += dy; v.cy[i] += dy;
+}
+
+/// <summary>
+/// Border handling of the bodies [from, to) with axisSweep. travelDt 0 only resolves penetrations,
+/// otherwise every body is also moved by its velocity times travelDt and reflected at the time of impact.
+/// </summary>
+static size_t sweepRange(struct bodySoA* soa, size_t from, size_t to, double breite, double hoehe, double travelDt) {
+    vertexSoA& v = soa->verts;
+    size_t hits = 0;
+    for (size_t i = from; i < to; i++) {
+        double loX = std::min(v.ax[i], std::min(v.bx[i], v.cx[i]));
+        double hiX = std::max(v.ax[i], std::max(v.bx[i], v.cx[i]));
+        double loY = std::min(v.ay[i], std::min(v.by[i], v.cy[i]));
+        double hiY = std::max(v.ay[i], std::max(v.by[i], v.cy[i]));
+        double tx = soa->vx[i] * travelDt, ty = soa->vy[i] * travelDt;
+        double mx = tx, my = ty;
+        bool hit = false;
+        if (loX + std::min(tx, 0.0) < -breite || hiX + std::max(tx, 0.0) > breite)
+            hit |= axisSweep(loX, hiX, &soa->vx[i], tx, breite, &mx);
+        if (loY + std::min(ty, 0.0) < -hoehe || hiY + std::max(ty, 0.0) > hoehe)
+            hit |= axisSweep(loY, hiY, &soa->vy[i], ty, hoehe, &my);
+        soa->x[i] += mx;
+        soa->y[i] += my;
+        shiftVertices(v, i, mx, my);
+        if (hit) {
+            soa->omega[i] = -soa->omega[i];
+            hits++;
+        }
+    }
+    return hits;
+}
+
+/// <summary>
+/// Handles collisions of every body with the world borders like triCollision:
+/// a penetrating body is moved back along the wall normal by its penetration depth,
+/// its velocity component is turned away from the wall and its angular velocity reversed.
+/// The cached vertices are moved along with the center.
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <returns>number of bodies that hit a border</returns>
+size_t soaCollide(struct bodySoA* soa, double breite, double hoehe) {
+    return sweepRange(soa, 0, soa->count, breite, hoehe, 0);
+}
+
+/// <summary>
+/// Translates every body by velocity times dt and reflects it at the borders at the time of impact, like triSweep
+/// </summary>
+/// <param name="soa">the body store, soaVertices must have run</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="dt">timestep</param>
+/// <returns>number of bodies that hit a border</returns>
+size_t soaSweep(struct bodySoA* soa, double breite, double hoehe, double dt) {
+    return sweepRange(soa, 0, soa->count, breite, hoehe, dt);
+}
+
+/// <summary>
+/// One fixed timestep on the bodies [from, to), see soaStep. Bodies do not interact here,
+/// so disjoint ranges can be stepped on different threads.
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="from">first body</param>
+/// <param name="to">one past the last body</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="dt">timestep</param>
+/// <param name="boundary">how the borders are handled</param>
+/// <returns>number of bodies that hit a border</returns>
+size_t soaStepRange(struct bodySoA* soa, size_t from, size_t to, double breite, double hoehe, double dt,
+    boundaryMode boundary) {
+    rotateRange(soa, dt, from, to);
+    if (boundary == BOUNDARY_SWEPT) {
+        verticesSimdRange(soa, from, to);
+        return sweepRange(soa, from, to, breite, hoehe, dt);
+    }
+    translateRange(soa, dt, from, to);
+    verticesSimdRange(soa, from, to);
+    return sweepRange(soa, from, to, breite, hoehe, 0);
+}
+
+/// <summary>
+/// Rotates and translates the bodies [from, to) and derives their vertices, without any border handling
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="from">first body</param>
+/// <param name="to">one past the last body</param>
+/// <param name="dt">timestep</param>
+void soaIntegrateRange(struct bodySoA* soa, size_t from, size_t to, double dt) {
+    rotateRange(soa, dt, from, to);
+    translateRange(soa, dt, from, to);
+    verticesSimdRange(soa, from, to);
+}
+
+/// <summary>
+/// One fixed timestep on the whole store. BOUNDARY_DISCRETE: rotate, translate, derive vertices, collide.
+/// BOUNDARY_SWEPT: rotate, derive vertices, then translate and collide in one swept pass.
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="dt">timestep</param>
+/// <param name="boundary">how the borders are handled</param>
+void soaStep(struct bodySoA* soa, double breite, double hoehe, double dt, boundaryMode boundary) {
+    soaStepRange(soa, 0, soa->count, breite, hoehe, dt, boundary);
+}
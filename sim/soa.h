@@ -0,0 +1,203 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "sim.h"
+
+/// <summary>
+/// World space vertices of all bodies, one array per coordinate
+/// </summary>
+struct vertexSoA {
+    std::vector<double> ax, ay, bx, by, cx, cy;
+};
+
+/// <summary>
+/// Structure-of-arrays body store. Every quantity lives in its own contiguous array,
+/// so the kernels below can process several bodies per SIMD instruction.
+/// A body is stored as center (x, y), orientation phi and side length len;
+/// its vertices are derived from these by soaVertices and cached in verts.
+/// invMass and invInertia follow from len and a uniform density, restitution and friction
+/// are per body material coefficients used by the impulse solver.
+/// </summary>
+struct bodySoA {
+    size_t count = 0;
+    std::vector<double> x, y;
+    std::vector<double> phi, len;
+    std::vector<double> vx, vy;
+    std::vector<double> omega;
+    std::vector<double> invMass, invInertia;
+    std::vector<double> restitution, friction;
+    vertexSoA verts;
+};
+
+/// <summary>
+/// Appends a body to the store
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="b">the body to be copied in</param>
+void soaPush(struct bodySoA* soa, const body& b);
+
+/// <summary>
+/// Makes room for n bodies, so pushing up to n bodies allocates nothing
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="n">number of bodies</param>
+void soaReserve(struct bodySoA* soa, size_t n);
+
+/// <summary>
+/// Removes a body by moving the last body into its place, so the arrays stay dense
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="i">index of the body to remove</param>
+void soaRemove(struct bodySoA* soa, size_t i);
+
+/// <summary>
+/// Sets mass, moment of inertia and material of one body. Mass is density times area,
+/// the moment of inertia of an equilateral triangle about its center is mass * len^2 / 12.
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="i">index of the body</param>
+/// <param name="density">mass per square pixel, 0 makes the body immovable</param>
+/// <param name="restitution">ratio of normal speed after and before an impact, 1 is perfectly elastic</param>
+/// <param name="friction">Coulomb friction coefficient</param>
+void soaSetMaterial(struct bodySoA* soa, size_t i, double density, double restitution, double friction);
+
+/// <summary>
+/// Replaces the content of the store with the bodies of a world
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="w">the world to be copied</param>
+void soaFromWorld(struct bodySoA* soa, const world& w);
+
+/// <summary>
+/// Assembles the world space triangle of one body from its pose
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="i">index of the body</param>
+/// <returns>the triangle with absolute vertex positions</returns>
+triangle soaTriangle(const bodySoA& soa, size_t i);
+
+/// <summary>
+/// Rotates every body by omega * dt around its center. Only the angles change,
+/// they are kept in [-pi, pi] so they do not lose precision over long runs.
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="dt">timestep</param>
+void soaRotate(struct bodySoA* soa, double dt);
+
+/// <summary>
+/// Moves every body by its velocity times dt
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="dt">timestep</param>
+void soaTranslate(struct bodySoA* soa, double dt);
+
+/// <summary>
+/// Derives the world space vertices of every body into soa->verts. sin and cos are evaluated once per body.
+/// </summary>
+/// <param name="soa">the body store</param>
+void soaVertices(struct bodySoA* soa);
+
+/// <summary>
+/// Resizes every body around its center with the given ratio. Mass and moment of inertia scale along.
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="coeff">resize ratio</param>
+void soaResize(struct bodySoA* soa, double coeff);
+
+/// <summary>
+/// Resizes the bodies [from, to) like soaResize
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="from">first body</param>
+/// <param name="to">one past the last body</param>
+/// <param name="coeff">resize ratio</param>
+void soaResizeRange(struct bodySoA* soa, size_t from, size_t to, double coeff);
+
+/// <summary>
+/// Resizes the bodies whose center lies in the box [lox, hix] x [loy, hiy], in one masked pass over all bodies
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="coeff">resize ratio</param>
+/// <param name="lox">left edge of the box</param>
+/// <param name="loy">bottom edge of the box</param>
+/// <param name="hix">right edge of the box</param>
+/// <param name="hiy">top edge of the box</param>
+void soaResizeBox(struct bodySoA* soa, double coeff, double lox, double loy, double hix, double hiy);
+
+/// <summary>
+/// Handles collisions of every body with the world borders like triCollision: pushes penetrating bodies
+/// back along the wall normal, turns the velocity away from the wall and reverses the angular velocity.
+/// Reads and updates soa->verts.
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <returns>number of bodies that hit a border</returns>
+size_t soaCollide(struct bodySoA* soa, double breite, double hoehe);
+
+/// <summary>
+/// Translates every body by velocity times dt and reflects it at the borders at the time of impact, like triSweep.
+/// Reads and updates soa->verts.
+/// </summary>
+/// <param name="soa">the body store, soaVertices must have run</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="dt">timestep</param>
+/// <returns>number of bodies that hit a border</returns>
+size_t soaSweep(struct bodySoA* soa, double breite, double hoehe, double dt);
+
+/// <summary>
+/// One fixed timestep on the whole store: rotate, translate, derive vertices, handle the borders
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="dt">timestep</param>
+/// <param name="boundary">how the borders are handled</param>
+void soaStep(struct bodySoA* soa, double breite, double hoehe, double dt,
+    boundaryMode boundary = BOUNDARY_DISCRETE);
+
+/// <summary>
+/// One fixed timestep on the bodies [from, to), see soaStep. Bodies do not interact here,
+/// so disjoint ranges can be stepped on different threads.
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="from">first body</param>
+/// <param name="to">one past the last body</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="dt">timestep</param>
+/// <param name="boundary">how the borders are handled</param>
+/// <returns>number of bodies that hit a border</returns>
+size_t soaStepRange(struct bodySoA* soa, size_t from, size_t to, double breite, double hoehe, double dt,
+    boundaryMode boundary);
+
+/// <summary>
+/// Rotates and translates the bodies [from, to) and derives their vertices, without any border handling
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="from">first body</param>
+/// <param name="to">one past the last body</param>
+/// <param name="dt">timestep</param>
+void soaIntegrateRange(struct bodySoA* soa, size_t from, size_t to, double dt);
+
+/// <summary>
+/// Derives the vertices of the bodies [from, to) from center, orientation and side length
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <param name="from">first body</param>
+/// <param name="to">one past the last body</param>
+void soaVerticesRange(struct bodySoA* soa, size_t from, size_t to);
+
+/* Portable reference versions of the SIMD kernels, the vectorized ones are checked against these */
+void soaRotateScalar(struct bodySoA* soa, double dt);
+void soaTranslateScalar(struct bodySoA* soa, double dt);
+void soaVerticesScalar(struct bodySoA* soa);
+void soaResizeScalar(struct bodySoA* soa, double coeff);
+
+/// <summary>
+/// Name of the instruction set the kernels were compiled for
+/// </summary>
+/// <returns>"avx2", "neon" or "scalar"</returns>
+const char* soaKernelName();
@@ -0,0 +1,229 @@
+#include "solver.h"
+#include <algorithm>
+#include <cmath>
+
+/* Closing speeds below this (px/s) do not bounce, which keeps resting contacts from jittering */
+static const double restingSpeed = 0.5;
+
+/* Overlap that is left in place so touching bodies keep producing contacts, and the fraction of the rest that is removed per step */
+static const double slop = 0.01;
+static const double separation = 0.8;
+
+/// <summary>
+/// Appends a wall contact for one vertex if it is outside the world
+/// </summary>
+static void wallVertex(uint32_t i, double x, double y, double breite, double hoehe, std::vector<contact>* contacts) {
+    if (x > breite)
+        contacts->push_back({ WALL, i, -1, 0, x - breite, x, y });
+    else if (x < -breite)
+        contacts->push_back({ WALL, i, 1, 0, -breite - x, x, y });
+    if (y > hoehe)
+        contacts->push_back({ WALL, i, 0, -1, y - hoehe, x, y });
+    else if (y < -hoehe)
+        contacts->push_back({ WALL, i, 0, 1, -hoehe - y, x, y });
+}
+
+/// <summary>
+/// Appends one contact for every vertex that is outside the world. a is WALL, the normal points into the world.
+/// </summary>
+/// <param name="soa">the body store, soaVertices must have run</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="contacts">the contacts are appended here</param>
+/// <returns>number of contacts appended</returns>
+size_t wallContacts(const bodySoA& soa, double breite, double hoehe, std::vector<contact>* contacts) {
+    return wallContactsRange(soa, 0, soa.count, breite, hoehe, contacts);
+}
+
+/// <summary>
+/// Appends the wall contacts of the bodies [from, to), see wallContacts
+/// </summary>
+/// <param name="soa">the body store, soaVertices must have run</param>
+/// <param name="from">first body</param>
+/// <param name="to">one past the last body</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="contacts">the contacts are appended here</param>
+/// <returns>number of contacts appended</returns>
+size_t wallContactsRange(const bodySoA& soa, size_t from, size_t to, double breite, double hoehe,
+    std::vector<contact>* contacts) {
+    const vertexSoA& v = soa.verts;
+    const size_t before = contacts->size();
+    for (size_t i = from; i < to; i++) {
+        double loX = std::min(v.ax[i], std::min(v.bx[i], v.cx[i]));
+        double hiX = std::max(v.ax[i], std::max(v.bx[i], v.cx[i]));
+        double loY = std::min(v.ay[i], std::min(v.by[i], v.cy[i]));
+        double hiY = std::max(v.ay[i], std::max(v.by[i], v.cy[i]));
+        if (loX >= -breite && hiX <= breite && loY >= -hoehe && hiY <= hoehe)
+            continue;
+        wallVertex((uint32_t)i, v.ax[i], v.ay[i], breite, hoehe, contacts);
+        wallVertex((uint32_t)i, v.bx[i], v.by[i], breite, hoehe, contacts);
+        wallVertex((uint32_t)i, v.cx[i], v.cy[i], breite, hoehe, contacts);
+    }
+    return contacts->size() - before;
+}
+
+/// <summary>
+/// Mass properties and velocity of one contact partner, all zero for a wall
+/// </summary>
+struct partner {
+    double invM, invI;
+    double* vx, * vy, * w;
+};
+
+static inline partner partnerOf(struct bodySoA* soa, uint32_t i, double* wall) {
+    if (i == WALL) {
+        wall[0] = wall[1] = wall[2] = 0;
+        return { 0, 0, &wall[0], &wall[1], &wall[2] };
+    }
+    return { soa->invMass[i], soa->invInertia[i], &soa->vx[i], &soa->vy[i], &soa->omega[i] };
+}
+
+/// <summary>
+/// Velocity of b relative to a at the contact point, projected onto (dx, dy)
+/// </summary>
+static inline double relVel(const partner& a, const partner& b, const contactRow& r, double dx, double dy) {
+    double vax = *a.vx - *a.w * r.ray, vay = *a.vy + *a.w * r.rax;
+    double vbx = *b.vx - *b.w * r.rby, vby = *b.vy + *b.w * r.rbx;
+    return (vbx - vax) * dx + (vby - vay) * dy;
+}
+
+/// <summary>
+/// Applies the impulse j along (dx, dy) to b and the opposite one to a
+/// </summary>
+static inline void applyImpulse(partner& a, partner& b, const contactRow& r, double j, double dx, double dy) {
+    double px = j * dx, py = j * dy;
+    *a.vx -= px * a.invM;
+    *a.vy -= py * a.invM;
+    *a.w -= a.invI * (r.rax * py - r.ray * px);
+    *b.vx += px * b.invM;
+    *b.vy += py * b.invM;
+    *b.w += b.invI * (r.rbx * py - r.rby * px);
+}
+
+/// <summary>
+/// Resolves all contacts of a step together with sequential impulses. Every iteration stops the approach
+/// along the normal and applies friction limited by the Coulomb cone, the accumulated normal impulse
+/// never pulls; a final pass adds the bounce. Impulses between two bodies are equal and opposite,
+/// so momentum is conserved, and with restitution 1 and no friction an isolated impact keeps kinetic energy.
+/// </summary>
+/// <param name="soa">the body store, velocities and angular velocities are updated</param>
+/// <param name="contacts">contacts of this step</param>
+/// <param name="solver">scratch space</param>
+/// <param name="iterations">number of passes over all contacts</param>
+void solveContacts(struct bodySoA* soa, const std::vector<contact>& contacts, struct contactSolver* solver, int iterations) {
+    std::vector<contactRow>& rows = solver->rows;
+    rows.resize(contacts.size());
+    double wall[3];
+    for (size_t k = 0; k < contacts.size(); k++) {
+        const contact& c = contacts[k];
+        contactRow& r = rows[k];
+        partner a = partnerOf(soa, c.a, wall), b = partnerOf(soa, c.b, wall);
+        r.rax = c.a == WALL ? 0 : c.px - soa->x[c.a];
+        r.ray = c.a == WALL ? 0 : c.py - soa->y[c.a];
+        r.rbx = c.px - soa->x[c.b];
+        r.rby = c.py - soa->y[c.b];
+        double tx = -c.ny, ty = c.nx;
+        double ran = r.rax * c.ny - r.ray * c.nx, rbn = r.rbx * c.ny - r.rby * c.nx;
+        double rat = r.rax * ty - r.ray * tx, rbt = r.rbx * ty - r.rby * tx;
+        double kn = a.invM + b.invM + ran * ran * a.invI + rbn * rbn * b.invI;
+        double kt = a.invM + b.invM + rat * rat * a.invI + rbt * rbt * b.invI;
+        r.kn = kn > 0 ? 1 / kn : 0;
+        r.kt = kt > 0 ? 1 / kt : 0;
+        r.e = c.a == WALL ? soa->restitution[c.b] : std::max(soa->restitution[c.a], soa->restitution[c.b]);
+        r.mu = c.a == WALL ? soa->friction[c.b] : sqrt(soa->friction[c.a] * soa->friction[c.b]);
+        r.approach = relVel(a, b, r, c.nx, c.ny);
+        r.jn = r.jt = 0;
+    }
+
+    for (int it = 0; it < iterations; it++) {
+        for (size_t k = 0; k < contacts.size(); k++) {
+            const contact& c = contacts[k];
+            contactRow& r = rows[k];
+            partner a = partnerOf(soa, c.a, wall), b = partnerOf(soa, c.b, wall);
+
+            double vn = relVel(a, b, r, c.nx, c.ny);
+            double jn = std::max(r.jn - vn * r.kn, 0.0);
+            applyImpulse(a, b, r, jn - r.jn, c.nx, c.ny);
+            r.jn = jn;
+
+            if (r.mu > 0) {
+                double tx = -c.ny, ty = c.nx;
+                double vt = relVel(a, b, r, tx, ty);
+                double limit = r.mu * r.jn;
+                double jt = std::min(std::max(r.jt - vt * r.kt, -limit), limit);
+                applyImpulse(a, b, r, jt - r.jt, tx, ty);
+                r.jt = jt;
+            }
+        }
+    }
+
+    /* restitution last, once the contacts have stopped pushing into each other: only contacts that
+       were approaching and took a push bounce back, with their own approach speed as target */
+    for (size_t k = 0; k < contacts.size(); k++) {
+        const contact& c = contacts[k];
+        contactRow& r = rows[k];
+        if (r.e == 0 || r.approach > -restingSpeed || r.jn == 0)
+            continue;
+        partner a = partnerOf(soa, c.a, wall), b = partnerOf(soa, c.b, wall);
+        double vn = relVel(a, b, r, c.nx, c.ny);
+        double jn = std::max(r.jn - (vn + r.e * r.approach) * r.kn, 0.0);
+        applyImpulse(a, b, r, jn - r.jn, c.nx, c.ny);
+        r.jn = jn;
+    }
+}
+
+/// <summary>
+/// Moves the center and the cached vertices of body i
+/// </summary>
+static inline void shiftBody(struct bodySoA* soa, uint32_t i, double dx, double dy) {
+    vertexSoA& v = soa->verts;
+    soa->x[i] += dx;
+    soa->y[i] += dy;
+    v.ax[i] += dx; v.bx[i] += dx; v.cx[i] += dx;
+    v.ay[i] += dy; v.by[i] += dy; v.cy[i] += dy;
+}
+
+/// <summary>
+/// Removes the remaining overlap: bodies are moved apart along the contact normal in proportion
+/// to their inverse masses, walls push the whole depth. Positions only, velocities are untouched.
+/// </summary>
+/// <param name="soa">the body store, centers and cached vertices are moved</param>
+/// <param name="contacts">contacts of this step</param>
+void separateContacts(struct bodySoA* soa, const std::vector<contact>& contacts) {
+    for (const contact& c : contacts) {
+        if (c.a == WALL) {
+            /* several vertices may report the same wall, only push as far as still needed */
+            const vertexSoA& v = soa->verts;
+            double worst = 0;
+            const double px[3] = { v.ax[c.b], v.bx[c.b], v.cx[c.b] }, py[3] = { v.ay[c.b], v.by[c.b], v.cy[c.b] };
+            double wall = (c.px * c.nx + c.py * c.ny) + c.depth;
+            for (int k = 0; k < 3; k++)
+                worst = std::max(worst, wall - (px[k] * c.nx + py[k] * c.ny));
+            shiftBody(soa, c.b, c.nx * worst, c.ny * worst);
+            continue;
+        }
+        double ia = soa->invMass[c.a], ib = soa->invMass[c.b];
+        if (ia + ib <= 0 || c.depth <= slop)
+            continue;
+        double d = (c.depth - slop) * separation / (ia + ib);
+        shiftBody(soa, c.a, -c.nx * d * ia, -c.ny * d * ia);
+        shiftBody(soa, c.b, c.nx * d * ib, c.ny * d * ib);
+    }
+}
+
+/// <summary>
+/// Total kinetic energy, translational plus rotational
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <returns>sum of m v^2 / 2 + I omega^2 / 2 over all bodies</returns>
+double kineticEnergy(const bodySoA& soa) {
+    double e = 0;
+    for (size_t i = 0; i < soa.count; i++) {
+        if (soa.invMass[i] > 0)
+            e += 0.5 * (soa.vx[i] * soa.vx[i] + soa.vy[i] * soa.vy[i]) / soa.invMass[i];
+        if (soa.invInertia[i] > 0)
+            e += 0.5 * soa.omega[i] * soa.omega[i] / soa.invInertia[i];
+    }
+    return e;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "narrowphase.h"
+
+/// <summary>
+/// Per contact data of the impulse solver: lever arms, effective masses, the normal speed before solving
+/// and the impulses accumulated over the iterations
+/// </summary>
+struct contactRow {
+    double rax, ray, rbx, rby;
+    double kn, kt;
+    double approach;
+    double e, mu;
+    double jn, jt;
+};
+
+/// <summary>
+/// Scratch space of the solver, kept between steps so solving does not allocate
+/// </summary>
+struct contactSolver {
+    std::vector<contactRow> rows;
+};
+
+/// <summary>
+/// Appends one contact for every vertex that is outside the world. a is WALL, the normal points into the world.
+/// </summary>
+/// <param name="soa">the body store, soaVertices must have run</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="contacts">the contacts are appended here</param>
+/// <returns>number of contacts appended</returns>
+size_t wallContacts(const bodySoA& soa, double breite, double hoehe, std::vector<contact>* contacts);
+
+/// <summary>
+/// Appends the wall contacts of the bodies [from, to), see wallContacts
+/// </summary>
+/// <param name="soa">the body store, soaVertices must have run</param>
+/// <param name="from">first body</param>
+/// <param name="to">one past the last body</param>
+/// <param name="breite">horizontal dimension of the world</param>
+/// <param name="hoehe">vertical dimension of the world</param>
+/// <param name="contacts">the contacts are appended here</param>
+/// <returns>number of contacts appended</returns>
+size_t wallContactsRange(const bodySoA& soa, size_t from, size_t to, double breite, double hoehe,
+    std::vector<contact>* contacts);
+
+/// <summary>
+/// Resolves all contacts of a step together with sequential impulses. Every iteration stops the approach
+/// along the normal and applies friction limited by the Coulomb cone, the accumulated normal impulse
+/// never pulls; a final pass adds the bounce. Impulses between two bodies are equal and opposite,
+/// so momentum is conserved, and with restitution 1 and no friction an isolated impact keeps kinetic energy.
+/// </summary>
+/// <param name="soa">the body store, velocities and angular velocities are updated</param>
+/// <param name="contacts">contacts of this step</param>
+/// <param name="solver">scratch space</param>
+/// <param name="iterations">number of passes over all contacts</param>
+void solveContacts(struct bodySoA* soa, const std::vector<contact>& contacts, struct contactSolver* solver, int iterations);
+
+/// <summary>
+/// Removes the remaining overlap: bodies are moved apart along the contact normal in proportion
+/// to their inverse masses, walls push the whole depth. Positions only, velocities are untouched.
+/// </summary>
+/// <param name="soa">the body store, centers and cached vertices are moved</param>
+/// <param name="contacts">contacts of this step</param>
+void separateContacts(struct bodySoA* soa, const std::vector<contact>& contacts);
+
+/// <summary>
+/// Total kinetic energy, translational plus rotational
+/// </summary>
+/// <param name="soa">the body store</param>
+/// <returns>sum of m v^2 / 2 + I omega^2 / 2 over all bodies</returns>
+double kineticEnergy(const bodySoA& soa);
@@ -0,0 +1,212 @@
+#include "sweep.h"
+#include <chrono>
+#include <cstring>
+
+#include "mapfile.h"
+#include "solver.h"
+
+static const uint32_t columnsVersion = 1;
+static const uint64_t columnAlign = 64;
+static const size_t columnCount = 13;
+static const char* columnNames[columnCount] = { "scene", "breite", "hoehe", "len", "omega", "speed", "seed",
+    "body_contacts", "wall_contacts", "energy_start", "energy_end", "seconds", "steps_per_sec" };
+
+static double rangeValue(const sweepRange& r, int k) {
+    return r.count > 1 ? r.from + (r.to - r.from) * k / (r.count - 1) : r.from;
+}
+
+static double columnValue(const sweepResult& r, size_t k) {
+    const sweepPoint& p = r.point;
+    const double values[columnCount] = { (double)p.index, p.breite, p.hoehe, p.len, p.omega, p.speed, (double)p.seed,
+        (double)r.bodyContacts, (double)r.wallContacts, r.energyStart, r.energyEnd, r.seconds, r.stepsPerSec };
+    return values[k];
+}
+
+/// <summary>
+/// Reads a sweep spec, settings that are not in the file keep their defaults
+/// </summary>
+/// <param name="path">the file</param>
+/// <param name="spec">receives the spec</param>
+/// <returns>false if the file is missing or a line can not be read</returns>
+bool sweepLoad(const char* path, struct sweepSpec* spec) {
+    *spec = sweepSpec();
+    FILE* f = std::fopen(path, "r");
+    if (!f)
+        return false;
+    char line[256], name[16], word[16];
+    bool ok = true;
+    while (ok && std::fgets(line, sizeof(line), f)) {
+        if (std::sscanf(line, " %15s", name) != 1 || name[0] == '#')
+            continue;
+        sweepRange* ranges[5] = { &spec->breite, &spec->hoehe, &spec->len, &spec->omega, &spec->speed };
+        const char* rangeNames[5] = { "breite", "hoehe", "len", "omega", "speed" };
+        sweepRange* r = nullptr;
+        for (int k = 0; k < 5; k++)
+            if (!std::strcmp(name, rangeNames[k]))
+                r = ranges[k];
+        if (r) {
+            sweepRange v = { 0, 0, 1 };
+            const int n = std::sscanf(line, " %*s %lf %lf %d", &v.from, &v.to, &v.count);
+            ok = (n == 1 || n == 3) && v.count >= 1;
+            if (n == 1)
+                v.to = v.from;
+            *r = v;
+            continue;
+        }
+        double value = 0;
+        if (!std::strcmp(name, "response")) {
+            ok = std::sscanf(line, " %*s %15s", word) == 1 && (!std::strcmp(word, "impulse") || !std::strcmp(word, "reflect"));
+            spec->response = !std::strcmp(word, "reflect") ? RESPONSE_REFLECT : RESPONSE_IMPULSE;
+            continue;
+        }
+        ok = std::sscanf(line, " %*s %lf", &value) == 1;
+        if (!std::strcmp(name, "bodies"))
+            spec->bodies = (size_t)value;
+        else if (!std::strcmp(name, "steps"))
+            spec->steps = (long long)value;
+        else if (!std::strcmp(name, "dt"))
+            spec->dt = value;
+        else if (!std::strcmp(name, "seed"))
+            spec->seed = (unsigned)value;
+        else if (!std::strcmp(name, "seeds")) {
+            ok = ok && value >= 1;
+            spec->seeds = (unsigned)value;
+        }
+        else if (!std::strcmp(name, "restitution"))
+            spec->restitution = value;
+        else if (!std::strcmp(name, "friction"))
+            spec->friction = value;
+        else
+            ok = false;
+    }
+    std::fclose(f);
+    return ok;
+}
+
+/// <summary>
+/// Number of scenes of a sweep
+/// </summary>
+/// <returns>the product of the range counts and seeds</returns>
+size_t sweepCount(const sweepSpec& spec) {
+    return (size_t)spec.breite.count * spec.hoehe.count * spec.len.count * spec.omega.count * spec.speed.count * spec.seeds;
+}
+
+/// <summary>
+/// Settings of one scene of a sweep. The index counts through the ranges like the digits of a number,
+/// breite slowest, then hoehe, len, omega, speed and the seed fastest.
+/// </summary>
+/// <param name="spec">the sweep</param>
+/// <param name="index">number of the scene, less than sweepCount</param>
+/// <returns>the settings</returns>
+sweepPoint sweepAt(const sweepSpec& spec, size_t index) {
+    sweepPoint p;
+    p.index = index;
+    p.seed = spec.seed + (unsigned)(index % spec.seeds);
+    index /= spec.seeds;
+    const sweepRange* ranges[5] = { &spec.speed, &spec.omega, &spec.len, &spec.hoehe, &spec.breite };
+    double* values[5] = { &p.speed, &p.omega, &p.len, &p.hoehe, &p.breite };
+    for (int k = 0; k < 5; k++) {
+        *values[k] = rangeValue(*ranges[k], (int)(index % ranges[k]->count));
+        index /= ranges[k]->count;
+    }
+    return p;
+}
+
+/// <summary>
+/// Creates the scene of a sweep point: world, bodies and material, not yet stepped
+/// </summary>
+/// <param name="spec">the sweep</param>
+/// <param name="p">the point</param>
+/// <returns>the scene, without a pool</returns>
+scene sweepScene(const sweepSpec& spec, const sweepPoint& p) {
+    sceneConfig cfg;
+    cfg.response = spec.response;
+    scene sc = makeScene(p.breite, p.hoehe, spec.dt, cfg);
+    /* spawned by worldSpawn as sceneSpawn does, so the default point is the scene of sceneSpawn */
+    world w = makeWorld(p.breite, p.hoehe, spec.dt, ROT_POSE);
+    worldSpawn(&w, spec.bodies, p.len, p.seed, p.speed, p.omega);
+    soaReserve(&sc.bodies, spec.bodies);
+    for (const body& b : w.bodies)
+        soaPush(&sc.bodies, b);
+    sceneSetMaterial(&sc, 1, spec.restitution, spec.friction);
+    return sc;
+}
+
+/// <summary>
+/// Runs one scene of a sweep from start to end on the calling thread. The scene lives only in this call,
+/// so any number of them can run at the same time.
+/// </summary>
+/// <param name="spec">the sweep</param>
+/// <param name="p">the point</param>
+/// <returns>the summary</returns>
+sweepResult sweepRun(const sweepSpec& spec, const sweepPoint& p) {
+    sweepResult r;
+    r.point = p;
+    scene sc = sweepScene(spec, p);
+    r.energyStart = kineticEnergy(sc.bodies);
+    auto t0 = std::chrono::steady_clock::now();
+    for (long long s = 0; s < spec.steps; s++) {
+        sceneStep(&sc);
+        r.bodyContacts += sc.stats.bodyContacts;
+        r.wallContacts += sc.stats.wallContacts;
+    }
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    r.stepsPerSec = r.seconds > 0 ? spec.steps / r.seconds : 0;
+    r.energyEnd = kineticEnergy(sc.bodies);
+    return r;
+}
+
+/// <summary>
+/// Writes the column names of sweepCsvRow
+/// </summary>
+/// <param name="f">the stream</param>
+void sweepCsvHeader(FILE* f) {
+    for (size_t k = 0; k < columnCount; k++)
+        std::fprintf(f, k ? ",%s" : "%s", columnNames[k]);
+    std::fprintf(f, "\n");
+}
+
+/// <summary>
+/// Writes one result as a comma separated line
+/// </summary>
+/// <param name="f">the stream</param>
+/// <param name="r">the result</param>
+void sweepCsvRow(FILE* f, const sweepResult& r) {
+    const sweepPoint& p = r.point;
+    std::fprintf(f, "%zu,%.17g,%.17g,%.17g,%.17g,%.17g,%u,%llu,%llu,%.17g,%.17g,%.6f,%.1f\n", p.index, p.breite, p.hoehe,
+        p.len, p.omega, p.speed, p.seed, (unsigned long long)r.bodyContacts, (unsigned long long)r.wallContacts,
+        r.energyStart, r.energyEnd, r.seconds, r.stepsPerSec);
+}
+
+/// <summary>
+/// Writes results column by column: a header ("GLSW", version, rows, columns), the names of the columns,
+/// 16 bytes each, then every column as rows doubles starting on a 64 byte boundary. A column can be read
+/// by mapping the file without touching the others.
+/// </summary>
+/// <param name="path">the file, replaced if it exists</param>
+/// <param name="results">the results, one row each</param>
+/// <returns>false if the file could not be created</returns>
+bool sweepWriteColumns(const char* path, const std::vector<sweepResult>& results) {
+    const uint64_t rows = results.size(), header = 4 + 4 + 8 + 8;
+    const uint64_t first = (header + 16 * columnCount + columnAlign - 1) / columnAlign * columnAlign;
+    const uint64_t stride = (rows * sizeof(double) + columnAlign - 1) / columnAlign * columnAlign;
+    const uint64_t size = first + columnCount * stride;
+    uint8_t* map = mapCreate(path, size);
+    if (!map)
+        return false;
+    const uint64_t columns = columnCount;
+    std::memcpy(map, "GLSW", 4);
+    std::memcpy(map + 4, &columnsVersion, 4);
+    std::memcpy(map + 8, &rows, 8);
+    std::memcpy(map + 16, &columns, 8);
+    for (size_t k = 0; k < columnCount; k++) {
+        char name[16] = {};
+        std::strncpy(name, columnNames[k], sizeof(name) - 1);
+        std::memcpy(map + header + 16 * k, name, sizeof(name));
+        double* column = (double*)(map + first + k * stride);
+        for (size_t i = 0; i < rows; i++)
+            column[i] = columnValue(results[i], k);
+    }
+    mapRelease(map, size);
+    return true;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "scene.h"
+
+/// <summary>
+/// count values evenly spaced from from to to, both included; count 1 is just from
+/// </summary>
+struct sweepRange {
+    double from, to;
+    int count;
+};
+
+/// <summary>
+/// A parameter sweep: every combination of the ranges is one scene. Read from a text file with one
+/// setting per line, "name from [to count]" for the ranges breite, hoehe, len, omega and speed and
+/// "name value" for bodies, steps, dt, seed, seeds, restitution, friction and response impulse|reflect;
+/// empty lines and lines starting with # are skipped. Bodies are spawned by worldSpawn, with every
+/// velocity component speed * [1, 2] and angular speed omega, both with a random sign. seeds runs every
+/// combination that many times, with the seeds seed, seed + 1, ... The defaults are the scene of sceneSpawn.
+/// </summary>
+struct sweepSpec {
+    sweepRange breite = { 1280, 1280, 1 };
+    sweepRange hoehe = { 720, 720, 1 };
+    sweepRange len = { 20, 20, 1 };
+    /* pi rad/s, the default of worldSpawn */
+    sweepRange omega = { 3.141592653589793, 3.141592653589793, 1 };
+    sweepRange speed = { 150, 150, 1 };
+    size_t bodies = 1000;
+    long long steps = 1000;
+    double dt = 1.0 / 120;
+    unsigned seed = 1;
+    unsigned seeds = 1;
+    responseMode response = RESPONSE_IMPULSE;
+    double restitution = 1;
+    double friction = 0;
+};
+
+/// <summary>
+/// The settings of one scene of a sweep
+/// </summary>
+struct sweepPoint {
+    size_t index;
+    double breite, hoehe, len, omega, speed;
+    unsigned seed;
+};
+
+/// <summary>
+/// Summary of one scene of a sweep: the contacts of all steps, kinetic energy before the first and after
+/// the last step, and how fast the scene stepped on its thread
+/// </summary>
+struct sweepResult {
+    sweepPoint point;
+    uint64_t bodyContacts = 0;
+    uint64_t wallContacts = 0;
+    double energyStart = 0;
+    double energyEnd = 0;
+    double seconds = 0;
+    double stepsPerSec = 0;
+};
+
+/// <summary>
+/// Reads a sweep spec, settings that are not in the file keep their defaults
+/// </summary>
+/// <param name="path">the file</param>
+/// <param name="spec">receives the spec</param>
+/// <returns>false if the file is missing or a line can not be read</returns>
+bool sweepLoad(const char* path, struct sweepSpec* spec);
+
+/// <summary>
+/// Number of scenes of a sweep
+/// </summary>
+/// <returns>the product of the range counts and seeds</returns>
+size_t sweepCount(const sweepSpec& spec);
+
+/// <summary>
+/// Settings of one scene of a sweep. The index counts through the ranges like the digits of a number,
+/// breite slowest, then hoehe, len, omega, speed and the seed fastest.
+/// </summary>
+/// <param name="spec">the sweep</param>
+/// <param name="index">number of the scene, less than sweepCount</param>
+/// <returns>the settings</returns>
+sweepPoint sweepAt(const sweepSpec& spec, size_t index);
+
+/// <summary>
+/// Creates the scene of a sweep point: world, bodies and material, not yet stepped
+/// </summary>
+/// <param name="spec">the sweep</param>
+/// <param name="p">the point</param>
+/// <returns>the scene, without a pool</returns>
+scene sweepScene(const sweepSpec& spec, const sweepPoint& p);
+
+/// <summary>
+/// Runs one scene of a sweep from start to end on the calling thread. The scene lives only in this call,
+/// so any number of them can run at the same time.
+/// </summary>
+/// <param name="spec">the sweep</param>
+/// <param name="p">the point</param>
+/// <returns>the summary</returns>
+sweepResult sweepRun(const sweepSpec& spec, const sweepPoint& p);
+
+/// <summary>
+/// Writes the column names of sweepCsvRow
+/// </summary>
+/// <param name="f">the stream</param>
+void sweepCsvHeader(FILE* f);
+
+/// <summary>
+/// Writes one result as a comma separated line
+/// </summary>
+/// <param name="f">the stream</param>
+/// <param name="r">the result</param>
+void sweepCsvRow(FILE* f, const sweepResult& r);
+
+/// <summary>
+/// Writes results column by column: a header ("GLSW", version, rows, columns), the names of the columns,
+/// 16 bytes each, then every column as rows doubles starting on a 64 byte boundary. A column can be read
+/// by mapping the file without touching the others.
+/// </summary>
+/// <param name="path">the file, replaced if it exists</param>
+/// <param name="results">the results, one row each</param>
+/// <returns>false if the file could not be created</returns>
+bool sweepWriteColumns(const char* path, const std::vector<sweepResult>& results);
@@ -0,0 +1,452 @@
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "commands.h"
+#include "mapfile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* record tags; 0 is what a fresh segment is filled with and tells the reader to go on at the next one */
+enum traceTag : uint8_t { TAG_NEXT_SEGMENT = 0, TAG_STEP = 1, TAG_COMMAND = 2, TAG_END = 3 };
+
+/* version 2 stores the selection of a command, version 3 the integrator settings, version 4 the sleep settings;
+   older traces are still read, with sub-stepping and sleeping off as when they were recorded */
+static const uint32_t traceVersion = 4;
+static const size_t commandBytes = 2 + 2 * sizeof(uint64_t) + 5 * sizeof(double);
+static const uint64_t megabyte = 1 << 20;
+
+/* the arrays of the initial state, in file order */
+static const size_t stateArrays = 17;
+
+static const std::vector<double>* stateArray(const bodySoA& b, size_t k) {
+    const std::vector<double>* arrays[stateArrays] = { &b.x, &b.y, &b.phi, &b.len, &b.vx, &b.vy, &b.omega,
+        &b.invMass, &b.invInertia, &b.restitution, &b.friction,
+        &b.verts.ax, &b.verts.ay, &b.verts.bx, &b.verts.by, &b.verts.cx, &b.verts.cy };
+    return arrays[k];
+}
+
+static std::vector<double>* stateArray(struct bodySoA* b, size_t k) {
+    return const_cast<std::vector<double>*>(stateArray(*b, k));
+}
+
+static uint64_t startBytes(uint64_t bodies, uint32_t version) {
+    return sizeof(traceHeader) + (version >= 3 ? sizeof(traceMotion) : 0) + (version >= 4 ? sizeof(traceSleep) : 0)
+        + stateArrays * bodies * sizeof(double);
+}
+
+static uint64_t bitsOf(double v) {
+    uint64_t u;
+    std::memcpy(&u, &v, sizeof(u));
+    return u;
+}
+
+static double fromBits(uint64_t u) {
+    double v;
+    std::memcpy(&v, &u, sizeof(v));
+    return v;
+}
+
+/// <summary>
+/// The values of the step a record is delta encoded against: positions and angle advanced by the
+/// previous velocities exactly like the integrator does it, the other quantities unchanged
+/// </summary>
+static double predict(const std::vector<double>* prev, size_t field, size_t i, double dt) {
+    switch (field) {
+    case 0: return prev[0][i] + prev[4][i] * dt;
+    case 1: return prev[1][i] + prev[5][i] * dt;
+    case 2: return prev[2][i] + prev[6][i] * dt;
+    default: return prev[field][i];
+    }
+}
+
+static const std::vector<double>& recorded(const bodySoA& b, size_t field) {
+    const std::vector<double>* fields[7] = { &b.x, &b.y, &b.phi, &b.len, &b.vx, &b.vy, &b.omega };
+    return *fields[field];
+}
+
+static uint8_t* putVarint(uint8_t* p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static bool getVarint(const uint8_t** p, const uint8_t* end, uint64_t* v) {
+    uint64_t r = 0;
+    for (int shift = 0; shift < 64 && *p < end; shift += 7) {
+        uint8_t c = *(*p)++;
+        r |= (uint64_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            *v = r;
+            return true;
+        }
+    }
+    return false;
+}
+
+#if defined(_WIN32)
+static bool mapSegment(struct traceWriter* w) {
+    const uint64_t end = (w->segmentIndex + 1) * w->segment, offset = w->segmentIndex * w->segment;
+    HANDLE mapping = CreateFileMappingA((HANDLE)w->file, nullptr, PAGE_READWRITE, (DWORD)(end >> 32), (DWORD)end, nullptr);
+    if (!mapping)
+        return false;
+    w->map = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_WRITE, (DWORD)(offset >> 32), (DWORD)offset, (SIZE_T)w->segment);
+    CloseHandle(mapping);
+    return w->map != nullptr;
+}
+
+static void unmapSegment(struct traceWriter* w) {
+    if (w->map)
+        UnmapViewOfFile(w->map);
+    w->map = nullptr;
+}
+
+static bool createFile(struct traceWriter* w, const char* path) {
+    HANDLE f = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    w->file = f == INVALID_HANDLE_VALUE ? nullptr : f;
+    return w->file != nullptr;
+}
+
+static bool finishFile(struct traceWriter* w, uint64_t used) {
+    LARGE_INTEGER at;
+    at.QuadPart = (LONGLONG)used;
+    bool ok = SetFilePointerEx((HANDLE)w->file, at, nullptr, FILE_BEGIN) && SetEndOfFile((HANDLE)w->file);
+    at.QuadPart = 0;
+    DWORD written = 0;
+    ok = ok && SetFilePointerEx((HANDLE)w->file, at, nullptr, FILE_BEGIN)
+        && WriteFile((HANDLE)w->file, &w->header, sizeof(w->header), &written, nullptr) && written == sizeof(w->header);
+    CloseHandle((HANDLE)w->file);
+    w->file = nullptr;
+    return ok;
+}
+#else
+static bool mapSegment(struct traceWriter* w) {
+    const uint64_t end = (w->segmentIndex + 1) * w->segment, offset = w->segmentIndex * w->segment;
+    if (ftruncate(w->file, (off_t)end) != 0)
+        return false;
+    void* p = mmap(nullptr, w->segment, PROT_READ | PROT_WRITE, MAP_SHARED, w->file, (off_t)offset);
+    w->map = p == MAP_FAILED ? nullptr : (uint8_t*)p;
+    return w->map != nullptr;
+}
+
+static void unmapSegment(struct traceWriter* w) {
+    if (w->map)
+        munmap(w->map, w->segment);
+    w->map = nullptr;
+}
+
+static bool createFile(struct traceWriter* w, const char* path) {
+    w->file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    return w->file >= 0;
+}
+
+static bool finishFile(struct traceWriter* w, uint64_t used) {
+    bool ok = ftruncate(w->file, (off_t)used) == 0
+        && pwrite(w->file, &w->header, sizeof(w->header), 0) == (ssize_t)sizeof(w->header);
+    ok &= close(w->file) == 0;
+    w->file = -1;
+    return ok;
+}
+#endif
+
+/// <summary>
+/// Makes room for a record of the given size, moving on to the next segment if the current one is too full
+/// </summary>
+static bool reserve(struct traceWriter* w, uint64_t bytes) {
+    if (w->failed)
+        return false;
+    if (w->pos + bytes <= w->segment)
+        return true;
+    unmapSegment(w);
+    w->segmentIndex++;
+    w->pos = 0;
+    w->failed = !mapSegment(w);
+    return !w->failed;
+}
+
+/// <summary>
+/// Creates a trace file and writes the current state of the scene as its start
+/// </summary>
+/// <param name="w">a traceWriter that is not open</param>
+/// <param name="path">the file, replaced if it exists</param>
+/// <param name="sc">the scene to be recorded</param>
+/// <returns>false if the file could not be created or mapped</returns>
+bool traceOpen(struct traceWriter* w, const char* path, struct scene* sc) {
+    sleepReset(&sc->sleeping, sc->bodies.count);
+    const bodySoA& b = sc->bodies;
+    /* a step record holds at most seven 10 byte varints per body */
+    w->maxRecord = 1 + 7 * 10 * (uint64_t)b.count;
+    const uint64_t start = startBytes(b.count, traceVersion);
+    w->segment = (std::max(16 * megabyte, start + 4 * w->maxRecord) + megabyte - 1) / megabyte * megabyte;
+    w->segmentIndex = 0;
+    w->pos = 0;
+    w->seconds = 0;
+    w->failed = true;
+    if (!createFile(w, path))
+        return false;
+    if (!mapSegment(w)) {
+        finishFile(w, 0);
+        return false;
+    }
+    w->failed = false;
+
+    traceHeader& h = w->header;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, "GLTR", 4);
+    h.version = traceVersion;
+    h.bodies = b.count;
+    h.segment = w->segment;
+    h.firstStep = sc->steps;
+    h.breite = sc->breite;
+    h.hoehe = sc->hoehe;
+    h.dt = sc->dt;
+    h.boundary = sc->cfg.boundary;
+    h.response = sc->cfg.response;
+    h.iterations = sc->cfg.iterations;
+    std::memcpy(w->map, &h, sizeof(h));
+    w->pos = sizeof(h);
+    const integratorConfig& ic = sc->cfg.integrator;
+    const traceMotion m = { (int32_t)ic.kind, ic.maxSubsteps, ic.gravityX, ic.gravityY, ic.drag, ic.maxTravel };
+    std::memcpy(w->map + w->pos, &m, sizeof(m));
+    w->pos += sizeof(m);
+    const sleepConfig& sl = sc->cfg.sleep;
+    const traceSleep z = { sl.enabled ? 1 : 0, 0, sl.linear, sl.angular, sl.time };
+    std::memcpy(w->map + w->pos, &z, sizeof(z));
+    w->pos += sizeof(z);
+    for (size_t k = 0; k < stateArrays; k++) {
+        std::memcpy(w->map + w->pos, stateArray(b, k)->data(), b.count * sizeof(double));
+        w->pos += b.count * sizeof(double);
+    }
+    for (size_t f = 0; f < 7; f++)
+        w->prev[f] = recorded(b, f);
+    return true;
+}
+
+/// <summary>
+/// Records a command that has just been applied to the scene with sceneApply
+/// </summary>
+/// <param name="w">an open traceWriter</param>
+/// <param name="cmd">the command</param>
+/// <returns>false if the file could not be extended</returns>
+bool traceCommand(struct traceWriter* w, const simCommand& cmd) {
+    if (!reserve(w, 1 + commandBytes))
+        return false;
+    uint8_t* p = w->map + w->pos;
+    const bodySelection& s = cmd.select;
+    const uint64_t range[2] = { s.first, s.count };
+    const double values[5] = { cmd.value, s.lox, s.loy, s.hix, s.hiy };
+    p[0] = TAG_COMMAND;
+    p[1] = (uint8_t)cmd.kind;
+    p[2] = (uint8_t)s.kind;
+    std::memcpy(p + 3, range, sizeof(range));
+    std::memcpy(p + 3 + sizeof(range), values, sizeof(values));
+    w->pos += 1 + commandBytes;
+    return true;
+}
+
+/// <summary>
+/// Records the state of the scene after a step
+/// </summary>
+/// <param name="w">an open traceWriter</param>
+/// <param name="sc">the scene that was just stepped</param>
+/// <returns>false if the file could not be extended</returns>
+bool traceStep(struct traceWriter* w, const scene& sc) {
+    auto t0 = std::chrono::steady_clock::now();
+    if (!reserve(w, w->maxRecord))
+        return false;
+    uint8_t* p = w->map + w->pos;
+    *p++ = TAG_STEP;
+    const size_t n = sc.bodies.count;
+    /* all predictions use last step's values, so the fields are written first and remembered afterwards */
+    for (size_t f = 0; f < 7; f++) {
+        const std::vector<double>& now = recorded(sc.bodies, f);
+        for (size_t i = 0; i < n; i++)
+            p = putVarint(p, bitsOf(now[i]) ^ bitsOf(predict(w->prev, f, i, sc.dt)));
+    }
+    for (size_t f = 0; f < 7; f++)
+        std::copy(recorded(sc.bodies, f).begin(), recorded(sc.bodies, f).end(), w->prev[f].begin());
+    w->pos = p - w->map;
+    w->header.steps++;
+    w->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return true;
+}
+
+/// <summary>
+/// Size of everything written so far
+/// </summary>
+/// <param name="w">an open traceWriter</param>
+/// <returns>bytes</returns>
+uint64_t traceBytes(const traceWriter& w) {
+    return w.segmentIndex * w.segment + w.pos;
+}
+
+/// <summary>
+/// Finishes the trace: writes the end marker and the step count and cuts the file to its used size
+/// </summary>
+/// <param name="w">an open traceWriter, closed afterwards</param>
+/// <returns>false on a write error, now or in an earlier record</returns>
+bool traceClose(struct traceWriter* w) {
+    bool ok = reserve(w, 1);
+    if (ok)
+        w->map[w->pos++] = TAG_END;
+    const uint64_t used = traceBytes(*w);
+    unmapSegment(w);
+    ok &= finishFile(w, used);
+    return ok;
+}
+
+/// <summary>
+/// Rebuilds the scene stored in a trace and runs it again as fast as possible, applying the recorded
+/// commands before the same steps as during recording. After every step the replayed state is compared
+/// bit for bit with the recorded one.
+/// </summary>
+/// <param name="path">the trace file</param>
+/// <param name="sc">receives the scene, a pool set on it is kept and used</param>
+/// <param name="stats">receives steps, commands, mismatches and the time taken</param>
+/// <returns>false if the file is missing, not a trace or cut short</returns>
+bool traceReplay(const char* path, struct scene* sc, struct replayStats* stats) {
+    uint64_t size = 0;
+    const uint8_t* data = mapRead(path, &size);
+    if (!data)
+        return false;
+    traceHeader h;
+    bool ok = size >= sizeof(h);
+    if (ok) {
+        std::memcpy(&h, data, sizeof(h));
+        ok = !std::memcmp(h.magic, "GLTR", 4) && h.version >= 1 && h.version <= traceVersion && h.segment > 0
+            && size >= startBytes(h.bodies, h.version);
+    }
+    if (!ok) {
+        mapRelease(data, size);
+        return false;
+    }
+
+    sceneConfig cfg;
+    cfg.boundary = (boundaryMode)h.boundary;
+    cfg.response = (responseMode)h.response;
+    cfg.iterations = h.iterations;
+    cfg.integrator.maxSubsteps = 1;
+    cfg.sleep.enabled = false;
+    const uint8_t* p = data + sizeof(h);
+    if (h.version >= 3) {
+        traceMotion m;
+        std::memcpy(&m, p, sizeof(m));
+        p += sizeof(m);
+        cfg.integrator.kind = (integratorKind)m.kind;
+        cfg.integrator.maxSubsteps = m.maxSubsteps;
+        cfg.integrator.gravityX = m.gravityX;
+        cfg.integrator.gravityY = m.gravityY;
+        cfg.integrator.drag = m.drag;
+        cfg.integrator.maxTravel = m.maxTravel;
+    }
+    if (h.version >= 4) {
+        traceSleep z;
+        std::memcpy(&z, p, sizeof(z));
+        p += sizeof(z);
+        cfg.sleep.enabled = z.enabled != 0;
+        cfg.sleep.linear = z.linear;
+        cfg.sleep.angular = z.angular;
+        cfg.sleep.time = z.time;
+    }
+    jobPool* pool = sc->pool;
+    *sc = makeScene(h.breite, h.hoehe, h.dt, cfg);
+    sc->pool = pool;
+    sc->steps = h.firstStep;
+    bodySoA* b = &sc->bodies;
+    b->count = (size_t)h.bodies;
+    for (size_t k = 0; k < stateArrays; k++) {
+        std::vector<double>* a = stateArray(b, k);
+        a->resize(b->count);
+        std::memcpy(a->data(), p, b->count * sizeof(double));
+        p += b->count * sizeof(double);
+    }
+    std::vector<double> prev[7], next[7];
+    for (size_t f = 0; f < 7; f++) {
+        prev[f] = recorded(*b, f);
+        next[f].resize(b->count);
+    }
+
+    *stats = replayStats();
+    const uint8_t* end = data + size;
+    bool finished = false;
+    auto t0 = std::chrono::steady_clock::now();
+    while (ok && !finished && p < end) {
+        switch (*p++) {
+        case TAG_NEXT_SEGMENT: {
+            const uint64_t at = (uint64_t)(p - data);
+            p = data + std::min(size, (at + h.segment - 1) / h.segment * h.segment);
+            break;
+        }
+        case TAG_COMMAND: {
+            const size_t bytes = h.version == 1 ? 1 + sizeof(double) : commandBytes;
+            ok = end - p >= (ptrdiff_t)bytes;
+            if (!ok)
+                break;
+            simCommand cmd;
+            cmd.kind = (commandKind)p[0];
+            if (h.version == 1)
+                std::memcpy(&cmd.value, p + 1, sizeof(double));
+            else {
+                uint64_t range[2];
+                double values[5];
+                std::memcpy(range, p + 2, sizeof(range));
+                std::memcpy(values, p + 2 + sizeof(range), sizeof(values));
+                cmd.select.kind = (selectKind)p[1];
+                cmd.select.first = (size_t)range[0];
+                cmd.select.count = (size_t)range[1];
+                cmd.value = values[0];
+                cmd.select.lox = values[1];
+                cmd.select.loy = values[2];
+                cmd.select.hix = values[3];
+                cmd.select.hiy = values[4];
+            }
+            p += bytes;
+            sceneApply(sc, cmd);
+            stats->commands++;
+            break;
+        }
+        case TAG_STEP: {
+            sceneStep(sc);
+            long long wrong = 0;
+            for (size_t f = 0; f < 7 && ok; f++) {
+                const std::vector<double>& now = recorded(*b, f);
+                for (size_t i = 0; i < b->count && ok; i++) {
+                    uint64_t x = 0;
+                    ok = getVarint(&p, end, &x);
+                    next[f][i] = fromBits(x ^ bitsOf(predict(prev, f, i, h.dt)));
+                    wrong += bitsOf(next[f][i]) != bitsOf(now[i]);
+                }
+            }
+            /* the next step is decoded against the recording, not against the replay */
+            for (size_t f = 0; f < 7; f++)
+                prev[f].swap(next[f]);
+            if (wrong && stats->firstMismatch < 0)
+                stats->firstMismatch = stats->steps;
+            stats->mismatches += wrong;
+            stats->steps++;
+            break;
+        }
+        case TAG_END:
+            finished = true;
+            break;
+        default:
+            ok = false;
+        }
+    }
+    stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    mapRelease(data, size);
+    return ok && finished;
+}
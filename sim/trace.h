@@ -0,0 +1,129 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "handoff.h"
+#include "scene.h"
+
+/// <summary>
+/// Fixed part at the start of a trace file. It is followed by the integrator and sleep settings (traceMotion, traceSleep), the initial state of the scene (every array
+/// of the body store including the cached vertices, count doubles each) and then by the records. Values are stored
+/// in the byte order of the machine that wrote the trace.
+/// </summary>
+struct traceHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t bodies;
+    uint64_t steps;
+    uint64_t segment;
+    int64_t firstStep;
+    double breite, hoehe, dt;
+    int32_t boundary, response, iterations;
+    uint32_t reserved;
+};
+
+/// <summary>
+/// Integrator settings of the scene, stored right after the header since version 3
+/// </summary>
+struct traceMotion {
+    int32_t kind, maxSubsteps;
+    double gravityX, gravityY, drag, maxTravel;
+};
+
+/// <summary>
+/// Sleep settings of the scene, stored after traceMotion since version 4
+/// </summary>
+struct traceSleep {
+    int32_t enabled, reserved;
+    double linear, angular, time;
+};
+
+/// <summary>
+/// Records a scene into a memory-mapped trace file: every command applied to it and the state after
+/// every step. The state is delta encoded against a prediction from the previous step (positions moved
+/// by their velocities, everything else unchanged); the XOR of the bits of actual and predicted value is
+/// written as a variable length integer, so an undisturbed body costs one byte per quantity.
+/// The file is mapped in segments of a fixed size, so a step costs the encoding and at most
+/// one remap, never a copy of what was written before. Once a segment can not be mapped, failed is set and
+/// every later record fails without touching the file; traceClose still finishes what was written.
+/// </summary>
+struct traceWriter {
+#if defined(_WIN32)
+    void* file = nullptr;
+#else
+    int file = -1;
+#endif
+    uint8_t* map = nullptr;
+    uint64_t segment = 0;
+    uint64_t segmentIndex = 0;
+    uint64_t pos = 0;
+    uint64_t maxRecord = 0;
+    bool failed = false;
+    traceHeader header;
+    std::vector<double> prev[7];
+    double seconds = 0;
+};
+
+/// <summary>
+/// Outcome of a replay. mismatches counts recorded values the replayed scene does not reproduce
+/// bit for bit, firstMismatch is the step they first appeared in, -1 if there were none.
+/// </summary>
+struct replayStats {
+    long long steps = 0;
+    long long commands = 0;
+    long long mismatches = 0;
+    long long firstMismatch = -1;
+    double seconds = 0;
+};
+
+/// <summary>
+/// Creates a trace file and writes the current state of the scene as its start. Sleeping bodies are woken
+/// first, a replay starts with every body awake.
+/// </summary>
+/// <param name="w">a traceWriter that is not open</param>
+/// <param name="path">the file, replaced if it exists</param>
+/// <param name="sc">the scene to be recorded</param>
+/// <returns>false if the file could not be created or mapped</returns>
+bool traceOpen(struct traceWriter* w, const char* path, struct scene* sc);
+
+/// <summary>
+/// Records a command that has just been applied to the scene with sceneApply
+/// </summary>
+/// <param name="w">an open traceWriter</param>
+/// <param name="cmd">the command</param>
+/// <returns>false if the file could not be extended</returns>
+bool traceCommand(struct traceWriter* w, const simCommand& cmd);
+
+/// <summary>
+/// Records the state of the scene after a step
+/// </summary>
+/// <param name="w">an open traceWriter</param>
+/// <param name="sc">the scene that was just stepped</param>
+/// <returns>false if the file could not be extended</returns>
+bool traceStep(struct traceWriter* w, const scene& sc);
+
+/// <summary>
+/// Finishes the trace: writes the end marker and the step count and cuts the file to its used size
+/// </summary>
+/// <param name="w">an open traceWriter, closed afterwards</param>
+/// <returns>false on a write error, now or in an earlier record</returns>
+bool traceClose(struct traceWriter* w);
+
+/// <summary>
+/// Size of everything written so far
+/// </summary>
+/// <param name="w">an open traceWriter</param>
+/// <returns>bytes</returns>
+uint64_t traceBytes(const traceWriter& w);
+
+/// <summary>
+/// Rebuilds the scene stored in a trace and runs it again as fast as possible, applying the recorded
+/// commands before the same steps as during recording. After every step the replayed state is compared
+/// bit for bit with the recorded one.
+/// </summary>
+/// <param name="path">the trace file</param>
+/// <param name="sc">receives the scene, a pool set on it is kept and used</param>
+/// <param name="stats">receives steps, commands, mismatches and the time taken</param>
+/// <returns>false if the file is missing, not a trace or cut short</returns>
+bool traceReplay(const char* path, struct scene* sc, struct replayStats* stats);
@@ -0,0 +1,2774 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#if !defined(_WIN32)
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+#include "bodypool.h"
+#include "checkpoint.h"
+#include "commands.h"
+#include "dirty.h"
+#include "handoff.h"
+#include "image.h"
+#include "instances.h"
+#include "integrator.h"
+#include "mapfile.h"
+#include "narrowphase.h"
+#include "polygon.h"
+#include "precision.h"
+#include "profile.h"
+#include "scene.h"
+#include "sim.h"
+#include "simthread.h"
+#include "soa.h"
+#include "softraster.h"
+#include "sweep.h"
+#include "trace.h"
+
+/* heap allocations made by a thread while its countAllocations is set, to prove that a code path does not allocate */
+static std::atomic<size_t> allocations{ 0 };
+static thread_local bool countAllocations = false;
+
+void* operator new(size_t n) {
+    if (countAllocations)
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+/// <summary>
+/// Benchmark settings, filled from the command line
+/// </summary>
+struct benchArgs {
+    size_t bodies = 1000;
+    long long steps = 2000;
+    long long warmup = 100;
+    double dt = 1.0 / 120;
+    double len = 20;
+    unsigned seed = 1;
+    bool soa = false;
+    bool scene = false;
+    bool verify = false;
+    bool diff = false;
+    bool pairs = false;
+    bool contacts = false;
+    bool scaling = false;
+    bool handoff = false;
+    bool pack = false;
+    bool raster = false;
+    bool dirty = false;
+    bool churn = false;
+    bool input = false;
+    bool poly = false;
+    bool precision = false;
+    bool substep = false;
+    bool sleep = false;
+    int width = 1280;
+    int height = 720;
+    const char* out = nullptr;
+    const char* record = nullptr;
+    const char* replay = nullptr;
+    const char* script = nullptr;
+    const char* profile = nullptr;
+    const char* chrome = nullptr;
+    const char* checkpoint = nullptr;
+    const char* restore = nullptr;
+    const char* sweep = nullptr;
+    const char* columns = nullptr;
+    const char* suite = nullptr;
+    int forks = 4;
+    imageFormat format = IMAGE_PPM;
+    double seconds = 2;
+    double fps = 60;
+    unsigned threads = 1;
+    double restitution = 1;
+    double friction = 0;
+    rotMode mode = ROT_VERTEX;
+    boundaryMode boundary = BOUNDARY_DISCRETE;
+    integratorConfig integrator;
+    sleepConfig sleepCfg;
+};
+
+static void usage(const char* prog) {
+    std::printf("usage: %s [--bodies N] [--steps N] [--warmup N] [--dt SECONDS] [--len PX] [--seed N]\n"
+        "          [--layout aos|soa|scene] [--rot vertex|pose] [--boundary discrete|swept]\n"
+        "          [--restitution E] [--friction MU] [--threads N] [--seconds S] [--fps N]\n"
+        "          [--width PX] [--height PX] [--out PATTERN|-] [--format ppm|png|raw]\n"
+        "          [--record FILE] [--replay FILE] [--script FILE] [--profile FILE.json] [--chrome FILE.json]\n"
+        "          [--checkpoint FILE] [--forks N] [--restore FILE] [--sweep SPEC] [--columns FILE]\n"
+        "          [--verify] [--suite NAME] [--diff] [--pairs] [--contacts] [--scaling] [--handoff] [--pack]\n"
+        "          [--raster] [--churn]\n"
+        "          [--integrator euler|verlet|rk4] [--gravity G] [--drag C] [--substeps N]\n"
+        "          [--sleep-linear V] [--sleep-angular W] [--sleep-time S] [--no-sleep]\n"
+        "          [--input] [--poly] [--precision] [--substep] [--sleep] [--dirty]\n", prog);
+}
+
+/// <summary>
+/// Parses the command line into a benchArgs object
+/// </summary>
+/// <returns>false if an argument is unknown or lacks its value</returns>
+static bool parseArgs(int argc, char** argv, benchArgs* args) {
+    /* options without a value, each sets its flag */
+    static const struct {
+        const char* name;
+        bool benchArgs::* flag;
+    } flags[] = { { "--verify", &benchArgs::verify }, { "--diff", &benchArgs::diff }, { "--pairs", &benchArgs::pairs },
+        { "--contacts", &benchArgs::contacts }, { "--scaling", &benchArgs::scaling }, { "--handoff", &benchArgs::handoff },
+        { "--pack", &benchArgs::pack }, { "--raster", &benchArgs::raster }, { "--dirty", &benchArgs::dirty },
+        { "--churn", &benchArgs::churn }, { "--input", &benchArgs::input }, { "--poly", &benchArgs::poly },
+        { "--precision", &benchArgs::precision }, { "--substep", &benchArgs::substep }, { "--sleep", &benchArgs::sleep } };
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool isFlag = false;
+        for (const auto& f : flags)
+            if (!std::strcmp(a, f.name)) {
+                args->*f.flag = true;
+                isFlag = true;
+            }
+        if (isFlag)
+            continue;
+        if (!std::strcmp(a, "--no-sleep")) {
+            args->sleepCfg.enabled = false;
+            continue;
+        }
+        if (i + 1 >= argc)
+            return false;
+        const char* v = argv[++i];
+        if (!std::strcmp(a, "--bodies"))
+            args->bodies = std::strtoull(v, nullptr, 10);
+        else if (!std::strcmp(a, "--steps"))
+            args->steps = std::strtoll(v, nullptr, 10);
+        else if (!std::strcmp(a, "--warmup"))
+            args->warmup = std::strtoll(v, nullptr, 10);
+        else if (!std::strcmp(a, "--dt"))
+            args->dt = std::strtod(v, nullptr);
+        else if (!std::strcmp(a, "--len"))
+            args->len = std::strtod(v, nullptr);
+        else if (!std::strcmp(a, "--seed"))
+            args->seed = (unsigned)std::strtoul(v, nullptr, 10);
+        else if (!std::strcmp(a, "--layout") && (!std::strcmp(v, "aos") || !std::strcmp(v, "soa") || !std::strcmp(v, "scene"))) {
+            args->soa = !std::strcmp(v, "soa");
+            args->scene = !std::strcmp(v, "scene");
+        }
+        else if (!std::strcmp(a, "--restitution"))
+            args->restitution = std::strtod(v, nullptr);
+        else if (!std::strcmp(a, "--friction"))
+            args->friction = std::strtod(v, nullptr);
+        else if (!std::strcmp(a, "--threads"))
+            args->threads = (unsigned)std::strtoul(v, nullptr, 10);
+        else if (!std::strcmp(a, "--seconds"))
+            args->seconds = std::strtod(v, nullptr);
+        else if (!std::strcmp(a, "--fps"))
+            args->fps = std::strtod(v, nullptr);
+        else if (!std::strcmp(a, "--width"))
+            args->width = std::atoi(v);
+        else if (!std::strcmp(a, "--height"))
+            args->height = std::atoi(v);
+        else if (!std::strcmp(a, "--out"))
+            args->out = v;
+        else if (!std::strcmp(a, "--record")) {
+            args->record = v;
+            args->scene = true;
+            args->soa = false;
+        }
+        else if (!std::strcmp(a, "--replay"))
+            args->replay = v;
+        else if (!std::strcmp(a, "--checkpoint"))
+            args->checkpoint = v;
+        else if (!std::strcmp(a, "--sweep"))
+            args->sweep = v;
+        else if (!std::strcmp(a, "--columns"))
+            args->columns = v;
+        else if (!std::strcmp(a, "--suite")) {
+            args->suite = v;
+            args->verify = true;
+        }
+        else if (!std::strcmp(a, "--forks"))
+            args->forks = std::atoi(v);
+        else if (!std::strcmp(a, "--restore")) {
+            args->restore = v;
+            args->scene = true;
+            args->soa = false;
+        }
+        else if (!std::strcmp(a, "--script"))
+            args->script = v;
+        else if (!std::strcmp(a, "--profile"))
+            args->profile = v;
+        else if (!std::strcmp(a, "--chrome"))
+            args->chrome = v;
+        else if (!std::strcmp(a, "--format") && (!std::strcmp(v, "ppm") || !std::strcmp(v, "png") || !std::strcmp(v, "raw")))
+            args->format = !std::strcmp(v, "png") ? IMAGE_PNG : !std::strcmp(v, "raw") ? IMAGE_RAW : IMAGE_PPM;
+        else if (!std::strcmp(a, "--rot") && (!std::strcmp(v, "vertex") || !std::strcmp(v, "pose")))
+            args->mode = !std::strcmp(v, "pose") ? ROT_POSE : ROT_VERTEX;
+        else if (!std::strcmp(a, "--boundary") && (!std::strcmp(v, "discrete") || !std::strcmp(v, "swept")))
+            args->boundary = !std::strcmp(v, "swept") ? BOUNDARY_SWEPT : BOUNDARY_DISCRETE;
+        else if (!std::strcmp(a, "--integrator") && (!std::strcmp(v, "euler") || !std::strcmp(v, "verlet") || !std::strcmp(v, "rk4")))
+            args->integrator.kind = !std::strcmp(v, "rk4") ? INTEGRATE_RK4 : !std::strcmp(v, "verlet") ? INTEGRATE_VERLET : INTEGRATE_EULER;
+        else if (!std::strcmp(a, "--gravity"))
+            args->integrator.gravityY = -std::strtod(v, nullptr);
+        else if (!std::strcmp(a, "--drag"))
+            args->integrator.drag = std::strtod(v, nullptr);
+        else if (!std::strcmp(a, "--substeps"))
+            args->integrator.maxSubsteps = std::atoi(v);
+        else if (!std::strcmp(a, "--sleep-linear"))
+            args->sleepCfg.linear = std::strtod(v, nullptr);
+        else if (!std::strcmp(a, "--sleep-angular"))
+            args->sleepCfg.angular = std::strtod(v, nullptr);
+        else if (!std::strcmp(a, "--sleep-time"))
+            args->sleepCfg.time = std::strtod(v, nullptr);
+        else
+            return false;
+    }
+    return true;
+}
+
+/// <summary>
+/// Sums up all vertex coordinates so the compiler can not drop the simulated work
+/// </summary>
+static double checksum(const world& w) {
+    double s = 0;
+    for (const body& b : w.bodies)
+        s += b.tri.aA.x + b.tri.aA.y + b.tri.bB.x + b.tri.bB.y + b.tri.cC.x + b.tri.cC.y;
+    return s;
+}
+
+static double checksum(const bodySoA& soa) {
+    double s = 0;
+    for (size_t i = 0; i < soa.count; i++) {
+        triangle t = soaTriangle(soa, i);
+        s += t.aA.x + t.aA.y + t.bB.x + t.bB.y + t.cC.x + t.cC.y;
+    }
+    return s;
+}
+
+/// <summary>
+/// Largest coordinate difference between two triangles
+/// </summary>
+static double triDiff(const triangle& p, const triangle& q) {
+    const vertex* a[4] = { &p.aA, &p.bB, &p.cC, &p.zZ };
+    const vertex* b[4] = { &q.aA, &q.bB, &q.cC, &q.zZ };
+    double d = 0;
+    for (int k = 0; k < 4; k++)
+        d = fmax(d, fmax(fabs(a[k]->x - b[k]->x), fabs(a[k]->y - b[k]->y)));
+    return d;
+}
+
+/// <summary>
+/// True if two body stores hold the same bodies bit for bit, velocities and cached vertices included
+/// </summary>
+static bool sameBodies(const bodySoA& a, const bodySoA& b) {
+    const std::vector<double>* pa[13] = { &a.x, &a.y, &a.phi, &a.len, &a.vx, &a.vy, &a.omega,
+        &a.verts.ax, &a.verts.ay, &a.verts.bx, &a.verts.by, &a.verts.cx, &a.verts.cy };
+    const std::vector<double>* pb[13] = { &b.x, &b.y, &b.phi, &b.len, &b.vx, &b.vy, &b.omega,
+        &b.verts.ax, &b.verts.ay, &b.verts.bx, &b.verts.by, &b.verts.cx, &b.verts.cy };
+    bool same = a.count == b.count;
+    for (int k = 0; k < 13 && same; k++)
+        same = !std::memcmp(pa[k]->data(), pb[k]->data(), a.count * sizeof(double));
+    return same;
+}
+
+static bool report(const char* what, double err, double tol) {
+    bool ok = err <= tol;
+    std::printf("%-34s max err %.3e (tol %.1e) %s\n", what, err, tol, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+/// <summary>
+/// A command stream for the input checks when no --script is given: resizes of all bodies, of a box
+/// and of an index range, some of them at the same time so they fold, and spins in between
+/// </summary>
+static commandScript builtinScript(const benchArgs& args) {
+    commandScript script;
+    for (int i = 0; i < 300; i++) {
+        simCommand cmd = { i % 3 == 2 ? CMD_SPIN : CMD_RESIZE, i % 3 == 2 ? 0.2 : i % 2 ? 1.05 : 1 / 1.04, (i / 2) * 0.0137, {} };
+        if (i % 5 == 1) {
+            cmd.select.kind = SELECT_BOX;
+            cmd.select.lox = -400;
+            cmd.select.loy = -300;
+            cmd.select.hix = 200;
+            cmd.select.hiy = 250;
+        }
+        else if (i % 5 == 3) {
+            cmd.select.kind = SELECT_RANGE;
+            cmd.select.first = args.bodies / 4;
+            cmd.select.count = args.bodies / 2;
+        }
+        script.commands.push_back(cmd);
+    }
+    return script;
+}
+
+/// <summary>
+/// Runs a script through a command ring the way the viewer does, on one thread: a renderer at fps frames
+/// per second feeds the ring, and before every step the physics drains the commands that are due.
+/// </summary>
+/// <param name="applied">receives the number of commands applied after folding</param>
+static scene runScript(const benchArgs& args, commandScript script, double fps, size_t* applied) {
+    scene sc = makeScene(1280, 720, args.dt);
+    sceneSpawn(&sc, args.bodies, args.len, args.seed);
+    commandRing ring;
+    double nextFrame = 0;
+    *applied = 0;
+    for (long long k = 0; k < args.steps; k++) {
+        /* the frames shown before the clock reaches the end of this step */
+        for (; nextFrame <= (k + 1) * args.dt; nextFrame += 1 / fps)
+            scriptFeed(&script, &ring);
+        *applied += commandDrain(&ring, &sc, (k + 1) * args.dt, nullptr);
+        sceneStep(&sc);
+    }
+    return sc;
+}
+
+/// <summary>
+/// The bodies most checks start from: 1003 random bodies, a tail that does not fill a whole SIMD register,
+/// spinning at up to two turns per second
+/// </summary>
+static world verifyWorld(const benchArgs& args) {
+    world w = makeWorld(1280, 720, args.dt);
+    worldSpawn(&w, 1003, args.len, args.seed);
+    std::default_random_engine re(args.seed);
+    std::uniform_real_distribution<double> om(-4 * 3.14159265358979, 4 * 3.14159265358979);
+    for (body& b : w.bodies)
+        b.omega = om(re);
+    return w;
+}
+
+/// <summary>
+/// Checks the vectorized SoA kernels against their scalar fallbacks and against triRotate, triTranslate
+/// and triResize for a set of random bodies, including a tail that does not fill a whole SIMD register
+/// </summary>
+/// <returns>true if every kernel is within tolerance</returns>
+static bool verifyKernels(const benchArgs& args) {
+    world w = verifyWorld(args);
+    const world base = w;
+
+    bodySoA simd, scalar;
+    soaFromWorld(&simd, w);
+    soaFromWorld(&scalar, w);
+    bool ok = true;
+    std::printf("kernels: %s\n", soaKernelName());
+
+    double err = 0, errLegacy = 0, tolLegacy = 0;
+    soaRotate(&simd, args.dt);
+    soaRotateScalar(&scalar, args.dt);
+    for (size_t i = 0; i < w.bodies.size(); i++)
+        err = fmax(err, fabs(simd.phi[i] - scalar.phi[i]));
+    ok &= report("rotate simd vs scalar", err, 1e-12);
+
+    err = 0;
+    soaVertices(&simd);
+    soaVerticesScalar(&scalar);
+    for (size_t i = 0; i < w.bodies.size(); i++) {
+        body& b = w.bodies[i];
+        triRotate(&b.tri, b.omega * args.dt);
+        const vertexSoA& p = simd.verts, & q = scalar.verts;
+        err = fmax(err, fmax(fabs(p.ax[i] - q.ax[i]), fabs(p.ay[i] - q.ay[i])));
+        err = fmax(err, fmax(fabs(p.bx[i] - q.bx[i]), fabs(p.by[i] - q.by[i])));
+        err = fmax(err, fmax(fabs(p.cx[i] - q.cx[i]), fabs(p.cy[i] - q.cy[i])));
+        errLegacy = fmax(errLegacy, triDiff(soaTriangle(scalar, i), b.tri));
+        /* triRotate feeds the rotated x into the y formula, which costs O(r * phi^2) per call */
+        double phi = b.omega * args.dt;
+        tolLegacy = fmax(tolLegacy, 2 * args.len * phi * phi + 1e-9);
+    }
+    ok &= report("vertices simd vs scalar", err, 1e-9);
+    ok &= report("rotated pose vs triRotate", errLegacy, tolLegacy);
+
+    w = base;
+    soaFromWorld(&simd, w);
+    soaFromWorld(&scalar, w);
+    soaTranslate(&simd, args.dt);
+    soaTranslateScalar(&scalar, args.dt);
+    err = errLegacy = 0;
+    for (size_t i = 0; i < w.bodies.size(); i++) {
+        body& b = w.bodies[i];
+        triTranslate(&b.tri, { b.velo.x * args.dt, b.velo.y * args.dt });
+        err = fmax(err, triDiff(soaTriangle(simd, i), soaTriangle(scalar, i)));
+        errLegacy = fmax(errLegacy, triDiff(soaTriangle(scalar, i), b.tri));
+    }
+    ok &= report("translate simd vs scalar", err, 1e-9);
+    ok &= report("translate scalar vs triTranslate", errLegacy, 1e-9);
+
+    w = base;
+    soaFromWorld(&simd, w);
+    soaFromWorld(&scalar, w);
+    soaResize(&simd, 1.1);
+    soaResizeScalar(&scalar, 1.1);
+    err = errLegacy = 0;
+    for (size_t i = 0; i < w.bodies.size(); i++) {
+        body& b = w.bodies[i];
+        triResize(&b.tri, 1.1);
+        err = fmax(err, triDiff(soaTriangle(simd, i), soaTriangle(scalar, i)));
+        errLegacy = fmax(errLegacy, triDiff(soaTriangle(scalar, i), b.tri));
+    }
+    ok &= report("resize simd vs scalar", err, 1e-9);
+    ok &= report("resize scalar vs triResize", errLegacy, 1e-9);
+
+    /* the ranged kernels, vectorized or not, move the bodies of their range only: a job must not step its neighbours */
+    {
+        bodySoA ranged, untouched;
+        soaFromWorld(&ranged, base);
+        soaFromWorld(&untouched, base);
+        soaFromWorld(&scalar, base);
+        const size_t from = 3, to = ranged.count - 5;
+        soaIntegrateRange(&ranged, from, to, args.dt);
+        soaRotateScalar(&scalar, args.dt);
+        soaTranslateScalar(&scalar, args.dt);
+        soaVerticesScalar(&scalar);
+        err = 0;
+        for (size_t i = 0; i < ranged.count; i++)
+            err = fmax(err, triDiff(soaTriangle(ranged, i), soaTriangle(i >= from && i < to ? scalar : untouched, i)));
+        ok &= report("ranged kernels stay in [from, to)", err, 1e-9);
+    }
+    return ok;
+}
+
+/// <summary>
+/// 100x the usual speed at 10 fps: in swept mode every body must end each step inside, in both layouts
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifyBoundary(const benchArgs& args) {
+    bool ok = true;
+    const boundaryMode bm = BOUNDARY_SWEPT;
+    world fast = makeWorld(1280, 720, 0.1, ROT_POSE, bm);
+    worldSpawn(&fast, 1003, args.len, args.seed);
+    for (body& b : fast.bodies) {
+        b.velo.x *= 100;
+        b.velo.y *= 100;
+    }
+    bodySoA fs;
+    soaFromWorld(&fs, fast);
+    double out = 0;
+    for (int s = 0; s < 100; s++) {
+        worldStep(&fast);
+        soaStep(&fs, fast.breite, fast.hoehe, fast.dt, bm);
+        for (size_t i = 0; i < fast.bodies.size(); i++) {
+            triangle t[2] = { fast.bodies[i].tri, soaTriangle(fs, i) };
+            for (const triangle& q : t) {
+                const vertex* v[3] = { &q.aA, &q.bB, &q.cC };
+                for (const vertex* p : v)
+                    out = fmax(out, fmax(fabs(p->x) - fast.breite, fabs(p->y) - fast.hoehe));
+            }
+        }
+    }
+    ok &= report("swept border, max outside", out, 1e-9);
+    return ok;
+}
+
+/// <summary>
+/// Sorted pairs with the smaller index first, to compare the pair sets of two broad phases
+/// </summary>
+static std::vector<std::pair<uint32_t, uint32_t>> pairSet(const std::vector<bodyPair>& pairs) {
+    std::vector<std::pair<uint32_t, uint32_t>> set;
+    for (const bodyPair& p : pairs)
+        set.push_back({ std::min(p.a, p.b), std::max(p.a, p.b) });
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+/// <summary>
+/// Broad phase: the grid, sort and sweep, and the grid split into listed bodies and a queried grid all find
+/// exactly the box overlaps of a brute force test, on a scene of small bodies with a few very large ones
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifyBroadphase(const benchArgs& args) {
+    bool ok = true;
+    bodySoA b;
+    std::default_random_engine re(args.seed);
+    std::uniform_real_distribution<double> ux(-1280, 1280), uy(-720, 720), small(4, 20), large(60, 200), phi(0, 6.3);
+    for (int i = 0; i < 2000; i++)
+        soaPush(&b, makeBody({ ux(re), uy(re) }, i % 50 ? small(re) : large(re), phi(re), { 0, 0 }, 0));
+    /* two bodies whose boxes touch in one edge count as a pair */
+    soaPush(&b, makeBody({ 0, 0 }, 10, 0, { 0, 0 }, 0));
+    soaPush(&b, makeBody({ 0, 0 }, 10, 0, { 0, 0 }, 0));
+    b.x[b.count - 1] = 10;
+    soaVertices(&b);
+    aabbSoA box;
+    soaBounds(b, &box);
+    const uint32_t n = (uint32_t)b.count;
+
+    std::vector<bodyPair> brute, grid, sweep, split;
+    for (uint32_t i = 0; i < n; i++)
+        for (uint32_t j = i + 1; j < n; j++)
+            if (box.lox[i] <= box.hix[j] && box.lox[j] <= box.hix[i] && box.loy[i] <= box.hiy[j] && box.loy[j] <= box.hiy[i])
+                brute.push_back({ i, j });
+    const auto expected = pairSet(brute);
+    hashGrid hg;
+    sweepAndPrune sap;
+    gridPairs(&hg, box, n, &grid);
+    sweepPairs(&sap, box, n, &sweep);
+    std::printf("%-34s %zu pairs\n", "brute force, mixed sizes", expected.size());
+    ok &= report("grid pairs vs brute force", pairSet(grid) == expected ? 0 : 1, 0);
+    ok &= report("sweep pairs vs brute force", pairSet(sweep) == expected ? 0 : 1, 0);
+
+    /* every third body is listed, the rest sits in a grid of its own, as the awake and sleeping bodies do */
+    std::vector<uint32_t> listed, rest;
+    for (uint32_t i = 0; i < n; i++)
+        (i % 3 ? rest : listed).push_back(i);
+    hashGrid own, other;
+    gridPairsOf(&own, box, listed.data(), listed.size(), &split);
+    gridBuild(&other, box, rest.data(), rest.size());
+    gridQuery(other, box, listed.data(), listed.size(), &split);
+    std::vector<bodyPair> restPairs;
+    gridPairsOf(&own, box, rest.data(), rest.size(), &restPairs);
+    split.insert(split.end(), restPairs.begin(), restPairs.end());
+    ok &= report("split grid pairs vs brute force", pairSet(split) == expected ? 0 : 1, 0);
+
+    /* one body covering the whole scene must not coarsen the cells until the small bodies share a few */
+    soaPush(&b, makeBody({ 0, 0 }, 3000, 0, { 0, 0 }, 0));
+    soaVertices(&b);
+    soaBounds(b, &box);
+    for (uint32_t i = 0; i < n; i++)
+        if (box.lox[i] <= box.hix[n] && box.lox[n] <= box.hix[i] && box.loy[i] <= box.hiy[n] && box.loy[n] <= box.hiy[i])
+            brute.push_back({ i, n });
+    gridPairs(&hg, box, n + 1, &grid);
+    uint32_t crowded = 0;
+    for (size_t k = 0; k + 1 < hg.bucketStart.size(); k++)
+        crowded = std::max(crowded, hg.bucketStart[k + 1] - hg.bucketStart[k]);
+    std::printf("%-34s %u entries\n", "fullest bucket, one huge body", crowded);
+    ok &= report("grid pairs with one huge body", pairSet(grid) == pairSet(brute) ? 0 : 1, 0);
+    ok &= report("grid cells stay small", crowded > 64 ? crowded : 0, 0);
+    return ok;
+}
+
+/// <summary>
+/// Triangle with the given corners, centered on their mean
+/// </summary>
+static triangle cornerTri(vertex a, vertex b, vertex c) {
+    return { a, b, c, { (a.x + b.x + c.x) / 3, (a.y + b.y + c.y) / 3 } };
+}
+
+/// <summary>
+/// Narrow phase: separated and touching triangles, the normal, depth and point of a known overlap,
+/// and on random pairs that the normal points from a to b and the depth is what separates them
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifyNarrowphase(const benchArgs& args) {
+    bool ok = true;
+    /* p is the right triangle under x + y = 10; q lies above x + y = 12 and 8, its box overlaps p's in each case */
+    const triangle p = cornerTri({ 0, 0 }, { 10, 0 }, { 0, 10 });
+    const triangle apart = cornerTri({ 6, 6 }, { 16, 6 }, { 6, 16 });
+    const triangle touching = cornerTri({ 5, 5 }, { 15, 5 }, { 5, 15 });
+    const triangle deep = cornerTri({ 4, 4 }, { 14, 4 }, { 4, 14 });
+    contact c;
+    double err = triOverlap(p, apart, &c) || triOverlap(apart, p, nullptr) ? 1 : 0;
+    ok &= report("SAT separated, boxes overlap", err, 0);
+    err = triOverlap(p, touching, &c) ? fabs(c.depth) : 1;
+    err = fmax(err, triOverlap(touching, p, nullptr) ? 0 : 1);
+    ok &= report("SAT touching, depth 0", err, 1e-12);
+
+    /* overlap of 8 / sqrt 2 to 10 / sqrt 2 along the diagonal, the point halfway from q's corner (4, 4) to the face */
+    const double r = sqrt(0.5);
+    err = triOverlap(p, deep, &c) ? fmax(fmax(fabs(c.nx - r), fabs(c.ny - r)), fmax(fabs(c.depth - sqrt(2.0)),
+        fmax(fabs(c.px - 4.5), fabs(c.py - 4.5)))) : 1;
+    ok &= report("SAT known overlap, normal and depth", err, 1e-12);
+    err = triOverlap(deep, p, &c) ? fmax(fmax(fabs(c.nx + r), fabs(c.ny + r)), fabs(c.depth - sqrt(2.0))) : 1;
+    ok &= report("SAT swapped, normal reversed", err, 1e-12);
+
+    /* random pairs: a overlaps b the same as b overlaps a; moving b by the depth along the normal separates them,
+       moving it most of the way does not */
+    std::default_random_engine re(args.seed);
+    std::uniform_real_distribution<double> off(-25, 25), phi(0, 6.3), len(8, 30);
+    size_t overlaps = 0;
+    double errSym = 0, errDepth = 0;
+    for (int k = 0; k < 20000; k++) {
+        triangle a, b;
+        a.zZ = { 0, 0 };
+        b.zZ = { off(re), off(re) };
+        triPose(&a, phi(re), len(re));
+        triPose(&b, phi(re), len(re));
+        contact ab, ba;
+        const bool hit = triOverlap(a, b, &ab);
+        errSym = fmax(errSym, hit == triOverlap(b, a, &ba) ? 0 : 1);
+        if (!hit)
+            continue;
+        overlaps++;
+        errSym = fmax(errSym, fmax(fabs(ab.depth - ba.depth), fmax(fabs(ab.nx + ba.nx), fabs(ab.ny + ba.ny))));
+        errDepth = fmax(errDepth, (b.zZ.x - a.zZ.x) * ab.nx + (b.zZ.y - a.zZ.y) * ab.ny < 0 ? 1 : 0);
+        triangle out = b, in = b;
+        triTranslate(&out, { ab.nx * (ab.depth + 1e-9), ab.ny * (ab.depth + 1e-9) });
+        triTranslate(&in, { ab.nx * ab.depth * 0.99, ab.ny * ab.depth * 0.99 });
+        errDepth = fmax(errDepth, triOverlap(a, out, nullptr) || (ab.depth > 1e-6 && !triOverlap(a, in, nullptr)) ? 1 : 0);
+    }
+    std::printf("%-34s %zu of 20000\n", "random pairs overlapping", overlaps);
+    ok &= report("SAT a vs b same as b vs a", errSym, 1e-12);
+    ok &= report("SAT normal a to b, depth separates", errDepth + (overlaps ? 0 : 1), 0);
+    return ok;
+}
+
+/// <summary>
+/// Two bodies of different size colliding off center, no walls in reach: momentum and energy must survive
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifySolver(const benchArgs& args) {
+    bool ok = true;
+    scene sc = makeScene(1e6, 1e6, args.dt);
+    soaPush(&sc.bodies, makeBody({ -30, 5 }, 40, 0.3, { 200, 0 }, 1));
+    soaPush(&sc.bodies, makeBody({ 30, -5 }, 25, -0.2, { -150, 20 }, -2));
+    const bodySoA& b = sc.bodies;
+    auto momentum = [&b](int k) {
+        double p = 0;
+        for (size_t i = 0; i < b.count; i++)
+            p += (k ? b.vy[i] : b.vx[i]) / b.invMass[i];
+        return p;
+    };
+    double e0 = kineticEnergy(b), px0 = momentum(0), py0 = momentum(1);
+    size_t hits = 0;
+    for (int s = 0; s < 120; s++) {
+        sceneStep(&sc);
+        hits += sc.stats.bodyContacts;
+    }
+    ok &= report("impulse contacts seen", hits ? 0 : 1, 0);
+    ok &= report("impulse momentum, rel err", fmax(fabs(momentum(0) - px0), fabs(momentum(1) - py0)) / fabs(px0), 1e-9);
+    ok &= report("impulse energy e=1, rel err", fabs(kineticEnergy(b) - e0) / e0, 1e-6);
+    return ok;
+}
+
+/// <summary>
+/// Small chunks on four threads must give exactly the result of the serial step
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifyThreads(const benchArgs& args) {
+    bool ok = true;
+    sceneConfig cfg;
+    cfg.grain = 64;
+    scene serial = makeScene(1280, 720, args.dt, cfg), threaded = makeScene(1280, 720, args.dt, cfg);
+    sceneSpawn(&serial, 3000, args.len, args.seed);
+    sceneSpawn(&threaded, 3000, args.len, args.seed);
+    jobPool pool;
+    poolStart(&pool, 4);
+    threaded.pool = &pool;
+    for (int s = 0; s < 60; s++) {
+        sceneStep(&serial);
+        sceneStep(&threaded);
+    }
+    poolStop(&pool);
+    double err = 0;
+    for (size_t i = 0; i < serial.bodies.count; i++)
+        err = fmax(err, fmax(fabs(serial.bodies.x[i] - threaded.bodies.x[i]), fabs(serial.bodies.vx[i] - threaded.bodies.vx[i])));
+    ok &= report("4 threads vs serial scene", err, 0);
+    return ok;
+}
+
+/// <summary>
+/// Snapshot handoff: interpolation ends match the poses, publishing and reading never allocate
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifyHandoff(const benchArgs& args) {
+    bool ok = true;
+    scene sc = makeScene(1280, 720, args.dt);
+    sceneSpawn(&sc, 3000, args.len, args.seed);
+    tripleBuffer buf;
+    bufferInit(&buf, sc.bodies.count);
+    double lerpErr = 0;
+    for (int s = 0; s < 20; s++) {
+        bodySoA before = sc.bodies;
+        countAllocations = true;
+        snapshot* back = bufferBack(&buf);
+        snapshotBefore(back, sc.bodies);
+        countAllocations = false;
+        sceneStep(&sc);
+        countAllocations = true;
+        snapshotAfter(back, sc.bodies, sc.steps, sc.dt);
+        bufferPublish(&buf);
+        bool fresh = false;
+        const snapshot* front = bufferRead(&buf, &fresh);
+        countAllocations = false;
+        lerpErr = fmax(lerpErr, fresh ? 0 : 1);
+        for (size_t i = 0; i < sc.bodies.count; i += 97) {
+            lerpErr = fmax(lerpErr, triDiff(snapshotTriangle(*front, i, 0), soaTriangle(before, i)));
+            lerpErr = fmax(lerpErr, triDiff(snapshotTriangle(*front, i, 1), soaTriangle(sc.bodies, i)));
+        }
+    }
+    ok &= report("snapshot interpolation ends", lerpErr, 1e-9);
+    ok &= report("allocations in handoff", (double)allocations.load(), 0);
+    return ok;
+}
+
+/// <summary>
+/// Software rasterizer: the AVX2 loop fills the same pixels as the scalar one, shared edges are filled once
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifyRaster(const benchArgs& args) {
+    bool ok = true;
+    scene sc = makeScene(640, 360, args.dt);
+    sceneSpawn(&sc, 2000, args.len, args.seed);
+    std::vector<triangle> tris(sc.bodies.count);
+    for (size_t i = 0; i < tris.size(); i++)
+        tris[i] = soaTriangle(sc.bodies, i);
+    softRaster simd, scalar;
+    scalar.simd = false;
+    rasterInit(&simd, 640, 360);
+    rasterInit(&scalar, 640, 360);
+    for (size_t i = 0; i < tris.size(); i += 100) {
+        const uint32_t color = rasterColor((uint8_t)i, (uint8_t)(i >> 8), 200);
+        rasterTriangles(&simd, &tris[i], std::min<size_t>(100, tris.size() - i), sc.breite, sc.hoehe, color);
+        rasterTriangles(&scalar, &tris[i], std::min<size_t>(100, tris.size() - i), sc.breite, sc.hoehe, color);
+    }
+    ok &= report("raster simd vs scalar pixels", simd.fb.pixels == scalar.fb.pixels ? 0 : 1, 0);
+
+    /* a triangle over the whole screen with its corners far outside: small once clipped, but its edge values
+       only fit 64 bits, so it must take the scalar loop */
+    {
+        const triangle huge = { { -20000, -20000 }, { 60000, -20000 }, { -20000, 60000 }, { 6667, 6667 } };
+        softRaster big, bigScalar;
+        bigScalar.simd = false;
+        rasterInit(&big, 1000, 1000);
+        rasterInit(&bigScalar, 1000, 1000);
+        const uint64_t filled = rasterTriangles(&big, &huge, 1, 500, 500, rasterColor(255, 255, 255));
+        const uint64_t filledScalar = rasterTriangles(&bigScalar, &huge, 1, 500, 500, rasterColor(255, 255, 255));
+        std::printf("%-34s %llu simd, %llu scalar\n", "raster huge triangle pixels", (unsigned long long)filled,
+            (unsigned long long)filledScalar);
+        ok &= report("raster huge triangle simd vs scalar", big.fb.pixels == bigScalar.fb.pixels && filled == 1000000
+            && filledScalar == 1000000 ? 0 : 1, 0);
+    }
+
+    /* a quad split along either diagonal covers the same pixels, each exactly once */
+    const double w = 640, h = 360;
+    vertex p[4] = { { -0.37 * w, -0.61 * h }, { 0.53 * w, -0.29 * h }, { 0.41 * w, 0.67 * h }, { -0.45 * w, 0.31 * h } };
+    auto cover = [&](const triangle* halves) {
+        std::vector<int> hits(640 * 360, 0);
+        for (int k = 0; k < 2; k++) {
+            softRaster one;
+            one.simd = k == 0;
+            rasterInit(&one, 640, 360);
+            rasterTriangles(&one, &halves[k], 1, w, h, rasterColor(255, 255, 255));
+            for (size_t i = 0; i < hits.size(); i++)
+                hits[i] += one.fb.pixels[i] != 0;
+        }
+        return hits;
+    };
+    const triangle splitA[2] = { { p[0], p[1], p[2], {} }, { p[0], p[2], p[3], {} } };
+    const triangle splitB[2] = { { p[0], p[1], p[3], {} }, { p[1], p[2], p[3], {} } };
+    const std::vector<int> hits = cover(splitA), other = cover(splitB);
+    ok &= report("raster quad holes", hits == other ? 0 : 1, 0);
+    ok &= report("raster shared edge overdraw", (double)std::count(hits.begin(), hits.end(), 2), 0);
+    return ok;
+}
+
+/// <summary>
+/// Dirty tiles: redrawing only what changed gives the pixels of a full redraw, also when bodies leave the
+/// screen or their number changes; the merged rects cover the dirty tiles exactly once
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifyDirty(const benchArgs& args) {
+    bool ok = true;
+    scene sc = makeScene(640, 360, args.dt);
+    sceneSpawn(&sc, 400, args.len, args.seed);
+    std::vector<triangle> tris(sc.bodies.count);
+    for (size_t i = 0; i < tris.size(); i++)
+        tris[i] = soaTriangle(sc.bodies, i);
+    softRaster full, partial;
+    rasterInit(&full, 640, 360);
+    rasterInit(&partial, 640, 360);
+    jobPool pool;
+    poolStart(&pool, 4);
+    dirtyRegion once, twice;
+    dirtyInit(&once, 640, 360, 64, 1);
+    dirtyInit(&twice, 640, 360, 64, 2);
+    std::vector<uint8_t> before;
+    double pixelErr = 0, rectErr = 0, ageErr = 0, share = 0;
+    for (int f = 0; f < 60; f++) {
+        for (size_t i = f % 10; i < tris.size(); i += 10) {
+            const double dx = f % 20 == 7 ? 700 : 3 * (f % 3 - 1), dy = 2;
+            for (vertex* v : { &tris[i].aA, &tris[i].bB, &tris[i].cC, &tris[i].zZ }) {
+                v->x += dx;
+                v->y += dy;
+            }
+        }
+        const size_t n = f == 30 ? tris.size() - 1 : tris.size();
+        rasterClear(&full, rasterColor(0, 0, 40));
+        rasterTriangles(&full, tris.data(), n, sc.breite, sc.hoehe, rasterColor(255, 255, 255));
+        rasterTrianglesDirty(&partial, tris.data(), n, sc.breite, sc.hoehe, rasterColor(255, 255, 255),
+            rasterColor(0, 0, 40), &pool);
+        pixelErr = fmax(pixelErr, full.fb.pixels == partial.fb.pixels ? 0 : 1);
+        share = fmax(share, f > 0 && f != 30 && f != 31 ? dirtyShare(partial.dirty) : 0);
+
+        std::vector<uint8_t> painted(partial.dirty.tiles.size(), 0);
+        dirtyMerge(&partial.dirty);
+        for (const dirtyRect& r : partial.dirty.rects)
+            for (int y = r.y; y < r.y + r.height; y += 64)
+                for (int x = r.x; x < r.x + r.width; x += 64)
+                    painted[(size_t)(y / 64) * partial.dirty.tilesX + x / 64]++;
+        rectErr = fmax(rectErr, painted == partial.dirty.tiles ? 0 : 1);
+
+        /* a double buffered target redraws at least what changed in this frame or the one before */
+        dirtyUpdate(&once, partial.boxes.data(), n);
+        dirtyUpdate(&twice, partial.boxes.data(), n);
+        for (size_t t = 0; t < once.tiles.size() && f > 0; t++)
+            ageErr = fmax(ageErr, (once.tiles[t] | before[t]) && !twice.tiles[t] ? 1 : 0);
+        before = once.tiles;
+    }
+    poolStop(&pool);
+    std::printf("%-34s %.1f %%\n", "dirty share, tenth of bodies move", 100 * share);
+    ok &= report("dirty redraw vs full redraw", pixelErr, 0);
+    ok &= report("dirty rects cover dirty tiles", rectErr, 0);
+    ok &= report("dirty tiles, double buffered", ageErr, 0);
+    return ok;
+}
+
+/// <summary>
+/// A recorded run with commands in between replays bit for bit, also on four threads
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifyTrace(const benchArgs& args) {
+    bool ok = true;
+    const char* path = "sim_bench_verify.trace";
+    scene sc = makeScene(1280, 720, args.dt);
+    sceneSpawn(&sc, 2000, args.len, args.seed);
+    sceneSetMaterial(&sc, 1, 0.9, 0.2);
+    traceWriter w;
+    bool written = traceOpen(&w, path, &sc);
+    for (int s = 0; s < 240 && written; s++) {
+        if (s % 60 == 30) {
+            simCommand cmd = { s % 120 == 30 ? CMD_RESIZE : CMD_SPIN, s % 120 == 30 ? 1.1 : 0.5, 0, {} };
+            sceneApply(&sc, cmd);
+            written = traceCommand(&w, cmd);
+        }
+        sceneStep(&sc);
+        written = written && traceStep(&w, sc);
+    }
+    written = traceClose(&w) && written;
+    double err = written ? 0 : 1;
+    for (unsigned threads : { 1u, 4u }) {
+        scene replayed;
+        jobPool pool;
+        if (threads > 1) {
+            poolStart(&pool, threads);
+            replayed.pool = &pool;
+        }
+        replayStats rs;
+        bool read = traceReplay(path, &replayed, &rs);
+        if (replayed.pool)
+            poolStop(&pool);
+        err = fmax(err, !read || rs.steps != 240 || rs.commands != 4 ? 1 : 0);
+        err = fmax(err, (double)rs.mismatches);
+        for (size_t i = 0; i < sc.bodies.count && read; i++)
+            err = fmax(err, fmax(fabs(sc.bodies.x[i] - replayed.bodies.x[i]), fabs(sc.bodies.omega[i] - replayed.bodies.omega[i])));
+    }
+    std::remove(path);
+    ok &= report("trace replay mismatches", err, 0);
+#if !defined(_WIN32)
+    /* a file size limit makes the second segment fail to map: every later record fails and closing does not crash */
+    {
+        rlimit before, limit;
+        getrlimit(RLIMIT_FSIZE, &before);
+        limit = before;
+        limit.rlim_cur = 24 << 20;
+        void (*handler)(int) = std::signal(SIGXFSZ, SIG_IGN);
+        setrlimit(RLIMIT_FSIZE, &limit);
+        traceWriter full;
+        bool opened = traceOpen(&full, path, &sc);
+        long long records = 0;
+        while (opened && records < 100000 && traceStep(&full, sc))
+            records++;
+        const simCommand cmd = { CMD_SPIN, 0.5, 0, {} };
+        const bool later = traceStep(&full, sc) || traceCommand(&full, cmd);
+        const bool closed = opened && traceClose(&full);
+        setrlimit(RLIMIT_FSIZE, &before);
+        std::signal(SIGXFSZ, handler);
+        std::remove(path);
+        std::printf("%-34s %lld records\n", "trace before the size limit", records);
+        ok &= report("trace segment map failure", opened && full.failed && records < 100000 && !later && !closed ? 0 : 1, 0);
+    }
+#endif
+    return ok;
+}
+
+/// <summary>
+/// Percentiles of the latency histogram are within one bucket, 1/16, of the exact ones
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifyProfile(const benchArgs& args) {
+    bool ok = true;
+    latencyHistogram h;
+    histogramClear(&h);
+    std::vector<uint64_t> values;
+    std::default_random_engine rv(args.seed);
+    std::lognormal_distribution<double> lat(10, 1.5);
+    for (int i = 0; i < 100000; i++) {
+        values.push_back((uint64_t)lat(rv));
+        histogramAdd(&h, values.back());
+    }
+    std::sort(values.begin(), values.end());
+    double err = 0;
+    for (double q : { 0.5, 0.9, 0.99, 0.999 }) {
+        const double exact = (double)values[(size_t)(q * values.size()) - 1];
+        err = fmax(err, fabs(histogramPercentile(h, q) - exact) / exact);
+    }
+    err = fmax(err, h.max == values.back() ? 0 : 1);
+    ok &= report("histogram percentiles, rel err", err, 1.0 / 16);
+    if (profileEnabled) {
+        latencyHistogram stages[STAGE_COUNT];
+        profileReset();
+        scene sc = makeScene(1280, 720, args.dt);
+        sceneSpawn(&sc, 500, args.len, args.seed);
+        for (int s = 0; s < 10; s++)
+            sceneStep(&sc);
+        profileHistograms(stages);
+        ok &= report("profiled steps", fabs((double)stages[STAGE_STEP].count - 10), 0);
+        profileReset();
+    }
+    return ok;
+}
+
+/// <summary>
+/// Body pool: random spawns and despawns keep every live handle pointing at its body, stale ones fail,
+/// and the sleep state of the scene follows the bodies
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifyBodyPool(const benchArgs& args) {
+    bool ok = true;
+    bodySoA bodies;
+    bodyPool bp;
+    bodyPoolInit(&bp, &bodies);
+    std::vector<std::pair<bodyHandle, double>> live, dead;
+    std::default_random_engine rp(args.seed);
+    double err = 0, tag = 0;
+    for (int op = 0; op < 20000; op++) {
+        if (live.empty() || rp() % 5 < 3) {
+            body b = makeBody({ 0, 0 }, 10, 0, { 0, 0 }, ++tag);
+            live.push_back({ bodyPoolSpawn(&bp, b), tag });
+        }
+        else {
+            size_t k = rp() % live.size();
+            err = fmax(err, bodyPoolDespawn(&bp, live[k].first) ? 0 : 1);
+            dead.push_back(live[k]);
+            live[k] = live.back();
+            live.pop_back();
+        }
+    }
+    for (const auto& l : live) {
+        size_t i = bodyPoolIndex(bp, l.first);
+        err = fmax(err, i == SIZE_MAX || bodies.omega[i] != l.second ? 1 : 0);
+    }
+    for (const auto& d : dead)
+        err = fmax(err, bodyPoolIndex(bp, d.first) != SIZE_MAX || bodyPoolDespawn(&bp, d.first) ? 1 : 0);
+    err = fmax(err, bodies.count == live.size() && bodies.x.size() == live.size() ? 0 : 1);
+    ok &= report("body pool handles", err, 0);
+
+    /* despawning a sleeper moves the last body into its place, which must take its own sleep entries along */
+    {
+        scene sc = makeScene(1280, 720, 1.0 / 120);
+        bodyPool sp;
+        bodyPoolInit(&sp, &sc.bodies, &sc.sleeping);
+        std::vector<bodyHandle> resting;
+        for (int k = 0; k < 3; k++)
+            resting.push_back(bodyPoolSpawn(&sp, makeBody({ -600.0 + 300 * k, 300 }, 20, 0, { 0, 0 }, 0)));
+        const bodyHandle moving = bodyPoolSpawn(&sp, makeBody({ -600, -300 }, 20, 0, { 100, 0 }, 0));
+        for (int s = 0; s < 90; s++)
+            sceneStep(&sc);
+        const size_t asleep = sc.stats.asleep;
+        bodyPoolDespawn(&sp, resting[0]);
+        bodyPoolSpawn(&sp, makeBody({ 600, 0 }, 20, 0, { 0, 0 }, 0));
+        const double x0 = sc.bodies.x[bodyPoolIndex(sp, moving)];
+        for (int s = 0; s < 30; s++)
+            sceneStep(&sc);
+        const double moved = sc.bodies.x[bodyPoolIndex(sp, moving)] - x0;
+        std::printf("%-34s %zu before, %zu after, moved %.1f px\n", "sleepers around a despawn", asleep, sc.stats.asleep, moved);
+        ok &= report("moving body after sleeper despawn", fabs(moved - 25), 1e-9);
+        ok &= report("sleepers kept after despawn", asleep == 3 && sc.stats.asleep == 2 ? 0 : 1, 0);
+    }
+    /* churn in a settling scene: the awake list holds exactly the awake bodies in order, every island is a closed circle */
+    {
+        sceneConfig cfg;
+        cfg.integrator.drag = 2;
+        scene sc = makeScene(1280, 720, args.dt, cfg);
+        sceneSpawn(&sc, 1000, args.len, args.seed);
+        sceneSetMaterial(&sc, 1, 0.5, 0.5);
+        bodyPool sp;
+        bodyPoolInit(&sp, &sc.bodies, &sc.sleeping);
+        std::default_random_engine rc(args.seed);
+        double bad = 0;
+        size_t asleep = 0;
+        for (int s = 0; s < 600; s++) {
+            for (int k = 0; k < 4 && s >= 120; k++) {
+                bodyPoolDespawn(&sp, bodyPoolHandle(sp, rc() % sc.bodies.count));
+                bodyPoolSpawn(&sp, makeBody({ -1000.0 + rc() % 2000, -600.0 + rc() % 1200 }, args.len, 0, { 0, 0 }, 0));
+            }
+            sceneStep(&sc);
+            asleep = std::max(asleep, sc.stats.asleep);
+            const sleepState& sl = sc.sleeping;
+            std::vector<uint32_t> awake;
+            for (size_t i = 0; i < sl.bodies; i++) {
+                if (!sl.asleep[i]) {
+                    awake.push_back((uint32_t)i);
+                    continue;
+                }
+                uint32_t j = sl.next[(uint32_t)i];
+                for (size_t n = 0; n < sl.bodies && j != i; n++)
+                    j = j < sl.bodies && sl.asleep[j] ? sl.next[j] : (uint32_t)i + 1;
+                bad += j != i;
+            }
+            bad += sl.bodies != sc.bodies.count || awake != sl.awake;
+        }
+        std::printf("%-34s %zu of %zu bodies at most\n", "asleep while churning", asleep, sc.bodies.count);
+        ok &= report("sleep state while churning", bad, 0);
+    }
+    return ok;
+}
+
+/// <summary>
+/// Folded and masked resizes match one command at a time, and a script runs the same at any frame rate
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifyCommands(const benchArgs& args) {
+    bool ok = true;
+    scene batched = makeScene(1280, 720, args.dt), single = makeScene(1280, 720, args.dt);
+    sceneSpawn(&batched, 1003, args.len, args.seed);
+    sceneSpawn(&single, 1003, args.len, args.seed);
+    commandRing ring;
+    const commandScript script = builtinScript(args);
+    for (size_t c = 0; c < 40; c++) {
+        simCommand cmd = script.commands[c];
+        cmd.time = 0;
+        commandPush(&ring, cmd);
+        sceneApply(&single, cmd);
+    }
+    const size_t applied = commandDrain(&ring, &batched, args.dt, nullptr);
+    double err = applied < 40 ? 0 : 1;
+    const bodySoA& p = batched.bodies, & q = single.bodies;
+    for (size_t i = 0; i < p.count; i++) {
+        err = fmax(err, fabs(p.len[i] / q.len[i] - 1));
+        err = fmax(err, fmax(fabs(p.invMass[i] / q.invMass[i] - 1), fabs(p.invInertia[i] / q.invInertia[i] - 1)));
+        err = fmax(err, p.omega[i] == q.omega[i] ? 0 : 1);
+    }
+    ok &= report("batched commands vs one by one", err, 1e-12);
+
+    benchArgs small = args;
+    small.bodies = 1000;
+    small.steps = 240;
+    size_t n[3];
+    const scene a = runScript(small, script, 24, &n[0]), b = runScript(small, script, 60, &n[1]), c = runScript(small, script, 1000, &n[2]);
+    err = n[0] == n[1] && n[1] == n[2] ? 0 : 1;
+    for (size_t i = 0; i < a.bodies.count; i++)
+        err = fmax(err, a.bodies.x[i] == b.bodies.x[i] && a.bodies.x[i] == c.bodies.x[i]
+            && a.bodies.len[i] == b.bodies.len[i] && a.bodies.len[i] == c.bodies.len[i] ? 0 : 1);
+    ok &= report("scripted commands at 24/60/1000 fps", err, 0);
+    return ok;
+}
+
+/// <summary>
+/// Polygon<3> does what the hand-written triangle functions do, and the run time polygon what Polygon<N> does
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifyPolygon(const benchArgs& args) {
+    bool ok = true;
+    const world base = verifyWorld(args);
+    vertex zero = { 0, 0 };
+    const triangle equi = makeEquiTri(&zero, 1);
+    const vertex* triUnit[3] = { &equi.aA, &equi.bB, &equi.cC };
+    const polygon hexagon = makeRegular(6, zero, 1, 0);
+    double err = 0;
+    for (int k = 0; k < 3; k++)
+        err = fmax(err, fmax(fabs(regularUnit<3>[k].x - triUnit[k]->x), fabs(regularUnit<3>[k].y - triUnit[k]->y)));
+    /* regularUnit<3> is unitTri, the series behind the other N must still give the triangle */
+    for (int k = 0; k < 3; k++)
+        err = fmax(err, fmax(fabs(regularOffsets<3>()[k].x - unitTri[k].x), fabs(regularOffsets<3>()[k].y - unitTri[k].y)));
+    for (int k = 0; k < 6; k++)
+        err = fmax(err, fmax(fabs(regularUnit<6>[k].x - hexagon.v[k].x), fabs(regularUnit<6>[k].y - hexagon.v[k].y)));
+    ok &= report("constexpr regular offsets", err, 1e-15);
+
+    double errPose = 0, errRotate = 0, errSweep = 0, errOverlap = 0, errDyn = 0;
+    for (size_t i = 0; i < base.bodies.size(); i++) {
+        const body& b = base.bodies[i];
+        triangle t = b.tri;
+        Polygon<3> p = polyFromTriangle(t);
+        triPose(&t, b.phi + 0.3, b.len);
+        polyPose(&p, regularUnit<3>.data(), b.phi + 0.3, b.len);
+        errPose = fmax(errPose, triDiff(t, { p.v[0], p.v[1], p.v[2], p.zZ }));
+        polyRotate(&p, b.omega * args.dt);
+        triPose(&t, b.phi + 0.3 + b.omega * args.dt, b.len);
+        errRotate = fmax(errRotate, triDiff(t, { p.v[0], p.v[1], p.v[2], p.zZ }));
+
+        /* push every body half its size over a border, so each one hits a wall */
+        velocity vt = { b.velo.x * 50, b.velo.y }, vp = vt;
+        double ot = b.omega, op = b.omega;
+        triTranslate(&t, { (b.tri.zZ.x < 0 ? -1 : 1) * (1280 - fabs(b.tri.zZ.x) + b.len / 2), 0 });
+        p = polyFromTriangle(t);
+        const bool ht = triSweep(&t, &vt, args.dt, 1280, 720, &ot);
+        const bool hp = polySweep(&p, &vp, args.dt, 1280, 720, &op);
+        errSweep = fmax(errSweep, triDiff(t, { p.v[0], p.v[1], p.v[2], p.zZ }));
+        errSweep = fmax(errSweep, ht == hp && ot == op && vt.x == vp.x && vt.y == vp.y ? 0 : 1);
+
+        /* a neighbour at a random offset of up to one side length, overlapping about half the time */
+        const body& o = base.bodies[(i + 1) % base.bodies.size()];
+        triangle u;
+        u.zZ = { b.tri.zZ.x + (o.velo.x / 300) * b.len, b.tri.zZ.y + (o.velo.y / 300) * b.len };
+        triPose(&u, o.omega * 0.1, b.len * 0.8);
+        contact ct, cp;
+        const bool overlapT = triOverlap(b.tri, u, &ct);
+        const bool overlapP = polyOverlap(polyFromTriangle(b.tri), polyFromTriangle(u), &cp);
+        errOverlap = fmax(errOverlap, overlapT == overlapP ? 0 : 1);
+        if (overlapT && overlapP)
+            errOverlap = fmax(errOverlap, fmax(fmax(fabs(ct.nx - cp.nx), fabs(ct.ny - cp.ny)),
+                fmax(fabs(ct.depth - cp.depth), fmax(fabs(ct.px - cp.px), fabs(ct.py - cp.py)))));
+
+        Polygon<6> h = makeRegular<6>(b.tri.zZ, b.len, b.phi), g = makeRegular<6>(u.zZ, b.len, 0.2);
+        polygon hd = makeRegular(6, b.tri.zZ, b.len, b.phi), gd = makeRegular(6, u.zZ, b.len, 0.2);
+        velocity vh = { b.velo.x * 50, b.velo.y }, vd = vh;
+        double oh = b.omega, od = b.omega;
+        polyRotate(&h, b.omega * args.dt);
+        polyRotate(&hd, b.omega * args.dt);
+        const bool ch = polyOverlap(h, g, &ct), cd = polyOverlap(hd, gd, &cp);
+        errDyn = fmax(errDyn, ch == cd ? 0 : 1);
+        if (ch && cd)
+            errDyn = fmax(errDyn, fmax(fmax(fabs(ct.nx - cp.nx), fabs(ct.ny - cp.ny)), fmax(fabs(ct.depth - cp.depth), fabs(ct.px - cp.px))));
+        errDyn = fmax(errDyn, polySweep(&h, &vh, args.dt, 1280, 720, &oh) == polySweep(&hd, &vd, args.dt, 1280, 720, &od) ? 0 : 1);
+        for (int k = 0; k < 6; k++)
+            errDyn = fmax(errDyn, fmax(fabs(h.v[k].x - hd.v[k].x), fabs(h.v[k].y - hd.v[k].y)));
+    }
+    ok &= report("Polygon<3> pose vs triPose", errPose, 1e-12);
+    ok &= report("Polygon<3> rotate vs triPose", errRotate, 1e-9);
+    ok &= report("Polygon<3> sweep vs triSweep", errSweep, 0);
+    ok &= report("Polygon<3> overlap vs triOverlap", errOverlap, 1e-12);
+    ok &= report("polygon vs Polygon<6>", errDyn, 1e-12);
+
+    /* two squares of side 20, 15 apart along x: depth 5 along +x, contact point halfway into the overlap */
+    const Polygon<4> s = makeRegular<4>({ 0, 0 }, 20, 0), r = makeRegular<4>({ 15, 3 }, 20, 0);
+    contact c;
+    err = polyOverlap(s, r, &c) ? fmax(fmax(fabs(c.nx - 1), fabs(c.ny)), fmax(fabs(c.depth - 5), fabs(c.px - 7.5))) : 1;
+    err = fmax(err, polyOverlap(s, makeRegular<4>({ 20.5, 0 }, 20, 0), nullptr) ? 1 : 0);
+    ok &= report("square overlap depth", err, 1e-12);
+    return ok;
+}
+
+/// <summary>
+/// The reduced precision stores stay close to double, and the float kernels match their portable loops
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifyPrecision(const benchArgs& args) {
+    bool ok = true;
+    world pw = makeWorld(1280, 720, args.dt);
+    worldSpawn(&pw, 1003, args.len, args.seed);
+    bodySoA reference;
+    soaFromWorld(&reference, pw);
+    bodyStore<double> sd;
+    bodyStore<float> sf, sfScalar;
+    bodyStore<fixed32> sx;
+    storeFromWorld(&sd, pw);
+    storeFromWorld(&sf, pw);
+    storeFromWorld(&sfScalar, pw);
+    storeFromWorld(&sx, pw);
+    storeStep(&sf, 1280, 720, args.dt);
+    storeStepScalar(&sfScalar, 1280, 720, args.dt);
+    double err = 0;
+    for (size_t i = 0; i < sf.count; i++)
+        err = fmax(err, triDiff(storeTriangle(sf, i), storeTriangle(sfScalar, i)));
+    ok &= report("float store simd vs scalar", err, 1e-3);
+    for (int k = 0; k < 600; k++) {
+        soaStep(&reference, 1280, 720, args.dt);
+        storeStep(&sd, 1280, 720, args.dt);
+    }
+    err = 0;
+    for (size_t i = 0; i < sd.count; i++)
+        err = fmax(err, triDiff(storeTriangle(sd, i), soaTriangle(reference, i)));
+    ok &= report("double store vs bodySoA, 600 steps", err, 1e-9);
+
+    /* far away walls: with the borders in play a rounding difference can move a bounce by a step, see --precision */
+    storeFromWorld(&sd, pw);
+    storeFromWorld(&sf, pw);
+    for (int k = 0; k < 600; k++) {
+        storeStep(&sd, 20000, 20000, args.dt);
+        storeStep(&sf, 20000, 20000, args.dt);
+        storeStep(&sx, 20000, 20000, args.dt);
+    }
+    double errF = 0, errX = 0;
+    for (size_t i = 0; i < sd.count; i++) {
+        const triangle t = storeTriangle(sd, i);
+        errF = fmax(errF, triDiff(storeTriangle(sf, i), t));
+        errX = fmax(errX, triDiff(storeTriangle(sx, i), t));
+    }
+    /* a float position of about 1000 px rounds by up to 6e-5 px per step, fixed32 by 8e-6 px */
+    ok &= report("float store vs double, 600 steps", errF, 0.05);
+    ok &= report("fixed32 store vs double, 600 steps", errX, 0.01);
+    return ok;
+}
+
+/// <summary>
+/// Integrators against the closed form under gravity and drag: v(t) = g/c + (v0 - g/c) e^-ct
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifyIntegrator(const benchArgs&) {
+    bool ok = true;
+    const double g = -500, c = 0.8, T = 1, h = 1.0 / 30;
+    const motionState start = { 0, 0, 0, 300, 200, 5 };
+    auto exact = [&](double v0, double f) {
+        const double vt = f / c, e = exp(-c * T);
+        return std::make_pair(vt * T + (v0 - vt) * (1 - e) / c, vt + (v0 - vt) * e);
+    };
+    const auto ex = exact(start.vx, 0), ey = exact(start.vy, g), ew = exact(start.omega, 0);
+    double errs[3];
+    for (int k = 0; k < 3; k++) {
+        integratorConfig ic;
+        ic.kind = (integratorKind)k;
+        ic.gravityY = g;
+        ic.drag = c;
+        motionState m = start;
+        for (int s = 0; s < (int)lround(T / h); s++)
+            integrateMotion(&m, ic, h);
+        errs[k] = fmax(fmax(fabs(m.x - ex.first), fabs(m.y - ey.first)), fmax(fabs(m.phi - ew.first),
+            fmax(fabs(m.vx - ex.second), fmax(fabs(m.vy - ey.second), fabs(m.omega - ew.second)))));
+    }
+    ok &= report("euler vs closed form, 1 s", errs[INTEGRATE_EULER], 20);
+    ok &= report("verlet vs closed form, 1 s", errs[INTEGRATE_VERLET], 0.1);
+    ok &= report("rk4 vs closed form, 1 s", errs[INTEGRATE_RK4], 1e-5);
+    return ok;
+}
+
+/// <summary>
+/// Adaptive sub-stepping: slow bodies keep the vectorized kernels, fast ones end where small steps take them
+/// and stop at the walls
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifySubstep(const benchArgs& args) {
+    bool ok = true;
+    /* slow bodies keep the vectorized kernels: with sub-stepping on, a reflect scene without fast bodies is unchanged */
+    {
+        sceneConfig cfg;
+        cfg.response = RESPONSE_REFLECT;
+        scene sub = makeScene(1280, 720, args.dt, cfg);
+        cfg.integrator.maxSubsteps = 1;
+        scene plain = makeScene(1280, 720, args.dt, cfg);
+        sceneSpawn(&sub, 2000, args.len, args.seed);
+        sceneSpawn(&plain, 2000, args.len, args.seed);
+        size_t fast = 0;
+        for (int s = 0; s < 120; s++) {
+            sceneStep(&sub);
+            sceneStep(&plain);
+            fast += sub.stats.fastBodies;
+        }
+        double err = fast ? 1 : 0;
+        for (size_t i = 0; i < sub.bodies.count; i++)
+            err = fmax(err, triDiff(soaTriangle(sub.bodies, i), soaTriangle(plain.bodies, i)));
+        ok &= report("slow bodies unchanged, reflect", err, 0);
+    }
+    /* collisions spin bodies up: among the fast bodies of an impulse scene the slow ones still move exactly as before */
+    {
+        scene sc = makeScene(1280, 720, args.dt);
+        sceneSpawn(&sc, 2000, args.len, args.seed);
+        for (int s = 0; s < 60; s++)
+            sceneStep(&sc);
+        const integratorConfig ic;
+        bodySoA moved = sc.bodies, plainMoved = sc.bodies, stepped = sc.bodies, plainStepped = sc.bodies;
+        integrateStats st;
+        integrateMoveRange(&moved, 0, moved.count, 1280, 720, args.dt, ic, &st);
+        soaIntegrateRange(&plainMoved, 0, plainMoved.count, args.dt);
+        integrateStepRange(&stepped, 0, stepped.count, 1280, 720, args.dt, BOUNDARY_SWEPT, ic, &st);
+        soaStepRange(&plainStepped, 0, plainStepped.count, 1280, 720, args.dt, BOUNDARY_SWEPT);
+        double err = st.fast ? 0 : 1;
+        for (size_t i = 0; i < sc.bodies.count; i++)
+            if (substepCount(sc.bodies, i, args.dt, ic) == 1)
+                err = fmax(err, fmax(triDiff(soaTriangle(moved, i), soaTriangle(plainMoved, i)),
+                    triDiff(soaTriangle(stepped, i), soaTriangle(plainStepped, i))));
+        std::printf("%-34s %zu of %zu bodies\n", "fast after 60 impulse steps", st.fast, sc.bodies.count);
+        ok &= report("slow bodies unchanged among fast", err, 0);
+    }
+    /* gravity and drag: slow bodies take the vectorized pass and end where integrateMotion takes each of them */
+    {
+        const integratorKind kinds[3] = { INTEGRATE_EULER, INTEGRATE_VERLET, INTEGRATE_RK4 };
+        bodySoA start;
+        for (int k = 0; k < 600; k++) {
+            const double a = 0.1 * k;
+            soaPush(&start, makeBody({ 800 * cos(a), 400 * sin(3 * a) }, 20, a, { 30 * cos(2 * a), 30 * sin(2 * a) }, 0.5 * sin(a)));
+        }
+        double err = 0;
+        size_t fast = 0;
+        for (integratorKind kind : kinds) {
+            integratorConfig ic;
+            ic.kind = kind;
+            ic.gravityY = -400;
+            ic.drag = 0.5;
+            bodySoA moved = start, stepped = start;
+            integrateStats st;
+            integrateMoveRange(&moved, 0, moved.count, 1280, 720, args.dt, ic, &st);
+            fast += st.fast;
+            integrateStepRange(&stepped, 0, stepped.count, 1280, 720, args.dt, BOUNDARY_SWEPT, ic, &st);
+            fast += st.fast;
+            for (size_t i = 0; i < start.count; i++) {
+                motionState m = { start.x[i], start.y[i], start.phi[i], start.vx[i], start.vy[i], start.omega[i] };
+                integrateMotion(&m, ic, args.dt);
+                for (const bodySoA* b : { &moved, &stepped }) {
+                    const double phiErr = fabs(remainder(b->phi[i] - m.phi, 2 * 3.14159265358979323846));
+                    err = fmax(err, fmax(fmax(fabs(b->x[i] - m.x), fabs(b->y[i] - m.y)), phiErr));
+                    err = fmax(err, fmax(fmax(fabs(b->vx[i] - m.vx), fabs(b->vy[i] - m.vy)), fabs(b->omega[i] - m.omega)));
+                }
+            }
+        }
+        ok &= report("forces, slow bodies vectorized", err, 1e-9);
+        ok &= report("forces, slow bodies sub-stepped", fast ? 1 : 0, 0);
+    }
+    /* a hitch of a quarter second: sub-stepped fast bodies end where 64 small steps take them, slow ones are untouched */
+    {
+        const double hitch = 0.25;
+        sceneConfig cfg;
+        cfg.response = RESPONSE_REFLECT;
+        cfg.integrator.maxSubsteps = 64;
+        scene sub = makeScene(1280, 720, hitch, cfg);
+        cfg.integrator.maxSubsteps = 1;
+        scene fine = makeScene(1280, 720, hitch / 64, cfg), coarse = makeScene(1280, 720, hitch, cfg);
+        for (int k = 0; k < 64; k++) {
+            const double a = 0.1 * k;
+            const double speed = k % 4 ? 10 : 3000, spin = k % 8 ? 0.5 : 40;
+            const body b = makeBody({ 1000 * cos(a), 600 * sin(3 * a) }, 20, a, { speed * cos(2 * a), speed * sin(2 * a) }, spin);
+            soaPush(&sub.bodies, b);
+            soaPush(&fine.bodies, b);
+            soaPush(&coarse.bodies, b);
+        }
+        sceneStep(&sub);
+        sceneStep(&coarse);
+        for (int s = 0; s < 64; s++)
+            sceneStep(&fine);
+        double errSub = 0, errCoarse = 0;
+        for (size_t i = 0; i < sub.bodies.count; i++) {
+            const vertex p = soaTriangle(sub.bodies, i).zZ, q = soaTriangle(fine.bodies, i).zZ, r = soaTriangle(coarse.bodies, i).zZ;
+            double phiErr = fabs(remainder(sub.bodies.phi[i] - fine.bodies.phi[i], 2 * 3.14159265358979323846));
+            errSub = fmax(errSub, fmax(hypot(p.x - q.x, p.y - q.y), phiErr * 20));
+            errCoarse = fmax(errCoarse, hypot(r.x - q.x, r.y - q.y));
+        }
+        std::printf("%-34s %zu bodies, %zu sub-steps, one step off by %.1f px\n", "hitch sub-stepping", sub.stats.fastBodies,
+            sub.stats.substeps, errCoarse);
+        ok &= report("sub-stepped hitch vs 64 steps", errSub, 1e-6);
+        ok &= report("sub-stepped bodies", sub.stats.fastBodies == 16 ? 0 : 1, 0);
+    }
+    /* impulse response: a fast body stops at the wall after a short sub-step instead of ending deep inside it */
+    {
+        sceneConfig cfg;
+        scene sc = makeScene(1280, 720, 0.1, cfg);
+        soaPush(&sc.bodies, makeBody({ 1100, 0 }, 20, 0, { 4000, 0 }, 0));
+        soaSetMaterial(&sc.bodies, 0, 1, 1, 0);
+        sceneStep(&sc);
+        ok &= report("fast body reaches the solver", sc.stats.wallContacts ? 0 : 1, 0);
+        ok &= report("fast body after solve, vx < 0", sc.bodies.vx[0] < 0 ? 0 : 1, 0);
+        ok &= report("fast body wall penetration, px", fmax(0, soaTriangle(sc.bodies, 0).zZ.x + 10 - 1280), 4000 * 0.1 / 32);
+    }
+    return ok;
+}
+
+/// <summary>
+/// Sleeping: nothing changes while every body moves, a scene at rest costs nothing and wakes where it is hit
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifySleep(const benchArgs& args) {
+    bool ok = true;
+    {
+        scene on = makeScene(1280, 720, args.dt), off;
+        sceneConfig cfg;
+        cfg.sleep.enabled = false;
+        off = makeScene(1280, 720, args.dt, cfg);
+        sceneSpawn(&on, 2000, args.len, args.seed);
+        sceneSpawn(&off, 2000, args.len, args.seed);
+        size_t asleep = 0;
+        for (int s = 0; s < 240; s++) {
+            sceneStep(&on);
+            sceneStep(&off);
+            asleep += on.stats.asleep;
+        }
+        double err = asleep ? 1 : 0;
+        for (size_t i = 0; i < on.bodies.count; i++)
+            err = fmax(err, triDiff(soaTriangle(on.bodies, i), soaTriangle(off.bodies, i)));
+        ok &= report("sleep on vs off, moving scene", err, 0);
+    }
+    {
+        const char* path = "sim_bench_sleep.trace";
+        sceneConfig cfg;
+        cfg.integrator.drag = 2;
+        scene sc = makeScene(1280, 720, args.dt, cfg);
+        sceneSpawn(&sc, 2000, args.len, args.seed);
+        sceneSetMaterial(&sc, 1, 0.5, 0.5);
+        traceWriter w;
+        bool written = traceOpen(&w, path, &sc);
+        int settled = -1;
+        for (int s = 0; s < 1200 && settled < 0; s++) {
+            sceneStep(&sc);
+            written = written && traceStep(&w, sc);
+            if (!sc.stats.awake)
+                settled = s + 1;
+        }
+        std::printf("%-34s %d steps\n", "drag 2 scene asleep after", settled);
+        ok &= report("settled scene asleep", (double)sc.stats.awake, 0);
+
+        const bodySoA rest = sc.bodies;
+        for (int s = 0; s < 10; s++)
+            sceneStep(&sc);
+        double err = sc.stats.pairs || sc.stats.wallContacts ? 1 : 0;
+        for (size_t i = 0; i < sc.bodies.count; i++)
+            err = fmax(err, fmax(triDiff(soaTriangle(sc.bodies, i), soaTriangle(rest, i)),
+                fabs(sc.bodies.vx[i]) + fabs(sc.bodies.vy[i]) + fabs(sc.bodies.omega[i])));
+        ok &= report("sleepers untouched", err, 0);
+
+        /* on a copy, so the recording stays untouched: the island of a woken body wakes as a whole,
+           and a body thrown into the rest wakes what it hits */
+        scene hit = sc;
+        size_t island = 0, largest = 0;
+        for (size_t i = 0; i < hit.bodies.count; i++) {
+            size_t n = 0;
+            uint32_t j = (uint32_t)i;
+            do {
+                j = hit.sleeping.next[j];
+                n++;
+            } while (j != i && n <= hit.bodies.count);
+            if (n > largest) {
+                largest = n;
+                island = i;
+            }
+        }
+        sleepWake(&hit.sleeping, (uint32_t)island);
+        err = sleepCommit(&hit.sleeping) == largest ? 0 : 1;
+        err = fmax(err, hit.sleeping.awake.size() == largest ? 0 : 1);
+        for (uint32_t i : hit.sleeping.awake)
+            err = fmax(err, hit.sleeping.asleep[i] ? 1 : 0);
+        std::printf("%-34s %zu bodies\n", "largest island", largest);
+        ok &= report("island wakes together", err, 0);
+
+        sleepWake(&hit.sleeping, (uint32_t)hit.bodies.count - 1);
+        sleepCommit(&hit.sleeping);
+        hit.bodies.vx[hit.bodies.count - 1] = 2000;
+        size_t woken = 0;
+        for (int s = 0; s < 120; s++) {
+            sceneStep(&hit);
+            woken += hit.stats.woken;
+        }
+        std::printf("%-34s %zu bodies\n", "woken by a thrown body", woken);
+        ok &= report("thrown body wakes others", woken ? 0 : 1, 0);
+
+        /* a command wakes the bodies it selects; the whole run replays bit for bit on four threads */
+        simCommand cmd = { CMD_SPIN, 20, 0, {} };
+        cmd.select.kind = SELECT_RANGE;
+        cmd.select.count = 100;
+        sceneApply(&sc, cmd);
+        written = written && traceCommand(&w, cmd);
+        err = sc.sleeping.awake.size() >= 100 ? 0 : 1;
+        for (int s = 0; s < 120; s++) {
+            sceneStep(&sc);
+            written = written && traceStep(&w, sc);
+        }
+        ok &= report("command wakes its selection", err, 0);
+        written = traceClose(&w) && written;
+
+        err = written ? 0 : 1;
+        scene replayed;
+        jobPool pool;
+        poolStart(&pool, 4);
+        replayed.pool = &pool;
+        replayStats rs;
+        bool read = traceReplay(path, &replayed, &rs);
+        poolStop(&pool);
+        err = fmax(err, read ? (double)rs.mismatches : 1);
+        for (size_t i = 0; i < sc.bodies.count && read; i++)
+            err = fmax(err, triDiff(soaTriangle(sc.bodies, i), soaTriangle(replayed.bodies, i)));
+        std::remove(path);
+        ok &= report("sleep replay, 4 threads", err, 0);
+    }
+    return ok;
+}
+
+/// <summary>
+/// A checkpoint of a half asleep scene resumes bit for bit, also when a body is thrown in afterwards,
+/// and damaged files are refused
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifyCheckpoint(const benchArgs& args) {
+    bool ok = true;
+    const char* path = "sim_bench.checkpoint";
+    sceneConfig cfg;
+    cfg.integrator.drag = 2;
+    scene sc = makeScene(1280, 720, args.dt, cfg);
+    sceneSpawn(&sc, 2000, args.len, args.seed);
+    sceneSetMaterial(&sc, 1, 0.5, 0.5);
+    for (int s = 0; s < 300; s++)
+        sceneStep(&sc);
+    std::printf("%-34s %zu of %zu bodies\n", "asleep at checkpoint", sc.stats.asleep, sc.bodies.count);
+    checkpointView view;
+    double err = checkpointWrite(path, &sc) && checkpointMap(path, &view) ? 0 : 1;
+    scene back;
+    if (!err) {
+        for (size_t i = 0; i < sc.bodies.count; i++)
+            err += std::memcmp(&view.x[i], &sc.bodies.x[i], sizeof(double)) != 0
+                || std::memcmp(&view.cy[i], &sc.bodies.verts.cy[i], sizeof(double)) != 0
+                || view.asleep[i] != sc.sleeping.asleep[i] || view.next[i] != sc.sleeping.next[i];
+        err += view.header.awake != sc.sleeping.awake.size();
+        ok &= report("checkpoint view mirrors the scene", err, 0);
+        checkpointRestore(view, &back);
+        checkpointUnmap(&view);
+    }
+    for (scene* s : { &sc, &back }) {
+        for (int k = 0; k < 60; k++)
+            sceneStep(s);
+        s->bodies.vx[0] = 1500;
+        for (int k = 0; k < 240; k++)
+            sceneStep(s);
+    }
+    err = fmax(err, sameBodies(sc.bodies, back.bodies) && sc.steps == back.steps
+        && sc.sleeping.awake == back.sleeping.awake ? 0 : 1);
+    ok &= report("checkpoint resume, bit for bit", err, 0);
+
+    /* a damaged or foreign file is refused */
+    uint64_t size = 0;
+    const uint8_t* data = mapRead(path, &size);
+    std::vector<uint8_t> bytes(data, data + size);
+    mapRelease(data, size);
+    const char* broken = "sim_bench_broken.checkpoint";
+    checkpointHeader h;
+    std::memcpy(&h, bytes.data(), sizeof(h));
+    /* the sleep state is the last three arrays: next, awake and asleep */
+    checkpointArray sleepArrays[3];
+    std::memcpy(sleepArrays, bytes.data() + sizeof(h) + (h.arrays - 3) * sizeof(checkpointArray), sizeof(sleepArrays));
+    const uint32_t* awake = (const uint32_t*)(bytes.data() + sleepArrays[1].offset);
+    const uint8_t* asleep = bytes.data() + sleepArrays[2].offset;
+    /* the sleep corruptions need two awake bodies and two sleepers; without them the check fails */
+    /* two sleepers, the chain of the first is led into the circle of the second and no longer closes */
+    uint32_t sleepers[2] = { UINT32_MAX, UINT32_MAX };
+    for (uint32_t i = 0, n = 0; i < h.bodies && n < 2; i++)
+        if (asleep[i])
+            sleepers[n++] = i;
+    err = h.awake >= 2 && sleepers[1] != UINT32_MAX ? 0 : 1;
+    int damages = err ? 3 : 8;
+    for (int k = 0; k < damages; k++) {
+        std::vector<uint8_t> b = bytes;
+        uint32_t* bnext = (uint32_t*)(b.data() + sleepArrays[0].offset);
+        uint32_t* bawake = (uint32_t*)(b.data() + sleepArrays[1].offset);
+        uint8_t* basleep = b.data() + sleepArrays[2].offset;
+        if (k == 0)
+            b.resize(b.size() / 2);
+        else if (k < 3)
+            b[k == 1 ? 0 : offsetof(checkpointHeader, version)] ^= 1;
+        else if (k == 3)
+            bawake[0] = (uint32_t)h.bodies;
+        else if (k == 4)
+            std::swap(bawake[0], bawake[1]);
+        else if (k == 5)
+            basleep[awake[0]] = 1;
+        else if (k == 6)
+            bnext[sleepers[0]] = sleepers[1];
+        else
+            bnext[sleepers[0]] = (uint32_t)h.bodies;
+        if (FILE* f = std::fopen(broken, "wb")) {
+            std::fwrite(b.data(), 1, b.size(), f);
+            std::fclose(f);
+        }
+        checkpointView v;
+        if (checkpointMap(broken, &v)) {
+            err++;
+            checkpointUnmap(&v);
+        }
+    }
+    std::remove(broken);
+    std::remove(path);
+    ok &= report("checkpoint refuses damaged files", err, 0);
+    return ok;
+}
+
+/// <summary>
+/// A sweep spec counts through its ranges, its default point is the scene of sceneSpawn, and the scenes
+/// come out the same whether they run one after another or side by side
+/// </summary>
+/// <returns>true if every check passed</returns>
+static bool verifySweep(const benchArgs&) {
+    bool ok = true;
+    const char* path = "sim_bench.sweep";
+    if (FILE* f = std::fopen(path, "w")) {
+        std::fprintf(f, "# sweep of the verify run\nbodies 300\nsteps 60\nbreite 300 600 2\nlen 10 30 3\n"
+            "speed 100\nomega 0 3.141592653589793 2\nseeds 2\nrestitution 0.8\n");
+        std::fclose(f);
+    }
+    sweepSpec spec;
+    double err = sweepLoad(path, &spec) && sweepCount(spec) == 24 && spec.bodies == 300 && spec.speed.to == 100 ? 0 : 1;
+    std::remove(path);
+    const sweepPoint last = sweepAt(spec, 23), third = sweepAt(spec, 2);
+    err = fmax(err, last.breite == 600 && last.len == 30 && last.omega == spec.omega.to && last.seed == 2 ? 0 : 1);
+    err = fmax(err, third.breite == 300 && third.len == 10 && third.omega == spec.omega.to && third.seed == 1 ? 0 : 1);
+    ok &= report("sweep spec and points", err, 0);
+
+    const sweepSpec plain;
+    scene a = sweepScene(plain, sweepAt(plain, 0)), b = makeScene(1280, 720, plain.dt);
+    sceneSpawn(&b, plain.bodies, plain.len.from, plain.seed);
+    sceneSetMaterial(&b, 1, plain.restitution, plain.friction);
+    ok &= report("sweep default is sceneSpawn", sameBodies(a.bodies, b.bodies) ? 0 : 1, 0);
+
+    std::vector<sweepResult> alone(sweepCount(spec)), side(alone.size());
+    for (size_t i = 0; i < alone.size(); i++)
+        alone[i] = sweepRun(spec, sweepAt(spec, i));
+    jobPool pool;
+    poolStart(&pool, 4);
+    poolFor(&pool, side.size(), 1, [&](size_t, size_t from, size_t to) {
+        for (size_t i = from; i < to; i++)
+            side[i] = sweepRun(spec, sweepAt(spec, i));
+    });
+    poolStop(&pool);
+    err = 0;
+    uint64_t contacts = 0;
+    for (size_t i = 0; i < alone.size(); i++) {
+        contacts += alone[i].bodyContacts;
+        err += alone[i].bodyContacts != side[i].bodyContacts || alone[i].wallContacts != side[i].wallContacts
+            || alone[i].energyEnd != side[i].energyEnd;
+    }
+    std::printf("%-34s %llu\n", "sweep body contacts", (unsigned long long)contacts);
+    ok &= report("sweep serial vs 4 threads", err + (contacts ? 0 : 1), 0);
+    return ok;
+}
+
+/// <summary>
+/// The suites of --verify, one per module; --suite runs one of them alone
+/// </summary>
+static const struct {
+    const char* name;
+    bool (*run)(const benchArgs&);
+} verifySuites[] = {
+    { "kernels", verifyKernels }, { "boundary", verifyBoundary }, { "broadphase", verifyBroadphase },
+    { "narrowphase", verifyNarrowphase }, { "solver", verifySolver },
+    { "threads", verifyThreads }, { "handoff", verifyHandoff }, { "raster", verifyRaster }, { "dirty", verifyDirty },
+    { "trace", verifyTrace }, { "profile", verifyProfile }, { "bodypool", verifyBodyPool },
+    { "commands", verifyCommands }, { "polygon", verifyPolygon }, { "precision", verifyPrecision },
+    { "integrator", verifyIntegrator }, { "substep", verifySubstep }, { "sleep", verifySleep },
+    { "checkpoint", verifyCheckpoint }, { "sweep", verifySweep }
+};
+
+/// <summary>
+/// Runs every suite of checks, or only the one --suite names. A failing suite does not stop the ones after it,
+/// the failed ones are listed at the end.
+/// </summary>
+/// <returns>true if every check passed; false if one failed or --suite names no suite</returns>
+static bool verifyAll(const benchArgs& args) {
+    bool ok = true, found = false;
+    std::string failed;
+    for (const auto& s : verifySuites) {
+        if (args.suite && std::strcmp(args.suite, s.name))
+            continue;
+        found = true;
+        std::printf("[%s]\n", s.name);
+        if (!s.run(args)) {
+            ok = false;
+            failed += failed.empty() ? s.name : std::string(" ") + s.name;
+        }
+    }
+    if (!found)
+        std::fprintf(stderr, "no suite %s\n", args.suite);
+    else if (!ok)
+        std::printf("failed: %s\n", failed.c_str());
+    return ok && found;
+}
+
+/// <summary>
+/// Steps the same world with ROT_VERTEX and ROT_POSE side by side and prints how far they drift apart,
+/// together with the side length error that compensator leaves in ROT_VERTEX mode
+/// </summary>
+static void diffModes(const benchArgs& args) {
+    world ref = makeWorld(1280, 720, args.dt, ROT_VERTEX);
+    worldSpawn(&ref, args.bodies, args.len, args.seed);
+    world pose = ref;
+    pose.mode = ROT_POSE;
+    long long every = args.steps >= 10 ? args.steps / 10 : 1;
+    std::printf("%10s %16s %16s\n", "step", "max vertex diff", "max side error");
+    for (long long s = 1; s <= args.steps; s++) {
+        worldStep(&ref);
+        worldStep(&pose);
+        if (s % every && s != args.steps)
+            continue;
+        double d = 0, side = 0;
+        for (size_t i = 0; i < ref.bodies.size(); i++) {
+            const triangle& t = ref.bodies[i].tri;
+            d = fmax(d, triDiff(t, pose.bodies[i].tri));
+            side = fmax(side, fabs(sqrt(pow(t.aA.x - t.bB.x, 2) + pow(t.aA.y - t.bB.y, 2)) - ref.bodies[i].len));
+        }
+        std::printf("%10lld %16.6e %16.6e\n", s, d, side);
+    }
+}
+
+/// <summary>
+/// Measures broad phase (grid and sort and sweep) and narrow phase cost for 1k, 10k, ... up to --bodies bodies.
+/// The world grows with the body count so the density, and with it the number of pairs per body, stays the same.
+/// </summary>
+/// <returns>false if grid and sweep disagree on the number of candidate pairs</returns>
+static bool benchPairs(const benchArgs& args) {
+    bool ok = true;
+    const int reps = 5;
+    std::printf("%10s %12s %12s %12s %12s %14s\n", "bodies", "pairs", "contacts", "grid ns/body", "sap ns/body", "narrow ns/pair");
+    for (size_t n = 1000; n <= args.bodies; n *= 10) {
+        double scale = sqrt(n / 1000.0);
+        world w = makeWorld(1280 * scale, 720 * scale, args.dt, ROT_POSE);
+        worldSpawn(&w, n, args.len, args.seed);
+        bodySoA soa;
+        soaFromWorld(&soa, w);
+        aabbSoA box;
+        hashGrid grid;
+        sweepAndPrune sap;
+        std::vector<bodyPair> gp, sp;
+        std::vector<contact> contacts;
+        double tGrid = 0, tSap = 0, tNarrow = 0;
+        size_t pairCount = 0;
+        for (int r = 0; r <= reps; r++) {
+            soaStep(&soa, w.breite, w.hoehe, w.dt);
+            auto t0 = std::chrono::steady_clock::now();
+            soaBounds(soa, &box);
+            gridPairs(&grid, box, soa.count, &gp);
+            auto t1 = std::chrono::steady_clock::now();
+            soaBounds(soa, &box);
+            sweepPairs(&sap, box, soa.count, &sp);
+            auto t2 = std::chrono::steady_clock::now();
+            soaNarrowphase(soa, gp, &contacts);
+            auto t3 = std::chrono::steady_clock::now();
+            /* the first round only warms up buffers and the sweep order */
+            if (r == 0)
+                continue;
+            tGrid += std::chrono::duration<double>(t1 - t0).count();
+            tSap += std::chrono::duration<double>(t2 - t1).count();
+            tNarrow += std::chrono::duration<double>(t3 - t2).count();
+            pairCount += gp.size();
+            if (gp.size() != sp.size()) {
+                std::printf("grid found %zu pairs, sweep %zu\n", gp.size(), sp.size());
+                ok = false;
+            }
+        }
+        std::printf("%10zu %12zu %12zu %12.2f %12.2f %14.2f\n", n, gp.size(), contacts.size(),
+            tGrid * 1e9 / (reps * (double)n), tSap * 1e9 / (reps * (double)n),
+            pairCount ? tNarrow * 1e9 / (double)pairCount : 0.0);
+    }
+    return ok;
+}
+
+/// <summary>
+/// Runs a crowded scene with the impulse solver and reports how many contacts are resolved per second,
+/// along with the energy before and after to show the effect of restitution and friction
+/// </summary>
+static void benchContacts(const benchArgs& args) {
+    scene sc = makeScene(1280, 720, args.dt);
+    sceneSpawn(&sc, args.bodies, args.len, args.seed);
+    sceneSetMaterial(&sc, 1, args.restitution, args.friction);
+    bodySoA* b = &sc.bodies;
+    double e0 = kineticEnergy(*b), tDetect = 0, tSolve = 0;
+    size_t resolved = 0;
+    for (long long s = 0; s < args.steps; s++) {
+        auto t0 = std::chrono::steady_clock::now();
+        soaRotate(b, sc.dt);
+        soaTranslate(b, sc.dt);
+        soaVertices(b);
+        soaBounds(*b, &sc.box);
+        gridPairs(&sc.grid, sc.box, b->count, &sc.pairs);
+        soaNarrowphase(*b, sc.pairs, &sc.contacts);
+        wallContacts(*b, sc.breite, sc.hoehe, &sc.contacts);
+        auto t1 = std::chrono::steady_clock::now();
+        solveContacts(b, sc.contacts, &sc.solver, sc.cfg.iterations);
+        separateContacts(b, sc.contacts);
+        auto t2 = std::chrono::steady_clock::now();
+        tDetect += std::chrono::duration<double>(t1 - t0).count();
+        tSolve += std::chrono::duration<double>(t2 - t1).count();
+        resolved += sc.contacts.size();
+    }
+    std::printf("bodies: %zu\n", args.bodies);
+    std::printf("steps: %lld\n", args.steps);
+    std::printf("iterations: %d\n", sc.cfg.iterations);
+    std::printf("contacts per step: %.1f\n", args.steps ? (double)resolved / args.steps : 0.0);
+    std::printf("detect seconds: %.6f\n", tDetect);
+    std::printf("solve seconds: %.6f\n", tSolve);
+    std::printf("contacts resolved/sec: %.1f\n", tSolve > 0 ? resolved / tSolve : 0.0);
+    std::printf("energy before: %.6e\n", e0);
+    std::printf("energy after: %.6e\n", kineticEnergy(*b));
+}
+
+/// <summary>
+/// Runs one scene for the warmup and measured steps and returns the measured steps per second
+/// </summary>
+static double timeScene(const benchArgs& args, responseMode response, jobPool* pool, double* sum) {
+    sceneConfig cfg;
+    cfg.response = response;
+    cfg.boundary = BOUNDARY_SWEPT;
+    scene sc = makeScene(1280, 720, args.dt, cfg);
+    sceneSpawn(&sc, args.bodies, args.len, args.seed);
+    sceneSetMaterial(&sc, 1, args.restitution, args.friction);
+    sc.pool = pool;
+    for (long long i = 0; i < args.warmup; i++)
+        sceneStep(&sc);
+    auto t0 = std::chrono::steady_clock::now();
+    for (long long i = 0; i < args.steps; i++)
+        sceneStep(&sc);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    *sum = checksum(sc.bodies);
+    return secs > 0 ? args.steps / secs : 0;
+}
+
+/// <summary>
+/// Steps the same scene with 1, 2, 4, ... threads up to --threads (0: all hardware threads) and prints
+/// the speedup against one thread, for the integration stage alone (rotate, translate and border
+/// reflection) and for the full impulse step. "same" tells whether the result matched the single thread run.
+/// </summary>
+static void benchScaling(const benchArgs& args) {
+    unsigned most = args.threads ? args.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> counts;
+    for (unsigned t = 1; t < most; t *= 2)
+        counts.push_back(t);
+    counts.push_back(most);
+
+    std::printf("bodies: %zu\n", args.bodies);
+    std::printf("steps: %lld\n", args.steps);
+    std::printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+    std::printf("%8s %16s %8s %16s %8s %5s\n", "threads", "integrate st/s", "speedup", "step st/s", "speedup", "same");
+    double base[2] = { 0, 0 }, sum0[2] = { 0, 0 };
+    for (unsigned t : counts) {
+        jobPool pool;
+        poolStart(&pool, t);
+        double rate[2], sum[2];
+        rate[0] = timeScene(args, RESPONSE_REFLECT, &pool, &sum[0]);
+        rate[1] = timeScene(args, RESPONSE_IMPULSE, &pool, &sum[1]);
+        poolStop(&pool);
+        if (t == 1)
+            for (int k = 0; k < 2; k++) {
+                base[k] = rate[k];
+                sum0[k] = sum[k];
+            }
+        std::printf("%8u %16.1f %8.2f %16.1f %8.2f %5s\n", t, rate[0], rate[0] / base[0], rate[1], rate[1] / base[1],
+            sum[0] == sum0[0] && sum[1] == sum0[1] ? "yes" : "no");
+    }
+}
+
+/// <summary>
+/// Prints the stage timings and writes them to the files given with --profile and --chrome
+/// </summary>
+/// <returns>false if a file could not be written</returns>
+static bool dumpProfile(const benchArgs& args) {
+    if (!profileEnabled)
+        return true;
+    profilePrint(stdout);
+    bool ok = true;
+    for (int k = 0; k < 2; k++) {
+        const char* path = k == 0 ? args.profile : args.chrome;
+        if (!path)
+            continue;
+        FILE* f = std::fopen(path, "w");
+        bool written = f && (k == 0 ? profileWriteJson(f) : profileWriteChromeTrace(f));
+        if (f)
+            written &= std::fclose(f) == 0;
+        if (!written)
+            std::fprintf(stderr, "could not write %s\n", path);
+        ok &= written;
+    }
+    return ok;
+}
+
+/// <summary>
+/// Runs the scene on a physics thread for --seconds while this thread plays the renderer: it takes the
+/// latest snapshot, interpolates every triangle and waits for the next frame at --fps (0: as fast as possible).
+/// Prints both rates and the heap allocations made by the render side.
+/// </summary>
+static void benchHandoff(const benchArgs& args) {
+    scene sc = makeScene(1280, 720, args.dt);
+    sceneSpawn(&sc, args.bodies, args.len, args.seed);
+    tripleBuffer buf;
+    bufferInit(&buf, sc.bodies.count);
+    commandRing ring;
+    std::vector<triangle> tris(sc.bodies.count);
+
+    simThread st;
+    simThreadStart(&st, &sc, &buf, &ring);
+    long long frames = 0, fresh = 0;
+    double checksumSum = 0;
+    auto frameTime = std::chrono::duration<double>(args.fps > 0 ? 1 / args.fps : 0);
+    auto next = std::chrono::steady_clock::now();
+    countAllocations = true;
+    while (simThreadTime(st) < args.seconds) {
+        bool isNew;
+        const snapshot* s = bufferRead(&buf, &isNew);
+        double alpha = snapshotAlpha(*s, simThreadTime(st) - args.dt);
+        for (size_t i = 0; i < s->count; i++)
+            tris[i] = snapshotTriangle(*s, i, alpha);
+        checksumSum += s->count ? tris[0].zZ.x : 0;
+        frames++;
+        fresh += isNew;
+        if (args.fps > 0) {
+            next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(frameTime);
+            std::this_thread::sleep_until(next);
+        }
+    }
+    countAllocations = false;
+    double secs = simThreadTime(st);
+    simThreadStop(&st);
+
+    std::printf("bodies: %zu\n", args.bodies);
+    std::printf("seconds: %.3f\n", secs);
+    std::printf("physics target Hz: %.1f\n", 1 / args.dt);
+    std::printf("physics steps/sec: %.1f\n", st.steps.load() / secs);
+    std::printf("physics steps dropped: %lld\n", st.dropped.load());
+    std::printf("render frames/sec: %.1f\n", frames / secs);
+    std::printf("new snapshots per frame: %.3f\n", frames ? (double)fresh / frames : 0.0);
+    std::printf("render allocations: %zu\n", allocations.load());
+    std::printf("checksum: %.6f\n", checksumSum);
+    dumpProfile(args);
+}
+
+/// <summary>
+/// Times the CPU side of the instanced renderer: interpolating a snapshot into the 16 byte instances
+/// that would be written to the mapped buffer, --steps times. Needs no GPU.
+/// </summary>
+static void benchPack(const benchArgs& args) {
+    scene sc = makeScene(1280, 720, args.dt);
+    sceneSpawn(&sc, args.bodies, args.len, args.seed);
+    snapshot snap;
+    snapshotBefore(&snap, sc.bodies);
+    sceneStep(&sc);
+    snapshotAfter(&snap, sc.bodies, sc.steps, sc.dt);
+    std::vector<instance> out(sc.bodies.count);
+    double sum = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (long long s = 0; s < args.steps; s++) {
+        packInstances(snap, (double)(s % 16) / 16, out.data());
+        sum += out.empty() ? 0 : out[s % out.size()].x;
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    double packed = (double)args.steps * sc.bodies.count;
+    std::printf("bodies: %zu\n", args.bodies);
+    std::printf("frames: %lld\n", args.steps);
+    std::printf("ns per instance: %.3f\n", packed > 0 ? secs * 1e9 / packed : 0.0);
+    std::printf("MB/s written: %.1f\n", secs > 0 ? packed * sizeof(instance) / secs / 1e6 : 0.0);
+    std::printf("checksum: %.6f\n", sum);
+}
+
+/// <summary>
+/// True if a --out pattern holds exactly one integer conversion for the frame number, %d with optional
+/// flags 0 and - and a width, and no other conversion than %%
+/// </summary>
+static bool framePattern(const char* pattern) {
+    int numbers = 0;
+    for (const char* c = pattern; *c; c++) {
+        if (*c != '%')
+            continue;
+        if (*++c == '%')
+            continue;
+        while (*c == '0' || *c == '-')
+            c++;
+        while (*c >= '0' && *c <= '9')
+            c++;
+        if (*c != 'd')
+            return false;
+        numbers++;
+    }
+    return numbers == 1;
+}
+
+/// <summary>
+/// Runs the scene and draws every step with the software rasterizer, optionally writing the frames.
+/// --out takes a printf pattern like frame%04d.png, or - to stream raw RGB to stdout for a video encoder.
+/// With --dirty only the tiles that changed since the last frame are cleared and drawn again.
+/// </summary>
+/// <returns>false if a frame could not be written</returns>
+static bool benchRaster(const benchArgs& args) {
+    const bool toStdout = args.out && !std::strcmp(args.out, "-");
+    if (args.out && !toStdout && !framePattern(args.out)) {
+        std::fprintf(stderr, "--out %s needs exactly one %%d for the frame number, like frame%%04d.png\n", args.out);
+        return false;
+    }
+    scene sc = makeScene(args.width, args.height, args.dt);
+    sceneSpawn(&sc, args.bodies, args.len, args.seed);
+    jobPool pool;
+    if (args.threads != 1)
+        poolStart(&pool, args.threads);
+    jobPool* p = args.threads != 1 ? &pool : nullptr;
+    softRaster r;
+    rasterInit(&r, args.width, args.height);
+    std::vector<triangle> tris(sc.bodies.count);
+    const imageFormat format = toStdout ? IMAGE_RAW : args.format;
+    FILE* log = toStdout ? stderr : stdout;
+
+    double rasterSecs = 0, writeSecs = 0;
+    bool ok = true;
+    for (long long f = 0; f < args.steps && ok; f++) {
+        sceneStep(&sc);
+        for (size_t i = 0; i < tris.size(); i++)
+            tris[i] = soaTriangle(sc.bodies, i);
+        auto t0 = std::chrono::steady_clock::now();
+        if (args.dirty)
+            rasterTrianglesDirty(&r, tris.data(), tris.size(), sc.breite, sc.hoehe, rasterColor(255, 255, 255),
+                rasterColor(0, 0, 0), p);
+        else {
+            rasterClear(&r, rasterColor(0, 0, 0));
+            rasterTriangles(&r, tris.data(), tris.size(), sc.breite, sc.hoehe, rasterColor(255, 255, 255), p);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        rasterSecs += std::chrono::duration<double>(t1 - t0).count();
+        if (toStdout)
+            ok = writeImage(stdout, r.fb, format);
+        else if (args.out) {
+            char path[1024];
+            std::snprintf(path, sizeof(path), args.out, (int)f);
+            FILE* file = std::fopen(path, "wb");
+            ok = file && writeImage(file, r.fb, format);
+            if (file)
+                ok &= std::fclose(file) == 0;
+            if (!ok)
+                std::fprintf(stderr, "could not write %s\n", path);
+        }
+        writeSecs += std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+    }
+    if (p)
+        poolStop(&pool);
+
+    const double frames = (double)args.steps, pixels = (double)r.covered;
+    std::fprintf(log, "kernel: %s\n", rasterKernelName());
+    std::fprintf(log, "threads: %u\n", poolThreads(p));
+    std::fprintf(log, "bodies: %zu\n", args.bodies);
+    std::fprintf(log, "frames: %lld\n", args.steps);
+    std::fprintf(log, "size: %dx%d\n", args.width, args.height);
+    std::fprintf(log, "ms per frame: %.3f\n", frames > 0 ? rasterSecs * 1e3 / frames : 0.0);
+    std::fprintf(log, "pixels rasterized/sec: %.1f M\n", rasterSecs > 0 ? pixels / rasterSecs / 1e6 : 0.0);
+    std::fprintf(log, "triangles/sec: %.1f M\n", rasterSecs > 0 ? frames * tris.size() / rasterSecs / 1e6 : 0.0);
+    std::fprintf(log, "covered per frame: %.2f %%\n", frames > 0 ? 100 * pixels / (frames * args.width * args.height) : 0.0);
+    std::fprintf(log, "redraw: %s\n", args.dirty ? "dirty tiles" : "full");
+    std::fprintf(log, "touched per frame: %.2f %%\n", !args.dirty ? 100.0
+        : frames > 0 ? 100 * (double)r.dirty.touchedTotal / (frames * args.width * args.height) : 0.0);
+    if (args.out)
+        std::fprintf(log, "ms per frame written: %.3f\n", frames > 0 ? writeSecs * 1e3 / frames : 0.0);
+    return ok;
+}
+
+/// <summary>
+/// Replaces a share of the bodies every step: despawns random live bodies through their handles and
+/// spawns as many new ones, then steps the scene. Reports the cost per spawn and despawn and counts
+/// the heap allocations once the pool has reached its size.
+/// </summary>
+static void benchChurn(const benchArgs& args) {
+    sceneConfig cfg;
+    cfg.sleep = args.sleepCfg;
+    scene sc = makeScene(1280, 720, args.dt, cfg);
+    sceneSpawn(&sc, args.bodies, args.len, args.seed);
+    bodyPool bp;
+    bodyPoolInit(&bp, &sc.bodies, &sc.sleeping);
+    bodyPoolReserve(&bp, args.bodies);
+    std::vector<bodyHandle> live;
+    live.reserve(args.bodies);
+    for (size_t i = 0; i < sc.bodies.count; i++)
+        live.push_back(bodyPoolHandle(bp, i));
+
+    const size_t perStep = std::max<size_t>(1, args.bodies / 16);
+    std::default_random_engine re(args.seed);
+    std::uniform_real_distribution<double> ux(-sc.breite + args.len, sc.breite - args.len), uy(-sc.hoehe + args.len, sc.hoehe - args.len);
+    std::uniform_real_distribution<double> uv(-150, 150);
+    double churnSecs = 0, stepSecs = 0;
+    for (long long s = 0; s < args.warmup + args.steps; s++) {
+        if (s == args.warmup) {
+            allocations.store(0);
+            churnSecs = stepSecs = 0;
+        }
+        countAllocations = s >= args.warmup;
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t k = 0; k < perStep && !live.empty(); k++) {
+            size_t j = re() % live.size();
+            bodyPoolDespawn(&bp, live[j]);
+            live[j] = live.back();
+            live.pop_back();
+        }
+        for (size_t k = 0; k < perStep; k++)
+            live.push_back(bodyPoolSpawn(&bp, makeBody({ ux(re), uy(re) }, args.len, 0, { uv(re), uv(re) }, 1)));
+        auto t1 = std::chrono::steady_clock::now();
+        countAllocations = false;
+        sceneStep(&sc);
+        churnSecs += std::chrono::duration<double>(t1 - t0).count();
+        stepSecs += std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+    }
+    const double ops = 2.0 * perStep * args.steps;
+    std::printf("bodies: %zu\n", sc.bodies.count);
+    std::printf("spawned and despawned per step: %zu\n", perStep);
+    std::printf("sleep: %s\n", cfg.sleep.enabled ? "on" : "off");
+    std::printf("steps: %lld\n", args.steps);
+    std::printf("ns per spawn or despawn: %.1f\n", ops > 0 ? churnSecs * 1e9 / ops : 0.0);
+    std::printf("spawns+despawns/sec: %.1f M\n", churnSecs > 0 ? ops / churnSecs / 1e6 : 0.0);
+    std::printf("steps/sec: %.1f\n", stepSecs > 0 ? args.steps / stepSecs : 0.0);
+    std::printf("allocations while churning: %zu\n", allocations.load());
+    std::printf("checksum: %.6f\n", checksum(sc.bodies));
+}
+
+/// <summary>
+/// Times a command on the selected bodies: a resize of all of them, of a box holding about half of them
+/// and of half the index range, and a spin of all of them. Then folds a queue of resizes into one pass
+/// and runs the command script (--script, or a built-in one) with the renderer at several frame rates.
+/// </summary>
+static bool benchInput(const benchArgs& args) {
+    commandScript script = builtinScript(args);
+    if (args.script && !scriptLoad(args.script, &script)) {
+        std::fprintf(stderr, "can not read script %s\n", args.script);
+        return false;
+    }
+    scene sc = makeScene(1280, 720, args.dt);
+    sceneSpawn(&sc, args.bodies, args.len, args.seed);
+    const int reps = 200;
+    auto timeCommand = [&](simCommand cmd) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) {
+            sceneApply(&sc, cmd);
+            if (cmd.kind == CMD_RESIZE)
+                cmd.value = 1 / cmd.value;
+        }
+        const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        return sc.bodies.count ? secs * 1e9 / reps / sc.bodies.count : 0.0;
+    };
+    simCommand all = { CMD_RESIZE, 1.1, 0, {} }, box = all, range = all, spin = { CMD_SPIN, 0.1, 0, {} };
+    box.select.kind = SELECT_BOX;
+    box.select.lox = -sc.breite / 2;
+    box.select.hix = sc.breite / 2;
+    box.select.loy = -sc.hoehe;
+    box.select.hiy = sc.hoehe;
+    range.select.kind = SELECT_RANGE;
+    range.select.count = sc.bodies.count / 2;
+    std::printf("bodies: %zu\n", sc.bodies.count);
+    std::printf("ns per body, resize all: %.3f\n", timeCommand(all));
+    std::printf("ns per body, resize box: %.3f\n", timeCommand(box));
+    std::printf("ns per body, resize range: %.3f\n", timeCommand(range));
+    std::printf("ns per body, spin all: %.3f\n", timeCommand(spin));
+
+    commandRing ring;
+    size_t queued = 0;
+    while (commandPush(&ring, all))
+        queued++;
+    auto t0 = std::chrono::steady_clock::now();
+    const size_t passes = commandDrain(&ring, &sc, args.dt, nullptr);
+    const double drainSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("queued resizes: %zu, passes: %zu, ms: %.3f\n", queued, passes, drainSecs * 1e3);
+
+    for (double fps : { 24.0, 60.0, 144.0, 1000.0 }) {
+        size_t applied;
+        const scene run = runScript(args, script, fps, &applied);
+        std::printf("script at %6.0f fps: %zu commands applied, checksum %.6f\n", fps, applied, checksum(run.bodies));
+    }
+    return true;
+}
+
+/* the shape kernels under one name each, so timeShapes can run the hand-written triangle, Polygon<N> and polygon alike */
+static void shapePose(triangle* t, const vertex*, double phi, double len) { triPose(t, phi, len); }
+static void shapeRotate(triangle* t, double phi) { triRotate(t, phi); }
+static void shapeTranslate(triangle* t, velocity v) { triTranslate(t, v); }
+static bool shapeSweep(triangle* t, velocity* v, double dt, double* omega) { return triSweep(t, v, dt, 1280, 720, omega); }
+static bool shapeOverlap(const triangle& p, const triangle& q, contact* c) { return triOverlap(p, q, c); }
+static vertex shapeCenter(const triangle& t) { return t.zZ; }
+
+template <int N>
+static void shapePose(Polygon<N>* p, const vertex* unit, double phi, double len) { polyPose(p, unit, phi, len); }
+template <int N>
+static void shapeRotate(Polygon<N>* p, double phi) { polyRotate(p, phi); }
+template <int N>
+static void shapeTranslate(Polygon<N>* p, velocity v) { polyTranslate(p, v); }
+template <int N>
+static bool shapeSweep(Polygon<N>* p, velocity* v, double dt, double* omega) { return polySweep(p, v, dt, 1280, 720, omega); }
+template <int N>
+static bool shapeOverlap(const Polygon<N>& p, const Polygon<N>& q, contact* c) { return polyOverlap(p, q, c); }
+template <int N>
+static vertex shapeCenter(const Polygon<N>& p) { return p.zZ; }
+
+static void shapePose(polygon* p, const vertex* unit, double phi, double len) { polyPose(p, unit, phi, len); }
+static void shapeRotate(polygon* p, double phi) { polyRotate(p, phi); }
+static void shapeTranslate(polygon* p, velocity v) { polyTranslate(p, v); }
+static bool shapeSweep(polygon* p, velocity* v, double dt, double* omega) { return polySweep(p, v, dt, 1280, 720, omega); }
+static bool shapeOverlap(const polygon& p, const polygon& q, contact* c) { return polyOverlap(p, q, c); }
+static vertex shapeCenter(const polygon& p) { return p.zZ; }
+
+/// <summary>
+/// Times pose, rotate, translate, border sweep and the overlap test of neighbouring shapes,
+/// every kernel args.steps times over all shapes, and prints ns per shape and call
+/// </summary>
+/// <param name="name">label of the row</param>
+/// <param name="shapes">the shapes, every odd one placed next to the one before it</param>
+/// <param name="unit">body space vertex offsets for the pose</param>
+template <class Shape>
+static void timeShapes(const char* name, std::vector<Shape> shapes, const vertex* unit, const benchArgs& args) {
+    std::vector<velocity> velo(shapes.size());
+    std::vector<double> omega(shapes.size());
+    std::default_random_engine re(args.seed);
+    std::uniform_real_distribution<double> uv(-300, 300), uo(-4, 4);
+    for (size_t i = 0; i < shapes.size(); i++) {
+        velo[i] = { uv(re), uv(re) };
+        omega[i] = uo(re);
+    }
+    const double dt = args.dt, n = (double)args.steps * shapes.size();
+    double ns[5];
+    size_t hits = 0;
+    auto time = [&](int k, auto&& fn) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (long long s = 0; s < args.steps; s++)
+            fn(s);
+        ns[k] = n > 0 ? std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() * 1e9 / n : 0.0;
+    };
+    time(0, [&](long long s) {
+        for (size_t i = 0; i < shapes.size(); i++)
+            shapePose(&shapes[i], unit, omega[i] * dt * s, args.len);
+    });
+    time(1, [&](long long) {
+        for (size_t i = 0; i < shapes.size(); i++)
+            shapeRotate(&shapes[i], omega[i] * dt);
+    });
+    time(2, [&](long long s) {
+        const double sign = s % 2 ? -dt : dt;
+        for (size_t i = 0; i < shapes.size(); i++)
+            shapeTranslate(&shapes[i], { velo[i].x * sign, velo[i].y * sign });
+    });
+    std::vector<Shape> moving = shapes;
+    time(3, [&](long long) {
+        for (size_t i = 0; i < moving.size(); i++)
+            hits += shapeSweep(&moving[i], &velo[i], dt, &omega[i]);
+    });
+    hits = 0;
+    time(4, [&](long long) {
+        contact c;
+        for (size_t i = 0; i + 1 < shapes.size(); i += 2)
+            hits += shapeOverlap(shapes[i], shapes[i + 1], &c);
+        for (size_t i = 1; i + 1 < shapes.size(); i += 2)
+            hits += shapeOverlap(shapes[i], shapes[i + 1], &c);
+    });
+    double sum = 0;
+    for (const Shape& s : moving)
+        sum += shapeCenter(s).x + shapeCenter(s).y;
+    std::printf("%-14s %8.3f %8.3f %8.3f %8.3f %8.3f %9.1f %% %14.3f\n", name, ns[0], ns[1], ns[2], ns[3], ns[4],
+        n > 0 ? 100.0 * hits / n : 0.0, sum);
+}
+
+/// <summary>
+/// Compares the Polygon&lt;3&gt; kernels against the hand-written triangle functions, then times squares,
+/// hexagons and the run time polygon on the same positions
+/// </summary>
+static void benchPoly(const benchArgs& args) {
+    std::default_random_engine re(args.seed);
+    std::uniform_real_distribution<double> ux(-1280 + args.len, 1280 - args.len), uy(-720 + args.len, 720 - args.len);
+    std::uniform_real_distribution<double> near(-args.len, args.len), angle(-3.14159265358979, 3.14159265358979);
+    std::vector<vertex> centers(args.bodies);
+    std::vector<double> phi(args.bodies);
+    for (size_t i = 0; i < args.bodies; i++) {
+        centers[i] = i % 2 ? vertex{ centers[i - 1].x + near(re), centers[i - 1].y + near(re) } : vertex{ ux(re), uy(re) };
+        phi[i] = angle(re);
+    }
+    std::vector<triangle> tris(args.bodies);
+    std::vector<Polygon<3>> p3(args.bodies);
+    std::vector<Polygon<4>> p4(args.bodies);
+    std::vector<Polygon<6>> p6(args.bodies);
+    std::vector<polygon> d3(args.bodies), d6(args.bodies);
+    for (size_t i = 0; i < args.bodies; i++) {
+        tris[i].zZ = centers[i];
+        triPose(&tris[i], phi[i], args.len);
+        p3[i] = makeRegular<3>(centers[i], args.len, phi[i]);
+        p4[i] = makeRegular<4>(centers[i], args.len, phi[i]);
+        p6[i] = makeRegular<6>(centers[i], args.len, phi[i]);
+        d3[i] = makeRegular(3, centers[i], args.len, phi[i]);
+        d6[i] = makeRegular(6, centers[i], args.len, phi[i]);
+    }
+    std::printf("bodies: %zu\n", args.bodies);
+    std::printf("steps: %lld\n", args.steps);
+    std::printf("ns per shape     pose   rotate translate  sweep  overlap    overlaps       checksum\n");
+    timeShapes("triangle", tris, nullptr, args);
+    timeShapes("Polygon<3>", p3, regularUnit<3>.data(), args);
+    timeShapes("polygon n=3", d3, regularUnit<3>.data(), args);
+    timeShapes("Polygon<4>", p4, regularUnit<4>.data(), args);
+    timeShapes("Polygon<6>", p6, regularUnit<6>.data(), args);
+    timeShapes("polygon n=6", d6, regularUnit<6>.data(), args);
+}
+
+/// <summary>
+/// Distance of every body of a store from the double reference: center position and orientation.
+/// A body that is further off than its own size has bounced at a different step than the reference.
+/// </summary>
+template <class T>
+static void precisionError(const bodyStore<double>& ref, const bodyStore<T>& st, double len,
+    double* maxPos, double* rmsPos, double* maxPhi, size_t* diverged) {
+    double sum = 0;
+    *maxPos = *maxPhi = 0;
+    *diverged = 0;
+    for (size_t i = 0; i < ref.count; i++) {
+        const triangle p = storeTriangle(st, i), q = storeTriangle(ref, i);
+        const double d = hypot(p.zZ.x - q.zZ.x, p.zZ.y - q.zZ.y);
+        double phiP, phiQ, omega;
+        storeSpin(st, i, &phiP, &omega);
+        storeSpin(ref, i, &phiQ, &omega);
+        *maxPos = fmax(*maxPos, d);
+        *maxPhi = fmax(*maxPhi, fabs(remainder(phiP - phiQ, 2 * 3.14159265358979323846)));
+        *diverged += d > len;
+        sum += d * d;
+    }
+    *rmsPos = ref.count ? sqrt(sum / ref.count) : 0;
+}
+
+/// <summary>
+/// Steps the same world in double, float and fixed32 and prints, at every tenth of the run, how far float
+/// and fixed32 have drifted from the double reference. Then prints the memory per body and the time per
+/// body-step of every store, next to the vectorized double bodySoA.
+/// </summary>
+static void benchPrecision(const benchArgs& args) {
+    world w = makeWorld(1280, 720, args.dt);
+    worldSpawn(&w, args.bodies, args.len, args.seed);
+    bodySoA soa;
+    soaFromWorld(&soa, w);
+    bodyStore<double> sd;
+    bodyStore<float> sf;
+    bodyStore<fixed32> sx;
+    storeFromWorld(&sd, w);
+    storeFromWorld(&sf, w);
+    storeFromWorld(&sx, w);
+    double secs[4] = { 0, 0, 0, 0 };
+    auto timed = [&](int k, auto&& fn) {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        secs[k] += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    };
+    const long long every = std::max(1LL, args.steps / 10);
+    std::printf("bodies: %zu\n", args.bodies);
+    std::printf("steps: %lld\n", args.steps);
+    std::printf("%8s %26s %26s %10s\n", "", "float vs double", "fixed32 vs double", "diverged");
+    std::printf("%8s %8s %8s %8s %8s %8s %8s %10s\n", "step", "max px", "rms px", "max rad", "max px", "rms px", "max rad", "flt / fix");
+    for (long long k = 1; k <= args.steps; k++) {
+        timed(0, [&] { soaStep(&soa, w.breite, w.hoehe, w.dt); });
+        timed(1, [&] { storeStep(&sd, w.breite, w.hoehe, w.dt); });
+        timed(2, [&] { storeStep(&sf, w.breite, w.hoehe, w.dt); });
+        timed(3, [&] { storeStep(&sx, w.breite, w.hoehe, w.dt); });
+        if (k % every && k != args.steps)
+            continue;
+        double posF, rmsF, phiF, posX, rmsX, phiX;
+        size_t divF, divX;
+        precisionError(sd, sf, args.len, &posF, &rmsF, &phiF, &divF);
+        precisionError(sd, sx, args.len, &posX, &rmsX, &phiX, &divX);
+        std::printf("%8lld %8.4f %8.4f %8.2e %8.4f %8.4f %8.2e %4zu / %zu\n", k, posF, rmsF, phiF, posX, rmsX, phiX, divF, divX);
+    }
+    const double bodySteps = (double)args.steps * args.bodies;
+    const char* names[4] = { "double soa", storeScalarName<double>(), storeScalarName<float>(), storeScalarName<fixed32>() };
+    const size_t bytes[4] = { 17 * sizeof(double), storeBodyBytes<double>(), storeBodyBytes<float>(), storeBodyBytes<fixed32>() };
+    std::printf("kernels: %s\n", soaKernelName());
+    std::printf("%-12s %10s %18s\n", "store", "bytes/body", "ns per body-step");
+    for (int k = 0; k < 4; k++)
+        std::printf("%-12s %10zu %18.3f\n", names[k], bytes[k], bodySteps > 0 ? secs[k] * 1e9 / bodySteps : 0.0);
+}
+
+/// <summary>
+/// Deepest wall contact the solver was handed in the last step
+/// </summary>
+static double wallDepth(const scene& sc) {
+    double d = 0;
+    for (const contact& c : sc.contacts)
+        if (c.a == WALL || c.b == WALL)
+            d = fmax(d, c.depth);
+    return d;
+}
+
+/// <summary>
+/// Steps the impulse scene with a growing share of bodies twenty times faster than the rest, once with the
+/// integrator of the command line and once with sub-stepping off, and prints the time per body-step, the
+/// sub-steps taken and the deepest wall penetration the solver has to resolve. Use a hitch sized --dt.
+/// </summary>
+static void benchSubstep(const benchArgs& args) {
+    std::printf("bodies: %zu\n", args.bodies);
+    std::printf("steps: %lld\n", args.steps);
+    std::printf("dt: %.4f\n", args.dt);
+    std::printf("integrator: %s, max sub-steps %d\n", integratorName(args.integrator.kind), args.integrator.maxSubsteps);
+    std::printf("%8s %8s %12s %14s %14s %12s %12s\n", "fast", "bodies", "substeps", "ns sub", "ns plain", "depth sub", "depth plain");
+    for (double share : { 0.0, 0.001, 0.01, 0.1, 1.0 }) {
+        double ns[2], depth[2];
+        size_t fast = 0, substeps = 0;
+        for (int k = 0; k < 2; k++) {
+            sceneConfig cfg;
+            cfg.integrator = args.integrator;
+            if (k)
+                cfg.integrator.maxSubsteps = 1;
+            scene sc = makeScene(1280, 720, args.dt, cfg);
+            sceneSpawn(&sc, args.bodies, args.len, args.seed);
+            sceneSetMaterial(&sc, 1, args.restitution, args.friction);
+            for (size_t i = 0; i < sc.bodies.count; i++)
+                if (floor((i + 1) * share) > floor(i * share)) {
+                    sc.bodies.vx[i] *= 20;
+                    sc.bodies.vy[i] *= 20;
+                }
+            depth[k] = 0;
+            auto t0 = std::chrono::steady_clock::now();
+            for (long long s = 0; s < args.steps; s++) {
+                sceneStep(&sc);
+                depth[k] = fmax(depth[k], wallDepth(sc));
+                if (!k) {
+                    fast += sc.stats.fastBodies;
+                    substeps += sc.stats.substeps;
+                }
+            }
+            const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            ns[k] = args.steps > 0 && sc.bodies.count ? secs * 1e9 / args.steps / sc.bodies.count : 0;
+        }
+        const double perStep = args.steps > 0 ? 1.0 / args.steps : 0;
+        std::printf("%7.1f%% %8.1f %12.1f %14.3f %14.3f %12.2f %12.2f\n", share * 100, fast * perStep, substeps * perStep,
+            ns[0], ns[1], depth[0], depth[1]);
+    }
+}
+
+/// <summary>
+/// Lets an impulse scene come to rest under drag, once with sleeping on and once with it off, and prints
+/// the awake and sleeping bodies and the time per step of both over ten equal parts of the run. Halfway
+/// one body is thrown into the others, so the islands it hits wake up again.
+/// </summary>
+static void benchSleep(const benchArgs& args) {
+    integratorConfig ic = args.integrator;
+    if (ic.drag == 0)
+        ic.drag = 1;
+    const long long blocks = 10, block = std::max(1LL, args.steps / blocks);
+    std::printf("bodies: %zu\n", args.bodies);
+    std::printf("steps: %lld\n", block * blocks);
+    std::printf("drag: %g, gravity: %g\n", ic.drag, 0.0 - ic.gravityY);
+    std::printf("rest below: %g px/s, %g rad/s for %g s\n", args.sleepCfg.linear, args.sleepCfg.angular, args.sleepCfg.time);
+    std::printf("%8s %8s %8s %8s %12s %12s\n", "step", "awake", "asleep", "woken", "ms sleep", "ms awake");
+    scene sc[2];
+    for (int k = 0; k < 2; k++) {
+        sceneConfig cfg;
+        cfg.integrator = ic;
+        cfg.sleep = args.sleepCfg;
+        cfg.sleep.enabled = !k;
+        sc[k] = makeScene(1280, 720, args.dt, cfg);
+        sceneSpawn(&sc[k], args.bodies, args.len, args.seed);
+        sceneSetMaterial(&sc[k], 1, args.restitution, args.friction);
+    }
+    for (long long b = 0; b < blocks; b++) {
+        double ms[2];
+        size_t woken = 0;
+        for (int k = 0; k < 2; k++) {
+            if (b == blocks / 2 && sc[k].bodies.count) {
+                simCommand cmd = { CMD_SPIN, 5, 0, {} };
+                cmd.select.kind = SELECT_RANGE;
+                cmd.select.count = 1;
+                sceneApply(&sc[k], cmd);
+                sc[k].bodies.vx[0] = 1000;
+                sc[k].bodies.vy[0] = 300;
+            }
+            auto t0 = std::chrono::steady_clock::now();
+            for (long long s = 0; s < block; s++) {
+                sceneStep(&sc[k]);
+                if (!k)
+                    woken += sc[k].stats.woken;
+            }
+            ms[k] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() / block;
+        }
+        std::printf("%8lld %8zu %8zu %8zu %12.4f %12.4f\n", (b + 1) * block, sc[0].stats.awake, sc[0].stats.asleep, woken,
+            ms[0], ms[1]);
+    }
+}
+
+/// <summary>
+/// Lets an impulse scene run through the warmup and writes it to a checkpoint, then times mapping and
+/// restoring it. Original and restored scene are stepped side by side and must stay equal bit for bit.
+/// Finally --forks experiments are restored from the one mapping, each with another restitution,
+/// and their energy is printed.
+/// </summary>
+/// <returns>false if the checkpoint could not be written or read, or the restored scene went its own way</returns>
+static bool benchCheckpoint(const benchArgs& args) {
+    sceneConfig cfg;
+    cfg.integrator = args.integrator;
+    cfg.sleep = args.sleepCfg;
+    scene sc = makeScene(1280, 720, args.dt, cfg);
+    sceneSpawn(&sc, args.bodies, args.len, args.seed);
+    sceneSetMaterial(&sc, 1, args.restitution, args.friction);
+    for (long long i = 0; i < args.warmup; i++)
+        sceneStep(&sc);
+
+    auto t0 = std::chrono::steady_clock::now();
+    const bool written = checkpointWrite(args.checkpoint, &sc);
+    auto t1 = std::chrono::steady_clock::now();
+    checkpointView view;
+    const bool mapped = written && checkpointMap(args.checkpoint, &view);
+    auto t2 = std::chrono::steady_clock::now();
+    if (!mapped) {
+        std::fprintf(stderr, "could not %s %s\n", written ? "read" : "write", args.checkpoint);
+        return false;
+    }
+    scene back;
+    checkpointRestore(view, &back);
+    auto t3 = std::chrono::steady_clock::now();
+    const double mb = view.size / 1048576.0, restoreMs = std::chrono::duration<double, std::milli>(t3 - t2).count();
+    std::printf("bodies: %zu, checkpoint at step %lld\n", sc.bodies.count, sc.steps);
+    std::printf("file: %.1f MB\n", mb);
+    std::printf("write ms: %.3f\n", std::chrono::duration<double, std::milli>(t1 - t0).count());
+    std::printf("map ms: %.3f\n", std::chrono::duration<double, std::milli>(t2 - t1).count());
+    std::printf("restore ms: %.3f (%.1f GB/s)\n", restoreMs, restoreMs > 0 ? mb / 1024 / (restoreMs / 1e3) : 0.0);
+
+    long long diverged = -1;
+    for (long long i = 0; i < args.steps && diverged < 0; i++) {
+        sceneStep(&sc);
+        sceneStep(&back);
+        if (!sameBodies(sc.bodies, back.bodies))
+            diverged = i;
+    }
+    if (diverged < 0)
+        std::printf("resumed run: equal to the original for %lld steps\n", args.steps);
+    else
+        std::printf("resumed run: differs from the original in step %lld\n", diverged);
+
+    std::printf("%6s %12s %14s %14s %12s\n", "fork", "restitution", "energy start", "energy end", "ms/step");
+    for (int k = 0; k < args.forks; k++) {
+        scene fork;
+        checkpointRestore(view, &fork);
+        const double e = args.forks > 1 ? (double)k / (args.forks - 1) : args.restitution;
+        for (size_t i = 0; i < fork.bodies.count; i++)
+            fork.bodies.restitution[i] = e;
+        const double before = kineticEnergy(fork.bodies);
+        auto f0 = std::chrono::steady_clock::now();
+        for (long long i = 0; i < args.steps; i++)
+            sceneStep(&fork);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - f0).count();
+        std::printf("%6d %12.2f %14.1f %14.1f %12.4f\n", k, e, before, kineticEnergy(fork.bodies),
+            args.steps > 0 ? ms / args.steps : 0.0);
+    }
+    checkpointUnmap(&view);
+    return diverged < 0;
+}
+
+/// <summary>
+/// Runs every scene of a sweep spec, one scene per task of a pool with --threads threads (0: all hardware
+/// threads). The scenes share nothing; a line of CSV is written for each as soon as it is done, to --out
+/// or stdout, so the rows come in the order the scenes finish. --columns FILE also writes all results
+/// column by column, in scene order. The totals go to stderr.
+/// </summary>
+/// <returns>false if the spec can not be read or an output can not be written</returns>
+static bool benchSweep(const benchArgs& args) {
+    sweepSpec spec;
+    if (!sweepLoad(args.sweep, &spec)) {
+        std::fprintf(stderr, "%s is not a sweep spec\n", args.sweep);
+        return false;
+    }
+    FILE* out = args.out && std::strcmp(args.out, "-") ? std::fopen(args.out, "w") : stdout;
+    if (!out) {
+        std::fprintf(stderr, "could not create %s\n", args.out);
+        return false;
+    }
+    const size_t n = sweepCount(spec);
+    std::vector<sweepResult> results(n);
+    jobPool pool;
+    poolStart(&pool, args.threads);
+    std::mutex lock;
+    sweepCsvHeader(out);
+    auto t0 = std::chrono::steady_clock::now();
+    poolFor(&pool, n, 1, [&](size_t, size_t from, size_t to) {
+        for (size_t i = from; i < to; i++) {
+            results[i] = sweepRun(spec, sweepAt(spec, i));
+            std::lock_guard<std::mutex> hold(lock);
+            sweepCsvRow(out, results[i]);
+            std::fflush(out);
+        }
+    });
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    const unsigned threads = poolThreads(&pool);
+    poolStop(&pool);
+    if (out != stdout)
+        std::fclose(out);
+    std::fprintf(stderr, "scenes: %zu, bodies: %zu, steps: %lld, threads: %u\n", n, spec.bodies, spec.steps, threads);
+    std::fprintf(stderr, "seconds: %.3f, scenes/sec: %.2f, body-steps/sec: %.3g\n", secs, secs > 0 ? n / secs : 0.0,
+        secs > 0 ? (double)n * spec.bodies * spec.steps / secs : 0.0);
+    if (args.columns && !sweepWriteColumns(args.columns, results)) {
+        std::fprintf(stderr, "could not create %s\n", args.columns);
+        return false;
+    }
+    return true;
+}
+
+/// <summary>
+/// Runs a recorded trace again as fast as possible and reports whether it reproduced the recording
+/// </summary>
+/// <returns>false if the trace could not be read or did not replay bit for bit</returns>
+static bool benchReplay(const benchArgs& args) {
+    scene sc;
+    jobPool pool;
+    if (args.threads != 1) {
+        poolStart(&pool, args.threads);
+        sc.pool = &pool;
+    }
+    replayStats rs;
+    bool read = traceReplay(args.replay, &sc, &rs);
+    if (sc.pool)
+        poolStop(&pool);
+    if (!read) {
+        std::fprintf(stderr, "%s is not a complete trace\n", args.replay);
+        return false;
+    }
+    const double simSeconds = rs.steps * sc.dt;
+    std::printf("bodies: %zu\n", sc.bodies.count);
+    std::printf("steps: %lld\n", rs.steps);
+    std::printf("commands: %lld\n", rs.commands);
+    std::printf("simulated seconds: %.3f\n", simSeconds);
+    std::printf("replay seconds: %.3f\n", rs.seconds);
+    std::printf("x real time: %.1f\n", rs.seconds > 0 ? simSeconds / rs.seconds : 0.0);
+    std::printf("mismatched values: %lld\n", rs.mismatches);
+    if (rs.firstMismatch >= 0)
+        std::printf("first mismatch in step: %lld\n", rs.firstMismatch);
+    std::printf("checksum: %.6f\n", checksum(sc.bodies));
+    return rs.mismatches == 0;
+}
+
+/// <summary>
+/// Steps N triangles with a fixed dt, without any window or GL context, and reports the throughput
+/// </summary>
+int main(int argc, char** argv) {
+    benchArgs args;
+    if (!parseArgs(argc, argv, &args)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (args.verify)
+        return verifyAll(args) ? 0 : 1;
+    if (args.pairs)
+        return benchPairs(args) ? 0 : 1;
+    if (args.contacts) {
+        benchContacts(args);
+        return 0;
+    }
+    if (args.diff) {
+        diffModes(args);
+        return 0;
+    }
+    if (args.scaling) {
+        benchScaling(args);
+        return 0;
+    }
+    if (args.handoff) {
+        benchHandoff(args);
+        return 0;
+    }
+    if (args.pack) {
+        benchPack(args);
+        return 0;
+    }
+    if (args.raster)
+        return benchRaster(args) ? 0 : 1;
+    if (args.replay)
+        return benchReplay(args) ? 0 : 1;
+    if (args.churn) {
+        benchChurn(args);
+        return 0;
+    }
+    if (args.input)
+        return benchInput(args) ? 0 : 1;
+    if (args.poly) {
+        benchPoly(args);
+        return 0;
+    }
+    if (args.precision) {
+        benchPrecision(args);
+        return 0;
+    }
+    if (args.substep) {
+        benchSubstep(args);
+        return 0;
+    }
+    if (args.sleep) {
+        benchSleep(args);
+        return 0;
+    }
+    if (args.checkpoint)
+        return benchCheckpoint(args) ? 0 : 1;
+    if (args.sweep)
+        return benchSweep(args) ? 0 : 1;
+
+    world w = makeWorld(1280, 720, args.dt, args.mode, args.boundary);
+    worldSpawn(&w, args.restore ? 0 : args.bodies, args.len, args.seed);
+
+    bodySoA soa;
+    if (args.soa)
+        soaFromWorld(&soa, w);
+    sceneConfig cfg;
+    cfg.integrator = args.integrator;
+    cfg.sleep = args.sleepCfg;
+    scene sc = makeScene(w.breite, w.hoehe, w.dt, cfg);
+    jobPool pool;
+    if (args.scene) {
+        soaFromWorld(&sc.bodies, w);
+        sceneSetMaterial(&sc, 1, args.restitution, args.friction);
+        if (args.threads != 1) {
+            poolStart(&pool, args.threads);
+            sc.pool = &pool;
+        }
+    }
+    double restoreSeconds = 0;
+    if (args.restore) {
+        auto r0 = std::chrono::steady_clock::now();
+        checkpointView view;
+        if (!checkpointMap(args.restore, &view)) {
+            std::fprintf(stderr, "%s is not a checkpoint\n", args.restore);
+            return 1;
+        }
+        checkpointRestore(view, &sc);
+        checkpointUnmap(&view);
+        restoreSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - r0).count();
+    }
+    const size_t bodies = args.restore ? sc.bodies.count : args.bodies;
+
+    for (long long i = 0; i < args.warmup; i++) {
+        if (args.soa)
+            soaStep(&soa, w.breite, w.hoehe, w.dt, w.boundary);
+        else if (args.scene)
+            sceneStep(&sc);
+        else
+            worldStep(&w);
+    }
+
+    traceWriter trace;
+    if (args.record && !traceOpen(&trace, args.record, &sc)) {
+        std::fprintf(stderr, "could not create %s\n", args.record);
+        return 1;
+    }
+    profileReset();
+    auto t0 = std::chrono::steady_clock::now();
+    if (args.soa) {
+        for (long long i = 0; i < args.steps; i++)
+            soaStep(&soa, w.breite, w.hoehe, w.dt, w.boundary);
+    }
+    else if (args.scene) {
+        bool recording = args.record != nullptr;
+        for (long long i = 0; i < args.steps; i++) {
+            sceneStep(&sc);
+            if (recording && !traceStep(&trace, sc)) {
+                std::fprintf(stderr, "recording to %s stopped at step %lld, the file could not be extended\n", args.record, i);
+                recording = false;
+            }
+        }
+    }
+    else {
+        for (long long i = 0; i < args.steps; i++)
+            worldStep(&w);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    double secs = std::chrono::duration<double>(t1 - t0).count();
+    double triSteps = (double)args.steps * (double)bodies;
+    std::printf("layout: %s\n", args.soa ? "soa" : args.scene ? "scene" : "aos");
+    if (!args.soa && !args.scene)
+        std::printf("rotation: %s\n", args.mode == ROT_POSE ? "pose" : "vertex");
+    std::printf("boundary: %s\n", args.boundary == BOUNDARY_SWEPT ? "swept" : "discrete");
+    if (args.soa)
+        std::printf("kernels: %s\n", soaKernelName());
+    if (args.scene)
+        std::printf("threads: %u\n", poolThreads(sc.pool));
+    if (args.scene)
+        std::printf("awake: %zu, asleep: %zu\n", sc.stats.awake, sc.stats.asleep);
+    if (args.restore)
+        std::printf("restored from step %lld in %.3f ms\n", sc.steps - args.warmup - args.steps, restoreSeconds * 1e3);
+    std::printf("bodies: %zu\n", bodies);
+    std::printf("steps: %lld\n", args.steps);
+    std::printf("dt: %g\n", args.dt);
+    std::printf("seconds: %.6f\n", secs);
+    std::printf("steps/sec: %.1f\n", args.steps / secs);
+    std::printf("ns per triangle-step: %.3f\n", triSteps > 0 ? secs * 1e9 / triSteps : 0.0);
+    std::printf("checksum: %.6f\n", args.soa ? checksum(soa) : args.scene ? checksum(sc.bodies) : checksum(w));
+    if (args.record) {
+        const double bytes = (double)traceBytes(trace);
+        std::printf("record seconds: %.6f (%.1f %% of the step)\n", trace.seconds, secs > 0 ? 100 * trace.seconds / secs : 0.0);
+        std::printf("trace bytes per body-step: %.2f\n", triSteps > 0 ? bytes / triSteps : 0.0);
+        if (!traceClose(&trace)) {
+            std::fprintf(stderr, "could not write %s\n", args.record);
+            return 1;
+        }
+    }
+    if (sc.pool)
+        poolStop(&pool);
+    return dumpProfile(args) ? 0 : 1;
+}